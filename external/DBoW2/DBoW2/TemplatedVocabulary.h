@@ -3,6 +3,8 @@
  * Added functions: Save and Load from text files without using cv::FileStorage.
  * Date: August 2015
  * Raúl Mur-Artal
+ *
+ * Added functions: Save to a binary file and Load from binary data in memory.
  */
 
 /**
@@ -18,6 +20,8 @@
 #define __D_T_TEMPLATED_VOCABULARY__
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 
 #include <vector>
 #include <numeric>
@@ -246,6 +250,32 @@ public:
    */
   void saveToTextFile(const std::string &filename) const;  
 
+  /**
+   * Loads the vocabulary from data in the format of saveToBinaryFile, for
+   * example a mapped file. The data is copied, it can be released once this
+   * returns.
+   * @param data
+   * @param size bytes of data
+   * @return false if data is not a valid binary vocabulary
+   */
+  bool loadFromBinaryData(const char *data, size_t size);
+
+  /**
+   * Saves the vocabulary into a binary file: a header, the parent, word id
+   * and weight of every node as flat arrays, then the packed descriptors of
+   * the nodes. Native byte order.
+   * @param filename
+   * @return false if the file could not be written
+   */
+  bool saveToBinaryFile(const std::string &filename) const;
+
+  /**
+   * Returns whether data starts with the header of a binary vocabulary
+   * @param data
+   * @param size bytes of data
+   */
+  static bool isBinaryData(const char *data, size_t size);
+
   /**
    * Saves the vocabulary into a file
    * @param filename
@@ -425,9 +455,40 @@ protected:
   /// Words of the vocabulary (tree leaves)
   /// this condition holds: m_words[wid]->word_id == wid
   std::vector<Node*> m_words;
+
+  /// Descriptors of all the nodes, one per row, when loaded from binary
+  /// data. The node descriptors are headers of its rows.
+  cv::Mat m_node_descriptors;
+
+  /// Header of the binary files
+  struct BinaryHeader
+  {
+    char magic[8];
+    uint32_t version;
+    int32_t k;
+    int32_t L;
+    int32_t scoring;
+    int32_t weighting;
+    uint32_t nodes;
+    uint32_t words;
+    uint32_t descriptor_bytes;
+  };
+
+  static const char BINARY_MAGIC[8];
+  static const uint32_t BINARY_VERSION = 1;
+
+  /// Offsets of the arrays that follow the header, 8 byte aligned
+  static size_t binaryParentsOffset();
+  static size_t binaryWordIdsOffset(uint32_t nodes);
+  static size_t binaryWeightsOffset(uint32_t nodes);
+  static size_t binaryDescriptorsOffset(uint32_t nodes);
   
 };
 
+template<class TDescriptor, class F>
+const char TemplatedVocabulary<TDescriptor,F>::BINARY_MAGIC[8] =
+  {'D', 'B', 'o', 'W', '2', 'B', 'I', 'N'};
+
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
@@ -1450,6 +1511,198 @@ void TemplatedVocabulary<TDescriptor,F>::saveToTextFile(const std::string &filen
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::binaryParentsOffset()
+{
+  return (sizeof(BinaryHeader) + 7) / 8 * 8;
+}
+
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::binaryWordIdsOffset(uint32_t nodes)
+{
+  return (binaryParentsOffset() + nodes * sizeof(uint32_t) + 7) / 8 * 8;
+}
+
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::binaryWeightsOffset(uint32_t nodes)
+{
+  return (binaryWordIdsOffset(nodes) + nodes * sizeof(int32_t) + 7) / 8 * 8;
+}
+
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::binaryDescriptorsOffset(
+  uint32_t nodes)
+{
+  return binaryWeightsOffset(nodes) + nodes * sizeof(double);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::isBinaryData(const char *data,
+  size_t size)
+{
+  return size >= sizeof(BinaryHeader) &&
+    memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::loadFromBinaryData(const char *data,
+  size_t size)
+{
+  if(!isBinaryData(data, size))
+  {
+    std::cerr << "Vocabulary loading failure: This is not a binary vocabulary!"
+      << endl;
+    return false;
+  }
+
+  BinaryHeader h;
+  memcpy(&h, data, sizeof(h));
+  if(h.version != BINARY_VERSION || h.k < 0 || h.k > 20 || h.L < 1 ||
+    h.L > 10 || h.scoring < 0 || h.scoring > 5 || h.weighting < 0 ||
+    h.weighting > 3 || h.nodes == 0 || h.words > h.nodes ||
+    h.descriptor_bytes != (uint32_t)F::L ||
+    size < binaryDescriptorsOffset(h.nodes) +
+      (size_t)h.nodes * h.descriptor_bytes)
+  {
+    std::cerr << "Vocabulary loading failure: Wrong binary vocabulary header!"
+      << endl;
+    return false;
+  }
+
+  // The arrays are copied out, data does not need to be aligned
+  std::vector<uint32_t> parents(h.nodes);
+  std::vector<int32_t> word_ids(h.nodes);
+  std::vector<double> weights(h.nodes);
+  memcpy(parents.data(), data + binaryParentsOffset(),
+    h.nodes * sizeof(uint32_t));
+  memcpy(word_ids.data(), data + binaryWordIdsOffset(h.nodes),
+    h.nodes * sizeof(int32_t));
+  memcpy(weights.data(), data + binaryWeightsOffset(h.nodes),
+    h.nodes * sizeof(double));
+
+  // Nodes come after their parent, every word id is used once
+  std::vector<uint32_t> n_children(h.nodes, 0);
+  std::vector<bool> word_used(h.words, false);
+  size_t n_words = 0;
+  bool valid = true;
+  for(uint32_t i = 0; i < h.nodes && valid; ++i)
+  {
+    if(i > 0)
+    {
+      valid = parents[i] < i;
+      if(valid) n_children[parents[i]]++;
+    }
+    if(valid && word_ids[i] >= 0)
+    {
+      valid = (uint32_t)word_ids[i] < h.words && !word_used[word_ids[i]];
+      if(valid) word_used[word_ids[i]] = true;
+      n_words++;
+    }
+  }
+  if(!valid || n_words != h.words)
+  {
+    std::cerr << "Vocabulary loading failure: Corrupted binary vocabulary!"
+      << endl;
+    return false;
+  }
+
+  m_k = h.k;
+  m_L = h.L;
+  m_scoring = (ScoringType)h.scoring;
+  m_weighting = (WeightingType)h.weighting;
+  createScoringObject();
+
+  m_words.clear();
+  m_nodes.clear();
+
+  // A single buffer for all the descriptors instead of one per node
+  m_node_descriptors.create(h.nodes, h.descriptor_bytes, CV_8U);
+  memcpy(m_node_descriptors.data, data + binaryDescriptorsOffset(h.nodes),
+    (size_t)h.nodes * h.descriptor_bytes);
+
+  m_nodes.resize(h.nodes);
+  m_words.resize(h.words);
+  for(uint32_t i = 0; i < h.nodes; ++i)
+  {
+    Node &node = m_nodes[i];
+    node.id = i;
+    node.parent = parents[i];
+    node.weight = weights[i];
+    node.children.reserve(n_children[i]);
+    if(i > 0)
+    {
+      node.descriptor = m_node_descriptors.row(i);
+      m_nodes[node.parent].children.push_back(i);
+    }
+    if(word_ids[i] >= 0)
+    {
+      node.word_id = word_ids[i];
+      m_words[node.word_id] = &node;
+    }
+  }
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::saveToBinaryFile(
+  const std::string &filename) const
+{
+  BinaryHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  h.version = BINARY_VERSION;
+  h.k = m_k;
+  h.L = m_L;
+  h.scoring = m_scoring;
+  h.weighting = m_weighting;
+  h.nodes = m_nodes.size();
+  h.words = m_words.size();
+  h.descriptor_bytes = F::L;
+
+  std::vector<char> buffer(binaryDescriptorsOffset(h.nodes) +
+    (size_t)h.nodes * h.descriptor_bytes, 0);
+  memcpy(buffer.data(), &h, sizeof(h));
+
+  char *parents = buffer.data() + binaryParentsOffset();
+  char *word_ids = buffer.data() + binaryWordIdsOffset(h.nodes);
+  char *weights = buffer.data() + binaryWeightsOffset(h.nodes);
+  char *descriptors = buffer.data() + binaryDescriptorsOffset(h.nodes);
+
+  std::vector<int32_t> node_words(h.nodes, -1);
+  for(size_t i = 0; i < m_words.size(); ++i)
+    node_words[m_words[i]->id] = i;
+
+  for(uint32_t i = 0; i < h.nodes; ++i)
+  {
+    const Node &node = m_nodes[i];
+    const uint32_t parent = node.parent;
+    const int32_t word_id = node_words[i];
+    const double weight = node.weight;
+    memcpy(parents + i * sizeof(parent), &parent, sizeof(parent));
+    memcpy(word_ids + i * sizeof(word_id), &word_id, sizeof(word_id));
+    memcpy(weights + i * sizeof(weight), &weight, sizeof(weight));
+
+    // The root has no descriptor
+    if(i > 0 && node.descriptor.isContinuous() &&
+      node.descriptor.total() * node.descriptor.elemSize() == (size_t)F::L)
+      memcpy(descriptors + (size_t)i * F::L, node.descriptor.data, F::L);
+  }
+
+  ofstream f(filename.c_str(), ios_base::out | ios_base::binary);
+  if(!f.is_open()) return false;
+  f.write(buffer.data(), buffer.size());
+  return f.good();
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::save(const std::string &filename) const
 {
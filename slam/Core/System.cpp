@@ -24,6 +24,9 @@
 #include <iomanip>
 #include <thread>
 
+#include "map/AtlasFile.h"
+#include "threads/FrontEnd.h"
+#include "threads/InputQueue.h"
 #include "utils/Converter.h"
 
 namespace ORB_SLAM3
@@ -38,6 +41,9 @@ System::System(const string& strVocFile,
                const int     initFr,
                const string& strSequence)
     : mSensor(sensor)
+    , mpFrontEnd(nullptr)
+    , mpInputQueue(nullptr)
+    , mInputMode(INPUT_NONE)
     , mbReset(false)
     , mbResetActiveMap(false)
     , mbActivateLocalizationMode(false)
@@ -120,34 +126,41 @@ System::System(const string& strVocFile,
 
     mStrVocabularyFilePath = strVocFile;
 
-    bool loadedAtlas = false;
+    // Load ORB Vocabulary
+    cout << endl
+         << "Loading ORB Vocabulary. This could take a while..." << endl;
 
-    if (mStrLoadAtlasFromFile.empty())
+    std::chrono::steady_clock::time_point tVoc0 =
+        std::chrono::steady_clock::now();
+    mpVocabulary  = new ORBVocabulary();
+    bool bVocLoad = LoadORBVocabulary(mpVocabulary, strVocFile);
+    if (!bVocLoad)
     {
-        // Load ORB Vocabulary
-        cout << endl
-             << "Loading ORB Vocabulary. This could take a while..." << endl;
+        cerr << "Wrong path to vocabulary. " << endl;
+        cerr << "Falied to open at: " << strVocFile << endl;
+        exit(-1);
+    }
+    std::chrono::steady_clock::time_point tVoc1 =
+        std::chrono::steady_clock::now();
+    cout << "Vocabulary loaded in "
+         << std::chrono::duration_cast<std::chrono::duration<double>>(tVoc1 -
+                                                                     tVoc0)
+                .count()
+         << " s!" << endl
+         << endl;
 
-        mpVocabulary  = new ORBVocabulary();
-        bool bVocLoad = mpVocabulary->loadFromTextFile(strVocFile);
-        if (!bVocLoad)
-        {
-            cerr << "Wrong path to vocabulary. " << endl;
-            cerr << "Falied to open at: " << strVocFile << endl;
-            exit(-1);
-        }
-        cout << "Vocabulary loaded!" << endl << endl;
-
-        // Create KeyFrame Database
-        mpKeyFrameDatabase = new KeyFrameDatabase(*mpVocabulary);
+    // Create KeyFrame Database
+    mpKeyFrameDatabase = new KeyFrameDatabase(*mpVocabulary);
 
+    if (mStrLoadAtlasFromFile.empty())
+    {
         // Create the Atlas
         cout << "Initialization of Atlas from scratch " << endl;
         mpAtlas = new Atlas(0);
     }
     else
     {
-        throw std::runtime_error("Not supported atlas type.");
+        LoadAtlas();
     }
 
     if (mSensor == IMU_STEREO || mSensor == IMU_MONOCULAR ||
@@ -175,6 +188,19 @@ System::System(const string& strVocFile,
                          mSensor == IMU_MONOCULAR || mSensor == IMU_STEREO ||
                              mSensor == IMU_RGBD,
                          strSequence);
+    if (settings_)
+    {
+        mpLocalMapper->SetMatchThreads(settings_->matchThreads());
+        mpLocalMapper->mbEpipolarSearch = settings_->epipolarSearch();
+    }
+    else
+    {
+        if (fsSettings["ORBmatcher.nThreads"].isInt())
+            mpLocalMapper->SetMatchThreads(fsSettings["ORBmatcher.nThreads"]);
+        if (fsSettings["ORBmatcher.epipolarSearch"].isInt())
+            mpLocalMapper->mbEpipolarSearch =
+                (int)fsSettings["ORBmatcher.epipolarSearch"];
+    }
     mptLocalMapping = new thread(&ORB_SLAM3::LocalMapping::Run, mpLocalMapper);
     mpLocalMapper->mInitFr = initFr;
     if (settings_)
@@ -209,6 +235,20 @@ System::System(const string& strVocFile,
     mpLoopCloser->SetTracker(mpTracker);
     mpLoopCloser->SetLocalMapper(mpLocalMapper);
 
+    // Launch the pipelined front-end, the input thread starts with the first
+    // submitted frame
+    if (settings_ && settings_->frontEndQueueSize() > 0)
+        mpFrontEnd =
+            new FrontEnd(this, mpTracker, settings_->frontEndQueueSize());
+
+    if (settings_)
+        mpInputQueue = new InputQueue(
+            this,
+            settings_->inputQueueSize(),
+            static_cast<InputQueue::DropPolicy>(settings_->inputDropPolicy()));
+    else
+        mpInputQueue = new InputQueue(this, 1, InputQueue::DROP_OLDEST);
+
     // usleep(10*1000*1000);
 
     // Fix verbosity
@@ -220,6 +260,9 @@ System::System(ORBVocabulary* vocabulary,
                const eSensor  sensor)
     : mSensor(sensor)
     , mpVocabulary(vocabulary)
+    , mpFrontEnd(nullptr)
+    , mpInputQueue(nullptr)
+    , mInputMode(INPUT_NONE)
     , mbReset(false)
     , mbResetActiveMap(false)
     , mbActivateLocalizationMode(false)
@@ -234,10 +277,18 @@ System::System(ORBVocabulary* vocabulary,
         assert(mpKeyFrameDatabase && "Failed to create Keyframe database.");
         std::cout << "Keyframe database has been created." << std::endl;
 
-        // atlas is not loaded from file
-        mpAtlas = new Atlas(0);
-        assert(mpAtlas && "Failed to create atlas.");
-        std::cout << "Atlas has been created." << std::endl;
+        mStrLoadAtlasFromFile = settings_->atlasLoadFile();
+        mStrSaveAtlasToFile   = settings_->atlasSaveFile();
+        if (mStrLoadAtlasFromFile.empty())
+        {
+            mpAtlas = new Atlas(0);
+            assert(mpAtlas && "Failed to create atlas.");
+            std::cout << "Atlas has been created." << std::endl;
+        }
+        else
+        {
+            LoadAtlas();
+        }
     }
 
     // setup imu sensor
@@ -269,6 +320,8 @@ System::System(ORBVocabulary* vocabulary,
                     (mSensor == IMU_RGBD);
         mpLocalMapper = new LocalMapping(this, mpAtlas, bMonocular, bImu, "");
         assert(mpLocalMapper && "Failed to create local mapper.");
+        mpLocalMapper->SetMatchThreads(settings_->matchThreads());
+        mpLocalMapper->mbEpipolarSearch = settings_->epipolarSearch();
         std::cout << "Local mapper has been created." << std::endl;
         mptLocalMapping =
             new thread(&ORB_SLAM3::LocalMapping::Run, mpLocalMapper);
@@ -311,11 +364,28 @@ System::System(ORBVocabulary* vocabulary,
         mpLoopCloser->SetLocalMapper(mpLocalMapper);
     }
 
+    if (settings_->frontEndQueueSize() > 0)
+    {
+        mpFrontEnd =
+            new FrontEnd(this, mpTracker, settings_->frontEndQueueSize());
+        std::cout << "Front-end thread has been created." << std::endl;
+    }
+
+    mpInputQueue = new InputQueue(
+        this,
+        settings_->inputQueueSize(),
+        static_cast<InputQueue::DropPolicy>(settings_->inputDropPolicy()));
+
     {
         Verbose::SetTh(Verbose::VERBOSITY_QUIET);
     }
 }
 
+System::~System()
+{
+    delete mpInputQueue;
+}
+
 Tracking& System::getTracker() const
 {
     return *mpTracker;
@@ -326,6 +396,24 @@ Sophus::SE3f System::TrackStereo(const cv::Mat&            imLeft,
                                  const double&             timestamp,
                                  const vector<IMU::Point>& vImuMeas,
                                  string                    filename)
+{
+    CheckInputMode(INPUT_TRACK);
+    return TrackStereo(imLeft,
+                       imRight,
+                       timestamp,
+                       vImuMeas,
+                       filename,
+                       TrackCallback(),
+                       true);
+}
+
+Sophus::SE3f System::TrackStereo(const cv::Mat&            imLeft,
+                                 const cv::Mat&            imRight,
+                                 const double&             timestamp,
+                                 const vector<IMU::Point>& vImuMeas,
+                                 const string&             filename,
+                                 const TrackCallback&      callback,
+                                 bool                      bCopy)
 {
     if (mSensor != STEREO && mSensor != IMU_STEREO)
     {
@@ -351,57 +439,36 @@ Sophus::SE3f System::TrackStereo(const cv::Mat&            imLeft,
         cv::resize(imLeft, imLeftToFeed, settings_->newImSize());
         cv::resize(imRight, imRightToFeed, settings_->newImSize());
     }
-    else
+    else if (bCopy)
     {
         imLeftToFeed  = imLeft.clone();
         imRightToFeed = imRight.clone();
     }
-
-    // Check mode change
+    else
     {
-        unique_lock<mutex> lock(mMutexMode);
-        if (mbActivateLocalizationMode)
-        {
-            mpLocalMapper->RequestStop();
-
-            // Wait until Local Mapping has effectively stopped
-            while (!mpLocalMapper->isStopped())
-            {
-                // usleep(1000);
-                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            }
-
-            mpTracker->InformOnlyTracking(true);
-            mbActivateLocalizationMode = false;
-        }
-        if (mbDeactivateLocalizationMode)
-        {
-            mpTracker->InformOnlyTracking(false);
-            mpLocalMapper->Release();
-            mbDeactivateLocalizationMode = false;
-        }
+        imLeftToFeed  = imLeft;
+        imRightToFeed = imRight;
     }
 
-    // Check reset
-    {
-        unique_lock<mutex> lock(mMutexReset);
-        if (mbReset)
-        {
-            mpTracker->Reset();
-            mbReset          = false;
-            mbResetActiveMap = false;
-        }
-        else if (mbResetActiveMap)
-        {
-            mpTracker->ResetActiveMap();
-            mbResetActiveMap = false;
-        }
-    }
+    // With the pipelined front-end requests are applied on its thread
+    if (!mpFrontEnd) CheckModeAndReset();
 
     if (mSensor == System::IMU_STEREO)
         for (size_t i_imu = 0; i_imu < vImuMeas.size(); i_imu++)
             mpTracker->GrabImuData(vImuMeas[i_imu]);
 
+    if (mpFrontEnd)
+    {
+        mpFrontEnd->SubmitStereo(imLeftToFeed,
+                                 imRightToFeed,
+                                 timestamp,
+                                 filename,
+                                 callback);
+
+        unique_lock<mutex> lock(mMutexState);
+        return mTrackedTcw;
+    }
+
     // std::cout << "start GrabImageStereo" << std::endl;
     Sophus::SE3f Tcw = mpTracker->GrabImageStereo(imLeftToFeed,
                                                   imRightToFeed,
@@ -410,10 +477,8 @@ Sophus::SE3f System::TrackStereo(const cv::Mat&            imLeft,
 
     // std::cout << "out grabber" << std::endl;
 
-    unique_lock<mutex> lock2(mMutexState);
-    mTrackingState      = mpTracker->mState;
-    mTrackedMapPoints   = mpTracker->mCurrentFrame.mvpMapPoints;
-    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+    const TrackResult result = UpdateTrackingState(Tcw);
+    if (callback) callback(result);
 
     return Tcw;
 }
@@ -423,6 +488,24 @@ Sophus::SE3f System::TrackRGBD(const cv::Mat&            im,
                                const double&             timestamp,
                                const vector<IMU::Point>& vImuMeas,
                                string                    filename)
+{
+    CheckInputMode(INPUT_TRACK);
+    return TrackRGBD(im,
+                     depthmap,
+                     timestamp,
+                     vImuMeas,
+                     filename,
+                     TrackCallback(),
+                     true);
+}
+
+Sophus::SE3f System::TrackRGBD(const cv::Mat&            im,
+                               const cv::Mat&            depthmap,
+                               const double&             timestamp,
+                               const vector<IMU::Point>& vImuMeas,
+                               const string&             filename,
+                               const TrackCallback&      callback,
+                               bool                      bCopy)
 {
     if (mSensor != RGBD && mSensor != IMU_RGBD)
     {
@@ -432,69 +515,47 @@ Sophus::SE3f System::TrackRGBD(const cv::Mat&            im,
         exit(-1);
     }
 
-    cv::Mat imToFeed      = im.clone();
-    cv::Mat imDepthToFeed = depthmap.clone();
+    cv::Mat imToFeed, imDepthToFeed;
     if (settings_ && settings_->needToResize())
     {
-        cv::Mat resizedIm;
-        cv::resize(im, resizedIm, settings_->newImSize());
-        imToFeed = resizedIm;
-
+        cv::resize(im, imToFeed, settings_->newImSize());
         cv::resize(depthmap, imDepthToFeed, settings_->newImSize());
     }
-
-    // Check mode change
+    else if (bCopy)
     {
-        unique_lock<mutex> lock(mMutexMode);
-        if (mbActivateLocalizationMode)
-        {
-            mpLocalMapper->RequestStop();
-
-            // Wait until Local Mapping has effectively stopped
-            while (!mpLocalMapper->isStopped())
-            {
-                // usleep(1000);
-                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            }
-
-            mpTracker->InformOnlyTracking(true);
-            mbActivateLocalizationMode = false;
-        }
-        if (mbDeactivateLocalizationMode)
-        {
-            mpTracker->InformOnlyTracking(false);
-            mpLocalMapper->Release();
-            mbDeactivateLocalizationMode = false;
-        }
+        imToFeed      = im.clone();
+        imDepthToFeed = depthmap.clone();
     }
-
-    // Check reset
+    else
     {
-        unique_lock<mutex> lock(mMutexReset);
-        if (mbReset)
-        {
-            mpTracker->Reset();
-            mbReset          = false;
-            mbResetActiveMap = false;
-        }
-        else if (mbResetActiveMap)
-        {
-            mpTracker->ResetActiveMap();
-            mbResetActiveMap = false;
-        }
+        imToFeed      = im;
+        imDepthToFeed = depthmap;
     }
 
+    // With the pipelined front-end requests are applied on its thread
+    if (!mpFrontEnd) CheckModeAndReset();
+
     if (mSensor == System::IMU_RGBD)
         for (size_t i_imu = 0; i_imu < vImuMeas.size(); i_imu++)
             mpTracker->GrabImuData(vImuMeas[i_imu]);
 
+    if (mpFrontEnd)
+    {
+        mpFrontEnd->SubmitRGBD(imToFeed,
+                               imDepthToFeed,
+                               timestamp,
+                               filename,
+                               callback);
+
+        unique_lock<mutex> lock(mMutexState);
+        return mTrackedTcw;
+    }
+
     Sophus::SE3f Tcw =
         mpTracker->GrabImageRGBD(imToFeed, imDepthToFeed, timestamp, filename);
 
-    unique_lock<mutex> lock2(mMutexState);
-    mTrackingState      = mpTracker->mState;
-    mTrackedMapPoints   = mpTracker->mCurrentFrame.mvpMapPoints;
-    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+    const TrackResult result = UpdateTrackingState(Tcw);
+    if (callback) callback(result);
     return Tcw;
 }
 
@@ -503,6 +564,7 @@ Sophus::SE3f System::TrackMonocular(const cv::Mat&            im,
                                     const vector<IMU::Point>& vImuMeas,
                                     string                    filename)
 {
+    CheckInputMode(INPUT_TRACK);
     {
         unique_lock<mutex> lock(mMutexReset);
         if (mbShutDown)
@@ -511,6 +573,21 @@ Sophus::SE3f System::TrackMonocular(const cv::Mat&            im,
         }
     }
 
+    return TrackMonocular(im,
+                          timestamp,
+                          vImuMeas,
+                          filename,
+                          TrackCallback(),
+                          true);
+}
+
+Sophus::SE3f System::TrackMonocular(const cv::Mat&            im,
+                                    const double&             timestamp,
+                                    const vector<IMU::Point>& vImuMeas,
+                                    const string&             filename,
+                                    const TrackCallback&      callback,
+                                    bool                      bCopy)
+{
     if (mSensor != MONOCULAR && mSensor != IMU_MONOCULAR)
     {
         cerr << "ERROR: you called TrackMonocular but input sensor was not set "
@@ -519,14 +596,181 @@ Sophus::SE3f System::TrackMonocular(const cv::Mat&            im,
         exit(-1);
     }
 
-    cv::Mat imToFeed = im.clone();
+    cv::Mat imToFeed;
     if (settings_ && settings_->needToResize())
+        cv::resize(im, imToFeed, settings_->newImSize());
+    else
+        imToFeed = bCopy ? im.clone() : im;
+
+    // With the pipelined front-end requests are applied on its thread
+    if (!mpFrontEnd) CheckModeAndReset();
+
+    if (mSensor == System::IMU_MONOCULAR)
+        for (size_t i_imu = 0; i_imu < vImuMeas.size(); i_imu++)
+            mpTracker->GrabImuData(vImuMeas[i_imu]);
+
+    if (mpFrontEnd)
     {
-        cv::Mat resizedIm;
-        cv::resize(im, resizedIm, settings_->newImSize());
-        imToFeed = resizedIm;
+        mpFrontEnd->SubmitMonocular(imToFeed, timestamp, filename, callback);
+
+        unique_lock<mutex> lock(mMutexState);
+        return mTrackedTcw;
     }
 
+    Sophus::SE3f Tcw =
+        mpTracker->GrabImageMonocular(imToFeed, timestamp, filename);
+
+    const TrackResult result = UpdateTrackingState(Tcw);
+    if (callback) callback(result);
+
+    // std::cout
+    //     << "Current global map point count: [" <<
+    //     mpAtlas->GetAllMapPoints().size()
+    //     << "]    Current local map point count: [" <<
+    //     mpAtlas->GetReferenceMapPoints().size()
+    //     << "]    Current keyframe count: [" <<
+    //     mpAtlas->GetAllKeyFrames().size()
+    //     << "]" << std::endl;
+
+    return Tcw;
+}
+
+
+std::future<System::TrackResult> System::SubmitStereo(
+    const cv::Mat&            imLeft,
+    const cv::Mat&            imRight,
+    const double&             timestamp,
+    const vector<IMU::Point>& vImuMeas,
+    string                    filename)
+{
+    auto pPromise = std::make_shared<std::promise<TrackResult>>();
+    std::future<TrackResult> future = pPromise->get_future();
+    Submit(imLeft,
+           imRight,
+           timestamp,
+           vImuMeas,
+           [pPromise](const TrackResult& result)
+           {
+               pPromise->set_value(result);
+           },
+           filename);
+    return future;
+}
+
+void System::SubmitStereo(const cv::Mat&            imLeft,
+                          const cv::Mat&            imRight,
+                          const double&             timestamp,
+                          const vector<IMU::Point>& vImuMeas,
+                          TrackCallback             callback,
+                          string                    filename)
+{
+    Submit(imLeft, imRight, timestamp, vImuMeas, callback, filename);
+}
+
+std::future<System::TrackResult> System::SubmitRGBD(
+    const cv::Mat&            im,
+    const cv::Mat&            depthmap,
+    const double&             timestamp,
+    const vector<IMU::Point>& vImuMeas,
+    string                    filename)
+{
+    auto pPromise = std::make_shared<std::promise<TrackResult>>();
+    std::future<TrackResult> future = pPromise->get_future();
+    Submit(im,
+           depthmap,
+           timestamp,
+           vImuMeas,
+           [pPromise](const TrackResult& result)
+           {
+               pPromise->set_value(result);
+           },
+           filename);
+    return future;
+}
+
+void System::SubmitRGBD(const cv::Mat&            im,
+                        const cv::Mat&            depthmap,
+                        const double&             timestamp,
+                        const vector<IMU::Point>& vImuMeas,
+                        TrackCallback             callback,
+                        string                    filename)
+{
+    Submit(im, depthmap, timestamp, vImuMeas, callback, filename);
+}
+
+std::future<System::TrackResult> System::SubmitMonocular(
+    const cv::Mat&            im,
+    const double&             timestamp,
+    const vector<IMU::Point>& vImuMeas,
+    string                    filename)
+{
+    auto pPromise = std::make_shared<std::promise<TrackResult>>();
+    std::future<TrackResult> future = pPromise->get_future();
+    Submit(im,
+           cv::Mat(),
+           timestamp,
+           vImuMeas,
+           [pPromise](const TrackResult& result)
+           {
+               pPromise->set_value(result);
+           },
+           filename);
+    return future;
+}
+
+void System::SubmitMonocular(const cv::Mat&            im,
+                             const double&             timestamp,
+                             const vector<IMU::Point>& vImuMeas,
+                             TrackCallback             callback,
+                             string                    filename)
+{
+    Submit(im, cv::Mat(), timestamp, vImuMeas, callback, filename);
+}
+
+void System::Submit(const cv::Mat&            im,
+                    const cv::Mat&            im2,
+                    const double&             timestamp,
+                    const vector<IMU::Point>& vImuMeas,
+                    TrackCallback             callback,
+                    string                    filename)
+{
+    CheckInputMode(INPUT_SUBMIT);
+
+    // The caller may reuse its buffers as soon as this returns. The input
+    // thread tracks these copies without copying them again.
+    InputQueue::Request request;
+    request.im        = im.clone();
+    request.im2       = im2.clone();
+    request.timestamp = timestamp;
+    request.vImuMeas  = vImuMeas;
+    request.filename  = std::move(filename);
+    request.callback  = std::move(callback);
+    mpInputQueue->Push(std::move(request));
+}
+
+void System::CheckInputMode(InputMode mode)
+{
+    int current = INPUT_NONE;
+    if (mInputMode.compare_exchange_strong(current, mode) || current == mode)
+        return;
+
+    cerr << "ERROR: frames were given to both the Track and the Submit "
+            "functions, they would be tracked on two threads at once."
+         << endl;
+    exit(-1);
+}
+
+System::TrackResult System::DroppedResult(const double& timestamp)
+{
+    TrackResult result;
+    result.timestamp = timestamp;
+    result.state     = GetTrackingState();
+    result.bDropped  = true;
+    return result;
+}
+
+void System::CheckModeAndReset()
+{
     // Check mode change
     {
         unique_lock<mutex> lock(mMutexMode);
@@ -563,37 +807,40 @@ Sophus::SE3f System::TrackMonocular(const cv::Mat&            im,
         }
         else if (mbResetActiveMap)
         {
-            cout << "SYSTEM-> Reseting active map in monocular case" << endl;
+            if (mSensor == MONOCULAR || mSensor == IMU_MONOCULAR)
+                cout << "SYSTEM-> Reseting active map in monocular case"
+                     << endl;
             mpTracker->ResetActiveMap();
             mbResetActiveMap = false;
         }
     }
+}
 
-    if (mSensor == System::IMU_MONOCULAR)
-        for (size_t i_imu = 0; i_imu < vImuMeas.size(); i_imu++)
-            mpTracker->GrabImuData(vImuMeas[i_imu]);
-
-    Sophus::SE3f Tcw =
-        mpTracker->GrabImageMonocular(imToFeed, timestamp, filename);
-
-    unique_lock<mutex> lock2(mMutexState);
+System::TrackResult System::UpdateTrackingState(const Sophus::SE3f& Tcw)
+{
+    unique_lock<mutex> lock(mMutexState);
     mTrackingState      = mpTracker->mState;
-    mTrackedMapPoints   = mpTracker->mCurrentFrame.mvpMapPoints;
-    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+    mTrackedMapPoints   = mpTracker->mpCurrentFrame->mvpMapPoints;
+    mTrackedKeyPointsUn = mpTracker->mpCurrentFrame->mvKeysUn;
+    mTrackedTcw         = Tcw;
+
+    TrackResult result;
+    result.timestamp = mpTracker->mpCurrentFrame->mTimeStamp;
+    result.Tcw       = Tcw;
+    result.state     = mTrackingState;
+    result.bDropped  = false;
+    return result;
+}
 
-    // std::cout
-    //     << "Current global map point count: [" <<
-    //     mpAtlas->GetAllMapPoints().size()
-    //     << "]    Current local map point count: [" <<
-    //     mpAtlas->GetReferenceMapPoints().size()
-    //     << "]    Current keyframe count: [" <<
-    //     mpAtlas->GetAllKeyFrames().size()
-    //     << "]" << std::endl;
+System::TrackResult System::TrackPreparedFrame(Frame&         frame,
+                                               const cv::Mat& imGray,
+                                               const string&  filename)
+{
+    CheckModeAndReset();
 
-    return Tcw;
+    return UpdateTrackingState(mpTracker->TrackFrame(frame, imGray, filename));
 }
 
-
 void System::ActivateLocalizationMode()
 {
     unique_lock<mutex> lock(mMutexMode);
@@ -640,6 +887,12 @@ void System::Shutdown()
 
     cout << "Shutdown" << endl;
 
+    // Track the frames still queued before stopping the other threads. The
+    // frames submitted from now on are dropped by the queue.
+    mpInputQueue->Close();
+    delete mpFrontEnd;
+    mpFrontEnd = nullptr;
+
     mpLocalMapper->RequestFinish();
     mpLoopCloser->RequestFinish();
 
@@ -648,6 +901,31 @@ void System::Shutdown()
 
     delete mptLocalMapping;
     delete mptLoopClosing;
+
+    if (!mStrSaveAtlasToFile.empty())
+    {
+        cout << "Saving the atlas to " << mStrSaveAtlasToFile << endl;
+        AtlasFile::Save(mpAtlas, mpVocabulary, mStrSaveAtlasToFile);
+    }
+}
+
+void System::LoadAtlas()
+{
+    cout << "Initialization of Atlas from file: " << mStrLoadAtlasFromFile
+         << endl;
+    mpAtlas = AtlasFile::Load(mStrLoadAtlasFromFile,
+                              mpVocabulary,
+                              mpKeyFrameDatabase);
+    if (!mpAtlas)
+    {
+        cerr << "Failed to load the atlas from: " << mStrLoadAtlasFromFile
+             << endl;
+        exit(-1);
+    }
+
+    // Tracking starts a new map, merged with the loaded ones when they are
+    // recognized
+    mpAtlas->CreateNewMap();
 }
 
 bool System::isShutDown()
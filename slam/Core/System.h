@@ -23,7 +23,10 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 // #include <unistd.h>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
@@ -75,9 +78,14 @@ class Tracking;
 class LocalMapping;
 class LoopClosing;
 class Settings;
+class FrontEnd;
+class InputQueue;
 
 class System
 {
+    friend class FrontEnd;
+    friend class InputQueue;
+
 public:
     // Input sensor
     enum eSensor
@@ -97,6 +105,17 @@ public:
         BINARY_FILE = 1,
     };
 
+    // Result of a frame given to the Submit functions
+    struct TrackResult
+    {
+        double       timestamp;
+        Sophus::SE3f Tcw;       // Empty if tracking failed
+        int          state;     // Tracking::eTrackingState
+        bool         bDropped;  // Dropped before tracking by the input queue
+    };
+
+    using TrackCallback = std::function<void(const TrackResult&)>;
+
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     // Initialize the SLAM system. It launches the Local Mapping, Loop Closing
@@ -110,6 +129,9 @@ public:
 
     System(ORBVocabulary* vocabulary, Settings* settings, const eSensor sensor);
 
+    // Only frees the input queue, Shutdown stops the threads
+    ~System();
+
     // Proccess the given stereo frame. Images must be synchronized and
     // rectified. Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is
     // converted to grayscale. Returns the camera pose (empty if tracking
@@ -135,6 +157,11 @@ public:
     // Proccess the given monocular frame and optionally imu data
     // Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to
     // grayscale. Returns the camera pose (empty if tracking fails).
+    //
+    // With System.frontEndQueueSize > 0 the Track functions only extract the
+    // features of the frame, which is tracked on the front-end thread while
+    // the next one is extracted. They block while the queue is full and
+    // return the pose of the last tracked frame, one frame behind the input.
     Sophus::SE3f TrackMonocular(
         const cv::Mat&            im,
         const double&             timestamp,
@@ -142,6 +169,60 @@ public:
         string                    filename = "");
 
 
+    // Non-blocking versions of the Track functions. Images are copied and
+    // queued for the input thread. When System.inputQueueSize frames are
+    // already waiting, frames are dropped according to System.inputDropPolicy:
+    // DropOldest drops the oldest waiting frame, KeepLatest all of them. The
+    // IMU measurements of dropped frames are handed to the next frame.
+    // The result is returned through the future or given to callback, which
+    // must return quickly. It is called from a SLAM thread once the frame is
+    // tracked, and from the thread calling Submit when the frame is dropped:
+    // the thread whose frame took its place in the queue, or any thread after
+    // Shutdown.
+    //
+    // A System takes its frames either from the Track or from the Submit
+    // functions, the input thread would otherwise run Tracking at the same
+    // time as the caller. Calling the other kind is an error and exits.
+    std::future<TrackResult> SubmitStereo(
+        const cv::Mat&            imLeft,
+        const cv::Mat&            imRight,
+        const double&             timestamp,
+        const vector<IMU::Point>& vImuMeas = vector<IMU::Point>(),
+        string                    filename = "");
+
+    void SubmitStereo(const cv::Mat&            imLeft,
+                      const cv::Mat&            imRight,
+                      const double&             timestamp,
+                      const vector<IMU::Point>& vImuMeas,
+                      TrackCallback             callback,
+                      string                    filename = "");
+
+    std::future<TrackResult> SubmitRGBD(
+        const cv::Mat&            im,
+        const cv::Mat&            depthmap,
+        const double&             timestamp,
+        const vector<IMU::Point>& vImuMeas = vector<IMU::Point>(),
+        string                    filename = "");
+
+    void SubmitRGBD(const cv::Mat&            im,
+                    const cv::Mat&            depthmap,
+                    const double&             timestamp,
+                    const vector<IMU::Point>& vImuMeas,
+                    TrackCallback             callback,
+                    string                    filename = "");
+
+    std::future<TrackResult> SubmitMonocular(
+        const cv::Mat&            im,
+        const double&             timestamp,
+        const vector<IMU::Point>& vImuMeas = vector<IMU::Point>(),
+        string                    filename = "");
+
+    void SubmitMonocular(const cv::Mat&            im,
+                         const double&             timestamp,
+                         const vector<IMU::Point>& vImuMeas,
+                         TrackCallback             callback,
+                         string                    filename = "");
+
     // This stops local mapping thread (map building) and performs only camera
     // tracking.
     void ActivateLocalizationMode();
@@ -215,6 +296,70 @@ public:
     int getTrackingState() const { return mTrackingState; }
 
 private:
+    // Atlas of mStrLoadAtlasFromFile, exits if it cannot be loaded
+    void LoadAtlas();
+
+    // Track functions behind the public ones and the input queue. callback,
+    // if any, is given the result of this frame once it has been tracked.
+    // Images are copied if bCopy, else they are kept as they are and the
+    // caller must not write to them any more.
+    Sophus::SE3f TrackStereo(const cv::Mat&            imLeft,
+                             const cv::Mat&            imRight,
+                             const double&             timestamp,
+                             const vector<IMU::Point>& vImuMeas,
+                             const string&             filename,
+                             const TrackCallback&      callback,
+                             bool                      bCopy);
+
+    Sophus::SE3f TrackRGBD(const cv::Mat&            im,
+                           const cv::Mat&            depthmap,
+                           const double&             timestamp,
+                           const vector<IMU::Point>& vImuMeas,
+                           const string&             filename,
+                           const TrackCallback&      callback,
+                           bool                      bCopy);
+
+    Sophus::SE3f TrackMonocular(const cv::Mat&            im,
+                                const double&             timestamp,
+                                const vector<IMU::Point>& vImuMeas,
+                                const string&             filename,
+                                const TrackCallback&      callback,
+                                bool                      bCopy);
+
+    // Queue a copy of the images for the input thread, which drops them at
+    // once after shutdown
+    void Submit(const cv::Mat&            im,
+                const cv::Mat&            im2,
+                const double&             timestamp,
+                const vector<IMU::Point>& vImuMeas,
+                TrackCallback             callback,
+                string                    filename);
+
+    // Result given to the callback of a frame that is not tracked
+    TrackResult DroppedResult(const double& timestamp);
+
+    // Frames come from the Track or from the Submit functions, see above
+    enum InputMode
+    {
+        INPUT_NONE   = 0,
+        INPUT_TRACK  = 1,
+        INPUT_SUBMIT = 2
+    };
+
+    // Exits if frames were already given through the other kind of function
+    void CheckInputMode(InputMode mode);
+
+    // Apply the pending localization mode change and reset requests
+    void CheckModeAndReset();
+
+    // Copy the tracking result of the current frame for the getters
+    TrackResult UpdateTrackingState(const Sophus::SE3f& Tcw);
+
+    // Tracking stage of the pipelined front-end
+    TrackResult TrackPreparedFrame(Frame&             frame,
+                                   const cv::Mat&     imGray,
+                                   const std::string& filename);
+
     // Input sensor
     eSensor mSensor;
 
@@ -243,6 +388,14 @@ private:
     // a new thread) afterwards.
     LoopClosing* mpLoopCloser;
 
+    // Pipelined front-end, null when frames are tracked on the caller thread
+    FrontEnd* mpFrontEnd;
+
+    // Input queue and thread of the Submit functions. Closed by Shutdown but
+    // only deleted with the System, a Submit may still be using it.
+    InputQueue*      mpInputQueue;
+    std::atomic<int> mInputMode;
+
     // System threads: Local Mapping, Loop Closing, Viewer.
     // The Tracking thread "lives" in the main execution thread that creates the
     // System object.
@@ -267,6 +420,7 @@ private:
     int                       mTrackingState;
     std::vector<MapPoint*>    mTrackedMapPoints;
     std::vector<cv::KeyPoint> mTrackedKeyPointsUn;
+    Sophus::SE3f              mTrackedTcw;
     std::mutex                mMutexState;
 
     //
@@ -0,0 +1,217 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "feature/ORBVocabulary.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "utils/MappedFile.h"
+
+namespace ORB_SLAM3
+{
+
+ORBVocabulary::ORBVocabulary()
+    : mnMaxChildren(0), mKernelLevel(ORBkernels::DetectLevel())
+{
+}
+
+bool ORBVocabulary::loadFromTextFile(const std::string& filename)
+{
+    if (!Base::loadFromTextFile(filename)) return false;
+    Flatten();
+    return true;
+}
+
+bool ORBVocabulary::loadFromBinaryData(const char* data, size_t size)
+{
+    if (!Base::loadFromBinaryData(data, size)) return false;
+    Flatten();
+    return true;
+}
+
+void ORBVocabulary::Flatten()
+{
+    mvNodeDescriptors.clear();
+    mvFirstChild.clear();
+    mvNumChildren.clear();
+    mvWordId.clear();
+    mvWeight.clear();
+    mvNodeId.clear();
+    mnMaxChildren = 0;
+
+    if (m_nodes.empty()) return;
+
+    // Breadth-first order, the children of a node are queued together
+    std::vector<DBoW2::NodeId> vOrder;
+    vOrder.reserve(m_nodes.size());
+    vOrder.push_back(0);
+
+    const size_t N = m_nodes.size();
+    mvNodeDescriptors.resize(N);
+    mvFirstChild.resize(N);
+    mvNumChildren.resize(N);
+    mvWordId.resize(N);
+    mvWeight.resize(N);
+    mvNodeId.resize(N);
+
+    for (size_t i = 0; i < vOrder.size(); ++i)
+    {
+        const Node& node = m_nodes[vOrder[i]];
+
+        if (node.descriptor.empty())  // root
+            mvNodeDescriptors[i] = ORBkernels::Descriptor();
+        else
+            mvNodeDescriptors[i] = ORBkernels::PackDescriptor(node.descriptor);
+
+        mvFirstChild[i]  = (uint32_t)vOrder.size();
+        mvNumChildren[i] = (uint32_t)node.children.size();
+        mvWordId[i]      = node.isLeaf() ? node.word_id : 0;
+        mvWeight[i]      = node.isLeaf() ? node.weight : 0;
+        mvNodeId[i]      = node.id;
+
+        mnMaxChildren = std::max(mnMaxChildren, (int)node.children.size());
+        vOrder.insert(vOrder.end(), node.children.begin(), node.children.end());
+    }
+}
+
+void ORBVocabulary::transform(
+    const std::vector<DBoW2::FORB::TDescriptor>& features,
+    DBoW2::BowVector&                            v,
+    DBoW2::FeatureVector&                        fv,
+    int                                          levelsup) const
+{
+    // Built with create() and not reloaded, only the DBoW2 tree exists
+    if (mvNodeDescriptors.empty())
+    {
+        Base::transform(features, v, fv, levelsup);
+        return;
+    }
+
+    std::vector<ORBkernels::Descriptor> vPacked(features.size());
+    for (size_t i = 0; i < features.size(); ++i)
+        vPacked[i] = ORBkernels::PackDescriptor(features[i]);
+
+    transform(vPacked, v, fv, levelsup);
+}
+
+void ORBVocabulary::transform(
+    const std::vector<ORBkernels::Descriptor>& features,
+    DBoW2::BowVector&                          v,
+    DBoW2::FeatureVector&                      fv,
+    int                                        levelsup) const
+{
+    if (mvNodeDescriptors.empty())
+    {
+        std::vector<DBoW2::FORB::TDescriptor> vDesc(features.size());
+        for (size_t i = 0; i < features.size(); ++i)
+            vDesc[i] = cv::Mat(1, 32, CV_8U, (void*)features[i].w).clone();
+        Base::transform(vDesc, v, fv, levelsup);
+        return;
+    }
+
+    v.clear();
+    fv.clear();
+
+    if (empty()) return;
+
+    const int N = (int)features.size();
+
+    // Flat node reached by every feature, and its DBoW2 node at nid_level
+    std::vector<uint32_t>      vNode(N, 0);
+    std::vector<DBoW2::NodeId> vNid(N, 0);
+    const int                  nid_level = m_L - levelsup;
+
+    std::vector<int> vActive(N);
+    std::iota(vActive.begin(), vActive.end(), 0);
+
+    std::vector<int> vDist(mnMaxChildren);
+
+    // One level of the tree for all the features still on an inner node.
+    // Ties keep the first child, as DBoW2 does.
+    for (int level = 1; !vActive.empty(); ++level)
+    {
+        size_t nActive = 0;
+        for (const int i : vActive)
+        {
+            const uint32_t first = mvFirstChild[vNode[i]];
+            const int      n     = (int)mvNumChildren[vNode[i]];
+
+            ORBkernels::Distances(features[i],
+                                  &mvNodeDescriptors[first],
+                                  n,
+                                  mKernelLevel,
+                                  vDist.data());
+
+            int best = 0;
+            for (int c = 1; c < n; ++c)
+                if (vDist[c] < vDist[best]) best = c;
+
+            vNode[i] = first + best;
+            if (level == nid_level) vNid[i] = mvNodeId[vNode[i]];
+
+            if (mvNumChildren[vNode[i]] > 0) vActive[nActive++] = i;
+        }
+        vActive.resize(nActive);
+    }
+
+    DBoW2::LNorm norm;
+    const bool   must = m_scoring_object->mustNormalize(norm);
+    const bool   bTF =
+        m_weighting == DBoW2::TF || m_weighting == DBoW2::TF_IDF;
+
+    for (int i = 0; i < N; ++i)
+    {
+        const DBoW2::WordValue w = mvWeight[vNode[i]];
+        if (w <= 0) continue;  // stopped
+
+        if (bTF)
+            v.addWeight(mvWordId[vNode[i]], w);
+        else
+            v.addIfNotExist(mvWordId[vNode[i]], w);
+        fv.addFeature(vNid[i], i);
+    }
+
+    if (bTF && !v.empty() && !must)
+    {
+        // unnecessary when normalizing
+        const double nd = v.size();
+        for (DBoW2::BowVector::iterator vit = v.begin(); vit != v.end(); vit++)
+            vit->second /= nd;
+    }
+
+    if (must) v.normalize(norm);
+}
+
+bool LoadORBVocabulary(ORBVocabulary* pVoc, const std::string& filename)
+{
+    MappedFile file;
+    if (!file.Open(filename)) return false;
+
+    if (ORBVocabulary::isBinaryData(file.Data(), file.Size()))
+        return pVoc->loadFromBinaryData(file.Data(), file.Size());
+
+    file.Close();
+    return pVoc->loadFromTextFile(filename);
+}
+
+}  // namespace ORB_SLAM3
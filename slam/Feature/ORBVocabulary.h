@@ -23,14 +23,70 @@
 #ifndef ORBVOCABULARY_H
 #define ORBVOCABULARY_H
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include <DBoW2/FORB.h>
 #include <DBoW2/TemplatedVocabulary.h>
 
+#include "feature/ORBkernels.h"
+
 namespace ORB_SLAM3
 {
 
-using ORBVocabulary =
-    DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB>;
+// DBoW2 vocabulary of ORB descriptors. After loading, the tree is copied to a
+// flat breadth-first layout where the children of a node are contiguous, with
+// their descriptors packed in 256 bits, so that all the k children are scored
+// by one ORBkernels::Distances call. transform walks this copy and gives the
+// same words, weights and direct index nodes as the DBoW2 tree.
+class ORBVocabulary
+    : public DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB>
+{
+public:
+    typedef DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB>
+        Base;
+
+    ORBVocabulary();
+
+    // Load as the base class does, then build the flat tree.
+    bool loadFromTextFile(const std::string& filename);
+    bool loadFromBinaryData(const char* data, size_t size);
+
+    using Base::transform;
+
+    void transform(const std::vector<DBoW2::FORB::TDescriptor>& features,
+                   DBoW2::BowVector&                            v,
+                   DBoW2::FeatureVector&                        fv,
+                   int levelsup) const override;
+
+    // Same as above from the packed descriptors of a frame. All of them go
+    // down the tree together, one level at a time.
+    void transform(const std::vector<ORBkernels::Descriptor>& features,
+                   DBoW2::BowVector&                          v,
+                   DBoW2::FeatureVector&                      fv,
+                   int                                        levelsup) const;
+
+private:
+    void Flatten();
+
+    // Flat nodes in breadth-first order, the root first.
+    std::vector<ORBkernels::Descriptor> mvNodeDescriptors;
+    std::vector<uint32_t>               mvFirstChild;
+    std::vector<uint32_t>               mvNumChildren;
+    std::vector<DBoW2::WordId>          mvWordId;
+    std::vector<DBoW2::WordValue>       mvWeight;
+    // Id of the node in the DBoW2 tree, used for the FeatureVector
+    std::vector<DBoW2::NodeId> mvNodeId;
+
+    int               mnMaxChildren;
+    ORBkernels::Level mKernelLevel;
+};
+
+// Loads pVoc from a binary vocabulary (ORBVocabulary::saveToBinaryFile),
+// mapped in memory, or from the text one otherwise. False if the file cannot
+// be read.
+bool LoadORBVocabulary(ORBVocabulary* pVoc, const std::string& filename);
 
 }  // namespace ORB_SLAM3
 
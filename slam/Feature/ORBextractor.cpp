@@ -56,6 +56,8 @@
 
 
 #include "feature/ORBextractor.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -75,42 +77,33 @@ const int HALF_PATCH_SIZE = 32;
 const int EDGE_THRESHOLD  = 19;
 
 
-static float IC_Angle(const Mat& image, Point2f pt, const vector<int>& u_max)
+static float IC_Angle(const Mat&         image,
+                      Point2f            pt,
+                      const vector<int>& u_max,
+                      ORBkernels::Level  level)
 {
-    int m_01 = 0, m_10 = 0;
+    int m_01, m_10;
 
     const uchar* center = &image.at<uchar>(cvRound(pt.y), cvRound(pt.x));
 
-    // Treat the center line differently, v=0
-    for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
-        m_10 += u * center[u];
-
-    // Go line by line in the circuI853lar patch
-    int step = (int)image.step1();
-    for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
-    {
-        // Proceed over the two lines
-        int v_sum = 0;
-        int d     = u_max[v];
-        for (int u = -d; u <= d; ++u)
-        {
-            int val_plus  = center[u + v * step],
-                val_minus = center[u - v * step];
-            v_sum += (val_plus - val_minus);
-            m_10 += u * (val_plus + val_minus);
-        }
-        m_01 += v * v_sum;
-    }
+    ORBkernels::ICMoments(center,
+                          (int)image.step1(),
+                          &u_max[0],
+                          HALF_PATCH_SIZE,
+                          level,
+                          m_01,
+                          m_10);
 
     return fastAtan2((float)m_01, (float)m_10);
 }
 
 
 const float factorPI = (float)(CV_PI / 180.f);
-static void computeOrbDescriptor(const KeyPoint& kpt,
-                                 const Mat&      img,
-                                 const Point*    pattern,
-                                 uchar*          desc)
+static void computeOrbDescriptor(const KeyPoint&            kpt,
+                                 const Mat&                 img,
+                                 const ORBkernels::Pattern& pattern,
+                                 ORBkernels::Level          level,
+                                 uchar*                     desc)
 {
     float angle = (float)kpt.angle * factorPI;
     float a = (float)cos(angle), b = (float)sin(angle);
@@ -118,43 +111,7 @@ static void computeOrbDescriptor(const KeyPoint& kpt,
     const uchar* center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
     const int    step   = (int)img.step;
 
-#define GET_VALUE(idx)                                               \
-    center[cvRound(pattern[idx].x * b + pattern[idx].y * a) * step + \
-           cvRound(pattern[idx].x * a - pattern[idx].y * b)]
-
-
-    for (int i = 0; i < 32; ++i, pattern += 16)
-    {
-        int t0, t1, val;
-        t0  = GET_VALUE(0);
-        t1  = GET_VALUE(1);
-        val = t0 < t1;
-        t0  = GET_VALUE(2);
-        t1  = GET_VALUE(3);
-        val |= (t0 < t1) << 1;
-        t0 = GET_VALUE(4);
-        t1 = GET_VALUE(5);
-        val |= (t0 < t1) << 2;
-        t0 = GET_VALUE(6);
-        t1 = GET_VALUE(7);
-        val |= (t0 < t1) << 3;
-        t0 = GET_VALUE(8);
-        t1 = GET_VALUE(9);
-        val |= (t0 < t1) << 4;
-        t0 = GET_VALUE(10);
-        t1 = GET_VALUE(11);
-        val |= (t0 < t1) << 5;
-        t0 = GET_VALUE(12);
-        t1 = GET_VALUE(13);
-        val |= (t0 < t1) << 6;
-        t0 = GET_VALUE(14);
-        t1 = GET_VALUE(15);
-        val |= (t0 < t1) << 7;
-
-        desc[i] = (uchar)val;
-    }
-
-#undef GET_VALUE
+    ORBkernels::OrbDescriptor(center, step, a, b, pattern, level, desc);
 }
 
 
@@ -447,6 +404,7 @@ ORBextractor::ORBextractor(int   _nfeatures,
     }
 
     mvImagePyramid.resize(nlevels);
+    mvPrevImagePyramid.resize(nlevels);
 
     mnFeaturesPerLevel.resize(nlevels);
     float factor = 1.0f / scaleFactor;
@@ -463,9 +421,35 @@ ORBextractor::ORBextractor(int   _nfeatures,
     }
     mnFeaturesPerLevel[nlevels - 1] = std::max(nfeatures - sumFeatures, 0);
 
+    // Working memory, the octree may keep a few more nodes than requested
+    mvPyramidBuffer.resize(nlevels);
+    mvPrevPyramidBuffer.resize(nlevels);
+    mvGrids.resize(nlevels);
+    mvLevelScratch.resize(nlevels);
+    mvAllKeypoints.resize(nlevels);
+    for (int level = 0; level < nlevels; level++)
+    {
+        const int nMaxLevel = 2 * mnFeaturesPerLevel[level] + 4;
+
+        LevelScratch& scratch = mvLevelScratch[level];
+        scratch.vToDistributeKeys.reserve(nfeatures * 10);
+        scratch.vSizeAndPointerToNode.reserve(nMaxLevel);
+        scratch.vPrevSizeAndPointerToNode.reserve(nMaxLevel);
+        scratch.vLeaves.reserve(nMaxLevel);
+        scratch.vNextLeaves.reserve(nMaxLevel);
+        scratch.vToSplit.reserve(nMaxLevel);
+        scratch.descriptors.create(nMaxLevel, 32, CV_8U);
+
+        mvAllKeypoints[level].reserve(nMaxLevel);
+    }
+
     const int    npoints  = 512;
     const Point* pattern0 = (const Point*)bit_pattern_31_;
     std::copy(pattern0, pattern0 + npoints, std::back_inserter(pattern));
+    ORBkernels::BuildPattern(pattern0, mPattern);
+
+    mKernelLevel  = ORBkernels::DetectLevel();
+    mDistribution = DISTRIBUTE_OCTREE;
 
     // This is for orientation
     //  pre-compute the end of a row in a circular patch
@@ -487,21 +471,66 @@ ORBextractor::ORBextractor(int   _nfeatures,
 
 static void computeOrientation(const Mat&         image,
                                vector<KeyPoint>&  keypoints,
-                               const vector<int>& umax)
+                               const vector<int>& umax,
+                               ORBkernels::Level  level)
 {
     for (vector<KeyPoint>::iterator keypoint    = keypoints.begin(),
                                     keypointEnd = keypoints.end();
          keypoint != keypointEnd;
          ++keypoint)
     {
-        keypoint->angle = IC_Angle(image, keypoint->pt, umax);
+        keypoint->angle = IC_Angle(image, keypoint->pt, umax, level);
     }
 }
 
-void ExtractorNode::DivideNode(ExtractorNode& n1,
-                               ExtractorNode& n2,
-                               ExtractorNode& n3,
-                               ExtractorNode& n4)
+// True if the mask has a non zero pixel in [x0, x1) x [y0, y1). maskSum is
+// the integral image of the mask.
+static bool AnyInMask(const Mat& maskSum,
+                      float      x0,
+                      float      y0,
+                      float      x1,
+                      float      y1)
+{
+    const int c0 = std::max(cvFloor(x0), 0);
+    const int r0 = std::max(cvFloor(y0), 0);
+    const int c1 = std::min(cvCeil(x1), maskSum.cols - 1);
+    const int r1 = std::min(cvCeil(y1), maskSum.rows - 1);
+
+    if (c0 >= c1 || r0 >= r1) return false;
+
+    return maskSum.at<double>(r1, c1) - maskSum.at<double>(r0, c1) -
+               maskSum.at<double>(r1, c0) + maskSum.at<double>(r0, c0) >
+           0;
+}
+
+static bool InMask(const Mat& mask, float x, float y)
+{
+    const int c = std::min(std::max(cvRound(x), 0), mask.cols - 1);
+    const int r = std::min(std::max(cvRound(y), 0), mask.rows - 1);
+    return mask.at<uchar>(r, c) != 0;
+}
+
+void ORBextractor::SetNumThreads(int nThreads)
+{
+    if (nThreads > 1)
+        mpThreadPool.reset(new ThreadPool(nThreads));
+    else
+        mpThreadPool.reset();
+}
+
+void ORBextractor::SetKernelLevel(ORBkernels::Level level)
+{
+    // Never go above what the CPU supports
+    mKernelLevel = std::min(level, ORBkernels::DetectLevel());
+}
+
+void ExtractorNode::DivideNode(ExtractorNode&              n1,
+                               ExtractorNode&              n2,
+                               ExtractorNode&              n3,
+                               ExtractorNode&              n4,
+                               const vector<cv::KeyPoint>& vKeys,
+                               vector<int>&                vIndices,
+                               vector<int>&                vBuffer)
 {
     const int halfX = ceil(static_cast<float>(UR.x - UL.x) / 2);
     const int halfY = ceil(static_cast<float>(BR.y - UL.y) / 2);
@@ -511,47 +540,53 @@ void ExtractorNode::DivideNode(ExtractorNode& n1,
     n1.UR = cv::Point2i(UL.x + halfX, UL.y);
     n1.BL = cv::Point2i(UL.x, UL.y + halfY);
     n1.BR = cv::Point2i(UL.x + halfX, UL.y + halfY);
-    n1.vKeys.reserve(vKeys.size());
 
     n2.UL = n1.UR;
     n2.UR = UR;
     n2.BL = n1.BR;
     n2.BR = cv::Point2i(UR.x, UL.y + halfY);
-    n2.vKeys.reserve(vKeys.size());
 
     n3.UL = n1.BL;
     n3.UR = n1.BR;
     n3.BL = BL;
     n3.BR = cv::Point2i(n1.BR.x, BL.y);
-    n3.vKeys.reserve(vKeys.size());
 
     n4.UL = n3.UR;
     n4.UR = n2.BR;
     n4.BL = n3.BR;
     n4.BR = BR;
-    n4.vKeys.reserve(vKeys.size());
 
     // Associate points to childs
-    for (size_t i = 0; i < vKeys.size(); i++)
+    auto childOf = [&](const cv::KeyPoint& kp)
     {
-        const cv::KeyPoint& kp = vKeys[i];
-        if (kp.pt.x < n1.UR.x)
-        {
-            if (kp.pt.y < n1.BR.y)
-                n1.vKeys.push_back(kp);
-            else
-                n3.vKeys.push_back(kp);
-        }
-        else if (kp.pt.y < n1.BR.y)
-            n2.vKeys.push_back(kp);
-        else
-            n4.vKeys.push_back(kp);
+        if (kp.pt.x < n1.UR.x) return kp.pt.y < n1.BR.y ? 0 : 2;
+        return kp.pt.y < n1.BR.y ? 1 : 3;
+    };
+
+    int vCount[4] = {0, 0, 0, 0};
+    for (int i = nBegin; i < nEnd; i++) vCount[childOf(vKeys[vIndices[i]])]++;
+
+    ExtractorNode* vpChilds[4] = {&n1, &n2, &n3, &n4};
+    int            vPos[4];
+    int            first = nBegin;
+    for (int c = 0; c < 4; c++)
+    {
+        vpChilds[c]->nBegin = first;
+        vpChilds[c]->nEnd   = first + vCount[c];
+        vPos[c]             = first;
+        first += vCount[c];
     }
 
-    if (n1.vKeys.size() == 1) n1.bNoMore = true;
-    if (n2.vKeys.size() == 1) n2.bNoMore = true;
-    if (n3.vKeys.size() == 1) n3.bNoMore = true;
-    if (n4.vKeys.size() == 1) n4.bNoMore = true;
+    for (int i = nBegin; i < nEnd; i++)
+        vBuffer[vPos[childOf(vKeys[vIndices[i]])]++] = vIndices[i];
+    std::copy(vBuffer.begin() + nBegin,
+              vBuffer.begin() + nEnd,
+              vIndices.begin() + nBegin);
+
+    if (n1.Size() == 1) n1.bNoMore = true;
+    if (n2.Size() == 1) n2.bNoMore = true;
+    if (n3.Size() == 1) n3.bNoMore = true;
+    if (n4.Size() == 1) n4.bNoMore = true;
 }
 
 static bool compareNodes(pair<int, ExtractorNode*>& e1,
@@ -578,56 +613,140 @@ static bool compareNodes(pair<int, ExtractorNode*>& e1,
     }
 }
 
-vector<cv::KeyPoint> ORBextractor::DistributeOctTree(
+// Move the node pointed by lit back to the free list, returns the next node.
+static list<ExtractorNode>::iterator ReleaseNode(
+    list<ExtractorNode>&          lNodes,
+    list<ExtractorNode>&          lFreeNodes,
+    list<ExtractorNode>::iterator lit)
+{
+    list<ExtractorNode>::iterator next = lit;
+    ++next;
+    lFreeNodes.splice(lFreeNodes.end(), lNodes, lit);
+    return next;
+}
+
+// Divide node into the first four nodes of the free list. The children that
+// contain points are moved to the front of lNodes, the ones with more than
+// one point are added to vToExpand. Returns how many of those were added.
+static int DivideIntoList(ExtractorNode&                      node,
+                          const vector<cv::KeyPoint>&         vKeys,
+                          vector<int>&                        vIndices,
+                          vector<int>&                        vBuffer,
+                          list<ExtractorNode>&                lNodes,
+                          list<ExtractorNode>&                lFreeNodes,
+                          vector<pair<int, ExtractorNode*> >& vToExpand)
+{
+    while (lFreeNodes.size() < 4) lFreeNodes.emplace_back();
+
+    list<ExtractorNode>::iterator vit[4];
+    vit[0] = lFreeNodes.begin();
+    for (int c = 1; c < 4; c++) vit[c] = std::next(vit[c - 1]);
+
+    for (int c = 0; c < 4; c++) vit[c]->bNoMore = false;
+
+    node.DivideNode(*vit[0],
+                    *vit[1],
+                    *vit[2],
+                    *vit[3],
+                    vKeys,
+                    vIndices,
+                    vBuffer);
+
+    // Add childs if they contain points
+    int nToExpand = 0;
+    for (int c = 0; c < 4; c++)
+    {
+        ExtractorNode& child = *vit[c];
+        if (child.Size() == 0) continue;
+
+        lNodes.splice(lNodes.begin(), lFreeNodes, vit[c]);
+        if (child.Size() > 1)
+        {
+            nToExpand++;
+            vToExpand.push_back(make_pair(child.Size(), &child));
+            child.lit = lNodes.begin();
+        }
+    }
+
+    return nToExpand;
+}
+
+void ORBextractor::DistributeOctTree(
     const vector<cv::KeyPoint>& vToDistributeKeys,
     const int&                  minX,
     const int&                  maxX,
     const int&                  minY,
     const int&                  maxY,
     const int&                  N,
-    const int&                  level)
+    const int&                  level,
+    vector<cv::KeyPoint>&       vResultKeys)
 {
+    LevelScratch&        scratch    = mvLevelScratch[level];
+    list<ExtractorNode>& lNodes     = scratch.lNodes;
+    list<ExtractorNode>& lFreeNodes = scratch.lFreeNodes;
+
+    // Recycle the nodes of the previous call
+    lFreeNodes.splice(lFreeNodes.end(), lNodes);
+
     // Compute how many initial nodes
     const int nIni = round(static_cast<float>(maxX - minX) / (maxY - minY));
 
     const float hX = static_cast<float>(maxX - minX) / nIni;
 
-    list<ExtractorNode> lNodes;
-
-    vector<ExtractorNode*> vpIniNodes;
+    vector<ExtractorNode*>& vpIniNodes = scratch.vpIniNodes;
     vpIniNodes.resize(nIni);
 
     for (int i = 0; i < nIni; i++)
     {
-        ExtractorNode ni;
-        ni.UL = cv::Point2i(hX * static_cast<float>(i), 0);
-        ni.UR = cv::Point2i(hX * static_cast<float>(i + 1), 0);
-        ni.BL = cv::Point2i(ni.UL.x, maxY - minY);
-        ni.BR = cv::Point2i(ni.UR.x, maxY - minY);
-        ni.vKeys.reserve(vToDistributeKeys.size());
-
-        lNodes.push_back(ni);
-        vpIniNodes[i] = &lNodes.back();
+        if (lFreeNodes.empty()) lFreeNodes.emplace_back();
+        lNodes.splice(lNodes.end(), lFreeNodes, lFreeNodes.begin());
+
+        ExtractorNode& ni = lNodes.back();
+        ni.UL             = cv::Point2i(hX * static_cast<float>(i), 0);
+        ni.UR             = cv::Point2i(hX * static_cast<float>(i + 1), 0);
+        ni.BL             = cv::Point2i(ni.UL.x, maxY - minY);
+        ni.BR             = cv::Point2i(ni.UR.x, maxY - minY);
+        ni.nBegin         = 0;
+        ni.nEnd           = 0;
+        ni.bNoMore        = false;
+
+        vpIniNodes[i] = &ni;
     }
 
-    // Associate points to childs
-    for (size_t i = 0; i < vToDistributeKeys.size(); i++)
+    // Associate points to childs, the keys of every initial node are stored
+    // one after the other in vIndices
+    const int    nKeys          = vToDistributeKeys.size();
+    vector<int>& vIndices       = scratch.vIndices;
+    vector<int>& vIndicesBuffer = scratch.vIndicesBuffer;
+    vIndices.resize(nKeys);
+    vIndicesBuffer.resize(nKeys);
+
+    for (int i = 0; i < nKeys; i++)
+        vpIniNodes[vToDistributeKeys[i].pt.x / hX]->nEnd++;
+
+    int first = 0;
+    for (int i = 0; i < nIni; i++)
     {
-        const cv::KeyPoint& kp = vToDistributeKeys[i];
-        vpIniNodes[kp.pt.x / hX]->vKeys.push_back(kp);
+        const int nCount      = vpIniNodes[i]->nEnd;
+        vpIniNodes[i]->nBegin = first;
+        vpIniNodes[i]->nEnd   = first;
+        first += nCount;
     }
 
+    for (int i = 0; i < nKeys; i++)
+        vIndices[vpIniNodes[vToDistributeKeys[i].pt.x / hX]->nEnd++] = i;
+
     list<ExtractorNode>::iterator lit = lNodes.begin();
 
     while (lit != lNodes.end())
     {
-        if (lit->vKeys.size() == 1)
+        if (lit->Size() == 1)
         {
             lit->bNoMore = true;
             lit++;
         }
-        else if (lit->vKeys.empty())
-            lit = lNodes.erase(lit);
+        else if (lit->Size() == 0)
+            lit = ReleaseNode(lNodes, lFreeNodes, lit);
         else
             lit++;
     }
@@ -636,8 +755,10 @@ vector<cv::KeyPoint> ORBextractor::DistributeOctTree(
 
     int iteration = 0;
 
-    vector<pair<int, ExtractorNode*> > vSizeAndPointerToNode;
-    vSizeAndPointerToNode.reserve(lNodes.size() * 4);
+    vector<pair<int, ExtractorNode*> >& vSizeAndPointerToNode =
+        scratch.vSizeAndPointerToNode;
+    vector<pair<int, ExtractorNode*> >& vPrevSizeAndPointerToNode =
+        scratch.vPrevSizeAndPointerToNode;
 
     while (!bFinish)
     {
@@ -662,56 +783,15 @@ vector<cv::KeyPoint> ORBextractor::DistributeOctTree(
             else
             {
                 // If more than one point, subdivide
-                ExtractorNode n1, n2, n3, n4;
-                lit->DivideNode(n1, n2, n3, n4);
-
-                // Add childs if they contain points
-                if (n1.vKeys.size() > 0)
-                {
-                    lNodes.push_front(n1);
-                    if (n1.vKeys.size() > 1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(
-                            make_pair(n1.vKeys.size(), &lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-                if (n2.vKeys.size() > 0)
-                {
-                    lNodes.push_front(n2);
-                    if (n2.vKeys.size() > 1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(
-                            make_pair(n2.vKeys.size(), &lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-                if (n3.vKeys.size() > 0)
-                {
-                    lNodes.push_front(n3);
-                    if (n3.vKeys.size() > 1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(
-                            make_pair(n3.vKeys.size(), &lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-                if (n4.vKeys.size() > 0)
-                {
-                    lNodes.push_front(n4);
-                    if (n4.vKeys.size() > 1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(
-                            make_pair(n4.vKeys.size(), &lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-
-                lit = lNodes.erase(lit);
+                nToExpand += DivideIntoList(*lit,
+                                            vToDistributeKeys,
+                                            vIndices,
+                                            vIndicesBuffer,
+                                            lNodes,
+                                            lFreeNodes,
+                                            vSizeAndPointerToNode);
+
+                lit = ReleaseNode(lNodes, lFreeNodes, lit);
                 continue;
             }
         }
@@ -728,8 +808,7 @@ vector<cv::KeyPoint> ORBextractor::DistributeOctTree(
             {
                 prevSize = lNodes.size();
 
-                vector<pair<int, ExtractorNode*> > vPrevSizeAndPointerToNode =
-                    vSizeAndPointerToNode;
+                vPrevSizeAndPointerToNode.swap(vSizeAndPointerToNode);
                 vSizeAndPointerToNode.clear();
 
                 sort(vPrevSizeAndPointerToNode.begin(),
@@ -737,55 +816,16 @@ vector<cv::KeyPoint> ORBextractor::DistributeOctTree(
                      compareNodes);
                 for (int j = vPrevSizeAndPointerToNode.size() - 1; j >= 0; j--)
                 {
-                    ExtractorNode n1, n2, n3, n4;
-                    vPrevSizeAndPointerToNode[j].second->DivideNode(n1,
-                                                                    n2,
-                                                                    n3,
-                                                                    n4);
-
-                    // Add childs if they contain points
-                    if (n1.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n1);
-                        if (n1.vKeys.size() > 1)
-                        {
-                            vSizeAndPointerToNode.push_back(
-                                make_pair(n1.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if (n2.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n2);
-                        if (n2.vKeys.size() > 1)
-                        {
-                            vSizeAndPointerToNode.push_back(
-                                make_pair(n2.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if (n3.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n3);
-                        if (n3.vKeys.size() > 1)
-                        {
-                            vSizeAndPointerToNode.push_back(
-                                make_pair(n3.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if (n4.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n4);
-                        if (n4.vKeys.size() > 1)
-                        {
-                            vSizeAndPointerToNode.push_back(
-                                make_pair(n4.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
+                    ExtractorNode* pNode = vPrevSizeAndPointerToNode[j].second;
+                    DivideIntoList(*pNode,
+                                   vToDistributeKeys,
+                                   vIndices,
+                                   vIndicesBuffer,
+                                   lNodes,
+                                   lFreeNodes,
+                                   vSizeAndPointerToNode);
 
-                    lNodes.erase(vPrevSizeAndPointerToNode[j].second->lit);
+                    ReleaseNode(lNodes, lFreeNodes, pNode->lit);
 
                     if ((int)lNodes.size() >= N) break;
                 }
@@ -797,29 +837,225 @@ vector<cv::KeyPoint> ORBextractor::DistributeOctTree(
     }
 
     // Retain the best point in each node
-    vector<cv::KeyPoint> vResultKeys;
-    vResultKeys.reserve(nfeatures);
+    vResultKeys.clear();
     for (list<ExtractorNode>::iterator lit = lNodes.begin();
          lit != lNodes.end();
          lit++)
     {
-        vector<cv::KeyPoint>& vNodeKeys   = lit->vKeys;
-        cv::KeyPoint*         pKP         = &vNodeKeys[0];
-        float                 maxResponse = pKP->response;
+        const int*          pIndex      = &vIndices[lit->nBegin];
+        const cv::KeyPoint* pKP         = &vToDistributeKeys[pIndex[0]];
+        float               maxResponse = pKP->response;
 
-        for (size_t k = 1; k < vNodeKeys.size(); k++)
+        for (int k = 1; k < lit->Size(); k++)
         {
-            if (vNodeKeys[k].response > maxResponse)
+            const cv::KeyPoint& kp = vToDistributeKeys[pIndex[k]];
+            if (kp.response > maxResponse)
             {
-                pKP         = &vNodeKeys[k];
-                maxResponse = vNodeKeys[k].response;
+                pKP         = &kp;
+                maxResponse = kp.response;
             }
         }
 
         vResultKeys.push_back(*pKP);
     }
+}
+
+// Split node at its center and append the children that contain keys to
+// vNodes. Children take consecutive parts of the range of node in vIndices
+// and keys keep their order.
+static void SplitQuadNode(const QuadTreeNode          node,
+                          const vector<cv::KeyPoint>& vKeys,
+                          vector<int>&                vIndices,
+                          vector<int>&                vBuffer,
+                          vector<QuadTreeNode>&       vNodes)
+{
+    const int halfX = ceil(static_cast<float>(node.maxX - node.minX) / 2);
+    const int halfY = ceil(static_cast<float>(node.maxY - node.minY) / 2);
+    const int midX  = node.minX + halfX;
+    const int midY  = node.minY + halfY;
+
+    // 0: UL, 1: UR, 2: BL, 3: BR
+    auto childOf = [&](const cv::KeyPoint& kp)
+    {
+        return (kp.pt.x < midX ? 0 : 1) + (kp.pt.y < midY ? 0 : 2);
+    };
+
+    int vCount[4] = {0, 0, 0, 0};
+    for (int i = node.nBegin; i < node.nEnd; i++)
+        vCount[childOf(vKeys[vIndices[i]])]++;
+
+    int vPos[4];
+    vPos[0] = node.nBegin;
+    for (int c = 1; c < 4; c++) vPos[c] = vPos[c - 1] + vCount[c - 1];
+
+    for (int c = 0; c < 4; c++)
+    {
+        if (vCount[c] == 0) continue;
+
+        QuadTreeNode child;
+        child.minX   = (c & 1) ? midX : node.minX;
+        child.maxX   = (c & 1) ? node.maxX : midX;
+        child.minY   = (c & 2) ? midY : node.minY;
+        child.maxY   = (c & 2) ? node.maxY : midY;
+        child.nBegin = vPos[c];
+        child.nEnd   = vPos[c] + vCount[c];
+        vNodes.push_back(child);
+    }
 
-    return vResultKeys;
+    for (int i = node.nBegin; i < node.nEnd; i++)
+        vBuffer[vPos[childOf(vKeys[vIndices[i]])]++] = vIndices[i];
+    std::copy(vBuffer.begin() + node.nBegin,
+              vBuffer.begin() + node.nEnd,
+              vIndices.begin() + node.nBegin);
+}
+
+void ORBextractor::DistributeQuadTree(
+    const vector<cv::KeyPoint>& vToDistributeKeys,
+    const int&                  minX,
+    const int&                  maxX,
+    const int&                  minY,
+    const int&                  maxY,
+    const int&                  N,
+    const int&                  level,
+    vector<cv::KeyPoint>&       vResultKeys)
+{
+    LevelScratch&            scratch     = mvLevelScratch[level];
+    vector<QuadTreeNode>&    vLeaves     = scratch.vLeaves;
+    vector<QuadTreeNode>&    vNextLeaves = scratch.vNextLeaves;
+    vector<pair<int, int> >& vToSplit    = scratch.vToSplit;
+
+    vResultKeys.clear();
+
+    const int nKeys = vToDistributeKeys.size();
+    if (nKeys == 0) return;
+
+    vector<int>& vIndices       = scratch.vIndices;
+    vector<int>& vIndicesBuffer = scratch.vIndicesBuffer;
+    vIndices.resize(nKeys);
+    vIndicesBuffer.resize(nKeys);
+
+    // Same initial columns as the octree, keys are bucketed by column
+    const int   nIni = round(static_cast<float>(maxX - minX) / (maxY - minY));
+    const float hX   = static_cast<float>(maxX - minX) / nIni;
+
+    vLeaves.resize(nIni);
+    for (int i = 0; i < nIni; i++)
+    {
+        QuadTreeNode& ni = vLeaves[i];
+        ni.minX          = hX * static_cast<float>(i);
+        ni.maxX          = hX * static_cast<float>(i + 1);
+        ni.minY          = 0;
+        ni.maxY          = maxY - minY;
+        ni.nBegin        = 0;
+        ni.nEnd          = 0;
+    }
+
+    for (int i = 0; i < nKeys; i++)
+        vLeaves[vToDistributeKeys[i].pt.x / hX].nEnd++;
+
+    int first = 0;
+    for (int i = 0; i < nIni; i++)
+    {
+        const int nCount  = vLeaves[i].nEnd;
+        vLeaves[i].nBegin = first;
+        vLeaves[i].nEnd   = first;
+        first += nCount;
+    }
+
+    for (int i = 0; i < nKeys; i++)
+        vIndices[vLeaves[vToDistributeKeys[i].pt.x / hX].nEnd++] = i;
+
+    vLeaves.erase(std::remove_if(vLeaves.begin(),
+                                 vLeaves.end(),
+                                 [](const QuadTreeNode& node)
+                                 {
+                                     return node.Size() == 0;
+                                 }),
+                  vLeaves.end());
+
+    // Nodes of one pixel are not split, several FAST cells can return the
+    // same corner
+    auto canSplit = [](const QuadTreeNode& node)
+    {
+        return node.Size() > 1 &&
+               (node.maxX - node.minX > 1 || node.maxY - node.minY > 1);
+    };
+
+    while ((int)vLeaves.size() < N)
+    {
+        vToSplit.clear();
+        for (size_t i = 0; i < vLeaves.size(); i++)
+        {
+            if (canSplit(vLeaves[i]))
+                vToSplit.push_back(make_pair(vLeaves[i].Size(), (int)i));
+        }
+
+        if (vToSplit.empty()) break;
+
+        if ((int)(vLeaves.size() + 3 * vToSplit.size()) <= N)
+        {
+            // Far from the budget, split all the nodes
+            vNextLeaves.clear();
+            for (const QuadTreeNode& node : vLeaves)
+            {
+                if (canSplit(node))
+                    SplitQuadNode(node,
+                                  vToDistributeKeys,
+                                  vIndices,
+                                  vIndicesBuffer,
+                                  vNextLeaves);
+                else
+                    vNextLeaves.push_back(node);
+            }
+            vLeaves.swap(vNextLeaves);
+        }
+        else
+        {
+            // Close to the budget, split the most populated nodes first. The
+            // last child takes the place of its parent.
+            sort(vToSplit.begin(),
+                 vToSplit.end(),
+                 [](const pair<int, int>& a, const pair<int, int>& b)
+                 {
+                     return a.first > b.first ||
+                            (a.first == b.first && a.second < b.second);
+                 });
+
+            for (const pair<int, int>& toSplit : vToSplit)
+            {
+                SplitQuadNode(vLeaves[toSplit.second],
+                              vToDistributeKeys,
+                              vIndices,
+                              vIndicesBuffer,
+                              vLeaves);
+
+                vLeaves[toSplit.second] = vLeaves.back();
+                vLeaves.pop_back();
+
+                if ((int)vLeaves.size() >= N) break;
+            }
+        }
+    }
+
+    // Retain the best point in each node
+    for (const QuadTreeNode& node : vLeaves)
+    {
+        const int*          pIndex      = &vIndices[node.nBegin];
+        const cv::KeyPoint* pKP         = &vToDistributeKeys[pIndex[0]];
+        float               maxResponse = pKP->response;
+
+        for (int k = 1; k < node.Size(); k++)
+        {
+            const cv::KeyPoint& kp = vToDistributeKeys[pIndex[k]];
+            if (kp.response > maxResponse)
+            {
+                pKP         = &kp;
+                maxResponse = kp.response;
+            }
+        }
+
+        vResultKeys.push_back(*pKP);
+    }
 }
 
 void ORBextractor::ComputeKeyPointsOctTree(
@@ -829,40 +1065,75 @@ void ORBextractor::ComputeKeyPointsOctTree(
 
     const float W = 35;
 
+    // FAST is run on one row of cells per task so that the large levels are
+    // split among the threads. Cell rows are concatenated in order afterwards,
+    // the result does not depend on the number of threads.
+    vector<LevelGrid>& vGrids     = mvGrids;
+    vector<int>&       vTaskLevel = mvTaskLevel;
+    vTaskLevel.clear();
     for (int level = 0; level < nlevels; ++level)
     {
-        const int minBorderX = EDGE_THRESHOLD - 3;
-        const int minBorderY = minBorderX;
-        const int maxBorderX = mvImagePyramid[level].cols - EDGE_THRESHOLD + 3;
-        const int maxBorderY = mvImagePyramid[level].rows - EDGE_THRESHOLD + 3;
+        LevelGrid& grid = vGrids[level];
 
-        vector<cv::KeyPoint> vToDistributeKeys;
-        vToDistributeKeys.reserve(nfeatures * 10);
+        grid.minBorderX = EDGE_THRESHOLD - 3;
+        grid.minBorderY = grid.minBorderX;
+        grid.maxBorderX = mvImagePyramid[level].cols - EDGE_THRESHOLD + 3;
+        grid.maxBorderY = mvImagePyramid[level].rows - EDGE_THRESHOLD + 3;
 
-        const float width  = (maxBorderX - minBorderX);
-        const float height = (maxBorderY - minBorderY);
+        const float width  = (grid.maxBorderX - grid.minBorderX);
+        const float height = (grid.maxBorderY - grid.minBorderY);
 
-        const int nCols = width / W;
-        const int nRows = height / W;
-        const int wCell = ceil(width / nCols);
-        const int hCell = ceil(height / nRows);
+        grid.nCols     = width / W;
+        grid.nRows     = height / W;
+        grid.wCell     = ceil(width / grid.nCols);
+        grid.hCell     = ceil(height / grid.nRows);
+        grid.firstTask = vTaskLevel.size();
 
-        for (int i = 0; i < nRows; i++)
+        vTaskLevel.insert(vTaskLevel.end(), grid.nRows, level);
+    }
+
+    vector<vector<cv::KeyPoint> >& vRowKeys = mvRowKeys;
+    if (vRowKeys.size() < vTaskLevel.size())
+    {
+        vRowKeys.resize(vTaskLevel.size());
+        mvCellKeys.resize(vTaskLevel.size());
+    }
+
+    ThreadPool::ParallelFor(
+        mpThreadPool.get(),
+        (int)vTaskLevel.size(),
+        [&](int task)
         {
-            const float iniY = minBorderY + i * hCell;
-            float       maxY = iniY + hCell + 6;
+            const int        level = vTaskLevel[task];
+            const LevelGrid& grid  = vGrids[level];
+            const int        i     = task - grid.firstTask;
+            const float      scale = mvScaleFactor[level];
+            const bool       bMask = !mMask.empty();
 
-            if (iniY >= maxBorderY - 3) continue;
-            if (maxY > maxBorderY) maxY = maxBorderY;
+            vector<cv::KeyPoint>& vKeysRow  = vRowKeys[task];
+            vector<cv::KeyPoint>& vKeysCell = mvCellKeys[task];
+            vKeysRow.clear();
 
-            for (int j = 0; j < nCols; j++)
-            {
-                const float iniX = minBorderX + j * wCell;
-                float       maxX = iniX + wCell + 6;
-                if (iniX >= maxBorderX - 6) continue;
-                if (maxX > maxBorderX) maxX = maxBorderX;
+            const float iniY = grid.minBorderY + i * grid.hCell;
+            float       maxY = iniY + grid.hCell + 6;
 
-                vector<cv::KeyPoint> vKeysCell;
+            if (iniY >= grid.maxBorderY - 3) return;
+            if (maxY > grid.maxBorderY) maxY = grid.maxBorderY;
+
+            for (int j = 0; j < grid.nCols; j++)
+            {
+                const float iniX = grid.minBorderX + j * grid.wCell;
+                float       maxX = iniX + grid.wCell + 6;
+                if (iniX >= grid.maxBorderX - 6) continue;
+                if (maxX > grid.maxBorderX) maxX = grid.maxBorderX;
+
+                // Nothing to detect in this cell
+                if (bMask && !AnyInMask(mMaskSum,
+                                        iniX * scale,
+                                        iniY * scale,
+                                        maxX * scale,
+                                        maxY * scale))
+                    continue;
 
                 FAST(mvImagePyramid[level]
                          .rowRange(iniY, maxY)
@@ -886,41 +1157,82 @@ void ORBextractor::ComputeKeyPointsOctTree(
                     for (auto vit = vKeysCell.begin(); vit != vKeysCell.end();
                          vit++)
                     {
-                        (*vit).pt.x += j * wCell;
-                        (*vit).pt.y += i * hCell;
-                        vToDistributeKeys.push_back(*vit);
+                        if (bMask && !InMask(mMask,
+                                             ((*vit).pt.x + iniX) * scale,
+                                             ((*vit).pt.y + iniY) * scale))
+                            continue;
+
+                        (*vit).pt.x += j * grid.wCell;
+                        (*vit).pt.y += i * grid.hCell;
+                        vKeysRow.push_back(*vit);
                     }
                 }
             }
-        }
+        });
 
-        vector<KeyPoint>& keypoints = allKeypoints[level];
-        keypoints.reserve(nfeatures);
+    ThreadPool::ParallelFor(
+        mpThreadPool.get(),
+        nlevels,
+        [&](int level)
+        {
+            const LevelGrid& grid = vGrids[level];
 
-        keypoints = DistributeOctTree(vToDistributeKeys,
-                                      minBorderX,
-                                      maxBorderX,
-                                      minBorderY,
-                                      maxBorderY,
-                                      mnFeaturesPerLevel[level],
-                                      level);
+            vector<cv::KeyPoint>& vToDistributeKeys =
+                mvLevelScratch[level].vToDistributeKeys;
+            vToDistributeKeys.clear();
 
-        const int scaledPatchSize = PATCH_SIZE * mvScaleFactor[level];
+            for (int i = 0; i < grid.nRows; i++)
+            {
+                const vector<cv::KeyPoint>& vKeysRow =
+                    vRowKeys[grid.firstTask + i];
+                vToDistributeKeys.insert(vToDistributeKeys.end(),
+                                         vKeysRow.begin(),
+                                         vKeysRow.end());
+            }
 
-        // Add border to coordinates and scale information
-        const int nkps = keypoints.size();
-        for (int i = 0; i < nkps; i++)
-        {
-            keypoints[i].pt.x += minBorderX;
-            keypoints[i].pt.y += minBorderY;
-            keypoints[i].octave = level;
-            keypoints[i].size   = scaledPatchSize;
-        }
-    }
+            vector<KeyPoint>& keypoints = allKeypoints[level];
 
-    // compute orientations
-    for (int level = 0; level < nlevels; ++level)
-        computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+            if (mDistribution == DISTRIBUTE_QUADTREE)
+            {
+                DistributeQuadTree(vToDistributeKeys,
+                                   grid.minBorderX,
+                                   grid.maxBorderX,
+                                   grid.minBorderY,
+                                   grid.maxBorderY,
+                                   mnFeaturesPerLevel[level],
+                                   level,
+                                   keypoints);
+            }
+            else
+            {
+                DistributeOctTree(vToDistributeKeys,
+                                  grid.minBorderX,
+                                  grid.maxBorderX,
+                                  grid.minBorderY,
+                                  grid.maxBorderY,
+                                  mnFeaturesPerLevel[level],
+                                  level,
+                                  keypoints);
+            }
+
+            const int scaledPatchSize = PATCH_SIZE * mvScaleFactor[level];
+
+            // Add border to coordinates and scale information
+            const int nkps = keypoints.size();
+            for (int i = 0; i < nkps; i++)
+            {
+                keypoints[i].pt.x += grid.minBorderX;
+                keypoints[i].pt.y += grid.minBorderY;
+                keypoints[i].octave = level;
+                keypoints[i].size   = scaledPatchSize;
+            }
+
+            // compute orientations
+            computeOrientation(mvImagePyramid[level],
+                               keypoints,
+                               umax,
+                               mKernelLevel);
+        });
 }
 
 void ORBextractor::ComputeKeyPointsOld(
@@ -1103,20 +1415,24 @@ void ORBextractor::ComputeKeyPointsOld(
 
     // and compute orientations
     for (int level = 0; level < nlevels; ++level)
-        computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+        computeOrientation(mvImagePyramid[level],
+                           allKeypoints[level],
+                           umax,
+                           mKernelLevel);
 }
 
-static void computeDescriptors(const Mat&           image,
-                               vector<KeyPoint>&    keypoints,
-                               Mat&                 descriptors,
-                               const vector<Point>& pattern)
+// descriptors must have one row per keypoint, every byte is written.
+static void computeDescriptors(const Mat&                 image,
+                               vector<KeyPoint>&          keypoints,
+                               Mat&                       descriptors,
+                               const ORBkernels::Pattern& pattern,
+                               ORBkernels::Level          level)
 {
-    descriptors = Mat::zeros((int)keypoints.size(), 32, CV_8UC1);
-
     for (size_t i = 0; i < keypoints.size(); i++)
         computeOrbDescriptor(keypoints[i],
                              image,
-                             &pattern[0],
+                             pattern,
+                             level,
                              descriptors.ptr((int)i));
 }
 
@@ -1132,10 +1448,17 @@ int ORBextractor::operator()(InputArray        _image,
     Mat image = _image.getMat();
     assert(image.type() == CV_8UC1);
 
+    mMask = _mask.getMat();
+    if (!mMask.empty())
+    {
+        assert(mMask.type() == CV_8UC1 && mMask.size() == image.size());
+        integral(mMask, mMaskSum, CV_64F);
+    }
+
     // Pre-compute the scale pyramid
     ComputePyramid(image);
 
-    vector<vector<KeyPoint> > allKeypoints;
+    vector<vector<KeyPoint> >& allKeypoints = mvAllKeypoints;
     ComputeKeyPointsOctTree(allKeypoints);
     // ComputeKeyPointsOld(allKeypoints);
 
@@ -1154,9 +1477,49 @@ int ORBextractor::operator()(InputArray        _image,
 
     //_keypoints.clear();
     //_keypoints.reserve(nkeypoints);
-    _keypoints = vector<cv::KeyPoint>(nkeypoints);
+    _keypoints.resize(nkeypoints);
+
+    // Descriptors are computed per level in parallel, then gathered in
+    // order
+    ThreadPool::ParallelFor(
+        mpThreadPool.get(),
+        nlevels,
+        [&](int level)
+        {
+            vector<KeyPoint>& keypoints = allKeypoints[level];
+            if (keypoints.empty()) return;
+
+            LevelScratch& scratch = mvLevelScratch[level];
+
+            // preprocess the resized image. The level is blurred as a
+            // standalone image, as the clone it used to be, not with the
+            // pixels of the border around it.
+            GaussianBlur(mvImagePyramid[level],
+                         scratch.blurred,
+                         Size(7, 7),
+                         2,
+                         2,
+                         BORDER_REFLECT_101 + BORDER_ISOLATED);
+
+            // Compute the descriptors
+            const int nkeypointsLevel = (int)keypoints.size();
+            if (scratch.descriptors.rows < nkeypointsLevel)
+                scratch.descriptors.create(nkeypointsLevel, 32, CV_8U);
+            Mat desc = scratch.descriptors.rowRange(0, nkeypointsLevel);
+            computeDescriptors(scratch.blurred,
+                               keypoints,
+                               desc,
+                               mPattern,
+                               mKernelLevel);
+
+            // Scale keypoint coordinates
+            if (level != 0)
+            {
+                const float scale = mvScaleFactor[level];
+                for (KeyPoint& keypoint : keypoints) keypoint.pt *= scale;
+            }
+        });
 
-    int offset = 0;
     // Modified for speeding up stereo fisheye matching
     int monoIndex = 0, stereoIndex = nkeypoints - 1;
     for (int level = 0; level < nlevels; ++level)
@@ -1166,48 +1529,25 @@ int ORBextractor::operator()(InputArray        _image,
 
         if (nkeypointsLevel == 0) continue;
 
-        // preprocess the resized image
-        Mat workingMat = mvImagePyramid[level].clone();
-        GaussianBlur(workingMat,
-                     workingMat,
-                     Size(7, 7),
-                     2,
-                     2,
-                     BORDER_REFLECT_101);
-
-        // Compute the descriptors
-        // Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-        Mat desc = cv::Mat(nkeypointsLevel, 32, CV_8U);
-        computeDescriptors(workingMat, keypoints, desc, pattern);
+        const Mat& desc = mvLevelScratch[level].descriptors;
 
-        offset += nkeypointsLevel;
-
-
-        float scale =
-            mvScaleFactor[level];  // getScale(level, firstLevel, scaleFactor);
         int i = 0;
         for (vector<KeyPoint>::iterator keypoint    = keypoints.begin(),
                                         keypointEnd = keypoints.end();
              keypoint != keypointEnd;
              ++keypoint)
         {
-            // Scale keypoint coordinates
-            if (level != 0)
-            {
-                keypoint->pt *= scale;
-            }
-
             if (keypoint->pt.x >= vLappingArea[0] &&
                 keypoint->pt.x <= vLappingArea[1])
             {
                 _keypoints.at(stereoIndex) = (*keypoint);
-                desc.row(i).copyTo(descriptors.row(stereoIndex));
+                memcpy(descriptors.ptr(stereoIndex), desc.ptr(i), 32);
                 stereoIndex--;
             }
             else
             {
                 _keypoints.at(monoIndex) = (*keypoint);
-                desc.row(i).copyTo(descriptors.row(monoIndex));
+                memcpy(descriptors.ptr(monoIndex), desc.ptr(i), 32);
                 monoIndex++;
             }
             i++;
@@ -1215,11 +1555,17 @@ int ORBextractor::operator()(InputArray        _image,
     }
     // cout << "[ORBextractor]: extracted " << _keypoints.size() << " KeyPoints"
     // << endl;
+    mMask.release();
     return monoIndex;
 }
 
 void ORBextractor::ComputePyramid(cv::Mat image)
 {
+    // The last pyramid becomes the previous one, the buffers of the one
+    // before it are reused for the new image
+    mvImagePyramid.swap(mvPrevImagePyramid);
+    mvPyramidBuffer.swap(mvPrevPyramidBuffer);
+
     for (int level = 0; level < nlevels; ++level)
     {
         float scale = mvInvScaleFactor[level];
@@ -1227,7 +1573,10 @@ void ORBextractor::ComputePyramid(cv::Mat image)
                 cvRound((float)image.rows * scale));
         Size  wholeSize(sz.width + EDGE_THRESHOLD * 2,
                        sz.height + EDGE_THRESHOLD * 2);
-        Mat   temp(wholeSize, image.type()), masktemp;
+
+        // Reallocated only when the image size changes
+        Mat& temp = mvPyramidBuffer[level];
+        temp.create(wholeSize, image.type());
         mvImagePyramid[level] =
             temp(Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
 
@@ -22,29 +22,53 @@
 #ifndef ORBEXTRACTOR_H
 #define ORBEXTRACTOR_H
 #include <list>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
 
+#include "feature/ORBkernels.h"
+
+#include "utils/ThreadPool.h"
+
 namespace ORB_SLAM3
 {
 
 class ExtractorNode
 {
 public:
-    ExtractorNode() : bNoMore(false) {}
-
-    void DivideNode(ExtractorNode& n1,
-                    ExtractorNode& n2,
-                    ExtractorNode& n3,
-                    ExtractorNode& n4);
-
-    std::vector<cv::KeyPoint>          vKeys;
+    ExtractorNode() : nBegin(0), nEnd(0), bNoMore(false) {}
+
+    // The keys of a node are vIndices[nBegin, nEnd), indices in vKeys.
+    // Children take consecutive parts of the range of the parent and keys keep
+    // their order. vBuffer is scratch memory as large as vIndices.
+    void DivideNode(ExtractorNode&                   n1,
+                    ExtractorNode&                   n2,
+                    ExtractorNode&                   n3,
+                    ExtractorNode&                   n4,
+                    const std::vector<cv::KeyPoint>& vKeys,
+                    std::vector<int>&                vIndices,
+                    std::vector<int>&                vBuffer);
+
+    int inline Size() const { return nEnd - nBegin; }
+
+    int                                nBegin, nEnd;
     cv::Point2i                        UL, UR, BL, BR;
     std::list<ExtractorNode>::iterator lit;
     bool                               bNoMore;
 };
 
+// Node of the flat quadtree, keys are vIndices[nBegin, nEnd) as for
+// ExtractorNode but nodes are plain values kept in a vector.
+struct QuadTreeNode
+{
+    int minX, minY, maxX, maxY;
+    int nBegin, nEnd;
+
+    int inline Size() const { return nEnd - nBegin; }
+};
+
 class ORBextractor
 {
 public:
@@ -54,6 +78,14 @@ public:
         FAST_SCORE   = 1
     };
 
+    // How the FAST corners of every level are spread over the image before
+    // keeping the best one of each cell.
+    enum DistributionMode
+    {
+        DISTRIBUTE_OCTREE   = 0,  // Original list based octree
+        DISTRIBUTE_QUADTREE = 1   // Flat quadtree on index ranges
+    };
+
     ORBextractor(int   nfeatures,
                  float scaleFactor,
                  int   nlevels,
@@ -64,7 +96,9 @@ public:
 
     // Compute the ORB features and descriptors on an image.
     // ORB are dispersed on the image using an octree.
-    // Mask is ignored in the current implementation.
+    // If a mask is given (CV_8UC1, image size) features are only detected
+    // where it is not zero. The FAST cells it hides are skipped and the
+    // feature budget of every level is spent on the rest of the image.
     int operator()(cv::InputArray             _image,
                    cv::InputArray             _mask,
                    std::vector<cv::KeyPoint>& _keypoints,
@@ -73,6 +107,8 @@ public:
 
     int inline GetLevels() { return nlevels; }
 
+    int inline GetNumFeatures() const { return nfeatures; }
+
     float inline GetScaleFactor() { return scaleFactor; }
 
     std::vector<float> inline GetScaleFactors() { return mvScaleFactor; }
@@ -89,24 +125,63 @@ public:
         return mvInvLevelSigma2;
     }
 
+    // Extract the pyramid levels (and row bands of the large levels) on a
+    // pool of nThreads threads, the calling one included. 1 disables it.
+    // Keypoints and descriptors are the same whatever the number of threads.
+    void SetNumThreads(int nThreads);
+
+    // Instruction set used for orientation and descriptors. It defaults to
+    // the best one supported by the CPU, lower it to force the scalar path.
+    void SetKernelLevel(ORBkernels::Level level);
+
+    ORBkernels::Level inline GetKernelLevel() const { return mKernelLevel; }
+
+    void SetDistributionMode(DistributionMode mode) { mDistribution = mode; }
+
+    DistributionMode inline GetDistributionMode() const
+    {
+        return mDistribution;
+    }
+
+    // Builds the scale pyramid of an image without extracting features, as
+    // operator() does first. The pyramid of the previous image is kept in
+    // mvPrevImagePyramid, e.g. for optical flow between both.
+    void ComputePyramid(cv::Mat image);
+
     std::vector<cv::Mat> mvImagePyramid;
+    std::vector<cv::Mat> mvPrevImagePyramid;
 
 protected:
-    void ComputePyramid(cv::Mat image);
     void ComputeKeyPointsOctTree(
         std::vector<std::vector<cv::KeyPoint> >& allKeypoints);
-    std::vector<cv::KeyPoint> DistributeOctTree(
-        const std::vector<cv::KeyPoint>& vToDistributeKeys,
-        const int&                       minX,
-        const int&                       maxX,
-        const int&                       minY,
-        const int&                       maxY,
-        const int&                       nFeatures,
-        const int&                       level);
+    void DistributeOctTree(const std::vector<cv::KeyPoint>& vToDistributeKeys,
+                           const int&                       minX,
+                           const int&                       maxX,
+                           const int&                       minY,
+                           const int&                       maxY,
+                           const int&                       nFeatures,
+                           const int&                       level,
+                           std::vector<cv::KeyPoint>&       vResultKeys);
+    // Same purpose as DistributeOctTree. Nodes live in two vectors swapped
+    // at every round, the most populated ones are split first when close to
+    // nFeatures. It keeps a similar spread, not the exact same keypoints.
+    void DistributeQuadTree(const std::vector<cv::KeyPoint>& vToDistributeKeys,
+                            const int&                       minX,
+                            const int&                       maxX,
+                            const int&                       minY,
+                            const int&                       maxY,
+                            const int&                       nFeatures,
+                            const int&                       level,
+                            std::vector<cv::KeyPoint>&       vResultKeys);
 
     void ComputeKeyPointsOld(
         std::vector<std::vector<cv::KeyPoint> >& allKeypoints);
     std::vector<cv::Point> pattern;
+    ORBkernels::Pattern    mPattern;
+    ORBkernels::Level      mKernelLevel;
+    DistributionMode       mDistribution;
+
+    std::unique_ptr<ThreadPool> mpThreadPool;
 
     int    nfeatures;
     double scaleFactor;
@@ -122,6 +197,55 @@ protected:
     std::vector<float> mvInvScaleFactor;
     std::vector<float> mvLevelSigma2;
     std::vector<float> mvInvLevelSigma2;
+
+    // Working memory kept from one call to the next. Buffers only grow, so
+    // once a few images of the same size went through, operator() does not
+    // allocate any more.
+    struct LevelGrid
+    {
+        int minBorderX, minBorderY, maxBorderX, maxBorderY;
+        int nCols, nRows, wCell, hCell;
+        int firstTask;
+    };
+
+    struct LevelScratch
+    {
+        std::vector<cv::KeyPoint> vToDistributeKeys;
+        std::vector<int>          vIndices;
+        std::vector<int>          vIndicesBuffer;
+
+        // Octree nodes, released nodes are spliced to lFreeNodes and reused
+        std::list<ExtractorNode>                     lNodes;
+        std::list<ExtractorNode>                     lFreeNodes;
+        std::vector<ExtractorNode*>                  vpIniNodes;
+        std::vector<std::pair<int, ExtractorNode*> > vSizeAndPointerToNode;
+        std::vector<std::pair<int, ExtractorNode*> > vPrevSizeAndPointerToNode;
+
+        // Quadtree nodes, (size, position) of the nodes to split
+        std::vector<QuadTreeNode>         vLeaves;
+        std::vector<QuadTreeNode>         vNextLeaves;
+        std::vector<std::pair<int, int> > vToSplit;
+
+        cv::Mat blurred;
+        // Descriptors of the level in the first rows
+        cv::Mat descriptors;
+    };
+
+    // Bordered levels, mvImagePyramid are views on them. Both pyramids are
+    // swapped at every image.
+    std::vector<cv::Mat> mvPyramidBuffer;
+    std::vector<cv::Mat> mvPrevPyramidBuffer;
+
+    // Detection mask of the current call and its integral image
+    cv::Mat mMask;
+    cv::Mat mMaskSum;
+
+    std::vector<LevelGrid>                  mvGrids;
+    std::vector<int>                        mvTaskLevel;
+    std::vector<std::vector<cv::KeyPoint> > mvRowKeys;
+    std::vector<std::vector<cv::KeyPoint> > mvCellKeys;
+    std::vector<LevelScratch>               mvLevelScratch;
+    std::vector<std::vector<cv::KeyPoint> > mvAllKeypoints;
 };
 
 }  // namespace ORB_SLAM3
@@ -0,0 +1,748 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "feature/ORBkernels.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define ORB_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ORB_TARGET_SSE42
+#define ORB_TARGET_POPCNT
+#define ORB_TARGET_AVX2
+#define ORB_TARGET_AVX512
+#else
+#define ORB_TARGET_SSE42  __attribute__((target("sse4.2")))
+#define ORB_TARGET_POPCNT __attribute__((target("sse4.2,popcnt")))
+#define ORB_TARGET_AVX2   __attribute__((target("avx2")))
+#define ORB_TARGET_AVX512 __attribute__((target("avx512f,avx512vpopcntdq")))
+#endif
+#endif
+
+namespace ORB_SLAM3
+{
+
+static void ICMomentsScalar(const uchar* center,
+                            int          step,
+                            const int*   u_max,
+                            int          halfPatchSize,
+                            int&         m_01,
+                            int&         m_10)
+{
+    m_01 = 0;
+    m_10 = 0;
+
+    // Treat the center line differently, v=0
+    for (int u = -halfPatchSize; u <= halfPatchSize; ++u)
+        m_10 += u * center[u];
+
+    // Go line by line in the circular patch
+    for (int v = 1; v <= halfPatchSize; ++v)
+    {
+        // Proceed over the two lines
+        int v_sum = 0;
+        int d     = u_max[v];
+        for (int u = -d; u <= d; ++u)
+        {
+            int val_plus  = center[u + v * step],
+                val_minus = center[u - v * step];
+            v_sum += (val_plus - val_minus);
+            m_10 += u * (val_plus + val_minus);
+        }
+        m_01 += v * v_sum;
+    }
+}
+
+static void OrbDescriptorScalar(const uchar*                center,
+                                int                         step,
+                                float                       a,
+                                float                       b,
+                                const ORBkernels::Pattern& p,
+                                uchar*                      desc)
+{
+#define GET_VALUE(x, y) \
+    center[cvRound(x * b + y * a) * step + cvRound(x * a - y * b)]
+
+    for (int i = 0; i < 32; ++i)
+    {
+        int val = 0;
+        for (int k = 0; k < 8; ++k)
+        {
+            const int j  = 8 * i + k;
+            const int t0 = GET_VALUE(p.x0[j], p.y0[j]);
+            const int t1 = GET_VALUE(p.x1[j], p.y1[j]);
+            val |= (t0 < t1) << k;
+        }
+        desc[i] = (uchar)val;
+    }
+
+#undef GET_VALUE
+}
+
+// Position in descs of the i-th descriptor to compare, through a list of
+// indices or straight, so each distance kernel serves both entry points.
+struct GatherIndex
+{
+    const size_t* indices;
+    size_t        operator()(int i) const { return indices[i]; }
+};
+
+struct ContiguousIndex
+{
+    size_t operator()(int i) const { return (size_t)i; }
+};
+
+template <typename Index>
+static void DistancesScalar(const ORBkernels::Descriptor& q,
+                            const ORBkernels::Descriptor* descs,
+                            Index                         index,
+                            int                           n,
+                            int*                          dist)
+{
+    for (int i = 0; i < n; ++i)
+        dist[i] = ORBkernels::Distance(q, descs[index(i)]);
+}
+
+#ifdef ORB_KERNELS_X86
+
+ORB_TARGET_SSE42
+static inline int HorizontalSum(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+// The patch rows are walked in chunks of W pixels. The last chunk of a row is
+// moved back so that it ends on the row end and the pixels already summed are
+// masked out, which keeps every load inside the patch.
+
+ORB_TARGET_SSE42
+static void ICMomentsSSE42(const uchar* center,
+                           int          step,
+                           const int*   u_max,
+                           int          halfPatchSize,
+                           int&         m_01,
+                           int&         m_10)
+{
+    const int     W    = 8;
+    const __m128i iota = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m128i acc10 = _mm_setzero_si128();
+    __m128i acc01 = _mm_setzero_si128();
+    int     s10 = 0, s01 = 0;
+
+    for (int v = 0; v <= halfPatchSize; ++v)
+    {
+        const int    d        = v == 0 ? halfPatchSize : u_max[v];
+        const uchar* rowPlus  = center + v * step;
+        const uchar* rowMinus = center - v * step;
+
+        if (2 * d + 1 < W)
+        {
+            int v_sum = 0;
+            for (int u = -d; u <= d; ++u)
+            {
+                int val_plus = rowPlus[u], val_minus = rowMinus[u];
+                if (v == 0)
+                {
+                    s10 += u * val_plus;
+                    continue;
+                }
+                v_sum += (val_plus - val_minus);
+                s10 += u * (val_plus + val_minus);
+            }
+            s01 += v * v_sum;
+            continue;
+        }
+
+        const __m128i vv    = _mm_set1_epi16((short)v);
+        int           first = -d;
+        while (first <= d)
+        {
+            const int     start = std::min(first, d - W + 1);
+            const __m128i u =
+                _mm_add_epi16(_mm_set1_epi16((short)start), iota);
+            const __m128i mask =
+                _mm_cmpgt_epi16(u, _mm_set1_epi16((short)(first - 1)));
+            const __m128i plus = _mm_cvtepu8_epi16(
+                _mm_loadl_epi64((const __m128i*)(rowPlus + start)));
+
+            if (v == 0)
+            {
+                acc10 = _mm_add_epi32(
+                    acc10,
+                    _mm_madd_epi16(plus, _mm_and_si128(u, mask)));
+            }
+            else
+            {
+                const __m128i minus = _mm_cvtepu8_epi16(
+                    _mm_loadl_epi64((const __m128i*)(rowMinus + start)));
+                const __m128i sum  = _mm_add_epi16(plus, minus);
+                const __m128i diff = _mm_sub_epi16(plus, minus);
+                acc10               = _mm_add_epi32(
+                    acc10,
+                    _mm_madd_epi16(sum, _mm_and_si128(u, mask)));
+                acc01 = _mm_add_epi32(
+                    acc01,
+                    _mm_madd_epi16(diff, _mm_and_si128(vv, mask)));
+            }
+
+            first = start + W;
+        }
+    }
+
+    m_10 = s10 + HorizontalSum(acc10);
+    m_01 = s01 + HorizontalSum(acc01);
+}
+
+ORB_TARGET_AVX2
+static void ICMomentsAVX2(const uchar* center,
+                          int          step,
+                          const int*   u_max,
+                          int          halfPatchSize,
+                          int&         m_01,
+                          int&         m_10)
+{
+    const int     W    = 16;
+    const __m256i iota = _mm256_setr_epi16(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    __m256i acc10 = _mm256_setzero_si256();
+    __m256i acc01 = _mm256_setzero_si256();
+    int     s10 = 0, s01 = 0;
+
+    for (int v = 0; v <= halfPatchSize; ++v)
+    {
+        const int    d        = v == 0 ? halfPatchSize : u_max[v];
+        const uchar* rowPlus  = center + v * step;
+        const uchar* rowMinus = center - v * step;
+
+        if (2 * d + 1 < W)
+        {
+            int v_sum = 0;
+            for (int u = -d; u <= d; ++u)
+            {
+                int val_plus = rowPlus[u], val_minus = rowMinus[u];
+                if (v == 0)
+                {
+                    s10 += u * val_plus;
+                    continue;
+                }
+                v_sum += (val_plus - val_minus);
+                s10 += u * (val_plus + val_minus);
+            }
+            s01 += v * v_sum;
+            continue;
+        }
+
+        const __m256i vv    = _mm256_set1_epi16((short)v);
+        int           first = -d;
+        while (first <= d)
+        {
+            const int     start = std::min(first, d - W + 1);
+            const __m256i u =
+                _mm256_add_epi16(_mm256_set1_epi16((short)start), iota);
+            const __m256i mask =
+                _mm256_cmpgt_epi16(u, _mm256_set1_epi16((short)(first - 1)));
+            const __m256i plus = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(rowPlus + start)));
+
+            if (v == 0)
+            {
+                acc10 = _mm256_add_epi32(
+                    acc10,
+                    _mm256_madd_epi16(plus, _mm256_and_si256(u, mask)));
+            }
+            else
+            {
+                const __m256i minus = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i*)(rowMinus + start)));
+                const __m256i sum  = _mm256_add_epi16(plus, minus);
+                const __m256i diff = _mm256_sub_epi16(plus, minus);
+                acc10              = _mm256_add_epi32(
+                    acc10,
+                    _mm256_madd_epi16(sum, _mm256_and_si256(u, mask)));
+                acc01 = _mm256_add_epi32(
+                    acc01,
+                    _mm256_madd_epi16(diff, _mm256_and_si256(vv, mask)));
+            }
+
+            first = start + W;
+        }
+    }
+
+    __m128i h10 = _mm_add_epi32(_mm256_castsi256_si128(acc10),
+                                _mm256_extracti128_si256(acc10, 1));
+    __m128i h01 = _mm_add_epi32(_mm256_castsi256_si128(acc01),
+                                _mm256_extracti128_si256(acc01, 1));
+    m_10 = s10 + HorizontalSum(h10);
+    m_01 = s01 + HorizontalSum(h01);
+}
+
+// Rotation of the pattern is done in float exactly as in the scalar code
+// (separate multiply and add, round to nearest even), so the sampled pixels
+// are the same.
+
+ORB_TARGET_SSE42
+static void OrbDescriptorSSE42(const uchar*                center,
+                               int                         step,
+                               float                       a,
+                               float                       b,
+                               const ORBkernels::Pattern& p,
+                               uchar*                      desc)
+{
+    const __m128  va    = _mm_set1_ps(a);
+    const __m128  vb    = _mm_set1_ps(b);
+    const __m128i vstep = _mm_set1_epi32(step);
+
+    alignas(16) int off0[8];
+    alignas(16) int off1[8];
+
+    for (int i = 0; i < 32; ++i)
+    {
+        for (int h = 0; h < 8; h += 4)
+        {
+            const int    j  = 8 * i + h;
+            const __m128 x0 = _mm_load_ps(p.x0 + j);
+            const __m128 y0 = _mm_load_ps(p.y0 + j);
+            const __m128 x1 = _mm_load_ps(p.x1 + j);
+            const __m128 y1 = _mm_load_ps(p.y1 + j);
+
+            const __m128i r0 = _mm_cvtps_epi32(
+                _mm_add_ps(_mm_mul_ps(x0, vb), _mm_mul_ps(y0, va)));
+            const __m128i c0 = _mm_cvtps_epi32(
+                _mm_sub_ps(_mm_mul_ps(x0, va), _mm_mul_ps(y0, vb)));
+            const __m128i r1 = _mm_cvtps_epi32(
+                _mm_add_ps(_mm_mul_ps(x1, vb), _mm_mul_ps(y1, va)));
+            const __m128i c1 = _mm_cvtps_epi32(
+                _mm_sub_ps(_mm_mul_ps(x1, va), _mm_mul_ps(y1, vb)));
+
+            _mm_store_si128((__m128i*)(off0 + h),
+                            _mm_add_epi32(_mm_mullo_epi32(r0, vstep), c0));
+            _mm_store_si128((__m128i*)(off1 + h),
+                            _mm_add_epi32(_mm_mullo_epi32(r1, vstep), c1));
+        }
+
+        int val = 0;
+        for (int k = 0; k < 8; ++k)
+            val |= (center[off0[k]] < center[off1[k]]) << k;
+        desc[i] = (uchar)val;
+    }
+}
+
+ORB_TARGET_AVX2
+static void OrbDescriptorAVX2(const uchar*                center,
+                              int                         step,
+                              float                       a,
+                              float                       b,
+                              const ORBkernels::Pattern& p,
+                              uchar*                      desc)
+{
+    const __m256  va    = _mm256_set1_ps(a);
+    const __m256  vb    = _mm256_set1_ps(b);
+    const __m256i vstep = _mm256_set1_epi32(step);
+    const __m256i lo    = _mm256_set1_epi32(0xFF);
+
+    // Gathers read 4 bytes per offset, the 3 extra bytes stay inside the
+    // image border and are masked out.
+    const int* base = reinterpret_cast<const int*>(center);
+
+    for (int i = 0; i < 32; ++i)
+    {
+        const int    j  = 8 * i;
+        const __m256 x0 = _mm256_load_ps(p.x0 + j);
+        const __m256 y0 = _mm256_load_ps(p.y0 + j);
+        const __m256 x1 = _mm256_load_ps(p.x1 + j);
+        const __m256 y1 = _mm256_load_ps(p.y1 + j);
+
+        const __m256i r0 = _mm256_cvtps_epi32(
+            _mm256_add_ps(_mm256_mul_ps(x0, vb), _mm256_mul_ps(y0, va)));
+        const __m256i c0 = _mm256_cvtps_epi32(
+            _mm256_sub_ps(_mm256_mul_ps(x0, va), _mm256_mul_ps(y0, vb)));
+        const __m256i r1 = _mm256_cvtps_epi32(
+            _mm256_add_ps(_mm256_mul_ps(x1, vb), _mm256_mul_ps(y1, va)));
+        const __m256i c1 = _mm256_cvtps_epi32(
+            _mm256_sub_ps(_mm256_mul_ps(x1, va), _mm256_mul_ps(y1, vb)));
+
+        const __m256i off0 =
+            _mm256_add_epi32(_mm256_mullo_epi32(r0, vstep), c0);
+        const __m256i off1 =
+            _mm256_add_epi32(_mm256_mullo_epi32(r1, vstep), c1);
+
+        const __m256i t0 =
+            _mm256_and_si256(_mm256_i32gather_epi32(base, off0, 1), lo);
+        const __m256i t1 =
+            _mm256_and_si256(_mm256_i32gather_epi32(base, off1, 1), lo);
+
+        // t0 < t1, one bit per test
+        const __m256i lt = _mm256_cmpgt_epi32(t1, t0);
+        desc[i]          = (uchar)_mm256_movemask_ps(_mm256_castsi256_ps(lt));
+    }
+}
+
+// SSE4.2 CPUs all have popcnt, so it comes with the SSE42 level.
+
+template <typename Index>
+ORB_TARGET_POPCNT
+static void DistancesPopcnt(const ORBkernels::Descriptor& q,
+                            const ORBkernels::Descriptor* descs,
+                            Index                         index,
+                            int                           n,
+                            int*                          dist)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        const uint64_t* d = descs[index(i)].w;
+#if defined(__x86_64__) || defined(_M_X64)
+        dist[i] = (int)(_mm_popcnt_u64(q.w[0] ^ d[0]) +
+                        _mm_popcnt_u64(q.w[1] ^ d[1]) +
+                        _mm_popcnt_u64(q.w[2] ^ d[2]) +
+                        _mm_popcnt_u64(q.w[3] ^ d[3]));
+#else
+        int sum = 0;
+        for (int k = 0; k < 4; ++k)
+        {
+            const uint64_t x = q.w[k] ^ d[k];
+            sum += _mm_popcnt_u32((unsigned int)x) +
+                   _mm_popcnt_u32((unsigned int)(x >> 32));
+        }
+        dist[i] = sum;
+#endif
+    }
+}
+
+// Four sums of bytes, one per 64 bit lane of each of a, b, c and d, reduced
+// to the four totals in this order. Totals must fit in 32 bits.
+ORB_TARGET_AVX2
+static inline __m128i ReduceFourAVX2(__m256i a, __m256i b, __m256i c, __m256i d)
+{
+    const __m256i ab = _mm256_or_si256(a, _mm256_slli_epi64(b, 32));
+    const __m256i cd = _mm256_or_si256(c, _mm256_slli_epi64(d, 32));
+    const __m256i s  = _mm256_add_epi64(_mm256_unpacklo_epi64(ab, cd),
+                                       _mm256_unpackhi_epi64(ab, cd));
+    return _mm_add_epi64(_mm256_castsi256_si128(s),
+                         _mm256_extracti128_si256(s, 1));
+}
+
+// Bit count of every byte with a 4 bit lookup table, then summed by 8 bytes
+// with SAD against zero.
+ORB_TARGET_AVX2
+static inline __m256i PopcountAVX2(__m256i x)
+{
+    const __m256i lut  = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+    const __m256i hi = _mm256_shuffle_epi8(
+        lut,
+        _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+template <typename Index>
+ORB_TARGET_AVX2
+static void DistancesAVX2(const ORBkernels::Descriptor& q,
+                          const ORBkernels::Descriptor* descs,
+                          Index                         index,
+                          int                           n,
+                          int*                          dist)
+{
+    const __m256i vq = _mm256_load_si256((const __m256i*)q.w);
+
+#define LOAD_XOR(k) \
+    _mm256_xor_si256(vq, _mm256_load_si256((const __m256i*)descs[index(k)].w))
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256i c0 = PopcountAVX2(LOAD_XOR(i));
+        const __m256i c1 = PopcountAVX2(LOAD_XOR(i + 1));
+        const __m256i c2 = PopcountAVX2(LOAD_XOR(i + 2));
+        const __m256i c3 = PopcountAVX2(LOAD_XOR(i + 3));
+        _mm_storeu_si128((__m128i*)(dist + i), ReduceFourAVX2(c0, c1, c2, c3));
+    }
+
+    for (; i < n; ++i)
+    {
+        const __m256i c = PopcountAVX2(LOAD_XOR(i));
+        __m128i s = _mm_add_epi64(_mm256_castsi256_si128(c),
+                                  _mm256_extracti128_si256(c, 1));
+        s         = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+        dist[i]   = _mm_cvtsi128_si32(s);
+    }
+
+#undef LOAD_XOR
+}
+
+// Two descriptors per register, the 64 bit counts come from VPOPCNTQ.
+template <typename Index>
+ORB_TARGET_AVX512
+static void DistancesAVX512(const ORBkernels::Descriptor& q,
+                            const ORBkernels::Descriptor* descs,
+                            Index                         index,
+                            int                           n,
+                            int*                          dist)
+{
+    const __m512i vq =
+        _mm512_broadcast_i64x4(_mm256_load_si256((const __m256i*)q.w));
+
+#define LOAD_PAIR(k)                                                          \
+    _mm512_inserti64x4(                                                       \
+        _mm512_castsi256_si512(                                               \
+            _mm256_load_si256((const __m256i*)descs[index(k)].w)),          \
+        _mm256_load_si256((const __m256i*)descs[index(k + 1)].w),           \
+        1)
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m512i c01 =
+            _mm512_popcnt_epi64(_mm512_xor_si512(vq, LOAD_PAIR(i)));
+        const __m512i c23 =
+            _mm512_popcnt_epi64(_mm512_xor_si512(vq, LOAD_PAIR(i + 2)));
+
+        // Lanes 0-3 of the pairs are descriptors i and i + 2, lanes 4-7 are
+        // descriptors i + 1 and i + 3
+        const __m512i t  = _mm512_or_si512(c01, _mm512_slli_epi64(c23, 32));
+        const __m256i t0 = _mm512_castsi512_si256(t);
+        const __m256i t1 = _mm512_extracti64x4_epi64(t, 1);
+        const __m256i s  = _mm256_add_epi64(_mm256_unpacklo_epi64(t0, t1),
+                                           _mm256_unpackhi_epi64(t0, t1));
+        const __m128i r  = _mm_add_epi64(_mm256_castsi256_si128(s),
+                                        _mm256_extracti128_si256(s, 1));
+        // (i, i + 2, i + 1, i + 3) to (i, i + 1, i + 2, i + 3)
+        _mm_storeu_si128((__m128i*)(dist + i),
+                         _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+#undef LOAD_PAIR
+
+    for (; i < n; ++i)
+    {
+        const __m256i x = _mm256_xor_si256(
+            _mm512_castsi512_si256(vq),
+            _mm256_load_si256((const __m256i*)descs[index(i)].w));
+        const __m512i c = _mm512_popcnt_epi64(_mm512_castsi256_si512(x));
+        // The upper lanes of the cast are undefined, only the lower four
+        // are summed
+        const __m256i c4 = _mm512_castsi512_si256(c);
+        __m128i       s  = _mm_add_epi64(_mm256_castsi256_si128(c4),
+                                  _mm256_extracti128_si256(c4, 1));
+        s                = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+        dist[i]          = _mm_cvtsi128_si32(s);
+    }
+}
+
+#endif  // ORB_KERNELS_X86
+
+static ORBkernels::Level DetectLevelImpl()
+{
+#ifdef ORB_KERNELS_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int nIds = info[0];
+    if (nIds < 1) return ORBkernels::SCALAR;
+
+    __cpuid(info, 1);
+    const bool bSSE42   = (info[2] & (1 << 20)) != 0;
+    const bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+    const bool bAVX     = (info[2] & (1 << 28)) != 0;
+
+    bool bAVX2   = false;
+    bool bAVX512 = false;
+    if (nIds >= 7 && bOSXSAVE && bAVX && (_xgetbv(0) & 0x6) == 0x6)
+    {
+        __cpuidex(info, 7, 0);
+        bAVX2 = (info[1] & (1 << 5)) != 0;
+        // AVX-512F, VPOPCNTDQ and the opmask and ZMM states saved by the OS
+        bAVX512 = bAVX2 && (info[1] & (1 << 16)) != 0 &&
+                  (info[2] & (1 << 14)) != 0 && (_xgetbv(0) & 0xe6) == 0xe6;
+    }
+#else
+    __builtin_cpu_init();
+    const bool bSSE42  = __builtin_cpu_supports("sse4.2");
+    const bool bAVX2   = __builtin_cpu_supports("avx2");
+    const bool bAVX512 = bAVX2 && __builtin_cpu_supports("avx512f") &&
+                         __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+    if (bAVX512) return ORBkernels::AVX512;
+    if (bAVX2) return ORBkernels::AVX2;
+    if (bSSE42) return ORBkernels::SSE42;
+#endif
+    return ORBkernels::SCALAR;
+}
+
+ORBkernels::Level ORBkernels::DetectLevel()
+{
+    static const Level level = DetectLevelImpl();
+    return level;
+}
+
+const char* ORBkernels::LevelName(Level level)
+{
+    switch (level)
+    {
+    case AVX512:
+        return "AVX-512";
+    case AVX2:
+        return "AVX2";
+    case SSE42:
+        return "SSE4.2";
+    default:
+        return "scalar";
+    }
+}
+
+void ORBkernels::BuildPattern(const cv::Point* points, Pattern& pattern)
+{
+    for (int j = 0; j < N_TESTS; ++j)
+    {
+        pattern.x0[j] = (float)points[2 * j].x;
+        pattern.y0[j] = (float)points[2 * j].y;
+        pattern.x1[j] = (float)points[2 * j + 1].x;
+        pattern.y1[j] = (float)points[2 * j + 1].y;
+    }
+}
+
+void ORBkernels::ICMoments(const uchar* center,
+                           int          step,
+                           const int*   umax,
+                           int          halfPatchSize,
+                           Level        level,
+                           int&         m_01,
+                           int&         m_10)
+{
+#ifdef ORB_KERNELS_X86
+    if (level >= AVX2)
+    {
+        ICMomentsAVX2(center, step, umax, halfPatchSize, m_01, m_10);
+        return;
+    }
+    if (level == SSE42)
+    {
+        ICMomentsSSE42(center, step, umax, halfPatchSize, m_01, m_10);
+        return;
+    }
+#endif
+    ICMomentsScalar(center, step, umax, halfPatchSize, m_01, m_10);
+}
+
+void ORBkernels::OrbDescriptor(const uchar*   center,
+                               int            step,
+                               float          a,
+                               float          b,
+                               const Pattern& pattern,
+                               Level          level,
+                               uchar*         desc)
+{
+#ifdef ORB_KERNELS_X86
+    if (level >= AVX2)
+    {
+        OrbDescriptorAVX2(center, step, a, b, pattern, desc);
+        return;
+    }
+    if (level == SSE42)
+    {
+        OrbDescriptorSSE42(center, step, a, b, pattern, desc);
+        return;
+    }
+#endif
+    OrbDescriptorScalar(center, step, a, b, pattern, desc);
+}
+
+void ORBkernels::PackDescriptors(const cv::Mat&           descriptors,
+                                 std::vector<Descriptor>& packed)
+{
+    assert(descriptors.empty() ||
+           (descriptors.type() == CV_8U && descriptors.cols == 32));
+
+    packed.resize(descriptors.rows);
+    for (int i = 0; i < descriptors.rows; ++i)
+        memcpy(packed[i].w, descriptors.ptr(i), sizeof(Descriptor));
+}
+
+ORBkernels::Descriptor ORBkernels::PackDescriptor(const cv::Mat& descriptor)
+{
+    assert(descriptor.type() == CV_8U && descriptor.total() == 32);
+
+    Descriptor packed;
+    memcpy(packed.w, descriptor.ptr(), sizeof(Descriptor));
+    return packed;
+}
+
+template <typename Index>
+static void DistancesDispatch(const ORBkernels::Descriptor& q,
+                              const ORBkernels::Descriptor* descs,
+                              Index                         index,
+                              int                           n,
+                              ORBkernels::Level             level,
+                              int*                          dist)
+{
+#ifdef ORB_KERNELS_X86
+    if (level == ORBkernels::AVX512)
+    {
+        DistancesAVX512(q, descs, index, n, dist);
+        return;
+    }
+    if (level == ORBkernels::AVX2)
+    {
+        DistancesAVX2(q, descs, index, n, dist);
+        return;
+    }
+    if (level == ORBkernels::SSE42)
+    {
+        DistancesPopcnt(q, descs, index, n, dist);
+        return;
+    }
+#endif
+    DistancesScalar(q, descs, index, n, dist);
+}
+
+void ORBkernels::Distances(const Descriptor& q,
+                           const Descriptor* descs,
+                           const size_t*     indices,
+                           int               n,
+                           Level             level,
+                           int*              dist)
+{
+    DistancesDispatch(q, descs, GatherIndex{indices}, n, level, dist);
+}
+
+void ORBkernels::Distances(const Descriptor& q,
+                           const Descriptor* descs,
+                           int               n,
+                           Level             level,
+                           int*              dist)
+{
+    DistancesDispatch(q, descs, ContiguousIndex(), n, level, dist);
+}
+
+}  // namespace ORB_SLAM3
@@ -0,0 +1,145 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ORBKERNELS_H
+#define ORBKERNELS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace ORB_SLAM3
+{
+
+// SIMD versions of the per keypoint work done by the ORBextractor. Every kernel
+// gives exactly the same result as the scalar code in ORBextractor.cpp, so the
+// level can be switched at any time without changing the features.
+// The Hamming distances used by the ORBmatcher live here too.
+class ORBkernels
+{
+public:
+    // AVX512 stands for AVX-512F with VPOPCNTDQ. Only the distances have a
+    // kernel of their own at this level, extraction runs the AVX2 one.
+    enum Level
+    {
+        SCALAR = 0,
+        SSE42  = 1,
+        AVX2   = 2,
+        AVX512 = 3
+    };
+
+    // Number of point pairs of the rotated BRIEF pattern (256 bits).
+    static constexpr int N_TESTS = 256;
+
+    // ORB descriptor packed in 32 aligned bytes. Frames, keyframes and map
+    // points keep a copy of their descriptors in this form for matching.
+    struct alignas(32) Descriptor
+    {
+        uint64_t w[4];
+    };
+
+    // BRIEF pattern split by test, so 8 tests can be rotated at once.
+    struct Pattern
+    {
+        alignas(32) float x0[N_TESTS];
+        alignas(32) float y0[N_TESTS];
+        alignas(32) float x1[N_TESTS];
+        alignas(32) float y1[N_TESTS];
+    };
+
+    // Highest level supported by the CPU we are running on (CPUID). The
+    // result is computed once and cached.
+    static Level DetectLevel();
+
+    static const char* LevelName(Level level);
+
+    // Fill the split pattern from the 512 points used by the scalar code.
+    static void BuildPattern(const cv::Point* points, Pattern& pattern);
+
+    // Intensity centroid moments of the circular patch around center.
+    // umax holds the half width of every row of the patch.
+    static void ICMoments(const uchar* center,
+                          int          step,
+                          const int*   umax,
+                          int          halfPatchSize,
+                          Level        level,
+                          int&         m_01,
+                          int&         m_10);
+
+    // Evaluate the 256 tests of the pattern rotated by (cos, sin) = (a, b)
+    // and write the 32 bytes of the descriptor.
+    static void OrbDescriptor(const uchar*   center,
+                              int            step,
+                              float          a,
+                              float          b,
+                              const Pattern& pattern,
+                              Level          level,
+                              uchar*         desc);
+
+    // Copy the rows of a CV_8U descriptor matrix (32 columns).
+    static void PackDescriptors(const cv::Mat&           descriptors,
+                                std::vector<Descriptor>& packed);
+
+    static Descriptor PackDescriptor(const cv::Mat& descriptor);
+
+    // Hamming distance of two descriptors.
+    static inline int Distance(const Descriptor& a, const Descriptor& b)
+    {
+        return Popcount64(a.w[0] ^ b.w[0]) + Popcount64(a.w[1] ^ b.w[1]) +
+               Popcount64(a.w[2] ^ b.w[2]) + Popcount64(a.w[3] ^ b.w[3]);
+    }
+
+    // Hamming distances from q to descs[indices[i]], written to dist[i] for
+    // the n first indices, e.g. the candidates given by GetFeaturesInArea.
+    static void Distances(const Descriptor& q,
+                          const Descriptor* descs,
+                          const size_t*     indices,
+                          int               n,
+                          Level             level,
+                          int*              dist);
+
+    // Hamming distances from q to the n descriptors stored from descs on,
+    // e.g. the children of a node of the flattened vocabulary tree.
+    static void Distances(const Descriptor& q,
+                          const Descriptor* descs,
+                          int               n,
+                          Level             level,
+                          int*              dist);
+
+private:
+    static inline int Popcount64(uint64_t v)
+    {
+#if defined(__POPCNT__)
+        return __builtin_popcountll(v);
+#else
+        v = v - ((v >> 1) & 0x5555555555555555ULL);
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // ORBKERNELS_H
@@ -22,11 +22,14 @@
 
 #include "feature/ORBmatcher.h"
 #include <climits>
+#include <limits>
 
 #include <opencv2/core/core.hpp>
 
 #include <DBoW2/FeatureVector.h>
 
+#include "utils/ThreadPool.h"
+
 using namespace std;
 
 namespace ORB_SLAM3
@@ -37,7 +40,9 @@ const int ORBmatcher::TH_LOW       = 50;
 const int ORBmatcher::HISTO_LENGTH = 30;
 
 ORBmatcher::ORBmatcher(float nnratio, bool checkOri)
-    : mfNNratio(nnratio), mbCheckOrientation(checkOri)
+    : mfNNratio(nnratio)
+    , mbCheckOrientation(checkOri)
+    , mKernelLevel(ORBkernels::DetectLevel())
 {}
 
 int ORBmatcher::SearchByProjection(Frame&                   F,
@@ -46,200 +51,322 @@ int ORBmatcher::SearchByProjection(Frame&                   F,
                                    const bool               bFarPoints,
                                    const float              thFarPoints)
 {
-    int nmatches = 0, left = 0, right = 0;
-
-    const bool bFactor = th != 1.0;
+    int nmatches = 0;
 
     for (size_t iMP = 0; iMP < vpMapPoints.size(); iMP++)
     {
-        MapPoint* pMP = vpMapPoints[iMP];
-        if (!pMP->mbTrackInView && !pMP->mbTrackInViewR) continue;
+        nmatches += MatchLocalPoint(F,
+                                    vpMapPoints[iMP],
+                                    th,
+                                    bFarPoints,
+                                    thFarPoints,
+                                    mvDistances,
+                                    nullptr);
+    }
+    return nmatches;
+}
 
-        if (bFarPoints && pMP->mTrackDepth > thFarPoints) continue;
+int ORBmatcher::SearchByProjectionParallel(Frame&                   F,
+                                           const vector<MapPoint*>& vpMapPoints,
+                                           ThreadPool*              pPool,
+                                           const float              th,
+                                           const bool               bFarPoints,
+                                           const float              thFarPoints)
+{
+    if (!pPool || pPool->GetNumThreads() == 1)
+        return SearchByProjection(F, vpMapPoints, th, bFarPoints, thFarPoints);
+
+    const int nMPs = (int)vpMapPoints.size();
+    if (nMPs == 0) return 0;
+
+    // Contiguous blocks of MapPoints, a few per thread to balance the load
+    const int nBlocks = std::min(nMPs, 4 * pPool->GetNumThreads());
+
+    mvLocalMatches.resize(nMPs);
+    mvvBlockDistances.resize(nBlocks);
+
+    // Match every MapPoint against the claims F had on entry
+    pPool->ParallelFor(nBlocks,
+                       [&](int iBlock)
+                       {
+                           const int iBegin = nMPs * iBlock / nBlocks;
+                           const int iEnd   = nMPs * (iBlock + 1) / nBlocks;
+                           for (int i = iBegin; i < iEnd; i++)
+                           {
+                               LocalPointMatch& match = mvLocalMatches[i];
+                               match.vReads.clear();
+                               match.nWrites = 0;
+                               MatchLocalPoint(F,
+                                               vpMapPoints[i],
+                                               th,
+                                               bFarPoints,
+                                               thFarPoints,
+                                               mvvBlockDistances[iBlock],
+                                               &match);
+                           }
+                       });
+
+    // Apply the claims in the order of vpMapPoints. A MapPoint none of whose
+    // keypoints was claimed by the previous ones saw the same frame as in
+    // the serial search, the others are matched again.
+    mvbClaimed.assign(F.mvpMapPoints.size(), false);
 
-        if (pMP->isBad()) continue;
+    int nmatches = 0;
+    for (int i = 0; i < nMPs; i++)
+    {
+        MapPoint*        pMP   = vpMapPoints[i];
+        LocalPointMatch& match = mvLocalMatches[i];
 
-        if (pMP->mbTrackInView)
+        bool bStale = false;
+        for (const size_t idx : match.vReads)
         {
-            const int& nPredictedLevel = pMP->mnTrackScaleLevel;
+            if (mvbClaimed[idx])
+            {
+                bStale = true;
+                break;
+            }
+        }
 
-            // The size of the window will depend on the viewing direction
-            float r = RadiusByViewingCos(pMP->mTrackViewCos);
+        if (bStale)
+        {
+            match.vReads.clear();
+            match.nWrites = 0;
+            MatchLocalPoint(F,
+                            pMP,
+                            th,
+                            bFarPoints,
+                            thFarPoints,
+                            mvDistances,
+                            &match);
+        }
 
-            if (bFactor) r *= th;
+        for (int j = 0; j < match.nWrites; j++)
+        {
+            F.mvpMapPoints[match.vWrites[j]] = pMP;
+            mvbClaimed[match.vWrites[j]]     = true;
+        }
+        nmatches += match.nWrites;
+    }
 
-            const vector<size_t> vIndices =
-                F.GetFeaturesInArea(pMP->mTrackProjX,
-                                    pMP->mTrackProjY,
-                                    r * F.mvScaleFactors[nPredictedLevel],
-                                    nPredictedLevel - 1,
-                                    nPredictedLevel);
+    return nmatches;
+}
 
-            if (!vIndices.empty())
-            {
-                const cv::Mat MPdescriptor = pMP->GetDescriptor();
-
-                int bestDist   = 256;
-                int bestLevel  = -1;
-                int bestDist2  = 256;
-                int bestLevel2 = -1;
-                int bestIdx    = -1;
-
-                // Get best and second matches with near keypoints
-                for (vector<size_t>::const_iterator vit  = vIndices.begin(),
-                                                    vend = vIndices.end();
-                     vit != vend;
-                     vit++)
-                {
-                    const size_t idx = *vit;
+int ORBmatcher::MatchLocalPoint(Frame&           F,
+                                MapPoint*        pMP,
+                                const float      th,
+                                const bool       bFarPoints,
+                                const float      thFarPoints,
+                                vector<int>&     vDistances,
+                                LocalPointMatch* pMatch)
+{
+    // MapPoint holding the keypoint idx, as seen by this search
+    auto claimOf = [&](const size_t idx) -> MapPoint*
+    {
+        if (!pMatch) return F.mvpMapPoints[idx];
+        for (int j = 0; j < pMatch->nWrites; j++)
+            if (pMatch->vWrites[j] == idx) return pMP;
+        pMatch->vReads.push_back(idx);
+        return F.mvpMapPoints[idx];
+    };
+
+    auto claim = [&](const size_t idx)
+    {
+        if (pMatch)
+            pMatch->vWrites[pMatch->nWrites++] = idx;
+        else
+            F.mvpMapPoints[idx] = pMP;
+    };
 
-                    if (F.mvpMapPoints[idx])
-                        if (F.mvpMapPoints[idx]->Observations() > 0) continue;
+    int nclaimed = 0;
 
-                    if (F.Nleft == -1 && F.mvuRight[idx] > 0)
-                    {
-                        const float er =
-                            fabs(pMP->mTrackProjXR - F.mvuRight[idx]);
-                        if (er > r * F.mvScaleFactors[nPredictedLevel])
-                            continue;
-                    }
+    const bool bFactor = th != 1.0;
 
-                    const cv::Mat& d = F.mDescriptors.row(idx);
+    if (!pMP->mbTrackInView && !pMP->mbTrackInViewR) return 0;
 
-                    const int dist = DescriptorDistance(MPdescriptor, d);
+    if (bFarPoints && pMP->mTrackDepth > thFarPoints) return 0;
 
-                    if (dist < bestDist)
-                    {
-                        bestDist2  = bestDist;
-                        bestDist   = dist;
-                        bestLevel2 = bestLevel;
-                        bestLevel  = (F.Nleft == -1) ? F.mvKeysUn[idx].octave
-                                   : (idx < F.Nleft)
-                                       ? F.mvKeys[idx].octave
-                                       : F.mvKeysRight[idx - F.Nleft].octave;
-                        bestIdx    = idx;
-                    }
-                    else if (dist < bestDist2)
-                    {
-                        bestLevel2 = (F.Nleft == -1) ? F.mvKeysUn[idx].octave
-                                   : (idx < F.Nleft)
-                                       ? F.mvKeys[idx].octave
-                                       : F.mvKeysRight[idx - F.Nleft].octave;
-                        bestDist2  = dist;
-                    }
+    if (pMP->isBad()) return 0;
+
+    if (pMP->mbTrackInView)
+    {
+        const int& nPredictedLevel = pMP->mnTrackScaleLevel;
+
+        // The size of the window will depend on the viewing direction
+        float r = RadiusByViewingCos(pMP->mTrackViewCos);
+
+        if (bFactor) r *= th;
+
+        const vector<size_t> vIndices =
+            F.GetFeaturesInArea(pMP->mTrackProjX,
+                                pMP->mTrackProjY,
+                                r * F.mvScaleFactors[nPredictedLevel],
+                                nPredictedLevel - 1,
+                                nPredictedLevel);
+
+        if (!vIndices.empty())
+        {
+            const ORBkernels::Descriptor MPdescriptor =
+                pMP->GetPackedDescriptor();
+
+            // Distances to all the candidates at once
+            const int nCandidates = (int)vIndices.size();
+            vDistances.resize(nCandidates);
+            ORBkernels::Distances(MPdescriptor,
+                                  F.mvPackedDescriptors.data(),
+                                  vIndices.data(),
+                                  nCandidates,
+                                  mKernelLevel,
+                                  vDistances.data());
+
+            int bestDist   = 256;
+            int bestLevel  = -1;
+            int bestDist2  = 256;
+            int bestLevel2 = -1;
+            int bestIdx    = -1;
+
+            // Get best and second matches with near keypoints
+            for (int k = 0; k < nCandidates; k++)
+            {
+                const size_t idx = vIndices[k];
+
+                MapPoint* pMPidx = claimOf(idx);
+                if (pMPidx)
+                    if (pMPidx->Observations() > 0) continue;
+
+                if (F.Nleft == -1 && F.mvuRight[idx] > 0)
+                {
+                    const float er = fabs(pMP->mTrackProjXR - F.mvuRight[idx]);
+                    if (er > r * F.mvScaleFactors[nPredictedLevel]) continue;
                 }
 
-                // Apply ratio to second match (only if best and second are in
-                // the same scale level)
-                if (bestDist <= TH_HIGH)
+                const int dist = vDistances[k];
+
+                if (dist < bestDist)
                 {
-                    if (bestLevel == bestLevel2 &&
-                        bestDist > mfNNratio * bestDist2)
-                        continue;
+                    bestDist2  = bestDist;
+                    bestDist   = dist;
+                    bestLevel2 = bestLevel;
+                    bestLevel  = (F.Nleft == -1) ? F.mvKeysUn[idx].octave
+                               : (idx < F.Nleft)
+                                   ? F.mvKeys[idx].octave
+                                   : F.mvKeysRight[idx - F.Nleft].octave;
+                    bestIdx    = idx;
+                }
+                else if (dist < bestDist2)
+                {
+                    bestLevel2 = (F.Nleft == -1) ? F.mvKeysUn[idx].octave
+                               : (idx < F.Nleft)
+                                   ? F.mvKeys[idx].octave
+                                   : F.mvKeysRight[idx - F.Nleft].octave;
+                    bestDist2  = dist;
+                }
+            }
 
-                    if (bestLevel != bestLevel2 ||
-                        bestDist <= mfNNratio * bestDist2)
-                    {
-                        F.mvpMapPoints[bestIdx] = pMP;
-
-                        if (F.Nleft != -1 &&
-                            F.mvLeftToRightMatch[bestIdx] != -1)
-                        {  // Also match with the stereo observation at right
-                           // camera
-                            F.mvpMapPoints[F.mvLeftToRightMatch[bestIdx] +
-                                           F.Nleft] = pMP;
-                            nmatches++;
-                            right++;
-                        }
+            // Apply ratio to second match (only if best and second are in
+            // the same scale level)
+            if (bestDist <= TH_HIGH)
+            {
+                if (bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
+                    return nclaimed;
 
-                        nmatches++;
-                        left++;
+                if (bestLevel != bestLevel2 ||
+                    bestDist <= mfNNratio * bestDist2)
+                {
+                    claim(bestIdx);
+
+                    if (F.Nleft != -1 && F.mvLeftToRightMatch[bestIdx] != -1)
+                    {  // Also match with the stereo observation at right
+                       // camera
+                        claim(F.mvLeftToRightMatch[bestIdx] + F.Nleft);
+                        nclaimed++;
                     }
+
+                    nclaimed++;
                 }
             }
         }
+    }
 
-        if (F.Nleft != -1 && pMP->mbTrackInViewR)
+    if (F.Nleft != -1 && pMP->mbTrackInViewR)
+    {
+        const int& nPredictedLevel = pMP->mnTrackScaleLevelR;
+        if (nPredictedLevel != -1)
         {
-            const int& nPredictedLevel = pMP->mnTrackScaleLevelR;
-            if (nPredictedLevel != -1)
+            float r = RadiusByViewingCos(pMP->mTrackViewCosR);
+
+            const vector<size_t> vIndices =
+                F.GetFeaturesInArea(pMP->mTrackProjXR,
+                                    pMP->mTrackProjYR,
+                                    r * F.mvScaleFactors[nPredictedLevel],
+                                    nPredictedLevel - 1,
+                                    nPredictedLevel,
+                                    true);
+
+            if (vIndices.empty()) return nclaimed;
+
+            const ORBkernels::Descriptor MPdescriptor =
+                pMP->GetPackedDescriptor();
+
+            int bestDist   = 256;
+            int bestLevel  = -1;
+            int bestDist2  = 256;
+            int bestLevel2 = -1;
+            int bestIdx    = -1;
+
+            // Get best and second matches with near keypoints
+            for (vector<size_t>::const_iterator vit  = vIndices.begin(),
+                                                vend = vIndices.end();
+                 vit != vend;
+                 vit++)
             {
-                float r = RadiusByViewingCos(pMP->mTrackViewCosR);
-
-                const vector<size_t> vIndices =
-                    F.GetFeaturesInArea(pMP->mTrackProjXR,
-                                        pMP->mTrackProjYR,
-                                        r * F.mvScaleFactors[nPredictedLevel],
-                                        nPredictedLevel - 1,
-                                        nPredictedLevel,
-                                        true);
-
-                if (vIndices.empty()) continue;
-
-                const cv::Mat MPdescriptor = pMP->GetDescriptor();
-
-                int bestDist   = 256;
-                int bestLevel  = -1;
-                int bestDist2  = 256;
-                int bestLevel2 = -1;
-                int bestIdx    = -1;
-
-                // Get best and second matches with near keypoints
-                for (vector<size_t>::const_iterator vit  = vIndices.begin(),
-                                                    vend = vIndices.end();
-                     vit != vend;
-                     vit++)
-                {
-                    const size_t idx = *vit;
+                const size_t idx = *vit;
 
-                    if (F.mvpMapPoints[idx + F.Nleft])
-                        if (F.mvpMapPoints[idx + F.Nleft]->Observations() > 0)
-                            continue;
+                MapPoint* pMPidx = claimOf(idx + F.Nleft);
+                if (pMPidx)
+                    if (pMPidx->Observations() > 0) continue;
 
 
-                    const cv::Mat& d = F.mDescriptors.row(idx + F.Nleft);
+                const ORBkernels::Descriptor& d =
+                    F.mvPackedDescriptors[idx + F.Nleft];
 
-                    const int dist = DescriptorDistance(MPdescriptor, d);
+                const int dist = DescriptorDistance(MPdescriptor, d);
 
-                    if (dist < bestDist)
-                    {
-                        bestDist2  = bestDist;
-                        bestDist   = dist;
-                        bestLevel2 = bestLevel;
-                        bestLevel  = F.mvKeysRight[idx].octave;
-                        bestIdx    = idx;
-                    }
-                    else if (dist < bestDist2)
-                    {
-                        bestLevel2 = F.mvKeysRight[idx].octave;
-                        bestDist2  = dist;
-                    }
+                if (dist < bestDist)
+                {
+                    bestDist2  = bestDist;
+                    bestDist   = dist;
+                    bestLevel2 = bestLevel;
+                    bestLevel  = F.mvKeysRight[idx].octave;
+                    bestIdx    = idx;
                 }
-
-                // Apply ratio to second match (only if best and second are in
-                // the same scale level)
-                if (bestDist <= TH_HIGH)
+                else if (dist < bestDist2)
                 {
-                    if (bestLevel == bestLevel2 &&
-                        bestDist > mfNNratio * bestDist2)
-                        continue;
-
-                    if (F.Nleft != -1 && F.mvRightToLeftMatch[bestIdx] != -1)
-                    {  // Also match with the stereo observation at right camera
-                        F.mvpMapPoints[F.mvRightToLeftMatch[bestIdx]] = pMP;
-                        nmatches++;
-                        left++;
-                    }
+                    bestLevel2 = F.mvKeysRight[idx].octave;
+                    bestDist2  = dist;
+                }
+            }
 
+            // Apply ratio to second match (only if best and second are in
+            // the same scale level)
+            if (bestDist <= TH_HIGH)
+            {
+                if (bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
+                    return nclaimed;
 
-                    F.mvpMapPoints[bestIdx + F.Nleft] = pMP;
-                    nmatches++;
-                    right++;
+                if (F.Nleft != -1 && F.mvRightToLeftMatch[bestIdx] != -1)
+                {  // Also match with the stereo observation at right camera
+                    claim(F.mvRightToLeftMatch[bestIdx]);
+                    nclaimed++;
                 }
+
+
+                claim(bestIdx + F.Nleft);
+                nclaimed++;
             }
         }
     }
-    return nmatches;
+
+    return nclaimed;
 }
 
 float ORBmatcher::RadiusByViewingCos(const float& viewCos)
@@ -290,7 +417,8 @@ int ORBmatcher::SearchByBoW(KeyFrame*          pKF,
 
                 if (pMP->isBad()) continue;
 
-                const cv::Mat& dKF = pKF->mDescriptors.row(realIdxKF);
+                const ORBkernels::Descriptor& dKF =
+                    pKF->mvPackedDescriptors[realIdxKF];
 
                 int bestDist1 = 256;
                 int bestIdxF  = -1;
@@ -308,7 +436,8 @@ int ORBmatcher::SearchByBoW(KeyFrame*          pKF,
 
                         if (vpMapPointMatches[realIdxF]) continue;
 
-                        const cv::Mat& dF = F.mDescriptors.row(realIdxF);
+                        const ORBkernels::Descriptor& dF =
+                            F.mvPackedDescriptors[realIdxF];
 
                         const int dist = DescriptorDistance(dKF, dF);
 
@@ -329,7 +458,8 @@ int ORBmatcher::SearchByBoW(KeyFrame*          pKF,
 
                         if (vpMapPointMatches[realIdxF]) continue;
 
-                        const cv::Mat& dF = F.mDescriptors.row(realIdxF);
+                        const ORBkernels::Descriptor& dF =
+                            F.mvPackedDescriptors[realIdxF];
 
                         const int dist = DescriptorDistance(dKF, dF);
 
@@ -529,7 +659,7 @@ int ORBmatcher::SearchByProjection(KeyFrame*                pKF,
         if (vIndices.empty()) continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
         int bestDist = 256;
         int bestIdx  = -1;
@@ -546,7 +676,7 @@ int ORBmatcher::SearchByProjection(KeyFrame*                pKF,
             if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                 continue;
 
-            const cv::Mat& dKF = pKF->mDescriptors.row(idx);
+            const ORBkernels::Descriptor& dKF = pKF->mvPackedDescriptors[idx];
 
             const int dist = DescriptorDistance(dMP, dKF);
 
@@ -644,7 +774,7 @@ int ORBmatcher::SearchByProjection(KeyFrame*                     pKF,
         if (vIndices.empty()) continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
         int bestDist = 256;
         int bestIdx  = -1;
@@ -661,7 +791,7 @@ int ORBmatcher::SearchByProjection(KeyFrame*                     pKF,
             if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                 continue;
 
-            const cv::Mat& dKF = pKF->mDescriptors.row(idx);
+            const ORBkernels::Descriptor& dKF = pKF->mvPackedDescriptors[idx];
 
             const int dist = DescriptorDistance(dMP, dKF);
 
@@ -713,7 +843,7 @@ int ORBmatcher::SearchForInitialization(Frame&               F1,
 
         if (vIndices2.empty()) continue;
 
-        cv::Mat d1 = F1.mDescriptors.row(i1);
+        const ORBkernels::Descriptor& d1 = F1.mvPackedDescriptors[i1];
 
         int bestDist  = INT_MAX;
         int bestDist2 = INT_MAX;
@@ -725,7 +855,7 @@ int ORBmatcher::SearchForInitialization(Frame&               F1,
         {
             size_t i2 = *vit;
 
-            cv::Mat d2 = F2.mDescriptors.row(i2);
+            const ORBkernels::Descriptor& d2 = F2.mvPackedDescriptors[i2];
 
             int dist = DescriptorDistance(d1, d2);
 
@@ -809,12 +939,15 @@ int ORBmatcher::SearchByBoW(KeyFrame*          pKF1,
     const vector<cv::KeyPoint>& vKeysUn1     = pKF1->mvKeysUn;
     const DBoW2::FeatureVector& vFeatVec1    = pKF1->mFeatVec;
     const vector<MapPoint*>     vpMapPoints1 = pKF1->GetMapPointMatches();
-    const cv::Mat&              Descriptors1 = pKF1->mDescriptors;
 
     const vector<cv::KeyPoint>& vKeysUn2     = pKF2->mvKeysUn;
     const DBoW2::FeatureVector& vFeatVec2    = pKF2->mFeatVec;
     const vector<MapPoint*>     vpMapPoints2 = pKF2->GetMapPointMatches();
-    const cv::Mat&              Descriptors2 = pKF2->mDescriptors;
+
+    const vector<ORBkernels::Descriptor>& Descriptors1 =
+        pKF1->mvPackedDescriptors;
+    const vector<ORBkernels::Descriptor>& Descriptors2 =
+        pKF2->mvPackedDescriptors;
 
     vpMatches12 =
         vector<MapPoint*>(vpMapPoints1.size(), static_cast<MapPoint*>(NULL));
@@ -848,7 +981,7 @@ int ORBmatcher::SearchByBoW(KeyFrame*          pKF1,
                 if (!pMP1) continue;
                 if (pMP1->isBad()) continue;
 
-                const cv::Mat& d1 = Descriptors1.row(idx1);
+                const ORBkernels::Descriptor& d1 = Descriptors1[idx1];
 
                 int bestDist1 = 256;
                 int bestIdx2  = -1;
@@ -870,7 +1003,7 @@ int ORBmatcher::SearchByBoW(KeyFrame*          pKF1,
 
                     if (pMP2->isBad()) continue;
 
-                    const cv::Mat& d2 = Descriptors2.row(idx2);
+                    const ORBkernels::Descriptor& d2 = Descriptors2[idx2];
 
                     int dist = DescriptorDistance(d1, d2);
 
@@ -949,7 +1082,8 @@ int ORBmatcher::SearchForTriangulation(
     KeyFrame*                      pKF2,
     vector<pair<size_t, size_t> >& vMatchedPairs,
     const bool                     bOnlyStereo,
-    const bool                     bCoarse)
+    const bool                     bCoarse,
+    const TriangulationSearch      search)
 {
     const DBoW2::FeatureVector& vFeatVec1 = pKF1->mFeatVec;
     const DBoW2::FeatureVector& vFeatVec2 = pKF2->mFeatVec;
@@ -1007,7 +1141,21 @@ int ORBmatcher::SearchForTriangulation(
     DBoW2::FeatureVector::const_iterator f1end = vFeatVec1.end();
     DBoW2::FeatureVector::const_iterator f2end = vFeatVec2.end();
 
-    while (f1it != f1end && f2it != f2end)
+    // Epipolar lines are only straight for undistorted single cameras, and
+    // the coarse search does not trust the poses enough to use them
+    bool bBands = search == SEARCH_EPIPOLAR && !bCoarse && !pKF1->mpCamera2 &&
+                  !pKF2->mpCamera2 &&
+                  pKF1->mpCamera->GetType() == GeometricCamera::CAM_PINHOLE &&
+                  pKF2->mpCamera->GetType() == GeometricCamera::CAM_PINHOLE;
+    if (bBands)
+    {
+        nmatches =
+            SearchInEpipolarBands(pKF1, pKF2, bOnlyStereo, vMatches12, rotHist);
+        bBands = nmatches >= 0;
+        if (!bBands) nmatches = 0;
+    }
+
+    while (!bBands && f1it != f1end && f2it != f2end)
     {
         if (f1it->first == f2it->first)
         {
@@ -1038,7 +1186,8 @@ int ORBmatcher::SearchForTriangulation(
                 const bool bRight1 =
                     (pKF1->NLeft == -1 || idx1 < pKF1->NLeft) ? false : true;
 
-                const cv::Mat& d1 = pKF1->mDescriptors.row(idx1);
+                const ORBkernels::Descriptor& d1 =
+                    pKF1->mvPackedDescriptors[idx1];
 
                 int bestDist = TH_LOW;
                 int bestIdx2 = -1;
@@ -1059,7 +1208,8 @@ int ORBmatcher::SearchForTriangulation(
                     if (bOnlyStereo)
                         if (!bStereo2) continue;
 
-                    const cv::Mat& d2 = pKF2->mDescriptors.row(idx2);
+                    const ORBkernels::Descriptor& d2 =
+                        pKF2->mvPackedDescriptors[idx2];
 
                     const int dist = DescriptorDistance(d1, d2);
 
@@ -1206,6 +1356,243 @@ int ORBmatcher::SearchForTriangulation(
     return nmatches;
 }
 
+// Clip the segment p0-p1 to the box [minX, maxX] x [minY, maxY]
+// (Liang-Barsky). Returns false if it lies outside.
+static bool ClipSegment(Eigen::Vector2f& p0,
+                        Eigen::Vector2f& p1,
+                        const float      minX,
+                        const float      minY,
+                        const float      maxX,
+                        const float      maxY)
+{
+    const Eigen::Vector2f d    = p1 - p0;
+    const float           p[4] = { -d(0), d(0), -d(1), d(1) };
+    const float           q[4] = { p0(0) - minX,
+                                   maxX - p0(0),
+                                   p0(1) - minY,
+                                   maxY - p0(1) };
+
+    float t0 = 0.f, t1 = 1.f;
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0)
+        {
+            if (q[i] < 0) return false;
+            continue;
+        }
+        const float t = q[i] / p[i];
+        if (p[i] < 0)
+            t0 = max(t0, t);
+        else
+            t1 = min(t1, t);
+        if (t0 > t1) return false;
+    }
+
+    p1 = p0 + t1 * d;
+    p0 = p0 + t0 * d;
+    return true;
+}
+
+int ORBmatcher::SearchInEpipolarBands(KeyFrame*    pKF1,
+                                      KeyFrame*    pKF2,
+                                      const bool   bOnlyStereo,
+                                      vector<int>& vMatches12,
+                                      vector<int>* rotHist)
+{
+    const Sophus::SE3f    T1w = pKF1->GetPose();
+    const Sophus::SE3f    T12 = T1w * pKF2->GetPoseInverse();
+    const Sophus::SE3f    T21 = T12.inverse();
+    const Eigen::Matrix3f R12 = T12.rotationMatrix();
+    const Eigen::Vector3f t12 = T12.translation();
+    const Eigen::Matrix3f R21 = T21.rotationMatrix();
+    const Eigen::Vector3f t21 = T21.translation();
+
+    GeometricCamera* pCamera1 = pKF1->mpCamera;
+    GeometricCamera* pCamera2 = pKF2->mpCamera;
+
+    // Epipole: center of the first camera seen from the second
+    const Eigen::Vector2f ep = pCamera2->project(t21);
+
+    // Depths searched along each ray. New points are expected around the
+    // ones pKF1 already sees, the margin covers the scale change allowed by
+    // the triangulation checks.
+    float minDepth = numeric_limits<float>::max();
+    float maxDepth = 0.f;
+
+    const vector<MapPoint*> vpMapPoints1 = pKF1->GetMapPointMatches();
+    for (MapPoint* pMP : vpMapPoints1)
+    {
+        if (!pMP || pMP->isBad()) continue;
+        const float z = (T1w * pMP->GetWorldPos())(2);
+        if (z <= 0) continue;
+        minDepth = min(minDepth, z);
+        maxDepth = max(maxDepth, z);
+    }
+    if (maxDepth <= 0) return -1;
+
+    const float nearDepth = 0.5f * minDepth;
+    const float farDepth  = 2.0f * maxDepth;
+    const float minZ2     = 0.01f * nearDepth;
+
+    // Band half-width: the largest distance epipolarConstrain accepts
+    const float r = sqrt(3.84f * pKF2->mvLevelSigma2.back());
+
+    const FeatureGrid& grid  = pKF2->GetGrid();
+    const int          nCols = pKF2->mnGridCols;
+    const int          nRows = pKF2->mnGridRows;
+    const float        minX  = pKF2->mnMinX;
+    const float        minY  = pKF2->mnMinY;
+    const float        invW  = pKF2->mfGridElementWidthInv;
+    const float        invH  = pKF2->mfGridElementHeightInv;
+    const float        step  = 0.5f * min(1.0f / invW, 1.0f / invH);
+
+    // Cells in the band of the current keypoint, marked with its index
+    vector<int> vCellMark(nCols * nRows, -1);
+    vector<int> vCells;
+    vCells.reserve(nCols * nRows);
+
+    const float factor   = 1.0f / HISTO_LENGTH;
+    int         nmatches = 0;
+
+    for (int idx1 = 0; idx1 < pKF1->N; idx1++)
+    {
+        // If there is already a MapPoint skip
+        if (pKF1->GetMapPoint(idx1)) continue;
+
+        const bool bStereo1 = pKF1->mvuRight[idx1] >= 0;
+        if (bOnlyStereo && !bStereo1) continue;
+
+        const cv::KeyPoint& kp1 = pKF1->mvKeysUn[idx1];
+
+        // Ray of kp1 in the second camera, X2(d) = d * ray2 + t21, cut to the
+        // part in front of it
+        const Eigen::Vector3f ray2 = R21 * pCamera1->unprojectEig(kp1.pt);
+
+        float dMin = nearDepth;
+        float dMax = farDepth;
+        if (ray2(2) > 0)
+            dMin = max(dMin, (minZ2 - t21(2)) / ray2(2));
+        else if (ray2(2) < 0)
+            dMax = min(dMax, (minZ2 - t21(2)) / ray2(2));
+        else if (t21(2) < minZ2)
+            continue;
+        if (dMin >= dMax) continue;
+
+        const Eigen::Vector3f X0 = dMin * ray2 + t21;
+        const Eigen::Vector3f X1 = dMax * ray2 + t21;
+        Eigen::Vector2f       p0 = pCamera2->project(X0);
+        Eigen::Vector2f       p1 = pCamera2->project(X1);
+        if (!ClipSegment(p0,
+                         p1,
+                         pKF2->mnMinX - r,
+                         pKF2->mnMinY - r,
+                         pKF2->mnMaxX + r,
+                         pKF2->mnMaxY + r))
+            continue;
+
+        // Rasterize the band by stepping along the segment
+        vCells.clear();
+        const Eigen::Vector2f seg    = p1 - p0;
+        const int             nSteps = max(1, (int)ceil(seg.norm() / step));
+        for (int k = 0; k <= nSteps; k++)
+        {
+            const Eigen::Vector2f p = p0 + seg * ((float)k / nSteps);
+
+            const int nMinCellX =
+                max(0, (int)floor((p(0) - minX - r) * invW));
+            const int nMaxCellX =
+                min(nCols - 1, (int)floor((p(0) - minX + r) * invW));
+            const int nMinCellY =
+                max(0, (int)floor((p(1) - minY - r) * invH));
+            const int nMaxCellY =
+                min(nRows - 1, (int)floor((p(1) - minY + r) * invH));
+
+            for (int ix = nMinCellX; ix <= nMaxCellX; ix++)
+            {
+                for (int iy = nMinCellY; iy <= nMaxCellY; iy++)
+                {
+                    const int cell = ix * nRows + iy;
+                    if (vCellMark[cell] == idx1) continue;
+                    vCellMark[cell] = idx1;
+                    vCells.push_back(cell);
+                }
+            }
+        }
+
+        const ORBkernels::Descriptor& d1 = pKF1->mvPackedDescriptors[idx1];
+
+        int bestDist = TH_LOW;
+        int bestIdx2 = -1;
+
+        for (const int cell : vCells)
+        {
+            const int ix = cell / nRows;
+            const int iy = cell % nRows;
+            for (int j = grid.Begin(ix, iy), jend = grid.End(ix, iy); j < jend;
+                 j++)
+            {
+                const size_t idx2 = grid.vIndices[j];
+
+                // If there is a MapPoint skip
+                if (pKF2->GetMapPoint(idx2)) continue;
+
+                const bool bStereo2 = pKF2->mvuRight[idx2] >= 0;
+                if (bOnlyStereo && !bStereo2) continue;
+
+                const int dist =
+                    DescriptorDistance(d1, pKF2->mvPackedDescriptors[idx2]);
+
+                if (dist > TH_LOW || dist > bestDist) continue;
+
+                const cv::KeyPoint& kp2 = pKF2->mvKeysUn[idx2];
+
+                if (!bStereo1 && !bStereo2)
+                {
+                    const float distex = ep(0) - kp2.pt.x;
+                    const float distey = ep(1) - kp2.pt.y;
+                    if (distex * distex + distey * distey <
+                        100 * pKF2->mvScaleFactors[kp2.octave])
+                    {
+                        continue;
+                    }
+                }
+
+                if (pCamera1->epipolarConstrain(
+                        pCamera2,
+                        kp1,
+                        kp2,
+                        R12,
+                        t12,
+                        pKF1->mvLevelSigma2[kp1.octave],
+                        pKF2->mvLevelSigma2[kp2.octave]))
+                {
+                    bestIdx2 = idx2;
+                    bestDist = dist;
+                }
+            }
+        }
+
+        if (bestIdx2 >= 0)
+        {
+            const cv::KeyPoint& kp2 = pKF2->mvKeysUn[bestIdx2];
+            vMatches12[idx1]        = bestIdx2;
+            nmatches++;
+
+            if (mbCheckOrientation)
+            {
+                float rot = kp1.angle - kp2.angle;
+                if (rot < 0.0) rot += 360.0f;
+                int bin = round(rot * factor);
+                if (bin == HISTO_LENGTH) bin = 0;
+                assert(bin >= 0 && bin < HISTO_LENGTH);
+                rotHist[bin].push_back(idx1);
+            }
+        }
+    }
+
+    return nmatches;
+}
+
 int ORBmatcher::Fuse(KeyFrame*                pKF,
                      const vector<MapPoint*>& vpMapPoints,
                      const float              th,
@@ -1323,7 +1710,7 @@ int ORBmatcher::Fuse(KeyFrame*                pKF,
 
         // Match to the most similar keypoint in the radius
 
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
         int bestDist = 256;
         int bestIdx  = -1;
@@ -1368,7 +1755,7 @@ int ORBmatcher::Fuse(KeyFrame*                pKF,
 
             if (bRight) idx += pKF->NLeft;
 
-            const cv::Mat& dKF = pKF->mDescriptors.row(idx);
+            const ORBkernels::Descriptor& dKF = pKF->mvPackedDescriptors[idx];
 
             const int dist = DescriptorDistance(dMP, dKF);
 
@@ -1480,7 +1867,7 @@ int ORBmatcher::Fuse(KeyFrame*                pKF,
 
         // Match to the most similar keypoint in the radius
 
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
         int bestDist = INT_MAX;
         int bestIdx  = -1;
@@ -1494,7 +1881,7 @@ int ORBmatcher::Fuse(KeyFrame*                pKF,
             if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                 continue;
 
-            const cv::Mat& dKF = pKF->mDescriptors.row(idx);
+            const ORBkernels::Descriptor& dKF = pKF->mvPackedDescriptors[idx];
 
             int dist = DescriptorDistance(dMP, dKF);
 
@@ -1610,7 +1997,7 @@ int ORBmatcher::SearchBySim3(KeyFrame*               pKF1,
         if (vIndices.empty()) continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
         int bestDist = INT_MAX;
         int bestIdx  = -1;
@@ -1626,7 +2013,7 @@ int ORBmatcher::SearchBySim3(KeyFrame*               pKF1,
             if (kp.octave < nPredictedLevel - 1 || kp.octave > nPredictedLevel)
                 continue;
 
-            const cv::Mat& dKF = pKF2->mDescriptors.row(idx);
+            const ORBkernels::Descriptor& dKF = pKF2->mvPackedDescriptors[idx];
 
             const int dist = DescriptorDistance(dMP, dKF);
 
@@ -1687,7 +2074,7 @@ int ORBmatcher::SearchBySim3(KeyFrame*               pKF1,
         if (vIndices.empty()) continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
         int bestDist = INT_MAX;
         int bestIdx  = -1;
@@ -1703,7 +2090,7 @@ int ORBmatcher::SearchBySim3(KeyFrame*               pKF1,
             if (kp.octave < nPredictedLevel - 1 || kp.octave > nPredictedLevel)
                 continue;
 
-            const cv::Mat& dKF = pKF1->mDescriptors.row(idx);
+            const ORBkernels::Descriptor& dKF = pKF1->mvPackedDescriptors[idx];
 
             const int dist = DescriptorDistance(dMP, dKF);
 
@@ -1816,17 +2203,24 @@ int ORBmatcher::SearchByProjection(Frame&       CurrentFrame,
 
                 if (vIndices2.empty()) continue;
 
-                const cv::Mat dMP = pMP->GetDescriptor();
+                const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
+
+                // Distances to all the candidates at once
+                const int nCandidates = (int)vIndices2.size();
+                mvDistances.resize(nCandidates);
+                ORBkernels::Distances(dMP,
+                                      CurrentFrame.mvPackedDescriptors.data(),
+                                      vIndices2.data(),
+                                      nCandidates,
+                                      mKernelLevel,
+                                      mvDistances.data());
 
                 int bestDist = 256;
                 int bestIdx2 = -1;
 
-                for (vector<size_t>::const_iterator vit  = vIndices2.begin(),
-                                                    vend = vIndices2.end();
-                     vit != vend;
-                     vit++)
+                for (int k = 0; k < nCandidates; k++)
                 {
-                    const size_t i2 = *vit;
+                    const size_t i2 = vIndices2[k];
 
                     if (CurrentFrame.mvpMapPoints[i2])
                         if (CurrentFrame.mvpMapPoints[i2]->Observations() > 0)
@@ -1840,9 +2234,7 @@ int ORBmatcher::SearchByProjection(Frame&       CurrentFrame,
                         if (er > radius) continue;
                     }
 
-                    const cv::Mat& d = CurrentFrame.mDescriptors.row(i2);
-
-                    const int dist = DescriptorDistance(dMP, d);
+                    const int dist = mvDistances[k];
 
                     if (dist < bestDist)
                     {
@@ -1919,7 +2311,8 @@ int ORBmatcher::SearchByProjection(Frame&       CurrentFrame,
                                                            nLastOctave + 1,
                                                            true);
 
-                    const cv::Mat dMP = pMP->GetDescriptor();
+                    const ORBkernels::Descriptor dMP =
+                        pMP->GetPackedDescriptor();
 
                     int bestDist = 256;
                     int bestIdx2 = -1;
@@ -1936,8 +2329,9 @@ int ORBmatcher::SearchByProjection(Frame&       CurrentFrame,
                                     ->Observations() > 0)
                                 continue;
 
-                        const cv::Mat& d = CurrentFrame.mDescriptors.row(
-                            i2 + CurrentFrame.Nleft);
+                        const ORBkernels::Descriptor& d =
+                            CurrentFrame
+                                .mvPackedDescriptors[i2 + CurrentFrame.Nleft];
 
                         const int dist = DescriptorDistance(dMP, d);
 
@@ -2067,7 +2461,7 @@ int ORBmatcher::SearchByProjection(Frame&                CurrentFrame,
 
                 if (vIndices2.empty()) continue;
 
-                const cv::Mat dMP = pMP->GetDescriptor();
+                const ORBkernels::Descriptor dMP = pMP->GetPackedDescriptor();
 
                 int bestDist = 256;
                 int bestIdx2 = -1;
@@ -2079,7 +2473,8 @@ int ORBmatcher::SearchByProjection(Frame&                CurrentFrame,
                     const size_t i2 = *vit;
                     if (CurrentFrame.mvpMapPoints[i2]) continue;
 
-                    const cv::Mat& d = CurrentFrame.mDescriptors.row(i2);
+                    const ORBkernels::Descriptor& d =
+                        CurrentFrame.mvPackedDescriptors[i2];
 
                     const int dist = DescriptorDistance(dMP, d);
 
@@ -28,6 +28,7 @@
 #include <opencv2/features2d/features2d.hpp>
 #include <sophus/sim3.hpp>
 
+#include "feature/ORBkernels.h"
 #include "map/MapPoint.h"
 
 #include "frame/Frame.h"
@@ -36,14 +37,29 @@
 namespace ORB_SLAM3
 {
 
+class ThreadPool;
+
 class ORBmatcher
 {
 public:
+    // Candidates compared by SearchForTriangulation
+    enum TriangulationSearch
+    {
+        SEARCH_BOW      = 0,  // Keypoints in the same vocabulary node
+        SEARCH_EPIPOLAR = 1   // Keypoints near the epipolar segment
+    };
+
     ORBmatcher(float nnratio = 0.6, bool checkOri = true);
 
     // Computes the Hamming distance between two ORB descriptors
     static int DescriptorDistance(const cv::Mat& a, const cv::Mat& b);
 
+    static inline int DescriptorDistance(const ORBkernels::Descriptor& a,
+                                         const ORBkernels::Descriptor& b)
+    {
+        return ORBkernels::Distance(a, b);
+    }
+
     // Search matches between Frame keypoints and projected MapPoints. Returns
     // number of matches Used to track the local map (Tracking)
     int SearchByProjection(Frame&                        F,
@@ -52,6 +68,17 @@ public:
                            const bool                    bFarPoints  = false,
                            const float                   thFarPoints = 50.0f);
 
+    // Same as above with the MapPoints split over the threads of pPool. The
+    // matches are the same as the serial search: claims on a keypoint are
+    // settled in the order of vpMapPoints.
+    int SearchByProjectionParallel(
+        Frame&                        F,
+        const std::vector<MapPoint*>& vpMapPoints,
+        ThreadPool*                   pPool,
+        const float                   th          = 3,
+        const bool                    bFarPoints  = false,
+        const float                   thFarPoints = 50.0f);
+
     // Project MapPoints tracked in last frame into the current frame and search
     // matches. Used to track from previous frame (Tracking)
     int SearchByProjection(Frame&       CurrentFrame,
@@ -105,12 +132,15 @@ public:
                                 int                       windowSize = 10);
 
     // Matching to triangulate new MapPoints. Check Epipolar Constraint.
+    // SEARCH_EPIPOLAR needs single pinhole cameras and a fine pose, the
+    // vocabulary nodes are used otherwise.
     int SearchForTriangulation(
         KeyFrame*                           pKF1,
         KeyFrame*                           pKF2,
         std::vector<pair<size_t, size_t> >& vMatchedPairs,
         const bool                          bOnlyStereo,
-        const bool                          bCoarse = false);
+        const bool                          bCoarse = false,
+        const TriangulationSearch           search  = SEARCH_BOW);
 
     // Search matches between MapPoints seen in KF1 and KF2 transforming by a
     // Sim3 [s12*R12|t12] In the stereo and RGB-D case, s12=1 int
@@ -144,6 +174,35 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
 protected:
+    // Matches of one MapPoint computed without touching the frame
+    struct LocalPointMatch
+    {
+        std::vector<size_t> vReads;      // Entries of F.mvpMapPoints looked at
+        size_t              vWrites[4];  // Entries claimed by the MapPoint
+        int                 nWrites;
+    };
+
+    // Match one MapPoint of the local map against F. Claims are written to
+    // pMatch when given, and read through it before F, directly otherwise.
+    // Returns the number of keypoints claimed.
+    int MatchLocalPoint(Frame&            F,
+                        MapPoint*         pMP,
+                        const float       th,
+                        const bool        bFarPoints,
+                        const float       thFarPoints,
+                        std::vector<int>& vDistances,
+                        LocalPointMatch*  pMatch);
+
+    // Matches of SearchForTriangulation among the keypoints of pKF2 in a band
+    // around the epipolar segment of each keypoint of pKF1. The segment spans
+    // the depths of the MapPoints pKF1 already sees, with a margin. Returns
+    // the number of matches, or -1 if pKF1 has no MapPoint to bound it.
+    int SearchInEpipolarBands(KeyFrame*         pKF1,
+                              KeyFrame*         pKF2,
+                              const bool        bOnlyStereo,
+                              std::vector<int>& vMatches12,
+                              std::vector<int>* rotHist);
+
     float RadiusByViewingCos(const float& viewCos);
 
     void ComputeThreeMaxima(std::vector<int>* histo,
@@ -154,6 +213,15 @@ protected:
 
     float mfNNratio;
     bool  mbCheckOrientation;
+
+    // Instruction set of the one to many distances, and their output
+    ORBkernels::Level mKernelLevel;
+    std::vector<int>  mvDistances;
+
+    // Work buffers of SearchByProjectionParallel
+    std::vector<LocalPointMatch>  mvLocalMatches;
+    std::vector<std::vector<int>> mvvBlockDistances;
+    std::vector<bool>             mvbClaimed;
 };
 
 }  // namespace ORB_SLAM3
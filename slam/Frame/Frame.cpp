@@ -40,7 +40,7 @@
 namespace ORB_SLAM3
 {
 
-long unsigned int Frame::nNextId               = 0;
+std::atomic<long unsigned int> Frame::nNextId{ 0 };
 bool              Frame::mbInitialComputations = true;
 float Frame::cx, Frame::cy, Frame::fx, Frame::fy, Frame::invfx, Frame::invfy;
 float Frame::mnMinX, Frame::mnMinY, Frame::mnMaxX, Frame::mnMaxY;
@@ -185,7 +185,8 @@ Frame::Frame(const cv::Mat&    imLeft,
              const float&      thDepth,
              GeometricCamera*  pCamera,
              Frame*            pPrevF,
-             const IMU::Calib& ImuCalib)
+             const IMU::Calib& ImuCalib,
+             const cv::Mat&    mask)
     : mpcpi(nullptr)
     , mpORBvocabulary(voc)
     , mpORBextractorLeft(extractorLeft)
@@ -221,14 +222,16 @@ Frame::Frame(const cv::Mat&    imLeft,
     mvInvLevelSigma2  = mpORBextractorLeft->GetInverseScaleSigmaSquares();
 
     // ORB extraction
-    thread threadLeft(&Frame::ExtractORB, this, 0, imLeft, 0, 0);
-    thread threadRight(&Frame::ExtractORB, this, 1, imRight, 0, 0);
+    thread threadLeft(&Frame::ExtractORB, this, 0, imLeft, 0, 0, mask);
+    thread threadRight(&Frame::ExtractORB, this, 1, imRight, 0, 0, cv::Mat());
     threadLeft.join();
     threadRight.join();
 
     N = mvKeys.size();
     if (mvKeys.empty()) return;
 
+    ORBkernels::PackDescriptors(mDescriptors, mvPackedDescriptors);
+
     UndistortKeyPoints();
 
     ComputeStereoMatches();
@@ -296,7 +299,8 @@ Frame::Frame(const cv::Mat&    imGray,
              const float&      thDepth,
              GeometricCamera*  pCamera,
              Frame*            pPrevF,
-             const IMU::Calib& ImuCalib)
+             const IMU::Calib& ImuCalib,
+             const cv::Mat&    mask)
     : mpcpi(nullptr)
     , mpORBvocabulary(voc)
     , mpORBextractorLeft(extractor)
@@ -332,13 +336,15 @@ Frame::Frame(const cv::Mat&    imGray,
     mvInvLevelSigma2  = mpORBextractorLeft->GetInverseScaleSigmaSquares();
 
     // ORB extraction
-    ExtractORB(0, imGray, 0, 0);
+    ExtractORB(0, imGray, 0, 0, mask);
 
 
     N = (int)mvKeys.size();
 
     if (mvKeys.empty()) return;
 
+    ORBkernels::PackDescriptors(mDescriptors, mvPackedDescriptors);
+
     UndistortKeyPoints();
 
     ComputeStereoFromRGBD(imDepth);
@@ -406,7 +412,8 @@ Frame::Frame(const cv::Mat&    imGray,
              const float&      bf,
              const float&      thDepth,
              Frame*            pPrevF,
-             const IMU::Calib& ImuCalib)
+             const IMU::Calib& ImuCalib,
+             const cv::Mat&    mask)
     : mpORBvocabulary(voc)
     , mpORBextractorLeft(extractor)
     , mTimeStamp(timeStamp)
@@ -436,12 +443,14 @@ Frame::Frame(const cv::Mat&    imGray,
     mvInvLevelSigma2  = mpORBextractorLeft->GetInverseScaleSigmaSquares();
 
     // ORB extraction
-    ExtractORB(0, imGray, 0, 1000);
+    ExtractORB(0, imGray, 0, 1000, mask);
 
 
     N = (int)mvKeys.size();
     if (mvKeys.empty()) return;
 
+    ORBkernels::PackDescriptors(mDescriptors, mvPackedDescriptors);
+
     UndistortKeyPoints();
 
     // Set no stereo information
@@ -507,24 +516,105 @@ Frame::Frame(const cv::Mat&    imGray,
     mpMutexImu = new std::mutex();
 }
 
+Frame::Frame(const Frame&                    lastFrame,
+             const double&                   timeStamp,
+             const std::vector<int>&         vIndices,
+             const std::vector<cv::Point2f>& vPoints,
+             const cv::Mat&                  imDepth)
+    : mpORBvocabulary(lastFrame.mpORBvocabulary)
+    , mpORBextractorLeft(lastFrame.mpORBextractorLeft)
+    , mTimeStamp(timeStamp)
+    , mK(lastFrame.mK)
+    , mK_(lastFrame.mK_)
+    , mDistCoef(lastFrame.mDistCoef)
+    , mbf(lastFrame.mbf)
+    , mb(lastFrame.mb)
+    , mThDepth(lastFrame.mThDepth)
+    , mImuCalib(lastFrame.mImuCalib)
+    , mpPrevFrame(nullptr)
+    , mpCamera(lastFrame.mpCamera)
+    , mpCamera2(nullptr)
+    , mbHasVelocity(false)
+{
+    assert(vIndices.size() == vPoints.size());
+
+    // Frame ID, only reserved: the caller takes it once the frame is kept
+    mnId = nNextId;
+
+    // Scale Level Info
+    mnScaleLevels     = lastFrame.mnScaleLevels;
+    mfScaleFactor     = lastFrame.mfScaleFactor;
+    mfLogScaleFactor  = lastFrame.mfLogScaleFactor;
+    mvScaleFactors    = lastFrame.mvScaleFactors;
+    mvInvScaleFactors = lastFrame.mvInvScaleFactors;
+    mvLevelSigma2     = lastFrame.mvLevelSigma2;
+    mvInvLevelSigma2  = lastFrame.mvInvLevelSigma2;
+
+    // Tracked keypoints keep the octave, angle and descriptor they were
+    // extracted with
+    N = (int)vIndices.size();
+    mvKeys.resize(N);
+    mDescriptors.create(N, 32, CV_8U);
+    mvPackedDescriptors.resize(N);
+    mvpMapPoints.resize(N);
+    for (int i = 0; i < N; i++)
+    {
+        const int idx = vIndices[i];
+
+        mvKeys[i]    = lastFrame.mvKeys[idx];
+        mvKeys[i].pt = vPoints[i];
+        lastFrame.mDescriptors.row(idx).copyTo(mDescriptors.row(i));
+        mvPackedDescriptors[i] = lastFrame.mvPackedDescriptors[idx];
+        mvpMapPoints[i]        = lastFrame.mvpMapPoints[idx];
+    }
+
+    mvbOutlier = vector<bool>(N, false);
+
+    mmProjectPoints.clear();
+    mmMatchedInImage.clear();
+
+    if (N == 0) return;
+
+    UndistortKeyPoints();
+
+    if (imDepth.empty())
+    {
+        mvuRight = vector<float>(N, -1);
+        mvDepth  = vector<float>(N, -1);
+    }
+    else
+    {
+        ComputeStereoFromRGBD(imDepth);
+    }
+    mnCloseMPs = 0;
+
+    // Set no stereo fisheye information
+    Nleft              = -1;
+    Nright             = -1;
+    mvLeftToRightMatch = vector<int>(0);
+    mvRightToLeftMatch = vector<int>(0);
+    mvStereo3Dpoints   = vector<Eigen::Vector3f>(0);
+    monoLeft           = -1;
+    monoRight          = -1;
+
+    AssignFeaturesToGrid();
+
+    mVw.setZero();
+
+    mpMutexImu = new std::mutex();
+}
+
 
 void Frame::AssignFeaturesToGrid()
 {
-    // Fill matrix with points
+    // Counting sort of the keypoints by cell
     const int nCells = FRAME_GRID_COLS * FRAME_GRID_ROWS;
 
-    int nReserve = 0.5f * N / (nCells);
-
-    for (unsigned int i = 0; i < FRAME_GRID_COLS; i++)
-        for (unsigned int j = 0; j < FRAME_GRID_ROWS; j++)
-        {
-            mGrid[i][j].reserve(nReserve);
-            if (Nleft != -1)
-            {
-                mGridRight[i][j].reserve(nReserve);
-            }
-        }
+    mGrid.vOffsets.assign(nCells + 1, 0);
+    mGridRight.vOffsets.assign(nCells + 1, 0);
 
+    // Cell of every keypoint, -1 when out of the grid
+    vector<int> vCells(N, -1);
 
     for (int i = 0; i < N; i++)
     {
@@ -535,26 +625,59 @@ void Frame::AssignFeaturesToGrid()
         int nGridPosX, nGridPosY;
         if (PosInGrid(kp, nGridPosX, nGridPosY))
         {
-            if (Nleft == -1 || i < Nleft)
-                mGrid[nGridPosX][nGridPosY].push_back(i);
-            else
-                mGridRight[nGridPosX][nGridPosY].push_back(i - Nleft);
+            vCells[i] = nGridPosX * FRAME_GRID_ROWS + nGridPosY;
+
+            FeatureGrid& grid = (Nleft == -1 || i < Nleft) ? mGrid : mGridRight;
+            grid.vOffsets[vCells[i] + 1]++;
         }
     }
+
+    for (int c = 0; c < nCells; c++)
+    {
+        mGrid.vOffsets[c + 1] += mGrid.vOffsets[c];
+        mGridRight.vOffsets[c + 1] += mGridRight.vOffsets[c];
+    }
+
+    mGrid.vIndices.resize(mGrid.vOffsets[nCells]);
+    mGridRight.vIndices.resize(mGridRight.vOffsets[nCells]);
+
+    // Fill the cells using the offsets as cursors, each one ends on the
+    // start of the next cell
+    for (int i = 0; i < N; i++)
+    {
+        if (vCells[i] < 0) continue;
+
+        if (Nleft == -1 || i < Nleft)
+            mGrid.vIndices[mGrid.vOffsets[vCells[i]]++] = i;
+        else
+            mGridRight.vIndices[mGridRight.vOffsets[vCells[i]]++] = i - Nleft;
+    }
+
+    for (int c = nCells; c > 0; c--)
+    {
+        mGrid.vOffsets[c]      = mGrid.vOffsets[c - 1];
+        mGridRight.vOffsets[c] = mGridRight.vOffsets[c - 1];
+    }
+    mGrid.vOffsets[0]      = 0;
+    mGridRight.vOffsets[0] = 0;
 }
 
-void Frame::ExtractORB(int flag, const cv::Mat& im, const int x0, const int x1)
+void Frame::ExtractORB(int            flag,
+                       const cv::Mat& im,
+                       const int      x0,
+                       const int      x1,
+                       const cv::Mat& mask)
 {
     vector<int> vLapping = { x0, x1 };
     if (flag == 0)
         monoLeft = (*mpORBextractorLeft)(im,
-                                         cv::Mat(),
+                                         mask,
                                          mvKeys,
                                          mDescriptors,
                                          vLapping);
     else
         monoRight = (*mpORBextractorRight)(im,
-                                           cv::Mat(),
+                                           mask,
                                            mvKeysRight,
                                            mDescriptorsRight,
                                            vLapping);
@@ -844,15 +967,15 @@ vector<size_t> Frame::GetFeaturesInArea(const float& x,
     {
         for (int iy = nMinCellY; iy <= nMaxCellY; iy++)
         {
-            const vector<size_t> vCell =
-                (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
-            if (vCell.empty()) continue;
+            const FeatureGrid& grid = (!bRight) ? mGrid : mGridRight;
 
-            for (size_t j = 0, jend = vCell.size(); j < jend; j++)
+            for (int j = grid.Begin(ix, iy), jend = grid.End(ix, iy); j < jend;
+                 j++)
             {
-                const cv::KeyPoint& kpUn = (Nleft == -1) ? mvKeysUn[vCell[j]]
-                                         : (!bRight)     ? mvKeys[vCell[j]]
-                                                     : mvKeysRight[vCell[j]];
+                const size_t        idx  = grid.vIndices[j];
+                const cv::KeyPoint& kpUn = (Nleft == -1) ? mvKeysUn[idx]
+                                         : (!bRight)     ? mvKeys[idx]
+                                                         : mvKeysRight[idx];
                 if (bCheckLevels)
                 {
                     if (kpUn.octave < minLevel) continue;
@@ -864,7 +987,7 @@ vector<size_t> Frame::GetFeaturesInArea(const float& x,
                 const float disty = kpUn.pt.y - y;
 
                 if (fabs(distx) < factorX && fabs(disty) < factorY)
-                    vIndices.push_back(vCell[j]);
+                    vIndices.push_back(idx);
             }
         }
     }
@@ -891,9 +1014,7 @@ void Frame::ComputeBoW()
 {
     if (mBowVec.empty())
     {
-        vector<cv::Mat> vCurrentDesc =
-            Converter::toDescriptorVector(mDescriptors);
-        mpORBvocabulary->transform(vCurrentDesc, mBowVec, mFeatVec, 4);
+        mpORBvocabulary->transform(mvPackedDescriptors, mBowVec, mFeatVec, 4);
     }
 }
 
@@ -1262,14 +1383,16 @@ Frame::Frame(const cv::Mat&    imLeft,
                       0,
                       imLeft,
                       static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[0],
-                      static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[1]);
+                      static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[1],
+                      cv::Mat());
     thread threadRight(
         &Frame::ExtractORB,
         this,
         1,
         imRight,
         static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[0],
-        static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[1]);
+        static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[1],
+        cv::Mat());
     threadLeft.join();
     threadRight.join();
 #ifdef REGISTER_TIMES
@@ -1334,6 +1457,7 @@ Frame::Frame(const cv::Mat&    imLeft,
 
     // Put all descriptors in the same matrix
     cv::vconcat(mDescriptors, mDescriptorsRight, mDescriptors);
+    ORBkernels::PackDescriptors(mDescriptors, mvPackedDescriptors);
 
     mvpMapPoints = vector<MapPoint*>(N, static_cast<MapPoint*>(nullptr));
     mvbOutlier   = vector<bool>(N, false);
@@ -22,7 +22,7 @@
 
 #ifndef FRAME_H
 #define FRAME_H
-#include <array>
+#include <atomic>
 #include <mutex>
 #include <vector>
 
@@ -37,6 +37,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "feature/ORBVocabulary.h"
+#include "feature/ORBkernels.h"
 
 #include "utils/Converter.h"
 #include "utils/ImuTypes.h"
@@ -49,6 +50,28 @@ namespace ORB_SLAM3
 static constexpr int FRAME_GRID_ROWS = 48;
 static constexpr int FRAME_GRID_COLS = 64;
 
+// Keypoint indices bucketed by grid cell in compressed row storage. The
+// keypoints of cell (ix, iy) are vIndices[Begin(ix, iy)] to
+// vIndices[End(ix, iy) - 1], in increasing order. A grid that was never
+// filled, e.g. of a frame without keypoints, has all cells empty.
+struct FeatureGrid
+{
+    FeatureGrid() : vOffsets(FRAME_GRID_COLS * FRAME_GRID_ROWS + 1, 0) {}
+
+    int Begin(int ix, int iy) const
+    {
+        return vOffsets[ix * FRAME_GRID_ROWS + iy];
+    }
+    int End(int ix, int iy) const
+    {
+        return vOffsets[ix * FRAME_GRID_ROWS + iy + 1];
+    }
+
+    // FRAME_GRID_COLS * FRAME_GRID_ROWS + 1 offsets into vIndices
+    std::vector<int>    vOffsets;
+    std::vector<size_t> vIndices;
+};
+
 class MapPoint;
 class KeyFrame;
 class ConstraintPoseImu;
@@ -76,7 +99,8 @@ public:
           const float&      thDepth,
           GeometricCamera*  pCamera,
           Frame*            pPrevF   = static_cast<Frame*>(NULL),
-          const IMU::Calib& ImuCalib = IMU::Calib());
+          const IMU::Calib& ImuCalib = IMU::Calib(),
+          const cv::Mat&    mask     = cv::Mat());
 
     // Constructor for RGB-D cameras.
     Frame(const cv::Mat&    imGray,
@@ -90,7 +114,8 @@ public:
           const float&      thDepth,
           GeometricCamera*  pCamera,
           Frame*            pPrevF   = static_cast<Frame*>(NULL),
-          const IMU::Calib& ImuCalib = IMU::Calib());
+          const IMU::Calib& ImuCalib = IMU::Calib(),
+          const cv::Mat&    mask     = cv::Mat());
 
     // Constructor for Monocular cameras.
     Frame(const cv::Mat&    imGray,
@@ -102,7 +127,19 @@ public:
           const float&      bf,
           const float&      thDepth,
           Frame*            pPrevF   = static_cast<Frame*>(NULL),
-          const IMU::Calib& ImuCalib = IMU::Calib());
+          const IMU::Calib& ImuCalib = IMU::Calib(),
+          const cv::Mat&    mask     = cv::Mat());
+
+    // Constructor for frames tracked with optical flow, without ORB
+    // extraction. Keypoint vIndices[i] of lastFrame is moved to vPoints[i] and
+    // keeps its descriptor and map point. imDepth is empty for monocular.
+    // Frame::nNextId is not advanced, the caller assigns mnId from it if the
+    // frame is kept.
+    Frame(const Frame&                    lastFrame,
+          const double&                   timeStamp,
+          const std::vector<int>&         vIndices,
+          const std::vector<cv::Point2f>& vPoints,
+          const cv::Mat&                  imDepth);
 
     // Destructor
     ~Frame() = default;
@@ -112,17 +149,28 @@ private:
     Frame& operator=(const Frame&) = default;
 
 public:
+    // Frames are moved between slots in Tracking, deep copies are explicit.
+    Frame(Frame&&)            = default;
+    Frame& operator=(Frame&&) = default;
+
     void copyFrom(const Frame& rhs) noexcept;
 
+    // Rebuild this frame in place. The temporary is moved from, so its
+    // buffers are taken over without cloning.
     template <typename... Args>
     void reset(Args&&... args)
     {
-        this->copyFrom(Frame(std::forward<Args&&>(args)...));
+        *this = Frame(std::forward<Args>(args)...);
     }
 
 public:
     // Extract ORB on the image. 0 for left image and 1 for right image.
-    void ExtractORB(int flag, const cv::Mat& im, const int x0, const int x1);
+    // Features are only detected where mask is not zero, if it is not empty.
+    void ExtractORB(int            flag,
+                    const cv::Mat& im,
+                    const int      x0,
+                    const int      x1,
+                    const cv::Mat& mask);
 
     // Compute Bag of Words representation.
     void ComputeBoW();
@@ -299,6 +347,9 @@ public:
     // ORB descriptor, each row associated to a keypoint.
     cv::Mat mDescriptors, mDescriptorsRight;
 
+    // Rows of mDescriptors packed for the matcher.
+    std::vector<ORBkernels::Descriptor> mvPackedDescriptors;
+
     // MapPoints associated to keypoints, NULL pointer if no association.
     // Flag to identify outlier associations.
     std::vector<bool> mvbOutlier;
@@ -308,10 +359,7 @@ public:
     // when projecting MapPoints.
     static float mfGridElementWidthInv;
     static float mfGridElementHeightInv;
-    // std::vector<std::size_t> mGrid[FRAME_GRID_COLS][FRAME_GRID_ROWS];
-    std::array<std::array<std::vector<size_t>, FRAME_GRID_ROWS>,
-               FRAME_GRID_COLS>
-        mGrid;
+    FeatureGrid  mGrid;
 
     IMU::Bias mPredBias;
 
@@ -329,9 +377,10 @@ public:
     Frame*              mpPrevFrame;
     IMU::Preintegrated* mpImuPreintegratedFrame = nullptr;
 
-    // Current and Next Frame id.
-    static long unsigned int nNextId;
-    long unsigned int        mnId;
+    // Current and Next Frame id. Atomic because frames may be built on the
+    // feature stage of the front-end while tracking resets the counter.
+    static std::atomic<long unsigned int> nNextId;
+    long unsigned int                     mnId;
 
     // Reference Keyframe.
     KeyFrame* mpReferenceKF = nullptr;
@@ -400,10 +449,7 @@ public:
     std::vector<Eigen::Vector3f> mvStereo3Dpoints;
 
     // Grid for the right image
-    //  std::vector<std::size_t> mGridRight[FRAME_GRID_COLS][FRAME_GRID_ROWS];
-    std::array<std::array<std::vector<size_t>, FRAME_GRID_ROWS>,
-               FRAME_GRID_COLS>
-        mGridRight;
+    FeatureGrid mGridRight;
 
     Frame(const cv::Mat&    imLeft,
           const cv::Mat&    imRight,
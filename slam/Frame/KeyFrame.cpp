@@ -20,6 +20,8 @@
  */
 
 #include "frame/KeyFrame.h"
+#include <algorithm>
+#include <functional>
 #include <mutex>
 
 #include "frame/KeyFrameDatabase.h"
@@ -44,12 +46,6 @@ KeyFrame::KeyFrame()
     , mnBALocalForKF(0)
     , mnBAFixedForKF(0)
     , mnBALocalForMerge(0)
-    , mnLoopQuery(0)
-    , mnLoopWords(0)
-    , mnRelocQuery(0)
-    , mnRelocWords(0)
-    , mnMergeQuery(0)
-    , mnMergeWords(0)
     , mnBAGlobalForKF(0)
     , fx(0)
     , fy(0)
@@ -57,9 +53,6 @@ KeyFrame::KeyFrame()
     , cy(0)
     , invfx(0)
     , invfy(0)
-    , mnPlaceRecognitionQuery(0)
-    , mnPlaceRecognitionWords(0)
-    , mPlaceRecognitionScore(0)
     , mbf(0)
     , mb(0)
     , mThDepth(0)
@@ -68,6 +61,7 @@ KeyFrame::KeyFrame()
     , mvKeysUn{}
     , mvuRight{}
     , mvDepth{}
+    , mvPackedDescriptors{}
     , mnScaleLevels(0)
     , mfScaleFactor(0)
     , mfLogScaleFactor(0)
@@ -107,14 +101,7 @@ KeyFrame::KeyFrame(Frame& F, Map* pMap, KeyFrameDatabase* pKFDB)
     , mnBALocalForKF(0)
     , mnBAFixedForKF(0)
     , mnBALocalForMerge(0)
-    , mnLoopQuery(0)
-    , mnLoopWords(0)
-    , mnRelocQuery(0)
-    , mnRelocWords(0)
     , mnBAGlobalForKF(0)
-    , mnPlaceRecognitionQuery(0)
-    , mnPlaceRecognitionWords(0)
-    , mPlaceRecognitionScore(0)
     , fx(F.fx)
     , fy(F.fy)
     , cx(F.cx)
@@ -130,6 +117,7 @@ KeyFrame::KeyFrame(Frame& F, Map* pMap, KeyFrameDatabase* pKFDB)
     , mvuRight(F.mvuRight)
     , mvDepth(F.mvDepth)
     , mDescriptors(F.mDescriptors.clone())
+    , mvPackedDescriptors(F.mvPackedDescriptors)
     , mBowVec(F.mBowVec)
     , mFeatVec(F.mFeatVec)
     , mnScaleLevels(F.mnScaleLevels)
@@ -176,21 +164,8 @@ KeyFrame::KeyFrame(Frame& F, Map* pMap, KeyFrameDatabase* pKFDB)
 {
     mnId = nNextId++;
 
-    mGrid.resize(mnGridCols);
-    if (F.Nleft != -1) mGridRight.resize(mnGridCols);
-    for (int i = 0; i < mnGridCols; i++)
-    {
-        mGrid[i].resize(mnGridRows);
-        if (F.Nleft != -1) mGridRight[i].resize(mnGridRows);
-        for (int j = 0; j < mnGridRows; j++)
-        {
-            mGrid[i][j] = F.mGrid[i][j];
-            if (F.Nleft != -1)
-            {
-                mGridRight[i][j] = F.mGridRight[i][j];
-            }
-        }
-    }
+    mGrid = F.mGrid;
+    if (F.Nleft != -1) mGridRight = F.mGridRight;
 
 
     if (!F.HasVelocity())
@@ -214,15 +189,18 @@ void KeyFrame::ComputeBoW()
 {
     if (mBowVec.empty() || mFeatVec.empty())
     {
-        vector<cv::Mat> vCurrentDesc =
-            Converter::toDescriptorVector(mDescriptors);
         // Feature vector associate features with nodes in the 4th level (from
         // leaves up) We assume the vocabulary tree has 6 levels, change the 4
         // otherwise
-        mpORBvocabulary->transform(vCurrentDesc, mBowVec, mFeatVec, 4);
+        mpORBvocabulary->transform(mvPackedDescriptors, mBowVec, mFeatVec, 4);
     }
 }
 
+static Sophus::SE3f PoseFromParams(const float* params)
+{
+    return Sophus::SE3f(Eigen::Map<const Sophus::SE3f>(params));
+}
+
 void KeyFrame::SetPose(const Sophus::SE3f& Tcw)
 {
     unique_lock<mutex> lock(mMutexPose);
@@ -232,6 +210,11 @@ void KeyFrame::SetPose(const Sophus::SE3f& Tcw)
     mTwc = mTcw.inverse();
     mRwc = mTwc.rotationMatrix();
 
+    PoseSnapshot snapshot;
+    Eigen::Map<Eigen::Matrix<float, 7, 1>>(snapshot.Tcw) = mTcw.params();
+    Eigen::Map<Eigen::Matrix<float, 7, 1>>(snapshot.Twc) = mTwc.params();
+    mPoseSnapshot.Store(snapshot);
+
     if (mImuCalib.mbIsSet)  // TODO Use a flag instead of the OpenCV matrix
     {
         mOwb = mRwc * mImuCalib.mTcb.translation() + mTwc.translation();
@@ -247,20 +230,18 @@ void KeyFrame::SetVelocity(const Eigen::Vector3f& Vw)
 
 Sophus::SE3f KeyFrame::GetPose()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTcw;
+    return PoseFromParams(mPoseSnapshot.Load().Tcw);
 }
 
 Sophus::SE3f KeyFrame::GetPoseInverse()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTwc;
+    return PoseFromParams(mPoseSnapshot.Load().Twc);
 }
 
 Eigen::Vector3f KeyFrame::GetCameraCenter()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTwc.translation();
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Eigen::Map<const Eigen::Vector3f>(snapshot.Twc + 4);
 }
 
 Eigen::Vector3f KeyFrame::GetImuPosition()
@@ -283,14 +264,15 @@ Sophus::SE3f KeyFrame::GetImuPose()
 
 Eigen::Matrix3f KeyFrame::GetRotation()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mRcw;
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Eigen::Map<const Eigen::Quaternionf>(snapshot.Tcw)
+        .toRotationMatrix();
 }
 
 Eigen::Vector3f KeyFrame::GetTranslation()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTcw.translation();
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Eigen::Map<const Eigen::Vector3f>(snapshot.Tcw + 4);
 }
 
 Eigen::Vector3f KeyFrame::GetVelocity()
@@ -305,14 +287,26 @@ bool KeyFrame::isVelocitySet()
     return mbHasVelocity;
 }
 
+vector<pair<KeyFrame*, int>>::iterator KeyFrame::FindConnection(KeyFrame* pKF)
+{
+    return lower_bound(mConnectedKeyFrameWeights.begin(),
+                       mConnectedKeyFrameWeights.end(),
+                       pKF,
+                       [](const pair<KeyFrame*, int>& connection, KeyFrame* p)
+                       {
+                           return connection.first < p;
+                       });
+}
+
 void KeyFrame::AddConnection(KeyFrame* pKF, const int& weight)
 {
     {
         unique_lock<mutex> lock(mMutexConnections);
-        if (!mConnectedKeyFrameWeights.count(pKF))
-            mConnectedKeyFrameWeights[pKF] = weight;
-        else if (mConnectedKeyFrameWeights[pKF] != weight)
-            mConnectedKeyFrameWeights[pKF] = weight;
+        vector<pair<KeyFrame*, int>>::iterator it = FindConnection(pKF);
+        if (it == mConnectedKeyFrameWeights.end() || it->first != pKF)
+            mConnectedKeyFrameWeights.insert(it, make_pair(pKF, weight));
+        else if (it->second != weight)
+            it->second = weight;
         else
             return;
     }
@@ -322,39 +316,32 @@ void KeyFrame::AddConnection(KeyFrame* pKF, const int& weight)
 
 void KeyFrame::UpdateBestCovisibles()
 {
-    unique_lock<mutex>           lock(mMutexConnections);
-    vector<pair<int, KeyFrame*>> vPairs;
-    vPairs.reserve(mConnectedKeyFrameWeights.size());
-    for (map<KeyFrame*, int>::iterator mit  = mConnectedKeyFrameWeights.begin(),
-                                       mend = mConnectedKeyFrameWeights.end();
-         mit != mend;
-         mit++)
-        vPairs.push_back(make_pair(mit->second, mit->first));
-
-    sort(vPairs.begin(), vPairs.end());
-    list<KeyFrame*> lKFs;
-    list<int>       lWs;
+    unique_lock<mutex>            lock(mMutexConnections);
+    vector<pair<int, KeyFrame*>>& vPairs = mvWeightOrder;
+    vPairs.clear();
+    for (const pair<KeyFrame*, int>& connection : mConnectedKeyFrameWeights)
+        vPairs.push_back(make_pair(connection.second, connection.first));
+
+    // Heaviest first
+    sort(vPairs.begin(), vPairs.end(), greater<pair<int, KeyFrame*>>());
+    mvpOrderedConnectedKeyFrames.clear();
+    mvOrderedWeights.clear();
     for (size_t i = 0, iend = vPairs.size(); i < iend; i++)
     {
         if (!vPairs[i].second->isBad())
         {
-            lKFs.push_front(vPairs[i].second);
-            lWs.push_front(vPairs[i].first);
+            mvpOrderedConnectedKeyFrames.push_back(vPairs[i].second);
+            mvOrderedWeights.push_back(vPairs[i].first);
         }
     }
-
-    mvpOrderedConnectedKeyFrames = vector<KeyFrame*>(lKFs.begin(), lKFs.end());
-    mvOrderedWeights             = vector<int>(lWs.begin(), lWs.end());
 }
 
 set<KeyFrame*> KeyFrame::GetConnectedKeyFrames()
 {
     unique_lock<mutex> lock(mMutexConnections);
     set<KeyFrame*>     s;
-    for (map<KeyFrame*, int>::iterator mit = mConnectedKeyFrameWeights.begin();
-         mit != mConnectedKeyFrameWeights.end();
-         mit++)
-        s.insert(mit->first);
+    for (const pair<KeyFrame*, int>& connection : mConnectedKeyFrameWeights)
+        s.insert(s.end(), connection.first);
     return s;
 }
 
@@ -374,6 +361,15 @@ vector<KeyFrame*> KeyFrame::GetBestCovisibilityKeyFrames(const int& N)
                                  mvpOrderedConnectedKeyFrames.begin() + N);
 }
 
+void KeyFrame::GetBestCovisibilityKeyFrames(const int&         N,
+                                            vector<KeyFrame*>& vpBestKFs)
+{
+    unique_lock<mutex> lock(mMutexConnections);
+    const int          n = min(N, (int)mvpOrderedConnectedKeyFrames.size());
+    vpBestKFs.assign(mvpOrderedConnectedKeyFrames.begin(),
+                     mvpOrderedConnectedKeyFrames.begin() + n);
+}
+
 vector<KeyFrame*> KeyFrame::GetCovisiblesByWeight(const int& w)
 {
     unique_lock<mutex> lock(mMutexConnections);
@@ -400,11 +396,20 @@ vector<KeyFrame*> KeyFrame::GetCovisiblesByWeight(const int& w)
     }
 }
 
+void KeyFrame::ChangeCovisibility(KeyFrame* pKF, const int n)
+{
+    unique_lock<mutex> lock(mMutexCovisibility);
+    int&               count = mCovisibilityCounter[pKF];
+    count += n;
+    if (count <= 0) mCovisibilityCounter.erase(pKF);
+}
+
 int KeyFrame::GetWeight(KeyFrame* pKF)
 {
     unique_lock<mutex> lock(mMutexConnections);
-    if (mConnectedKeyFrameWeights.count(pKF))
-        return mConnectedKeyFrameWeights[pKF];
+    vector<pair<KeyFrame*, int>>::iterator it = FindConnection(pKF);
+    if (it != mConnectedKeyFrameWeights.end() && it->first == pKF)
+        return it->second;
     else
         return 0;
 }
@@ -501,44 +506,34 @@ MapPoint* KeyFrame::GetMapPoint(const size_t& idx)
 
 void KeyFrame::UpdateConnections(bool upParent)
 {
-    map<KeyFrame*, int> KFcounter;
-
-    vector<MapPoint*> vpMP;
+    // Scratch memory of the calling thread, kept from one call to the next.
+    // The new weights are swapped with mConnectedKeyFrameWeights, so the old
+    // array becomes the scratch of the next call.
+    static thread_local vector<pair<KeyFrame*, int>> vWeights;
+    static thread_local vector<pair<int, KeyFrame*>> vPairs;
 
+    // Map points shared with every other keyframe, counted as the
+    // observations were made
     {
-        unique_lock<mutex> lockMPs(mMutexFeatures);
-        vpMP = mvpMapPoints;
+        unique_lock<mutex> lock(mMutexCovisibility);
+        vWeights.assign(mCovisibilityCounter.begin(),
+                        mCovisibilityCounter.end());
     }
 
-    // For all map points in keyframe check in which other keyframes are they
-    // seen Increase counter for those keyframes
-    for (vector<MapPoint*>::iterator vit = vpMP.begin(), vend = vpMP.end();
-         vit != vend;
-         vit++)
-    {
-        MapPoint* pMP = *vit;
-
-        if (!pMP) continue;
-
-        if (pMP->isBad()) continue;
-
-        map<KeyFrame*, tuple<int, int>> observations = pMP->GetObservations();
-
-        for (map<KeyFrame*, tuple<int, int>>::iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
-             mit != mend;
-             mit++)
-        {
-            if (mit->first->mnId == mnId || mit->first->isBad() ||
-                mit->first->GetMap() != mpMap)
-                continue;
-            KFcounter[mit->first]++;
-        }
-    }
+    vWeights.erase(remove_if(vWeights.begin(),
+                             vWeights.end(),
+                             [this](const pair<KeyFrame*, int>& covisibility)
+                             {
+                                 KeyFrame* pKFi = covisibility.first;
+                                 return pKFi->mnId == mnId || pKFi->isBad() ||
+                                        pKFi->GetMap() != mpMap;
+                             }),
+                   vWeights.end());
 
     // This should not happen
-    if (KFcounter.empty()) return;
+    if (vWeights.empty()) return;
+
+    sort(vWeights.begin(), vWeights.end());
 
     // If the counter is greater than threshold add connection
     // In case no keyframe counter is over threshold add the one with maximum
@@ -547,26 +542,22 @@ void KeyFrame::UpdateConnections(bool upParent)
     KeyFrame* pKFmax = NULL;
     int       th     = 15;
 
-    vector<pair<int, KeyFrame*>> vPairs;
-    vPairs.reserve(KFcounter.size());
+    vPairs.clear();
     if (!upParent) cout << "UPDATE_CONN: current KF " << mnId << endl;
-    for (map<KeyFrame*, int>::iterator mit  = KFcounter.begin(),
-                                       mend = KFcounter.end();
-         mit != mend;
-         mit++)
+    for (const pair<KeyFrame*, int>& weight : vWeights)
     {
         if (!upParent)
-            cout << "  UPDATE_CONN: KF " << mit->first->mnId
-                 << " ; num matches: " << mit->second << endl;
-        if (mit->second > nmax)
+            cout << "  UPDATE_CONN: KF " << weight.first->mnId
+                 << " ; num matches: " << weight.second << endl;
+        if (weight.second > nmax)
         {
-            nmax   = mit->second;
-            pKFmax = mit->first;
+            nmax   = weight.second;
+            pKFmax = weight.first;
         }
-        if (mit->second >= th)
+        if (weight.second >= th)
         {
-            vPairs.push_back(make_pair(mit->second, mit->first));
-            (mit->first)->AddConnection(this, mit->second);
+            vPairs.push_back(make_pair(weight.second, weight.first));
+            (weight.first)->AddConnection(this, weight.second);
         }
     }
 
@@ -576,22 +567,20 @@ void KeyFrame::UpdateConnections(bool upParent)
         pKFmax->AddConnection(this, nmax);
     }
 
-    sort(vPairs.begin(), vPairs.end());
-    list<KeyFrame*> lKFs;
-    list<int>       lWs;
-    for (size_t i = 0; i < vPairs.size(); i++)
-    {
-        lKFs.push_front(vPairs[i].second);
-        lWs.push_front(vPairs[i].first);
-    }
+    // Heaviest first
+    sort(vPairs.begin(), vPairs.end(), greater<pair<int, KeyFrame*>>());
 
     {
         unique_lock<mutex> lockCon(mMutexConnections);
 
-        mConnectedKeyFrameWeights = KFcounter;
-        mvpOrderedConnectedKeyFrames =
-            vector<KeyFrame*>(lKFs.begin(), lKFs.end());
-        mvOrderedWeights = vector<int>(lWs.begin(), lWs.end());
+        mConnectedKeyFrameWeights.swap(vWeights);
+        mvpOrderedConnectedKeyFrames.clear();
+        mvOrderedWeights.clear();
+        for (size_t i = 0; i < vPairs.size(); i++)
+        {
+            mvpOrderedConnectedKeyFrames.push_back(vPairs[i].second);
+            mvOrderedWeights.push_back(vPairs[i].first);
+        }
 
 
         if (mbFirstConnection && mnId != mpMap->GetInitKFid())
@@ -703,6 +692,8 @@ void KeyFrame::SetErase()
 
 void KeyFrame::SetBadFlag()
 {
+    // Copy, the array can change while the connections are erased
+    vector<pair<KeyFrame*, int>> vConnections;
     {
         unique_lock<mutex> lock(mMutexConnections);
         if (mnId == mpMap->GetInitKFid())
@@ -714,14 +705,12 @@ void KeyFrame::SetBadFlag()
             mbToBeErased = true;
             return;
         }
+        vConnections = mConnectedKeyFrameWeights;
     }
 
-    for (map<KeyFrame*, int>::iterator mit  = mConnectedKeyFrameWeights.begin(),
-                                       mend = mConnectedKeyFrameWeights.end();
-         mit != mend;
-         mit++)
+    for (const pair<KeyFrame*, int>& connection : vConnections)
     {
-        mit->first->EraseConnection(this);
+        connection.first->EraseConnection(this);
     }
 
     for (size_t i = 0; i < mvpMapPoints.size(); i++)
@@ -834,9 +823,10 @@ void KeyFrame::EraseConnection(KeyFrame* pKF)
     bool bUpdate = false;
     {
         unique_lock<mutex> lock(mMutexConnections);
-        if (mConnectedKeyFrameWeights.count(pKF))
+        vector<pair<KeyFrame*, int>>::iterator it = FindConnection(pKF);
+        if (it != mConnectedKeyFrameWeights.end() && it->first == pKF)
         {
-            mConnectedKeyFrameWeights.erase(pKF);
+            mConnectedKeyFrameWeights.erase(it);
             bUpdate = true;
         }
     }
@@ -878,18 +868,19 @@ vector<size_t> KeyFrame::GetFeaturesInArea(const float& x,
     {
         for (int iy = nMinCellY; iy <= nMaxCellY; iy++)
         {
-            const vector<size_t> vCell =
-                (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
-            for (size_t j = 0, jend = vCell.size(); j < jend; j++)
+            const FeatureGrid& grid = (!bRight) ? mGrid : mGridRight;
+
+            for (int j = grid.Begin(ix, iy), jend = grid.End(ix, iy); j < jend;
+                 j++)
             {
-                const cv::KeyPoint& kpUn  = (NLeft == -1) ? mvKeysUn[vCell[j]]
-                                          : (!bRight)     ? mvKeys[vCell[j]]
-                                                      : mvKeysRight[vCell[j]];
+                const size_t        idx   = grid.vIndices[j];
+                const cv::KeyPoint& kpUn  = (NLeft == -1) ? mvKeysUn[idx]
+                                          : (!bRight)     ? mvKeys[idx]
+                                                          : mvKeysRight[idx];
                 const float         distx = kpUn.pt.x - x;
                 const float         disty = kpUn.pt.y - y;
 
-                if (fabs(distx) < r && fabs(disty) < r)
-                    vIndices.push_back(vCell[j]);
+                if (fabs(distx) < r && fabs(disty) < r) vIndices.push_back(idx);
             }
         }
     }
@@ -1013,14 +1004,11 @@ void KeyFrame::PreSave(set<KeyFrame*>&        spKF,
     }
     // Save the id of each connected KF with it weight
     mBackupConnectedKeyFrameIdWeights.clear();
-    for (std::map<KeyFrame*, int>::const_iterator
-             it  = mConnectedKeyFrameWeights.begin(),
-             end = mConnectedKeyFrameWeights.end();
-         it != end;
-         ++it)
+    for (const pair<KeyFrame*, int>& connection : mConnectedKeyFrameWeights)
     {
-        if (spKF.find(it->first) != spKF.end())
-            mBackupConnectedKeyFrameIdWeights[it->first->mnId] = it->second;
+        if (spKF.find(connection.first) != spKF.end())
+            mBackupConnectedKeyFrameIdWeights[connection.first->mnId] =
+                connection.second;
     }
 
     // Save the parent id
@@ -1108,9 +1096,10 @@ void KeyFrame::PostLoad(map<long unsigned int, KeyFrame*>&   mpKFid,
          it != end;
          ++it)
     {
-        KeyFrame* pKFi                  = mpKFid[it->first];
-        mConnectedKeyFrameWeights[pKFi] = it->second;
+        KeyFrame* pKFi = mpKFid[it->first];
+        mConnectedKeyFrameWeights.push_back(make_pair(pKFi, it->second));
     }
+    sort(mConnectedKeyFrameWeights.begin(), mConnectedKeyFrameWeights.end());
 
     // Restore parent KeyFrame
     if (mBackupParentId >= 0) mpParent = mpKFid[mBackupParentId];
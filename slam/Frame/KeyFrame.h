@@ -23,6 +23,7 @@
 #ifndef KEYFRAME_H
 #define KEYFRAME_H
 #include <mutex>
+#include <unordered_map>
 
 #include <DBoW2/BowVector.h>
 #include <DBoW2/FeatureVector.h>
@@ -33,6 +34,7 @@
 #include "frame/Frame.h"
 
 #include "utils/ImuTypes.h"
+#include "utils/SeqLock.h"
 
 #include "camera_models/GeometricCamera.h"
 
@@ -48,6 +50,8 @@ class GeometricCamera;
 
 class KeyFrame
 {
+    friend class AtlasFile;
+
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     KeyFrame();
@@ -85,6 +89,15 @@ public:
     std::vector<KeyFrame*> GetCovisiblesByWeight(const int& w);
     int                    GetWeight(KeyFrame* pKF);
 
+    // Same as above into vpBestKFs, which keeps its capacity between calls
+    void GetBestCovisibilityKeyFrames(const int&              N,
+                                      std::vector<KeyFrame*>& vpBestKFs);
+
+    // Add n to the number of good MapPoints seen by this keyframe and pKF.
+    // Called by MapPoint as observations come and go, UpdateConnections
+    // reads these counters instead of walking the observations.
+    void ChangeCovisibility(KeyFrame* pKF, const int n);
+
     // Spanning tree functions
     void                AddChild(KeyFrame* pKF);
     void                EraseChild(KeyFrame* pKF);
@@ -120,6 +133,12 @@ public:
                                           const bool   bRight = false) const;
     bool                UnprojectStereo(int i, Eigen::Vector3f& x3D);
 
+    // Keypoints bucketed by grid cell, left or right image
+    const FeatureGrid& GetGrid(const bool bRight = false) const
+    {
+        return bRight ? mGridRight : mGrid;
+    }
+
     // Image
     bool IsInImage(const float& x, const float& y) const;
 
@@ -199,20 +218,6 @@ public:
     // Number of optimizations by BA(amount of iterations in BA)
     long unsigned int mnNumberOfOpt;
 
-    // Variables used by the keyframe database
-    long unsigned int mnLoopQuery;
-    int               mnLoopWords;
-    float             mLoopScore;
-    long unsigned int mnRelocQuery;
-    int               mnRelocWords;
-    float             mRelocScore;
-    long unsigned int mnMergeQuery;
-    int               mnMergeWords;
-    float             mMergeScore;
-    long unsigned int mnPlaceRecognitionQuery;
-    int               mnPlaceRecognitionWords;
-    float             mPlaceRecognitionScore;
-
     bool mbCurrentPlaceRecognition;
 
 
@@ -252,6 +257,9 @@ public:
     const std::vector<float> mvDepth;   // negative value for monocular points
     const cv::Mat            mDescriptors;
 
+    // Rows of mDescriptors packed for the matcher
+    const std::vector<ORBkernels::Descriptor> mvPackedDescriptors;
+
     // BoW
     DBoW2::BowVector     mBowVec;
     DBoW2::FeatureVector mFeatVec;
@@ -301,6 +309,16 @@ protected:
     Sophus::SE3<float> mTwc;
     Eigen::Matrix3f    mRwc;
 
+    // Copy of the pose read without mMutexPose by the getters that run in
+    // every thread. Written by SetPose, under the mutex. Poses are kept as
+    // their SE3f::params(), the quaternion then the translation.
+    struct PoseSnapshot
+    {
+        float Tcw[7];
+        float Twc[7];
+    };
+    SeqLock<PoseSnapshot> mPoseSnapshot;
+
     // IMU position
     Eigen::Vector3f mOwb;
     // Velocity (Only used for inertial SLAM)
@@ -325,11 +343,24 @@ protected:
     ORBVocabulary*    mpORBvocabulary;
 
     // Grid over the image to speed up feature matching
-    std::vector<std::vector<std::vector<size_t> > > mGrid;
-
-    std::map<KeyFrame*, int> mConnectedKeyFrameWeights;
-    std::vector<KeyFrame*>   mvpOrderedConnectedKeyFrames;
-    std::vector<int>         mvOrderedWeights;
+    FeatureGrid mGrid;
+
+    // Connected keyframes with their weight, sorted by keyframe so that a
+    // weight is found with a binary search
+    std::vector<std::pair<KeyFrame*, int>> mConnectedKeyFrameWeights;
+    std::vector<KeyFrame*>                 mvpOrderedConnectedKeyFrames;
+    std::vector<int>                       mvOrderedWeights;
+    // Scratch memory of UpdateBestCovisibles, under mMutexConnections
+    std::vector<std::pair<int, KeyFrame*>> mvWeightOrder;
+
+    // Entry of pKF in mConnectedKeyFrameWeights, or where it goes if it is
+    // not connected. mMutexConnections must be locked.
+    std::vector<std::pair<KeyFrame*, int>>::iterator FindConnection(
+        KeyFrame* pKF);
+
+    // MapPoints shared with every other keyframe, not saved but rebuilt from
+    // the observations on load
+    std::unordered_map<KeyFrame*, int> mCovisibilityCounter;
     // For save relation without pointer, this is necessary for save/load
     // function
     std::map<long unsigned int, int> mBackupConnectedKeyFrameIdWeights;
@@ -372,6 +403,7 @@ protected:
     std::mutex mMutexConnections;
     std::mutex mMutexFeatures;
     std::mutex mMutexMap;
+    std::mutex mMutexCovisibility;
 
 public:
     GeometricCamera *mpCamera, *mpCamera2;
@@ -387,7 +419,7 @@ public:
 
     const int NLeft, NRight;
 
-    std::vector<std::vector<std::vector<size_t> > > mGridRight;
+    FeatureGrid mGridRight;
 
     Sophus::SE3<float> GetRightPose();
     Sophus::SE3<float> GetRightPoseInverse();
@@ -21,7 +21,10 @@
 
 
 #include "frame/KeyFrameDatabase.h"
+#include <algorithm>
+#include <cmath>
 #include <mutex>
+#include <shared_mutex>
 
 #include <DBoW2/BowVector.h>
 
@@ -40,18 +43,44 @@ KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary& voc) : mpVoc(&voc)
 
 void KeyFrameDatabase::add(KeyFrame* pKF)
 {
-    unique_lock<mutex> lock(mMutex);
+    unique_lock<shared_mutex> lock(mMutex);
+
+    if (mmKeyFrameSlots.count(pKF)) return;
+
+    uint32_t slot;
+    if (mvFreeSlots.empty())
+    {
+        slot = (uint32_t)mvpKeyFrames.size();
+        mvpKeyFrames.push_back(pKF);
+    }
+    else
+    {
+        slot = mvFreeSlots.back();
+        mvFreeSlots.pop_back();
+        mvpKeyFrames[slot] = pKF;
+    }
+    mmKeyFrameSlots[pKF] = slot;
 
     for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
                                           vend = pKF->mBowVec.end();
          vit != vend;
          vit++)
-        mvInvertedFile[vit->first].push_back(pKF);
+    {
+        PostingList& posting = mvInvertedFile[vit->first];
+        posting.slots.push_back(slot);
+        posting.weights.push_back((float)vit->second);
+    }
 }
 
 void KeyFrameDatabase::erase(KeyFrame* pKF)
 {
-    unique_lock<mutex> lock(mMutex);
+    unique_lock<shared_mutex> lock(mMutex);
+
+    unordered_map<KeyFrame*, uint32_t>::iterator it =
+        mmKeyFrameSlots.find(pKF);
+    if (it == mmKeyFrameSlots.end()) return;
+
+    const uint32_t slot = it->second;
 
     // Erase elements in the Inverse File for the entry
     for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
@@ -59,157 +88,195 @@ void KeyFrameDatabase::erase(KeyFrame* pKF)
          vit != vend;
          vit++)
     {
-        // List of keyframes that share the word
-        list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+        // Keyframes that share the word, the order does not matter
+        PostingList& posting = mvInvertedFile[vit->first];
 
-        for (list<KeyFrame*>::iterator lit = lKFs.begin(), lend = lKFs.end();
-             lit != lend;
-             lit++)
+        for (size_t j = 0; j < posting.slots.size(); j++)
         {
-            if (pKF == *lit)
+            if (posting.slots[j] == slot)
             {
-                lKFs.erase(lit);
+                posting.slots[j]   = posting.slots.back();
+                posting.weights[j] = posting.weights.back();
+                posting.slots.pop_back();
+                posting.weights.pop_back();
                 break;
             }
         }
     }
+
+    mvpKeyFrames[slot] = NULL;
+    mvFreeSlots.push_back(slot);
+    mmKeyFrameSlots.erase(it);
 }
 
 void KeyFrameDatabase::clear()
 {
+    unique_lock<shared_mutex> lock(mMutex);
+
     mvInvertedFile.clear();
     mvInvertedFile.resize(mpVoc->size());
+    mvpKeyFrames.clear();
+    mvFreeSlots.clear();
+    mmKeyFrameSlots.clear();
 }
 
 void KeyFrameDatabase::clearMap(Map* pMap)
 {
-    unique_lock<mutex> lock(mMutex);
+    unique_lock<shared_mutex> lock(mMutex);
 
-    // Erase elements in the Inverse File for the entry
-    for (std::vector<list<KeyFrame*> >::iterator vit  = mvInvertedFile.begin(),
-                                                 vend = mvInvertedFile.end();
+    // Dont delete the KFs because the class Map clean all the KF when it is
+    // destroyed
+    vector<bool> vbErase(mvpKeyFrames.size(), false);
+    for (size_t slot = 0; slot < mvpKeyFrames.size(); slot++)
+    {
+        KeyFrame* pKFi = mvpKeyFrames[slot];
+        if (pKFi && pKFi->GetMap() == pMap) vbErase[slot] = true;
+    }
+
+    EraseSlots(vbErase);
+}
+
+void KeyFrameDatabase::EraseSlots(const vector<bool>& vbErase)
+{
+    for (vector<PostingList>::iterator vit  = mvInvertedFile.begin(),
+                                       vend = mvInvertedFile.end();
          vit != vend;
          vit++)
     {
-        // List of keyframes that share the word
-        list<KeyFrame*>& lKFs = *vit;
+        PostingList& posting = *vit;
 
-        for (list<KeyFrame*>::iterator lit = lKFs.begin(), lend = lKFs.end();
-             lit != lend;)
+        size_t n = 0;
+        for (size_t j = 0; j < posting.slots.size(); j++)
         {
-            KeyFrame* pKFi = *lit;
-            if (pMap == pKFi->GetMap())
-            {
-                lit = lKFs.erase(lit);
-                // Dont delete the KF because the class Map clean all the KF
-                // when it is destroyed
-            }
-            else
-            {
-                ++lit;
-            }
+            if (vbErase[posting.slots[j]]) continue;
+            posting.slots[n]   = posting.slots[j];
+            posting.weights[n] = posting.weights[j];
+            n++;
         }
+        posting.slots.resize(n);
+        posting.weights.resize(n);
+    }
+
+    for (size_t slot = 0; slot < vbErase.size(); slot++)
+    {
+        if (!vbErase[slot]) continue;
+        mmKeyFrameSlots.erase(mvpKeyFrames[slot]);
+        mvpKeyFrames[slot] = NULL;
+        mvFreeSlots.push_back((uint32_t)slot);
     }
 }
 
-vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* pKF,
-                                                         float     minScore)
+void KeyFrameDatabase::ScoreKeyFrames(const DBoW2::BowVector& bowVec,
+                                      QueryContext&           context) const
 {
-    set<KeyFrame*>  spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
-    list<KeyFrame*> lKFsSharingWords;
-
-    // Search all keyframes that share a word with current keyframes
-    // Discard keyframes connected to the query keyframe
+    // Reset what the previous query touched before sizing to the database
+    for (const uint32_t slot : context.mvTouchedSlots)
     {
-        unique_lock<mutex> lock(mMutex);
-
-        for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
-                                              vend = pKF->mBowVec.end();
+        context.mvWords[slot]  = 0;
+        context.mvScores[slot] = 0.0;
+    }
+    context.mvTouchedSlots.clear();
+    context.mvWords.resize(mvpKeyFrames.size(), 0);
+    context.mvScores.resize(mvpKeyFrames.size(), 0.0);
+
+    vector<uint32_t>& vSlots = context.mvTouchedSlots;
+    int*              words  = context.mvWords.data();
+    double*           scores = context.mvScores.data();
+
+    // term gives the share of a word with weights vi and wi in the DBoW2
+    // score, which is summed over the words both vectors have. The sums are
+    // kept in double as DBoW2 does.
+    auto accumulate = [&](auto term)
+    {
+        for (DBoW2::BowVector::const_iterator vit  = bowVec.begin(),
+                                              vend = bowVec.end();
              vit != vend;
              vit++)
         {
-            list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+            const PostingList& posting = mvInvertedFile[vit->first];
+            const uint32_t*    slots   = posting.slots.data();
+            const float*       weights = posting.weights.data();
+            const size_t       n       = posting.slots.size();
+            const double       vi      = vit->second;
 
-            for (list<KeyFrame*>::iterator lit  = lKFs.begin(),
-                                           lend = lKFs.end();
-                 lit != lend;
-                 lit++)
+            for (size_t j = 0; j < n; j++)
             {
-                KeyFrame* pKFi = *lit;
-                if (pKFi->GetMap() ==
-                    pKF->GetMap())  // For consider a loop candidate it a
-                                    // candidate it must be in the same map
-                {
-                    if (pKFi->mnLoopQuery != pKF->mnId)
-                    {
-                        pKFi->mnLoopWords = 0;
-                        if (!spConnectedKeyFrames.count(pKFi))
-                        {
-                            pKFi->mnLoopQuery = pKF->mnId;
-                            lKFsSharingWords.push_back(pKFi);
-                        }
-                    }
-                    pKFi->mnLoopWords++;
-                }
+                const uint32_t slot = slots[j];
+                if (words[slot]++ == 0) vSlots.push_back(slot);
+                scores[slot] += term(vi, weights[j]);
             }
         }
-    }
-
-    if (lKFsSharingWords.empty()) return vector<KeyFrame*>();
-
-    list<pair<float, KeyFrame*> > lScoreAndMatch;
+    };
 
-    // Only compare against those keyframes that share enough words
-    int maxCommonWords = 0;
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
+    const DBoW2::ScoringType scoring = mpVoc->getScoringType();
+    switch (scoring)
     {
-        if ((*lit)->mnLoopWords > maxCommonWords)
-            maxCommonWords = (*lit)->mnLoopWords;
+    case DBoW2::L1_NORM:
+        accumulate([](double vi, double wi)
+                   { return fabs(vi - wi) - fabs(vi) - fabs(wi); });
+        break;
+    case DBoW2::L2_NORM:
+    case DBoW2::DOT_PRODUCT:
+        accumulate([](double vi, double wi) { return vi * wi; });
+        break;
+    case DBoW2::CHI_SQUARE:
+        accumulate([](double vi, double wi)
+                   { return vi + wi != 0.0 ? vi * wi / (vi + wi) : 0.0; });
+        break;
+    case DBoW2::BHATTACHARYYA:
+        accumulate([](double vi, double wi) { return sqrt(vi * wi); });
+        break;
+    default:
+        // KL also depends on the words of only one of the vectors
+        accumulate([](double, double) { return 0.0; });
+        break;
     }
 
-    int minCommonWords = maxCommonWords * 0.8f;
-
-    int nscores = 0;
-
-    // Compute similarity score. Retain the matches whose score is higher than
-    // minScore
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
+    for (const uint32_t slot : vSlots)
     {
-        KeyFrame* pKFi = *lit;
-
-        if (pKFi->mnLoopWords > minCommonWords)
+        double& score = scores[slot];
+        switch (scoring)
         {
-            nscores++;
-
-            float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
-
-            pKFi->mLoopScore = si;
-            if (si >= minScore) lScoreAndMatch.push_back(make_pair(si, pKFi));
+        case DBoW2::L1_NORM:
+            score = -score / 2.0;
+            break;
+        case DBoW2::L2_NORM:
+            score = score >= 1.0 ? 1.0 : 1.0 - sqrt(1.0 - score);
+            break;
+        case DBoW2::CHI_SQUARE:
+            score = 2.0 * score;
+            break;
+        case DBoW2::KL:
+            score = mpVoc->score(bowVec, mvpKeyFrames[slot]->mBowVec);
+            break;
+        default:
+            break;
         }
     }
 
-    if (lScoreAndMatch.empty()) return vector<KeyFrame*>();
-
-    list<pair<float, KeyFrame*> > lAccScoreAndMatch;
-    float                         bestAccScore = minScore;
+    context.mvSlots = vSlots;
+}
 
-    // Lets now accumulate score by covisibility
-    for (list<pair<float, KeyFrame*> >::iterator it    = lScoreAndMatch.begin(),
-                                                 itend = lScoreAndMatch.end();
-         it != itend;
-         it++)
+void KeyFrameDatabase::AccumulateScores(
+    const vector<uint32_t>&          vSlots,
+    const vector<int>&               vWords,
+    const vector<double>&            vScores,
+    int                              minCommonWords,
+    int                              minNeighbourWords,
+    float                            minScore,
+    vector<pair<float, KeyFrame*> >& vAccScoreAndMatch,
+    float&                           bestAccScore) const
+{
+    for (const uint32_t slot : vSlots)
     {
-        KeyFrame*         pKFi     = it->second;
+        if (vWords[slot] <= minCommonWords || vScores[slot] < minScore)
+            continue;
+
+        KeyFrame*         pKFi     = mvpKeyFrames[slot];
         vector<KeyFrame*> vpNeighs = pKFi->GetBestCovisibilityKeyFrames(10);
 
-        float     bestScore = it->first;
-        float     accScore  = it->first;
+        double    bestScore = vScores[slot];
+        double    accScore  = bestScore;
         KeyFrame* pBestKF   = pKFi;
         for (vector<KeyFrame*>::iterator vit  = vpNeighs.begin(),
                                          vend = vpNeighs.end();
@@ -217,487 +284,247 @@ vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* pKF,
              vit++)
         {
             KeyFrame* pKF2 = *vit;
-            if (pKF2->mnLoopQuery == pKF->mnId &&
-                pKF2->mnLoopWords > minCommonWords)
-            {
-                accScore += pKF2->mLoopScore;
-                if (pKF2->mLoopScore > bestScore)
-                {
-                    pBestKF   = pKF2;
-                    bestScore = pKF2->mLoopScore;
-                }
-            }
-        }
-
-        lAccScoreAndMatch.push_back(make_pair(accScore, pBestKF));
-        if (accScore > bestAccScore) bestAccScore = accScore;
-    }
 
-    // Return all those keyframes with a score higher than 0.75*bestScore
-    float minScoreToRetain = 0.75f * bestAccScore;
+            unordered_map<KeyFrame*, uint32_t>::const_iterator it =
+                mmKeyFrameSlots.find(pKF2);
+            if (it == mmKeyFrameSlots.end() ||
+                vWords[it->second] <= minNeighbourWords)
+                continue;
 
-    set<KeyFrame*>    spAlreadyAddedKF;
-    vector<KeyFrame*> vpLoopCandidates;
-    vpLoopCandidates.reserve(lAccScoreAndMatch.size());
-
-    for (list<pair<float, KeyFrame*> >::iterator
-             it    = lAccScoreAndMatch.begin(),
-             itend = lAccScoreAndMatch.end();
-         it != itend;
-         it++)
-    {
-        if (it->first > minScoreToRetain)
-        {
-            KeyFrame* pKFi = it->second;
-            if (!spAlreadyAddedKF.count(pKFi))
+            const double si = vScores[it->second];
+            accScore += si;
+            if (si > bestScore)
             {
-                vpLoopCandidates.push_back(pKFi);
-                spAlreadyAddedKF.insert(pKFi);
+                pBestKF   = pKF2;
+                bestScore = si;
             }
         }
-    }
-
 
-    return vpLoopCandidates;
+        vAccScoreAndMatch.push_back(make_pair((float)accScore, pBestKF));
+        if (accScore > bestAccScore) bestAccScore = (float)accScore;
+    }
 }
 
-void KeyFrameDatabase::DetectCandidates(KeyFrame*          pKF,
-                                        float              minScore,
-                                        vector<KeyFrame*>& vpLoopCand,
-                                        vector<KeyFrame*>& vpMergeCand)
+// Keep in vSlots the keyframes accepted by f, the words of the others are
+// set to zero so that they do not count as covisible candidates either.
+template <typename F>
+static void FilterSlots(vector<uint32_t>& vSlots, vector<int>& vWords, F f)
 {
-    set<KeyFrame*>  spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
-    list<KeyFrame*> lKFsSharingWordsLoop, lKFsSharingWordsMerge;
-
-    // Search all keyframes that share a word with current keyframes
-    // Discard keyframes connected to the query keyframe
+    size_t n = 0;
+    for (const uint32_t slot : vSlots)
     {
-        unique_lock<mutex> lock(mMutex);
+        if (f(slot))
+            vSlots[n++] = slot;
+        else
+            vWords[slot] = 0;
+    }
+    vSlots.resize(n);
+}
 
-        for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
-                                              vend = pKF->mBowVec.end();
-             vit != vend;
-             vit++)
-        {
-            list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+static int MaxCommonWords(const vector<uint32_t>& vSlots,
+                          const vector<int>&      vWords)
+{
+    int maxCommonWords = 0;
+    for (const uint32_t slot : vSlots)
+        maxCommonWords = max(maxCommonWords, vWords[slot]);
+    return maxCommonWords;
+}
 
-            for (list<KeyFrame*>::iterator lit  = lKFs.begin(),
-                                           lend = lKFs.end();
-                 lit != lend;
-                 lit++)
-            {
-                KeyFrame* pKFi = *lit;
-                if (pKFi->GetMap() ==
-                    pKF->GetMap())  // For consider a loop candidate it a
-                                    // candidate it must be in the same map
-                {
-                    if (pKFi->mnLoopQuery != pKF->mnId)
-                    {
-                        pKFi->mnLoopWords = 0;
-                        if (!spConnectedKeyFrames.count(pKFi))
-                        {
-                            pKFi->mnLoopQuery = pKF->mnId;
-                            lKFsSharingWordsLoop.push_back(pKFi);
-                        }
-                    }
-                    pKFi->mnLoopWords++;
-                }
-                else if (!pKFi->GetMap()->IsBad())
-                {
-                    if (pKFi->mnMergeQuery != pKF->mnId)
-                    {
-                        pKFi->mnMergeWords = 0;
-                        if (!spConnectedKeyFrames.count(pKFi))
-                        {
-                            pKFi->mnMergeQuery = pKF->mnId;
-                            lKFsSharingWordsMerge.push_back(pKFi);
-                        }
-                    }
-                    pKFi->mnMergeWords++;
-                }
-            }
-        }
-    }
+// Return all those keyframes with a score higher than 0.75*bestScore
+static vector<KeyFrame*> RetainBest(
+    const vector<pair<float, KeyFrame*> >& vAccScoreAndMatch,
+    float                                  bestAccScore)
+{
+    const float minScoreToRetain = 0.75f * bestAccScore;
 
-    if (lKFsSharingWordsLoop.empty() && lKFsSharingWordsMerge.empty()) return;
+    set<KeyFrame*>    spAlreadyAddedKF;
+    vector<KeyFrame*> vpCandidates;
+    vpCandidates.reserve(vAccScoreAndMatch.size());
 
-    if (!lKFsSharingWordsLoop.empty())
+    for (const pair<float, KeyFrame*>& scoreAndMatch : vAccScoreAndMatch)
     {
-        list<pair<float, KeyFrame*> > lScoreAndMatch;
-
-        // Only compare against those keyframes that share enough words
-        int maxCommonWords = 0;
-        for (list<KeyFrame*>::iterator lit  = lKFsSharingWordsLoop.begin(),
-                                       lend = lKFsSharingWordsLoop.end();
-             lit != lend;
-             lit++)
+        if (scoreAndMatch.first > minScoreToRetain)
         {
-            if ((*lit)->mnLoopWords > maxCommonWords)
-                maxCommonWords = (*lit)->mnLoopWords;
+            KeyFrame* pKFi = scoreAndMatch.second;
+            if (spAlreadyAddedKF.insert(pKFi).second)
+                vpCandidates.push_back(pKFi);
         }
+    }
 
-        int minCommonWords = maxCommonWords * 0.8f;
-
-        int nscores = 0;
-
-        // Compute similarity score. Retain the matches whose score is higher
-        // than minScore
-        for (list<KeyFrame*>::iterator lit  = lKFsSharingWordsLoop.begin(),
-                                       lend = lKFsSharingWordsLoop.end();
-             lit != lend;
-             lit++)
-        {
-            KeyFrame* pKFi = *lit;
-
-            if (pKFi->mnLoopWords > minCommonWords)
-            {
-                nscores++;
-
-                float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
+    return vpCandidates;
+}
 
-                pKFi->mLoopScore = si;
-                if (si >= minScore)
-                    lScoreAndMatch.push_back(make_pair(si, pKFi));
-            }
-        }
+vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(
+    KeyFrame*     pKF,
+    float         minScore,
+    QueryContext& context)
+{
+    set<KeyFrame*> spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
 
-        if (!lScoreAndMatch.empty())
-        {
-            list<pair<float, KeyFrame*> > lAccScoreAndMatch;
-            float                         bestAccScore = minScore;
-
-            // Lets now accumulate score by covisibility
-            for (list<pair<float, KeyFrame*> >::iterator
-                     it    = lScoreAndMatch.begin(),
-                     itend = lScoreAndMatch.end();
-                 it != itend;
-                 it++)
-            {
-                KeyFrame*         pKFi = it->second;
-                vector<KeyFrame*> vpNeighs =
-                    pKFi->GetBestCovisibilityKeyFrames(10);
-
-                float     bestScore = it->first;
-                float     accScore  = it->first;
-                KeyFrame* pBestKF   = pKFi;
-                for (vector<KeyFrame*>::iterator vit  = vpNeighs.begin(),
-                                                 vend = vpNeighs.end();
-                     vit != vend;
-                     vit++)
-                {
-                    KeyFrame* pKF2 = *vit;
-                    if (pKF2->mnLoopQuery == pKF->mnId &&
-                        pKF2->mnLoopWords > minCommonWords)
-                    {
-                        accScore += pKF2->mLoopScore;
-                        if (pKF2->mLoopScore > bestScore)
-                        {
-                            pBestKF   = pKF2;
-                            bestScore = pKF2->mLoopScore;
-                        }
-                    }
-                }
-
-                lAccScoreAndMatch.push_back(make_pair(accScore, pBestKF));
-                if (accScore > bestAccScore) bestAccScore = accScore;
-            }
+    shared_lock<shared_mutex> lock(mMutex);
 
-            // Return all those keyframes with a score higher than
-            // 0.75*bestScore
-            float minScoreToRetain = 0.75f * bestAccScore;
+    ScoreKeyFrames(pKF->mBowVec, context);
 
-            set<KeyFrame*> spAlreadyAddedKF;
-            vpLoopCand.reserve(lAccScoreAndMatch.size());
+    vector<uint32_t>&     vSlots  = context.mvSlots;
+    vector<int>&          vWords  = context.mvWords;
+    const vector<double>& vScores = context.mvScores;
 
-            for (list<pair<float, KeyFrame*> >::iterator
-                     it    = lAccScoreAndMatch.begin(),
-                     itend = lAccScoreAndMatch.end();
-                 it != itend;
-                 it++)
-            {
-                if (it->first > minScoreToRetain)
+    // For consider a loop candidate it must be in the same map and not be
+    // connected to the query keyframe
+    FilterSlots(vSlots,
+                vWords,
+                [&](uint32_t slot)
                 {
-                    KeyFrame* pKFi = it->second;
-                    if (!spAlreadyAddedKF.count(pKFi))
-                    {
-                        vpLoopCand.push_back(pKFi);
-                        spAlreadyAddedKF.insert(pKFi);
-                    }
-                }
-            }
-        }
-    }
+                    KeyFrame* pKFi = mvpKeyFrames[slot];
+                    return pKFi->GetMap() == pKF->GetMap() &&
+                           !spConnectedKeyFrames.count(pKFi);
+                });
 
-    if (!lKFsSharingWordsMerge.empty())
-    {
-        list<pair<float, KeyFrame*> > lScoreAndMatch;
+    if (vSlots.empty()) return vector<KeyFrame*>();
 
-        // Only compare against those keyframes that share enough words
-        int maxCommonWords = 0;
-        for (list<KeyFrame*>::iterator lit  = lKFsSharingWordsMerge.begin(),
-                                       lend = lKFsSharingWordsMerge.end();
-             lit != lend;
-             lit++)
-        {
-            if ((*lit)->mnMergeWords > maxCommonWords)
-                maxCommonWords = (*lit)->mnMergeWords;
-        }
-
-        int minCommonWords = maxCommonWords * 0.8f;
-
-        int nscores = 0;
-
-        // Compute similarity score. Retain the matches whose score is higher
-        // than minScore
-        for (list<KeyFrame*>::iterator lit  = lKFsSharingWordsMerge.begin(),
-                                       lend = lKFsSharingWordsMerge.end();
-             lit != lend;
-             lit++)
-        {
-            KeyFrame* pKFi = *lit;
-
-            if (pKFi->mnMergeWords > minCommonWords)
-            {
-                nscores++;
-
-                float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
+    // Only compare against those keyframes that share enough words
+    int minCommonWords = MaxCommonWords(vSlots, vWords) * 0.8f;
+
+    // Retain the matches whose score is higher than minScore and accumulate
+    // their score by covisibility
+    vector<pair<float, KeyFrame*> > vAccScoreAndMatch;
+    float                           bestAccScore = minScore;
+    AccumulateScores(vSlots,
+                     vWords,
+                     vScores,
+                     minCommonWords,
+                     minCommonWords,
+                     minScore,
+                     vAccScoreAndMatch,
+                     bestAccScore);
+
+    return RetainBest(vAccScoreAndMatch, bestAccScore);
+}
 
-                pKFi->mMergeScore = si;
-                if (si >= minScore)
-                    lScoreAndMatch.push_back(make_pair(si, pKFi));
-            }
-        }
+void KeyFrameDatabase::DetectCandidates(KeyFrame*          pKF,
+                                        float              minScore,
+                                        vector<KeyFrame*>& vpLoopCand,
+                                        vector<KeyFrame*>& vpMergeCand,
+                                        QueryContext&      context)
+{
+    set<KeyFrame*> spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
 
-        if (!lScoreAndMatch.empty())
-        {
-            list<pair<float, KeyFrame*> > lAccScoreAndMatch;
-            float                         bestAccScore = minScore;
-
-            // Lets now accumulate score by covisibility
-            for (list<pair<float, KeyFrame*> >::iterator
-                     it    = lScoreAndMatch.begin(),
-                     itend = lScoreAndMatch.end();
-                 it != itend;
-                 it++)
-            {
-                KeyFrame*         pKFi = it->second;
-                vector<KeyFrame*> vpNeighs =
-                    pKFi->GetBestCovisibilityKeyFrames(10);
-
-                float     bestScore = it->first;
-                float     accScore  = it->first;
-                KeyFrame* pBestKF   = pKFi;
-                for (vector<KeyFrame*>::iterator vit  = vpNeighs.begin(),
-                                                 vend = vpNeighs.end();
-                     vit != vend;
-                     vit++)
-                {
-                    KeyFrame* pKF2 = *vit;
-                    if (pKF2->mnMergeQuery == pKF->mnId &&
-                        pKF2->mnMergeWords > minCommonWords)
-                    {
-                        accScore += pKF2->mMergeScore;
-                        if (pKF2->mMergeScore > bestScore)
-                        {
-                            pBestKF   = pKF2;
-                            bestScore = pKF2->mMergeScore;
-                        }
-                    }
-                }
-
-                lAccScoreAndMatch.push_back(make_pair(accScore, pBestKF));
-                if (accScore > bestAccScore) bestAccScore = accScore;
-            }
+    shared_lock<shared_mutex> lock(mMutex);
 
-            // Return all those keyframes with a score higher than
-            // 0.75*bestScore
-            float minScoreToRetain = 0.75f * bestAccScore;
+    ScoreKeyFrames(pKF->mBowVec, context);
 
-            set<KeyFrame*> spAlreadyAddedKF;
-            vpMergeCand.reserve(lAccScoreAndMatch.size());
+    vector<uint32_t>&     vSlots  = context.mvSlots;
+    vector<int>&          vWords  = context.mvWords;
+    const vector<double>& vScores = context.mvScores;
 
-            for (list<pair<float, KeyFrame*> >::iterator
-                     it    = lAccScoreAndMatch.begin(),
-                     itend = lAccScoreAndMatch.end();
-                 it != itend;
-                 it++)
-            {
-                if (it->first > minScoreToRetain)
+    // Discard keyframes connected to the query keyframe, and those of bad
+    // maps
+    FilterSlots(vSlots,
+                vWords,
+                [&](uint32_t slot)
                 {
-                    KeyFrame* pKFi = it->second;
-                    if (!spAlreadyAddedKF.count(pKFi))
+                    KeyFrame* pKFi = mvpKeyFrames[slot];
+                    if (spConnectedKeyFrames.count(pKFi)) return false;
+                    return pKFi->GetMap() == pKF->GetMap() ||
+                           !pKFi->GetMap()->IsBad();
+                });
+
+    // Loop candidates are in the same map, merge candidates in another one.
+    // Each group is scored on its own.
+    auto detect = [&](bool bLoop, vector<KeyFrame*>& vpCand)
+    {
+        vector<uint32_t> vGroupSlots = vSlots;
+        vector<int>      vGroupWords = vWords;
+        FilterSlots(vGroupSlots,
+                    vGroupWords,
+                    [&](uint32_t slot)
                     {
-                        vpMergeCand.push_back(pKFi);
-                        spAlreadyAddedKF.insert(pKFi);
-                    }
-                }
-            }
-        }
-    }
+                        KeyFrame* pKFi = mvpKeyFrames[slot];
+                        return (pKFi->GetMap() == pKF->GetMap()) == bLoop;
+                    });
 
-    for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
-                                          vend = pKF->mBowVec.end();
-         vit != vend;
-         vit++)
-    {
-        list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+        if (vGroupSlots.empty()) return;
 
-        for (list<KeyFrame*>::iterator lit = lKFs.begin(), lend = lKFs.end();
-             lit != lend;
-             lit++)
-        {
-            KeyFrame* pKFi     = *lit;
-            pKFi->mnLoopQuery  = -1;
-            pKFi->mnMergeQuery = -1;
-        }
-    }
+        // Only compare against those keyframes that share enough words
+        int minCommonWords = MaxCommonWords(vGroupSlots, vGroupWords) * 0.8f;
+
+        // Retain the matches whose score is higher than minScore and
+        // accumulate their score by covisibility
+        vector<pair<float, KeyFrame*> > vAccScoreAndMatch;
+        float                           bestAccScore = minScore;
+        AccumulateScores(vGroupSlots,
+                         vGroupWords,
+                         vScores,
+                         minCommonWords,
+                         minCommonWords,
+                         minScore,
+                         vAccScoreAndMatch,
+                         bestAccScore);
+
+        vector<KeyFrame*> vpRetained =
+            RetainBest(vAccScoreAndMatch, bestAccScore);
+        vpCand.insert(vpCand.end(), vpRetained.begin(), vpRetained.end());
+    };
+
+    detect(true, vpLoopCand);
+    detect(false, vpMergeCand);
 }
 
 void KeyFrameDatabase::DetectBestCandidates(KeyFrame*          pKF,
                                             vector<KeyFrame*>& vpLoopCand,
                                             vector<KeyFrame*>& vpMergeCand,
-                                            int                nMinWords)
+                                            int                nMinWords,
+                                            QueryContext&      context)
 {
-    list<KeyFrame*> lKFsSharingWords;
-    set<KeyFrame*>  spConnectedKF;
+    set<KeyFrame*> spConnectedKF = pKF->GetConnectedKeyFrames();
 
-    // Search all keyframes that share a word with current frame
-    {
-        unique_lock<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
-        spConnectedKF = pKF->GetConnectedKeyFrames();
+    ScoreKeyFrames(pKF->mBowVec, context);
 
-        for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
-                                              vend = pKF->mBowVec.end();
-             vit != vend;
-             vit++)
-        {
-            list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+    vector<uint32_t>&     vSlots  = context.mvSlots;
+    vector<int>&          vWords  = context.mvWords;
+    const vector<double>& vScores = context.mvScores;
 
-            for (list<KeyFrame*>::iterator lit  = lKFs.begin(),
-                                           lend = lKFs.end();
-                 lit != lend;
-                 lit++)
-            {
-                KeyFrame* pKFi = *lit;
-                if (spConnectedKF.find(pKFi) != spConnectedKF.end())
-                {
-                    continue;
-                }
-                if (pKFi->mnPlaceRecognitionQuery != pKF->mnId)
-                {
-                    pKFi->mnPlaceRecognitionWords = 0;
-                    pKFi->mnPlaceRecognitionQuery = pKF->mnId;
-                    lKFsSharingWords.push_back(pKFi);
-                }
-                pKFi->mnPlaceRecognitionWords++;
-            }
-        }
-    }
-    if (lKFsSharingWords.empty()) return;
+    FilterSlots(vSlots,
+                vWords,
+                [&](uint32_t slot)
+                { return !spConnectedKF.count(mvpKeyFrames[slot]); });
 
-    // Only compare against those keyframes that share enough words
-    int maxCommonWords = 0;
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
-    {
-        if ((*lit)->mnPlaceRecognitionWords > maxCommonWords)
-            maxCommonWords = (*lit)->mnPlaceRecognitionWords;
-    }
+    if (vSlots.empty()) return;
 
-    int minCommonWords = maxCommonWords * 0.8f;
+    // Only compare against those keyframes that share enough words
+    int minCommonWords = MaxCommonWords(vSlots, vWords) * 0.8f;
 
     if (minCommonWords < nMinWords)
     {
         minCommonWords = nMinWords;
     }
 
-    list<pair<float, KeyFrame*> > lScoreAndMatch;
-
-    int nscores = 0;
-
-    // Compute similarity score.
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
+    vector<pair<float, KeyFrame*> > vAccScoreAndMatch;
+    float                           bestAccScore = 0;
+    AccumulateScores(vSlots,
+                     vWords,
+                     vScores,
+                     minCommonWords,
+                     0,
+                     0.f,
+                     vAccScoreAndMatch,
+                     bestAccScore);
+
+    vector<KeyFrame*> vpCandidates =
+        RetainBest(vAccScoreAndMatch, bestAccScore);
+    vpLoopCand.reserve(vpCandidates.size());
+    vpMergeCand.reserve(vpCandidates.size());
+    for (KeyFrame* pKFi : vpCandidates)
     {
-        KeyFrame* pKFi = *lit;
-
-        if (pKFi->mnPlaceRecognitionWords > minCommonWords)
-        {
-            nscores++;
-            float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
-            pKFi->mPlaceRecognitionScore = si;
-            lScoreAndMatch.push_back(make_pair(si, pKFi));
-        }
-    }
-
-    if (lScoreAndMatch.empty()) return;
-
-    list<pair<float, KeyFrame*> > lAccScoreAndMatch;
-    float                         bestAccScore = 0;
-
-    // Lets now accumulate score by covisibility
-    for (list<pair<float, KeyFrame*> >::iterator it    = lScoreAndMatch.begin(),
-                                                 itend = lScoreAndMatch.end();
-         it != itend;
-         it++)
-    {
-        KeyFrame*         pKFi     = it->second;
-        vector<KeyFrame*> vpNeighs = pKFi->GetBestCovisibilityKeyFrames(10);
-
-        float     bestScore = it->first;
-        float     accScore  = bestScore;
-        KeyFrame* pBestKF   = pKFi;
-        for (vector<KeyFrame*>::iterator vit  = vpNeighs.begin(),
-                                         vend = vpNeighs.end();
-             vit != vend;
-             vit++)
+        if (pKF->GetMap() == pKFi->GetMap())
         {
-            KeyFrame* pKF2 = *vit;
-            if (pKF2->mnPlaceRecognitionQuery != pKF->mnId) continue;
-
-            accScore += pKF2->mPlaceRecognitionScore;
-            if (pKF2->mPlaceRecognitionScore > bestScore)
-            {
-                pBestKF   = pKF2;
-                bestScore = pKF2->mPlaceRecognitionScore;
-            }
+            vpLoopCand.push_back(pKFi);
         }
-        lAccScoreAndMatch.push_back(make_pair(accScore, pBestKF));
-        if (accScore > bestAccScore) bestAccScore = accScore;
-    }
-
-    // Return all those keyframes with a score higher than 0.75*bestScore
-    float          minScoreToRetain = 0.75f * bestAccScore;
-    set<KeyFrame*> spAlreadyAddedKF;
-    vpLoopCand.reserve(lAccScoreAndMatch.size());
-    vpMergeCand.reserve(lAccScoreAndMatch.size());
-    for (list<pair<float, KeyFrame*> >::iterator
-             it    = lAccScoreAndMatch.begin(),
-             itend = lAccScoreAndMatch.end();
-         it != itend;
-         it++)
-    {
-        const float& si = it->first;
-        if (si > minScoreToRetain)
+        else
         {
-            KeyFrame* pKFi = it->second;
-            if (!spAlreadyAddedKF.count(pKFi))
-            {
-                if (pKF->GetMap() == pKFi->GetMap())
-                {
-                    vpLoopCand.push_back(pKFi);
-                }
-                else
-                {
-                    vpMergeCand.push_back(pKFi);
-                }
-                spAlreadyAddedKF.insert(pKFi);
-            }
+            vpMergeCand.push_back(pKFi);
         }
     }
 }
@@ -711,128 +538,51 @@ bool compFirst(const pair<float, KeyFrame*>& a, const pair<float, KeyFrame*>& b)
 void KeyFrameDatabase::DetectNBestCandidates(KeyFrame*          pKF,
                                              vector<KeyFrame*>& vpLoopCand,
                                              vector<KeyFrame*>& vpMergeCand,
-                                             int                nNumCandidates)
+                                             int                nNumCandidates,
+                                             QueryContext&      context)
 {
-    list<KeyFrame*> lKFsSharingWords;
-    set<KeyFrame*>  spConnectedKF;
+    set<KeyFrame*> spConnectedKF = pKF->GetConnectedKeyFrames();
 
-    // Search all keyframes that share a word with current frame
-    {
-        unique_lock<mutex> lock(mMutex);
+    shared_lock<shared_mutex> lock(mMutex);
 
-        spConnectedKF = pKF->GetConnectedKeyFrames();
+    ScoreKeyFrames(pKF->mBowVec, context);
 
-        for (DBoW2::BowVector::const_iterator vit  = pKF->mBowVec.begin(),
-                                              vend = pKF->mBowVec.end();
-             vit != vend;
-             vit++)
-        {
-            list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+    vector<uint32_t>&     vSlots  = context.mvSlots;
+    vector<int>&          vWords  = context.mvWords;
+    const vector<double>& vScores = context.mvScores;
 
-            for (list<KeyFrame*>::iterator lit  = lKFs.begin(),
-                                           lend = lKFs.end();
-                 lit != lend;
-                 lit++)
-            {
-                KeyFrame* pKFi = *lit;
+    FilterSlots(vSlots,
+                vWords,
+                [&](uint32_t slot)
+                { return !spConnectedKF.count(mvpKeyFrames[slot]); });
 
-                if (pKFi->mnPlaceRecognitionQuery != pKF->mnId)
-                {
-                    pKFi->mnPlaceRecognitionWords = 0;
-                    if (!spConnectedKF.count(pKFi))
-                    {
-                        pKFi->mnPlaceRecognitionQuery = pKF->mnId;
-                        lKFsSharingWords.push_back(pKFi);
-                    }
-                }
-                pKFi->mnPlaceRecognitionWords++;
-            }
-        }
-    }
-    if (lKFsSharingWords.empty()) return;
+    if (vSlots.empty()) return;
 
     // Only compare against those keyframes that share enough words
-    int maxCommonWords = 0;
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
-    {
-        if ((*lit)->mnPlaceRecognitionWords > maxCommonWords)
-            maxCommonWords = (*lit)->mnPlaceRecognitionWords;
-    }
-
-    int minCommonWords = maxCommonWords * 0.8f;
-
-    list<pair<float, KeyFrame*> > lScoreAndMatch;
-
-    int nscores = 0;
+    int minCommonWords = MaxCommonWords(vSlots, vWords) * 0.8f;
 
-    // Compute similarity score.
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
-    {
-        KeyFrame* pKFi = *lit;
+    vector<pair<float, KeyFrame*> > vAccScoreAndMatch;
+    float                           bestAccScore = 0;
+    AccumulateScores(vSlots,
+                     vWords,
+                     vScores,
+                     minCommonWords,
+                     0,
+                     0.f,
+                     vAccScoreAndMatch,
+                     bestAccScore);
 
-        if (pKFi->mnPlaceRecognitionWords > minCommonWords)
-        {
-            nscores++;
-            float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
-            pKFi->mPlaceRecognitionScore = si;
-            lScoreAndMatch.push_back(make_pair(si, pKFi));
-        }
-    }
-
-    if (lScoreAndMatch.empty()) return;
-
-    list<pair<float, KeyFrame*> > lAccScoreAndMatch;
-    float                         bestAccScore = 0;
-
-    // Lets now accumulate score by covisibility
-    for (list<pair<float, KeyFrame*> >::iterator it    = lScoreAndMatch.begin(),
-                                                 itend = lScoreAndMatch.end();
-         it != itend;
-         it++)
-    {
-        KeyFrame*         pKFi     = it->second;
-        vector<KeyFrame*> vpNeighs = pKFi->GetBestCovisibilityKeyFrames(10);
-
-        float     bestScore = it->first;
-        float     accScore  = bestScore;
-        KeyFrame* pBestKF   = pKFi;
-        for (vector<KeyFrame*>::iterator vit  = vpNeighs.begin(),
-                                         vend = vpNeighs.end();
-             vit != vend;
-             vit++)
-        {
-            KeyFrame* pKF2 = *vit;
-            if (pKF2->mnPlaceRecognitionQuery != pKF->mnId) continue;
-
-            accScore += pKF2->mPlaceRecognitionScore;
-            if (pKF2->mPlaceRecognitionScore > bestScore)
-            {
-                pBestKF   = pKF2;
-                bestScore = pKF2->mPlaceRecognitionScore;
-            }
-        }
-        lAccScoreAndMatch.push_back(make_pair(accScore, pBestKF));
-        if (accScore > bestAccScore) bestAccScore = accScore;
-    }
-
-    lAccScoreAndMatch.sort(compFirst);
+    stable_sort(vAccScoreAndMatch.begin(), vAccScoreAndMatch.end(), compFirst);
 
     vpLoopCand.reserve(nNumCandidates);
     vpMergeCand.reserve(nNumCandidates);
-    set<KeyFrame*>                          spAlreadyAddedKF;
-    int                                     i  = 0;
-    list<pair<float, KeyFrame*> >::iterator it = lAccScoreAndMatch.begin();
-    while (i < lAccScoreAndMatch.size() &&
-           (vpLoopCand.size() < nNumCandidates ||
-            vpMergeCand.size() < nNumCandidates))
+    set<KeyFrame*> spAlreadyAddedKF;
+    for (size_t i = 0; i < vAccScoreAndMatch.size() &&
+                       (vpLoopCand.size() < nNumCandidates ||
+                        vpMergeCand.size() < nNumCandidates);
+         i++)
     {
-        KeyFrame* pKFi = it->second;
+        KeyFrame* pKFi = vAccScoreAndMatch[i].second;
         if (pKFi->isBad()) continue;
 
         if (!spAlreadyAddedKF.count(pKFi))
@@ -850,139 +600,47 @@ void KeyFrameDatabase::DetectNBestCandidates(KeyFrame*          pKF,
             }
             spAlreadyAddedKF.insert(pKFi);
         }
-        i++;
-        it++;
     }
 }
 
 
-vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame* F,
-                                                                   Map*   pMap)
+vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(
+    Frame*        F,
+    Map*          pMap,
+    QueryContext& context)
 {
-    list<KeyFrame*> lKFsSharingWords;
+    shared_lock<shared_mutex> lock(mMutex);
 
     // Search all keyframes that share a word with current frame
-    {
-        unique_lock<mutex> lock(mMutex);
+    ScoreKeyFrames(F->mBowVec, context);
 
-        for (DBoW2::BowVector::const_iterator vit  = F->mBowVec.begin(),
-                                              vend = F->mBowVec.end();
-             vit != vend;
-             vit++)
-        {
-            list<KeyFrame*>& lKFs = mvInvertedFile[vit->first];
+    const vector<uint32_t>& vSlots  = context.mvSlots;
+    const vector<int>&      vWords  = context.mvWords;
+    const vector<double>&   vScores = context.mvScores;
 
-            for (list<KeyFrame*>::iterator lit  = lKFs.begin(),
-                                           lend = lKFs.end();
-                 lit != lend;
-                 lit++)
-            {
-                KeyFrame* pKFi = *lit;
-                if (pKFi->mnRelocQuery != F->mnId)
-                {
-                    pKFi->mnRelocWords = 0;
-                    pKFi->mnRelocQuery = F->mnId;
-                    lKFsSharingWords.push_back(pKFi);
-                }
-                pKFi->mnRelocWords++;
-            }
-        }
-    }
-    if (lKFsSharingWords.empty()) return vector<KeyFrame*>();
+    if (vSlots.empty()) return vector<KeyFrame*>();
 
     // Only compare against those keyframes that share enough words
-    int maxCommonWords = 0;
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
-    {
-        if ((*lit)->mnRelocWords > maxCommonWords)
-            maxCommonWords = (*lit)->mnRelocWords;
-    }
-
-    int minCommonWords = maxCommonWords * 0.8f;
-
-    list<pair<float, KeyFrame*> > lScoreAndMatch;
-
-    int nscores = 0;
-
-    // Compute similarity score.
-    for (list<KeyFrame*>::iterator lit  = lKFsSharingWords.begin(),
-                                   lend = lKFsSharingWords.end();
-         lit != lend;
-         lit++)
-    {
-        KeyFrame* pKFi = *lit;
-
-        if (pKFi->mnRelocWords > minCommonWords)
-        {
-            nscores++;
-            float si          = mpVoc->score(F->mBowVec, pKFi->mBowVec);
-            pKFi->mRelocScore = si;
-            lScoreAndMatch.push_back(make_pair(si, pKFi));
-        }
-    }
-
-    if (lScoreAndMatch.empty()) return vector<KeyFrame*>();
-
-    list<pair<float, KeyFrame*> > lAccScoreAndMatch;
-    float                         bestAccScore = 0;
-
-    // Lets now accumulate score by covisibility
-    for (list<pair<float, KeyFrame*> >::iterator it    = lScoreAndMatch.begin(),
-                                                 itend = lScoreAndMatch.end();
-         it != itend;
-         it++)
-    {
-        KeyFrame*         pKFi     = it->second;
-        vector<KeyFrame*> vpNeighs = pKFi->GetBestCovisibilityKeyFrames(10);
-
-        float     bestScore = it->first;
-        float     accScore  = bestScore;
-        KeyFrame* pBestKF   = pKFi;
-        for (vector<KeyFrame*>::iterator vit  = vpNeighs.begin(),
-                                         vend = vpNeighs.end();
-             vit != vend;
-             vit++)
-        {
-            KeyFrame* pKF2 = *vit;
-            if (pKF2->mnRelocQuery != F->mnId) continue;
-
-            accScore += pKF2->mRelocScore;
-            if (pKF2->mRelocScore > bestScore)
-            {
-                pBestKF   = pKF2;
-                bestScore = pKF2->mRelocScore;
-            }
-        }
-        lAccScoreAndMatch.push_back(make_pair(accScore, pBestKF));
-        if (accScore > bestAccScore) bestAccScore = accScore;
-    }
-
-    // Return all those keyframes with a score higher than 0.75*bestScore
-    float             minScoreToRetain = 0.75f * bestAccScore;
-    set<KeyFrame*>    spAlreadyAddedKF;
-    vector<KeyFrame*> vpRelocCandidates;
-    vpRelocCandidates.reserve(lAccScoreAndMatch.size());
-    for (list<pair<float, KeyFrame*> >::iterator
-             it    = lAccScoreAndMatch.begin(),
-             itend = lAccScoreAndMatch.end();
-         it != itend;
-         it++)
-    {
-        const float& si = it->first;
-        if (si > minScoreToRetain)
-        {
-            KeyFrame* pKFi = it->second;
-            if (pKFi->GetMap() != pMap) continue;
-            if (!spAlreadyAddedKF.count(pKFi))
-            {
-                vpRelocCandidates.push_back(pKFi);
-                spAlreadyAddedKF.insert(pKFi);
-            }
-        }
-    }
+    int minCommonWords = MaxCommonWords(vSlots, vWords) * 0.8f;
+
+    vector<pair<float, KeyFrame*> > vAccScoreAndMatch;
+    float                           bestAccScore = 0;
+    AccumulateScores(vSlots,
+                     vWords,
+                     vScores,
+                     minCommonWords,
+                     0,
+                     0.f,
+                     vAccScoreAndMatch,
+                     bestAccScore);
+
+    vector<KeyFrame*> vpRelocCandidates =
+        RetainBest(vAccScoreAndMatch, bestAccScore);
+    vpRelocCandidates.erase(remove_if(vpRelocCandidates.begin(),
+                                      vpRelocCandidates.end(),
+                                      [&](KeyFrame* pKFi)
+                                      { return pKFi->GetMap() != pMap; }),
+                            vpRelocCandidates.end());
 
     return vpRelocCandidates;
 }
@@ -995,6 +653,9 @@ void KeyFrameDatabase::SetORBVocabulary(ORBVocabulary* pORBVoc)
 
     mvInvertedFile.clear();
     mvInvertedFile.resize(mpVoc->size());
+    mvpKeyFrames.clear();
+    mvFreeSlots.clear();
+    mmKeyFrameSlots.clear();
 }
 
 }  // namespace ORB_SLAM3
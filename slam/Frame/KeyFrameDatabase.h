@@ -22,9 +22,13 @@
 
 #ifndef KEYFRAMEDATABASE_H
 #define KEYFRAMEDATABASE_H
+#include <cstdint>
 #include <list>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "frame/Frame.h"
@@ -46,6 +50,20 @@ class KeyFrameDatabase
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+    // Scratch state of a query: words shared with the query and score of
+    // every keyframe. Queries only read the database, so threads holding a
+    // context each can run them at the same time. A context is reused from
+    // one query to the next and only the entries touched are reset.
+    class QueryContext
+    {
+        friend class KeyFrameDatabase;
+
+        std::vector<uint32_t> mvSlots;
+        std::vector<uint32_t> mvTouchedSlots;
+        std::vector<int>      mvWords;
+        std::vector<double>   mvScores;
+    };
+
     KeyFrameDatabase() {}
     KeyFrameDatabase(const ORBVocabulary& voc);
 
@@ -57,42 +75,89 @@ public:
     void clearMap(Map* pMap);
 
     // Loop Detection(DEPRECATED)
-    std::vector<KeyFrame*> DetectLoopCandidates(KeyFrame* pKF, float minScore);
+    std::vector<KeyFrame*> DetectLoopCandidates(KeyFrame*     pKF,
+                                                float         minScore,
+                                                QueryContext& context);
 
     // Loop and Merge Detection
     void DetectCandidates(KeyFrame*          pKF,
                           float              minScore,
                           vector<KeyFrame*>& vpLoopCand,
-                          vector<KeyFrame*>& vpMergeCand);
+                          vector<KeyFrame*>& vpMergeCand,
+                          QueryContext&      context);
     void DetectBestCandidates(KeyFrame*          pKF,
                               vector<KeyFrame*>& vpLoopCand,
                               vector<KeyFrame*>& vpMergeCand,
-                              int                nMinWords);
+                              int                nMinWords,
+                              QueryContext&      context);
     void DetectNBestCandidates(KeyFrame*          pKF,
                                vector<KeyFrame*>& vpLoopCand,
                                vector<KeyFrame*>& vpMergeCand,
-                               int                nNumCandidates);
+                               int                nNumCandidates,
+                               QueryContext&      context);
 
     // Relocalization
-    std::vector<KeyFrame*> DetectRelocalizationCandidates(Frame* F, Map* pMap);
+    std::vector<KeyFrame*> DetectRelocalizationCandidates(
+        Frame*        F,
+        Map*          pMap,
+        QueryContext& context);
 
     void PreSave();
     void PostLoad(map<long unsigned int, KeyFrame*> mpKFid);
     void SetORBVocabulary(ORBVocabulary* pORBVoc);
 
 protected:
+    // Keyframes containing a word, by database slot, with their weight for
+    // the word. Both arrays are kept in the same order.
+    struct PostingList
+    {
+        std::vector<uint32_t> slots;
+        std::vector<float>    weights;
+    };
+
+    // Number of words shared with bowVec and score against it of every
+    // keyframe, by slot, in one pass over the posting lists of its words.
+    // context.mvSlots gets the keyframes sharing at least one word, the rest
+    // of its words and scores are zero.
+    void ScoreKeyFrames(const DBoW2::BowVector& bowVec,
+                        QueryContext&           context) const;
+
+    // Candidates among vSlots sharing more than minCommonWords words and
+    // scoring at least minScore, with their score accumulated over their 10
+    // best covisible keyframes that share more than minNeighbourWords words,
+    // paired with the best scoring keyframe of the group. Every neighbour
+    // adds its score against this query, also those sharing too few words
+    // to be candidates themselves.
+    void AccumulateScores(
+        const std::vector<uint32_t>&               vSlots,
+        const std::vector<int>&                    vWords,
+        const std::vector<double>&                 vScores,
+        int                                        minCommonWords,
+        int                                        minNeighbourWords,
+        float                                      minScore,
+        std::vector<std::pair<float, KeyFrame*> >& vAccScoreAndMatch,
+        float&                                     bestAccScore) const;
+
+    // Remove the postings of the keyframes in the marked slots and free them.
+    void EraseSlots(const std::vector<bool>& vbErase);
+
     // Associated vocabulary
     const ORBVocabulary* mpVoc;
 
-    // Inverted file
-    std::vector<list<KeyFrame*> > mvInvertedFile;
+    // Inverted file, by word id
+    std::vector<PostingList> mvInvertedFile;
+
+    // Keyframe of every slot, NULL if free, and slot of every keyframe
+    std::vector<KeyFrame*>                   mvpKeyFrames;
+    std::vector<uint32_t>                    mvFreeSlots;
+    std::unordered_map<KeyFrame*, uint32_t> mmKeyFrameSlots;
 
     // For save relation without pointer, this is necessary for save/load
     // function
     std::vector<list<long unsigned int> > mvBackupInvertedFileId;
 
-    // Mutex
-    std::mutex mMutex;
+    // Queries share the lock, changes to the inverted file take it alone
+    std::shared_mutex mMutex;
 };
 
 }  // namespace ORB_SLAM3
@@ -47,6 +47,8 @@ class Pinhole;
 
 class Atlas
 {
+    friend class AtlasFile;
+
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
@@ -81,6 +83,21 @@ public:
     std::vector<MapPoint*> GetAllMapPoints();
     std::vector<MapPoint*> GetReferenceMapPoints();
 
+    // Map::ForEachKeyFrame / ForEachMapPoint on the current map
+    template <typename F>
+    void ForEachKeyFrame(F f)
+    {
+        std::unique_lock<std::mutex> lock(mMutexAtlas);
+        mpCurrentMap->ForEachKeyFrame(f);
+    }
+
+    template <typename F>
+    void ForEachMapPoint(F f)
+    {
+        std::unique_lock<std::mutex> lock(mMutexAtlas);
+        mpCurrentMap->ForEachMapPoint(f);
+    }
+
     vector<Map*> GetAllMaps();
 
     int CountMaps();
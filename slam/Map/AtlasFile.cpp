@@ -0,0 +1,1218 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map/AtlasFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "camera_models/KannalaBrandt8.h"
+#include "camera_models/Pinhole.h"
+#include "frame/KeyFrame.h"
+#include "frame/KeyFrameDatabase.h"
+#include "map/Atlas.h"
+#include "map/Map.h"
+#include "map/MapPoint.h"
+#include "utils/MappedFile.h"
+
+using namespace std;
+
+namespace ORB_SLAM3
+{
+
+namespace
+{
+
+// Sections of the file, in this order
+enum Section
+{
+    SEC_CAMERAS = 0,
+    SEC_MAPS,
+    SEC_KEYFRAMES,
+    SEC_MAPPOINTS,
+    SEC_KEYPOINTS,
+    SEC_DESCRIPTORS,
+    SEC_OBSERVATIONS,
+    SEC_GRAPH,
+    SEC_BOW,
+    SEC_IMU,
+    SEC_ARRAYS,  // Everything else: parameters, depths, ids, grids...
+    N_SECTIONS
+};
+
+const char     MAGIC[8]    = { 'S', 'L', 'A', 'M', 'A', 'T', 'L', 'S' };
+const uint32_t ENDIAN_MARK = 0x01020304;
+const uint64_t NO_ID       = ~uint64_t(0);
+
+// Sections start aligned to this in the file, so the records of the mapped
+// file are aligned as well
+const uint64_t SECTION_ALIGN = 64;
+
+// Array of count elements starting offset bytes into a section
+struct Range
+{
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SectionEntry
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct FileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t vocabularyWords;
+    uint32_t nSections;
+
+    // Atlas
+    uint64_t lastInitKFidMap;
+    uint64_t currentMapId;  // NO_ID if it was not saved
+    Range    cameras;       // CameraRecord
+    Range    maps;          // MapRecord
+
+    // Next ids, so the new objects do not reuse the loaded ones
+    uint64_t nextMapId;
+    uint64_t nextKeyFrameId;
+    uint64_t nextMapPointId;
+    uint64_t nextFrameId;
+    uint64_t nextCameraId;
+
+    SectionEntry sections[N_SECTIONS];
+};
+
+struct KeyPointRecord
+{
+    float   x, y, size, angle, response;
+    int32_t octave;
+    int32_t classId;
+};
+
+struct EdgeRecord
+{
+    uint64_t id;
+    int32_t  weight;
+    int32_t  pad;
+};
+
+struct WordRecord
+{
+    uint32_t id;
+    uint32_t pad;
+    double   weight;
+};
+
+// The feature indices of the nodes follow each other, in node order
+struct NodeRecord
+{
+    uint32_t id;
+    uint32_t count;
+};
+
+struct ObservationRecord
+{
+    uint64_t kfId;
+    int32_t  leftIndex;
+    int32_t  rightIndex;
+};
+
+struct MeasurementRecord
+{
+    float a[3];
+    float w[3];
+    float t;
+};
+
+bool IsLittleEndian()
+{
+    const uint32_t value = ENDIAN_MARK;
+    uint8_t        first;
+    memcpy(&first, &value, 1);
+    return first == 0x04;
+}
+
+// Poses are the quaternion (x, y, z, w) then the translation
+void PutPose(float* out, const Sophus::SE3f& T)
+{
+    const Eigen::Quaternionf q = T.unit_quaternion();
+    const Eigen::Vector3f    t = T.translation();
+    out[0] = q.x(), out[1] = q.y(), out[2] = q.z(), out[3] = q.w();
+    out[4] = t.x(), out[5] = t.y(), out[6] = t.z();
+}
+
+Sophus::SE3f GetPose(const float* in)
+{
+    return Sophus::SE3f(Eigen::Quaternionf(in[3], in[0], in[1], in[2]),
+                        Eigen::Vector3f(in[4], in[5], in[6]));
+}
+
+void PutBias(float* out, const IMU::Bias& b)
+{
+    out[0] = b.bax, out[1] = b.bay, out[2] = b.baz;
+    out[3] = b.bwx, out[4] = b.bwy, out[5] = b.bwz;
+}
+
+IMU::Bias GetBias(const float* in)
+{
+    return IMU::Bias(in[0], in[1], in[2], in[3], in[4], in[5]);
+}
+
+// Const members of the loaded objects are written once, before anyone else
+// sees them
+template <typename T>
+T& Mutable(const T& value)
+{
+    return const_cast<T&>(value);
+}
+
+}  // namespace
+
+struct AtlasFile::CameraRecord
+{
+    uint32_t id;
+    uint32_t type;
+    float    precision;
+    int32_t  lappingArea[2];
+    uint32_t pad;
+    Range    parameters;  // float
+};
+
+struct AtlasFile::MapRecord
+{
+    uint64_t id;
+    uint64_t initKFid;
+    uint64_t maxKFid;
+    uint64_t kfInitialId;  // NO_ID if none
+    uint64_t kfLowerId;    // NO_ID if none
+    int32_t  bigChangeIdx;
+    int32_t  mapChange;
+    uint8_t  imuInitialized;
+    uint8_t  inertial;
+    uint8_t  imuBA1;
+    uint8_t  imuBA2;
+    uint8_t  fail;
+    uint8_t  pad[7];
+    Range    keyFrames;    // KeyFrameRecord
+    Range    mapPoints;    // MapPointRecord
+    Range    kfOriginIds;  // uint64_t
+};
+
+struct AtlasFile::PreintegratedRecord
+{
+    float dT;
+    float C[15 * 15];
+    float Info[15 * 15];
+    float Nga[6], NgaWalk[6];
+    float b[6], bu[6], db[6];
+    float dR[9], dV[3], dP[3];
+    float JRg[9], JVg[9], JVa[9], JPg[9], JPa[9];
+    float avgA[3], avgW[3];
+    Range measurements;  // MeasurementRecord
+};
+
+struct AtlasFile::KeyFrameRecord
+{
+    uint64_t id;
+    uint64_t frameId;
+    double   timeStamp;
+    int64_t  parentId;  // -1 if none
+    int64_t  prevKFId;  // -1 if none
+    int64_t  nextKFId;  // -1 if none
+
+    float    gridElementWidthInv, gridElementHeightInv;
+    float    fx, fy, cx, cy, invfx, invfy, bf, b, thDepth;
+    int32_t  N, NLeft, NRight;
+    int32_t  scaleLevels;
+    float    scaleFactor, logScaleFactor;
+    int32_t  minX, minY, maxX, maxY;
+    uint32_t originMapId;
+    int32_t  dataset;
+    uint32_t cameraId, camera2Id;  // ~0 if none
+    int32_t  imuPreintegrated;     // Index in SEC_IMU, -1 if none
+
+    uint8_t imu, hasVelocity, firstConnection, notErase, toBeErased;
+    uint8_t calibSet;
+    uint8_t pad[2];
+
+    float Tcw[7], Tlr[7], Tcp[7];
+    float Vw[3];
+    float bias[6];
+    float halfBaseline;
+    float scale;
+    float K[9];
+    float Tbc[7];
+    float cov[6], covWalk[6];
+
+    Range name;              // char
+    Range distCoef;          // float
+    Range keys;              // KeyPointRecord
+    Range keysUn;            // KeyPointRecord
+    Range keysRight;         // KeyPointRecord
+    Range uRight;            // float
+    Range depth;             // float
+    Range descriptors;       // ORBkernels::Descriptor
+    Range scaleFactors;      // float
+    Range levelSigma2;       // float
+    Range invLevelSigma2;    // float
+    Range mapPointIds;       // int64_t, -1 if none
+    Range leftToRight;       // int32_t
+    Range rightToLeft;       // int32_t
+    Range gridOffsets;       // int32_t
+    Range gridIndices;       // uint32_t
+    Range gridRightOffsets;  // int32_t
+    Range gridRightIndices;  // uint32_t
+    Range connections;       // EdgeRecord
+    Range children;          // uint64_t
+    Range loopEdges;         // uint64_t
+    Range mergeEdges;        // uint64_t
+    Range bowWords;          // WordRecord
+    Range featNodes;         // NodeRecord
+    Range featIndices;       // uint32_t
+};
+
+struct AtlasFile::MapPointRecord
+{
+    uint64_t id;
+    int64_t  firstKFid;
+    int64_t  firstFrame;
+    uint64_t refKFId;
+    int64_t  replacedId;  // -1 if none
+    int32_t  nObs;
+    int32_t  visible;
+    int32_t  found;
+    uint32_t originMapId;
+    float    pos[3];
+    float    normal[3];
+    float    minDistance;
+    float    maxDistance;
+    double   invDepth;
+    double   initU;
+    double   initV;
+    uint64_t descriptor[4];
+    Range    observations;  // ObservationRecord
+};
+
+// Sections being written, each one grows at its end
+class AtlasFile::Writer
+{
+public:
+    // Append n elements, aligned for their type
+    template <typename T>
+    Range Append(Section s, const T* data, size_t n)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "records are written as raw bytes");
+        std::vector<char>& buffer = mvSections[s];
+        const size_t       align  = alignof(T) < 8 ? 8 : alignof(T);
+        buffer.resize((buffer.size() + align - 1) / align * align);
+
+        const Range range = { buffer.size(), n };
+        const char* p     = reinterpret_cast<const char*>(data);
+        buffer.insert(buffer.end(), p, p + n * sizeof(T));
+        return range;
+    }
+
+    template <typename T>
+    Range Append(Section s, const std::vector<T>& v)
+    {
+        return Append(s, v.data(), v.size());
+    }
+
+    // Copy of v as the type stored in the file
+    template <typename TFile, typename T>
+    Range AppendAs(Section s, const std::vector<T>& v)
+    {
+        return Append(s, std::vector<TFile>(v.begin(), v.end()));
+    }
+
+    // Fills the section table of header
+    bool Write(const std::string& filename, FileHeader& header)
+    {
+        uint64_t offset = sizeof(FileHeader);
+        for (int s = 0; s < N_SECTIONS; s++)
+        {
+            offset =
+                (offset + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+            header.sections[s].offset = offset;
+            header.sections[s].size   = mvSections[s].size();
+            offset += mvSections[s].size();
+        }
+
+        std::ofstream f(filename.c_str(), std::ios::binary);
+        if (!f.is_open()) return false;
+
+        f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (int s = 0; s < N_SECTIONS; s++)
+        {
+            const std::vector<char> padding(header.sections[s].offset -
+                                            written);
+            f.write(padding.data(), padding.size());
+            f.write(mvSections[s].data(), mvSections[s].size());
+            written = header.sections[s].offset + mvSections[s].size();
+        }
+        return f.good();
+    }
+
+private:
+    std::vector<char> mvSections[N_SECTIONS];
+};
+
+// Sections of the mapped file. Every range is checked against the bounds of
+// its section, a reader that met a bad one stays invalid.
+class AtlasFile::Reader
+{
+public:
+    explicit Reader(const MappedFile& file) : mFile(file), mbValid(true)
+    {
+        if (mFile.Size() < sizeof(FileHeader))
+        {
+            mbValid = false;
+            return;
+        }
+        memcpy(&mHeader, mFile.Data(), sizeof(FileHeader));
+
+        if (memcmp(mHeader.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            mHeader.byteOrder != ENDIAN_MARK ||
+            mHeader.nSections != N_SECTIONS)
+        {
+            mbValid = false;
+            return;
+        }
+        for (int s = 0; s < N_SECTIONS; s++)
+        {
+            const SectionEntry& entry = mHeader.sections[s];
+            if (entry.offset % SECTION_ALIGN != 0 ||
+                entry.offset > mFile.Size() ||
+                entry.size > mFile.Size() - entry.offset)
+                mbValid = false;
+        }
+    }
+
+    bool              IsValid() const { return mbValid; }
+    const FileHeader& Header() const { return mHeader; }
+
+    // First element of the range, NULL if it is empty or does not fit in
+    // the section
+    template <typename T>
+    const T* Get(Section s, const Range& range)
+    {
+        const SectionEntry& entry = mHeader.sections[s];
+        if (!mbValid || range.count == 0) return nullptr;
+        if (range.offset % alignof(T) != 0 || range.offset > entry.size ||
+            range.count > (entry.size - range.offset) / sizeof(T))
+        {
+            mbValid = false;
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(mFile.Data() + entry.offset +
+                                          range.offset);
+    }
+
+    // Copy of the range as a vector of T
+    template <typename TFile, typename T = TFile>
+    std::vector<T> GetVector(Section s, const Range& range)
+    {
+        const TFile* p = Get<TFile>(s, range);
+        return p ? std::vector<T>(p, p + range.count) : std::vector<T>();
+    }
+
+    // Range that must hold exactly n elements
+    void Expect(const Range& range, size_t n)
+    {
+        if (range.count != n) mbValid = false;
+    }
+
+    void Invalidate() { mbValid = false; }
+
+private:
+    const MappedFile& mFile;
+    FileHeader        mHeader;
+    bool              mbValid;
+};
+
+namespace
+{
+
+std::vector<KeyPointRecord> ToRecords(const std::vector<cv::KeyPoint>& vKeys)
+{
+    std::vector<KeyPointRecord> vRecords(vKeys.size());
+    for (size_t i = 0; i < vKeys.size(); i++)
+    {
+        const cv::KeyPoint& kp = vKeys[i];
+        vRecords[i] = { kp.pt.x,    kp.pt.y,  kp.size,    kp.angle,
+                        kp.response, kp.octave, kp.class_id };
+    }
+    return vRecords;
+}
+
+std::vector<cv::KeyPoint> ToKeyPoints(const KeyPointRecord* p, size_t n)
+{
+    std::vector<cv::KeyPoint> vKeys;
+    vKeys.reserve(n);
+    for (size_t i = 0; i < n; i++)
+        vKeys.emplace_back(p[i].x,
+                           p[i].y,
+                           p[i].size,
+                           p[i].angle,
+                           p[i].response,
+                           p[i].octave,
+                           p[i].classId);
+    return vKeys;
+}
+
+// Grid of nKeys keypoints as built by Frame::AssignFeaturesToGrid: an offset
+// per cell plus one, increasing from 0 to the number of indices, and indices
+// of existing keypoints
+bool IsValidGrid(const FeatureGrid& grid, size_t nKeys)
+{
+    const size_t nCells = FRAME_GRID_COLS * FRAME_GRID_ROWS;
+    if (grid.vOffsets.size() != nCells + 1 || grid.vOffsets[0] != 0 ||
+        size_t(grid.vOffsets[nCells]) != grid.vIndices.size())
+        return false;
+    for (size_t c = 0; c < nCells; c++)
+        if (grid.vOffsets[c + 1] < grid.vOffsets[c]) return false;
+    for (const size_t idx : grid.vIndices)
+        if (idx >= nKeys) return false;
+    return true;
+}
+
+// Stereo matches, -1 or the index of one of the nOther keypoints
+bool IsValidMatches(const std::vector<int>& vMatches, size_t nOther)
+{
+    for (const int idx : vMatches)
+        if (idx < -1 || (idx >= 0 && size_t(idx) >= nOther)) return false;
+    return true;
+}
+
+bool IsValidOctaves(const std::vector<cv::KeyPoint>& vKeys, int nLevels)
+{
+    for (const cv::KeyPoint& kp : vKeys)
+        if (kp.octave < 0 || kp.octave >= nLevels) return false;
+    return true;
+}
+
+}  // namespace
+
+bool AtlasFile::Save(Atlas*             pAtlas,
+                     ORBVocabulary*     pVoc,
+                     const std::string& filename)
+{
+    if (!IsLittleEndian())
+    {
+        cerr << "ERROR: Atlas files can only be saved on little endian hosts"
+             << endl;
+        return false;
+    }
+
+    pAtlas->mvpBackupMaps.clear();
+    pAtlas->PreSave();
+
+    Writer     writer;
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version         = VERSION;
+    header.byteOrder       = ENDIAN_MARK;
+    header.vocabularyWords = pVoc->size();
+    header.nSections       = N_SECTIONS;
+    header.lastInitKFidMap = pAtlas->mnLastInitKFidMap;
+    header.currentMapId    = NO_ID;
+
+    std::vector<CameraRecord> vCameras(pAtlas->mvpCameras.size());
+    for (size_t i = 0; i < vCameras.size(); i++)
+        WriteCamera(writer, pAtlas->mvpCameras[i], vCameras[i]);
+    header.cameras = writer.Append(SEC_CAMERAS, vCameras);
+
+    std::vector<MapRecord> vMaps;
+    for (Map* pMap : pAtlas->mvpBackupMaps)
+    {
+        if (!pMap || pMap->IsBad()) continue;
+
+        vMaps.emplace_back();
+        WriteMap(writer, pMap, vMaps.back());
+        if (pMap == pAtlas->mpCurrentMap) header.currentMapId = pMap->GetId();
+    }
+    header.maps = writer.Append(SEC_MAPS, vMaps);
+    pAtlas->mvpBackupMaps.clear();
+
+    header.nextMapId      = Map::nNextId;
+    header.nextKeyFrameId = KeyFrame::nNextId;
+    header.nextMapPointId = MapPoint::nNextId;
+    header.nextFrameId    = Frame::nNextId;
+    header.nextCameraId   = GeometricCamera::nNextId;
+
+    if (!writer.Write(filename, header))
+    {
+        cerr << "ERROR: Cannot write the atlas to " << filename << endl;
+        return false;
+    }
+    cout << "Atlas saved to " << filename << ": " << vMaps.size() << " maps"
+         << endl;
+    return true;
+}
+
+Atlas* AtlasFile::Load(const std::string& filename,
+                       ORBVocabulary*     pVoc,
+                       KeyFrameDatabase*  pKFDB)
+{
+    MappedFile file;
+    if (!file.Open(filename))
+    {
+        cerr << "ERROR: Cannot open the atlas file " << filename << endl;
+        return nullptr;
+    }
+
+    Reader reader(file);
+    if (!reader.IsValid())
+    {
+        cerr << "ERROR: " << filename << " is not an atlas file" << endl;
+        return nullptr;
+    }
+    const FileHeader& header = reader.Header();
+    if (header.version != VERSION)
+    {
+        cerr << "ERROR: Atlas file version " << header.version
+             << ", expected " << VERSION << endl;
+        return nullptr;
+    }
+    if (header.vocabularyWords != pVoc->size())
+    {
+        cerr << "ERROR: The atlas was saved with another vocabulary ("
+             << header.vocabularyWords << " words, this one has "
+             << pVoc->size() << ")" << endl;
+        return nullptr;
+    }
+
+    Atlas* pAtlas             = new Atlas();
+    pAtlas->mnLastInitKFidMap = header.lastInitKFidMap;
+
+    const CameraRecord* pCams =
+        reader.Get<CameraRecord>(SEC_CAMERAS, header.cameras);
+    for (size_t i = 0; pCams && i < header.cameras.count; i++)
+    {
+        GeometricCamera* pCam = ReadCamera(reader, pCams[i]);
+        if (pCam) pAtlas->mvpCameras.push_back(pCam);
+    }
+
+    const MapRecord* pMaps = reader.Get<MapRecord>(SEC_MAPS, header.maps);
+    for (size_t i = 0; pMaps && i < header.maps.count; i++)
+        pAtlas->mvpBackupMaps.push_back(ReadMap(reader, pMaps[i]));
+
+    if (!reader.IsValid())
+    {
+        cerr << "ERROR: The atlas file " << filename << " is corrupted"
+             << endl;
+        for (Map* pMap : pAtlas->mvpBackupMaps)
+        {
+            for (MapPoint* pMP : pMap->mvpBackupMapPoints) delete pMP;
+            for (KeyFrame* pKF : pMap->mvpBackupKeyFrames) delete pKF;
+            delete pMap;
+        }
+        for (GeometricCamera* pCam : pAtlas->mvpCameras) delete pCam;
+        pAtlas->mvpBackupMaps.clear();
+        delete pAtlas;
+        return nullptr;
+    }
+
+    // KeyFrame::PostLoad points every keyframe to its preintegration copy,
+    // keep NULL for the ones that had none
+    std::vector<KeyFrame*> vpKFsWithoutImu;
+    for (size_t i = 0; i < header.maps.count; i++)
+    {
+        const KeyFrameRecord* pKFs =
+            reader.Get<KeyFrameRecord>(SEC_KEYFRAMES, pMaps[i].keyFrames);
+        const std::vector<KeyFrame*>& vpKFs =
+            pAtlas->mvpBackupMaps[i]->mvpBackupKeyFrames;
+        for (size_t j = 0; j < vpKFs.size(); j++)
+            if (pKFs[j].imuPreintegrated < 0)
+                vpKFsWithoutImu.push_back(vpKFs[j]);
+    }
+
+    pAtlas->SetKeyFrameDababase(pKFDB);
+    pAtlas->SetORBVocabulary(pVoc);
+    Map* pCurrentMap = nullptr;
+    for (Map* pMap : pAtlas->mvpBackupMaps)
+        if (pMap->GetId() == header.currentMapId) pCurrentMap = pMap;
+    if (!pCurrentMap && !pAtlas->mvpBackupMaps.empty())
+        pCurrentMap = pAtlas->mvpBackupMaps.back();
+    pAtlas->PostLoad();
+
+    for (KeyFrame* pKF : vpKFsWithoutImu) pKF->mpImuPreintegrated = nullptr;
+
+    Map::nNextId             = header.nextMapId;
+    KeyFrame::nNextId        = header.nextKeyFrameId;
+    MapPoint::nNextId        = header.nextMapPointId;
+    Frame::nNextId           = header.nextFrameId;
+    GeometricCamera::nNextId = header.nextCameraId;
+
+    if (pCurrentMap) pAtlas->ChangeMap(pCurrentMap);
+
+    cout << "Atlas loaded from " << filename << ": " << header.maps.count
+         << " maps, " << pAtlas->GetNumLivedKF() << " keyframes, "
+         << pAtlas->GetNumLivedMP() << " map points" << endl;
+    return pAtlas;
+}
+
+void AtlasFile::WriteCamera(Writer& w, GeometricCamera* pCam, CameraRecord& r)
+{
+    memset(&r, 0, sizeof(r));
+    r.id         = pCam->GetId();
+    r.type       = pCam->GetType();
+    r.parameters = w.Append(SEC_ARRAYS, pCam->mvParameters);
+    if (r.type == GeometricCamera::CAM_FISHEYE)
+    {
+        KannalaBrandt8* pKB = static_cast<KannalaBrandt8*>(pCam);
+        r.precision         = pKB->GetPrecision();
+        r.lappingArea[0]    = pKB->mvLappingArea[0];
+        r.lappingArea[1]    = pKB->mvLappingArea[1];
+    }
+}
+
+GeometricCamera* AtlasFile::ReadCamera(Reader& rd, const CameraRecord& r)
+{
+    const std::vector<float> vParameters =
+        rd.GetVector<float>(SEC_ARRAYS, r.parameters);
+
+    GeometricCamera* pCam = nullptr;
+    if (r.type == GeometricCamera::CAM_PINHOLE && vParameters.size() == 4)
+    {
+        pCam = new Pinhole(vParameters);
+    }
+    else if (r.type == GeometricCamera::CAM_FISHEYE && vParameters.size() == 8)
+    {
+        KannalaBrandt8* pKB = new KannalaBrandt8(vParameters, r.precision);
+        pKB->mvLappingArea[0] = r.lappingArea[0];
+        pKB->mvLappingArea[1] = r.lappingArea[1];
+        pCam                  = pKB;
+    }
+    else
+    {
+        rd.Invalidate();
+        return nullptr;
+    }
+    pCam->mnId = r.id;
+    return pCam;
+}
+
+void AtlasFile::WriteMap(Writer& w, Map* pMap, MapRecord& r)
+{
+    memset(&r, 0, sizeof(r));
+    r.id             = pMap->mnId;
+    r.initKFid       = pMap->mnInitKFid;
+    r.maxKFid        = pMap->mnMaxKFid;
+    r.kfInitialId    = pMap->mpKFinitial ? pMap->mnBackupKFinitialID : NO_ID;
+    r.kfLowerId      = pMap->mpKFlowerID ? pMap->mnBackupKFlowerID : NO_ID;
+    r.bigChangeIdx   = pMap->mnBigChangeIdx;
+    r.mapChange      = pMap->mnMapChange;
+    r.imuInitialized = pMap->mbImuInitialized;
+    r.inertial       = pMap->mbIsInertial;
+    r.imuBA1         = pMap->mbIMU_BA1;
+    r.imuBA2         = pMap->mbIMU_BA2;
+    r.fail           = pMap->mbFail;
+    r.kfOriginIds =
+        w.AppendAs<uint64_t>(SEC_ARRAYS, pMap->mvBackupKeyFrameOriginsId);
+
+    std::vector<KeyFrameRecord> vKFs(pMap->mvpBackupKeyFrames.size());
+    for (size_t i = 0; i < vKFs.size(); i++)
+        WriteKeyFrame(w, pMap->mvpBackupKeyFrames[i], vKFs[i]);
+    r.keyFrames = w.Append(SEC_KEYFRAMES, vKFs);
+
+    std::vector<MapPointRecord> vMPs(pMap->mvpBackupMapPoints.size());
+    for (size_t i = 0; i < vMPs.size(); i++)
+        WriteMapPoint(w, pMap->mvpBackupMapPoints[i], vMPs[i]);
+    r.mapPoints = w.Append(SEC_MAPPOINTS, vMPs);
+}
+
+Map* AtlasFile::ReadMap(Reader& rd, const MapRecord& r)
+{
+    Map* pMap                 = new Map();
+    pMap->mnId                = r.id;
+    pMap->mnInitKFid          = r.initKFid;
+    pMap->mnMaxKFid           = r.maxKFid;
+    pMap->mnBackupKFinitialID = r.kfInitialId;
+    pMap->mnBackupKFlowerID   = r.kfLowerId;
+    pMap->mnBigChangeIdx      = r.bigChangeIdx;
+    pMap->mnMapChange         = r.mapChange;
+    pMap->mbImuInitialized    = r.imuInitialized;
+    pMap->mbIsInertial        = r.inertial;
+    pMap->mbIMU_BA1           = r.imuBA1;
+    pMap->mbIMU_BA2           = r.imuBA2;
+    pMap->mbFail              = r.fail;
+    pMap->mvBackupKeyFrameOriginsId =
+        rd.GetVector<uint64_t, unsigned long int>(SEC_ARRAYS, r.kfOriginIds);
+
+    const KeyFrameRecord* pKFs =
+        rd.Get<KeyFrameRecord>(SEC_KEYFRAMES, r.keyFrames);
+    for (size_t i = 0; pKFs && i < r.keyFrames.count && rd.IsValid(); i++)
+        pMap->mvpBackupKeyFrames.push_back(ReadKeyFrame(rd, pKFs[i]));
+
+    const MapPointRecord* pMPs =
+        rd.Get<MapPointRecord>(SEC_MAPPOINTS, r.mapPoints);
+    for (size_t i = 0; pMPs && i < r.mapPoints.count && rd.IsValid(); i++)
+        pMap->mvpBackupMapPoints.push_back(ReadMapPoint(rd, pMPs[i]));
+
+    return pMap;
+}
+
+void AtlasFile::WriteKeyFrame(Writer& w, KeyFrame* pKF, KeyFrameRecord& r)
+{
+    memset(&r, 0, sizeof(r));
+    r.id        = pKF->mnId;
+    r.frameId   = pKF->mnFrameId;
+    r.timeStamp = pKF->mTimeStamp;
+    r.parentId  = pKF->mBackupParentId;
+    r.prevKFId  = pKF->mBackupPrevKFId;
+    r.nextKFId  = pKF->mBackupNextKFId;
+
+    r.gridElementWidthInv  = pKF->mfGridElementWidthInv;
+    r.gridElementHeightInv = pKF->mfGridElementHeightInv;
+    r.fx = pKF->fx, r.fy = pKF->fy, r.cx = pKF->cx, r.cy = pKF->cy;
+    r.invfx = pKF->invfx, r.invfy = pKF->invfy;
+    r.bf = pKF->mbf, r.b = pKF->mb, r.thDepth = pKF->mThDepth;
+    r.N = pKF->N, r.NLeft = pKF->NLeft, r.NRight = pKF->NRight;
+    r.scaleLevels    = pKF->mnScaleLevels;
+    r.scaleFactor    = pKF->mfScaleFactor;
+    r.logScaleFactor = pKF->mfLogScaleFactor;
+    r.minX = pKF->mnMinX, r.minY = pKF->mnMinY;
+    r.maxX = pKF->mnMaxX, r.maxY = pKF->mnMaxY;
+    r.originMapId      = pKF->mnOriginMapId;
+    r.dataset          = pKF->mnDataset;
+    r.cameraId         = pKF->mnBackupIdCamera;
+    r.camera2Id        = pKF->mnBackupIdCamera2;
+    r.imuPreintegrated = -1;
+    if (pKF->mpImuPreintegrated)
+    {
+        PreintegratedRecord imu;
+        WritePreintegrated(w, pKF->mBackupImuPreintegrated, imu);
+        const Range range  = w.Append(SEC_IMU, &imu, 1);
+        r.imuPreintegrated = range.offset / sizeof(PreintegratedRecord);
+    }
+
+    r.imu             = pKF->bImu;
+    r.hasVelocity     = pKF->mbHasVelocity;
+    r.firstConnection = pKF->mbFirstConnection;
+    r.notErase        = pKF->mbNotErase;
+    r.toBeErased      = pKF->mbToBeErased;
+    r.calibSet        = pKF->mImuCalib.mbIsSet;
+
+    PutPose(r.Tcw, pKF->mTcw);
+    PutPose(r.Tlr, pKF->mTlr);
+    PutPose(r.Tcp, pKF->mTcp);
+    memcpy(r.Vw, pKF->mVw.data(), sizeof(r.Vw));
+    PutBias(r.bias, pKF->mImuBias);
+    r.halfBaseline = pKF->mHalfBaseline;
+    r.scale        = pKF->mfScale;
+    memcpy(r.K, pKF->mK_.data(), sizeof(r.K));
+    PutPose(r.Tbc, pKF->mImuCalib.mTbc);
+    memcpy(r.cov, pKF->mImuCalib.Cov.diagonal().data(), sizeof(r.cov));
+    memcpy(r.covWalk,
+           pKF->mImuCalib.CovWalk.diagonal().data(),
+           sizeof(r.covWalk));
+
+    r.name = w.Append(SEC_ARRAYS, pKF->mNameFile.data(), pKF->mNameFile.size());
+    if (!pKF->mDistCoef.empty())
+    {
+        cv::Mat distCoef;
+        pKF->mDistCoef.convertTo(distCoef, CV_32F);
+        distCoef   = distCoef.reshape(1, int(distCoef.total()));
+        r.distCoef = w.Append(SEC_ARRAYS, distCoef.ptr<float>(), distCoef.rows);
+    }
+    r.keys      = w.Append(SEC_KEYPOINTS, ToRecords(pKF->mvKeys));
+    r.keysUn    = w.Append(SEC_KEYPOINTS, ToRecords(pKF->mvKeysUn));
+    r.keysRight = w.Append(SEC_KEYPOINTS, ToRecords(pKF->mvKeysRight));
+    r.uRight    = w.Append(SEC_ARRAYS, pKF->mvuRight);
+    r.depth     = w.Append(SEC_ARRAYS, pKF->mvDepth);
+    r.descriptors    = w.Append(SEC_DESCRIPTORS, pKF->mvPackedDescriptors);
+    r.scaleFactors   = w.Append(SEC_ARRAYS, pKF->mvScaleFactors);
+    r.levelSigma2    = w.Append(SEC_ARRAYS, pKF->mvLevelSigma2);
+    r.invLevelSigma2 = w.Append(SEC_ARRAYS, pKF->mvInvLevelSigma2);
+    r.mapPointIds = w.AppendAs<int64_t>(SEC_ARRAYS, pKF->mvBackupMapPointsId);
+    r.leftToRight = w.Append(SEC_ARRAYS, pKF->mvLeftToRightMatch);
+    r.rightToLeft = w.Append(SEC_ARRAYS, pKF->mvRightToLeftMatch);
+    r.gridOffsets = w.Append(SEC_ARRAYS, pKF->mGrid.vOffsets);
+    r.gridIndices = w.AppendAs<uint32_t>(SEC_ARRAYS, pKF->mGrid.vIndices);
+    r.gridRightOffsets = w.Append(SEC_ARRAYS, pKF->mGridRight.vOffsets);
+    r.gridRightIndices =
+        w.AppendAs<uint32_t>(SEC_ARRAYS, pKF->mGridRight.vIndices);
+
+    std::vector<EdgeRecord> vConnections;
+    vConnections.reserve(pKF->mBackupConnectedKeyFrameIdWeights.size());
+    for (const auto& connection : pKF->mBackupConnectedKeyFrameIdWeights)
+        vConnections.push_back({ connection.first, connection.second, 0 });
+    r.connections = w.Append(SEC_GRAPH, vConnections);
+    r.children    = w.AppendAs<uint64_t>(SEC_GRAPH, pKF->mvBackupChildrensId);
+    r.loopEdges   = w.AppendAs<uint64_t>(SEC_GRAPH, pKF->mvBackupLoopEdgesId);
+    r.mergeEdges = w.AppendAs<uint64_t>(SEC_GRAPH, pKF->mvBackupMergeEdgesId);
+
+    std::vector<WordRecord> vWords;
+    vWords.reserve(pKF->mBowVec.size());
+    for (const auto& word : pKF->mBowVec)
+        vWords.push_back({ word.first, 0, word.second });
+    r.bowWords = w.Append(SEC_BOW, vWords);
+
+    std::vector<NodeRecord> vNodes;
+    std::vector<uint32_t>   vIndices;
+    vNodes.reserve(pKF->mFeatVec.size());
+    for (const auto& node : pKF->mFeatVec)
+    {
+        vNodes.push_back({ node.first, uint32_t(node.second.size()) });
+        vIndices.insert(vIndices.end(), node.second.begin(), node.second.end());
+    }
+    r.featNodes   = w.Append(SEC_BOW, vNodes);
+    r.featIndices = w.Append(SEC_BOW, vIndices);
+}
+
+KeyFrame* AtlasFile::ReadKeyFrame(Reader& rd, const KeyFrameRecord& r)
+{
+    KeyFrame* pKF               = new KeyFrame();
+    pKF->mnId                   = r.id;
+    Mutable(pKF->mnFrameId)     = r.frameId;
+    Mutable(pKF->mTimeStamp)    = r.timeStamp;
+    pKF->mBackupParentId        = r.parentId;
+    pKF->mBackupPrevKFId        = r.prevKFId;
+    pKF->mBackupNextKFId        = r.nextKFId;
+
+    Mutable(pKF->mfGridElementWidthInv)  = r.gridElementWidthInv;
+    Mutable(pKF->mfGridElementHeightInv) = r.gridElementHeightInv;
+    Mutable(pKF->fx)                     = r.fx;
+    Mutable(pKF->fy)                     = r.fy;
+    Mutable(pKF->cx)                     = r.cx;
+    Mutable(pKF->cy)                     = r.cy;
+    Mutable(pKF->invfx)                  = r.invfx;
+    Mutable(pKF->invfy)                  = r.invfy;
+    Mutable(pKF->mbf)                    = r.bf;
+    Mutable(pKF->mb)                     = r.b;
+    Mutable(pKF->mThDepth)               = r.thDepth;
+    Mutable(pKF->N)                      = r.N;
+    Mutable(pKF->NLeft)                  = r.NLeft;
+    Mutable(pKF->NRight)                 = r.NRight;
+    Mutable(pKF->mnScaleLevels)          = r.scaleLevels;
+    Mutable(pKF->mfScaleFactor)          = r.scaleFactor;
+    Mutable(pKF->mfLogScaleFactor)       = r.logScaleFactor;
+    Mutable(pKF->mnMinX)                 = r.minX;
+    Mutable(pKF->mnMinY)                 = r.minY;
+    Mutable(pKF->mnMaxX)                 = r.maxX;
+    Mutable(pKF->mnMaxY)                 = r.maxY;
+    pKF->mnOriginMapId                   = r.originMapId;
+    pKF->mnDataset                       = r.dataset;
+    pKF->mnBackupIdCamera                = r.cameraId;
+    pKF->mnBackupIdCamera2               = r.camera2Id;
+
+    if (r.imuPreintegrated >= 0)
+    {
+        const Range range = { uint64_t(r.imuPreintegrated) *
+                                  sizeof(PreintegratedRecord),
+                              1 };
+        const PreintegratedRecord* pImu =
+            rd.Get<PreintegratedRecord>(SEC_IMU, range);
+        if (pImu) ReadPreintegrated(rd, *pImu, pKF->mBackupImuPreintegrated);
+    }
+
+    pKF->bImu              = r.imu;
+    pKF->mbHasVelocity     = r.hasVelocity;
+    pKF->mbFirstConnection = r.firstConnection;
+    pKF->mbNotErase        = r.notErase;
+    pKF->mbToBeErased      = r.toBeErased;
+
+    // Set before KeyFrame::PostLoad, SetPose needs it for the IMU position
+    IMU::Calib& calib = pKF->mImuCalib;
+    calib.mbIsSet     = r.calibSet;
+    calib.mTbc        = GetPose(r.Tbc);
+    calib.mTcb        = calib.mTbc.inverse();
+    memcpy(calib.Cov.diagonal().data(), r.cov, sizeof(r.cov));
+    memcpy(calib.CovWalk.diagonal().data(), r.covWalk, sizeof(r.covWalk));
+
+    pKF->mTcw          = GetPose(r.Tcw);
+    pKF->mTlr          = GetPose(r.Tlr);
+    pKF->mTcp          = GetPose(r.Tcp);
+    pKF->mVw           = Eigen::Vector3f(r.Vw[0], r.Vw[1], r.Vw[2]);
+    pKF->mImuBias      = GetBias(r.bias);
+    pKF->mHalfBaseline = r.halfBaseline;
+    pKF->mfScale       = r.scale;
+    memcpy(pKF->mK_.data(), r.K, sizeof(r.K));
+
+    const std::vector<char> vName = rd.GetVector<char>(SEC_ARRAYS, r.name);
+    pKF->mNameFile.assign(vName.begin(), vName.end());
+    const std::vector<float> vDistCoef =
+        rd.GetVector<float>(SEC_ARRAYS, r.distCoef);
+    if (!vDistCoef.empty())
+        pKF->mDistCoef = cv::Mat(vDistCoef, true);
+
+    // Every per feature array holds N elements. In a fisheye stereo pair
+    // (NLeft != -1) the keypoints are split between mvKeys and mvKeysRight
+    // and the stereo matches index into each other, otherwise mvKeysRight
+    // holds whatever was extracted on the right image and is not indexed.
+    const bool bPair = r.NLeft != -1;
+    if (r.N < 0 || r.scaleLevels <= 0 ||
+        (bPair && (r.NLeft < 0 || r.NRight < 0 || r.NLeft + r.NRight != r.N)))
+    {
+        rd.Invalidate();
+        return pKF;
+    }
+    const size_t N      = r.N;
+    const size_t NLeft  = bPair ? r.NLeft : N;
+    const size_t NRight = bPair ? r.NRight : 0;
+    rd.Expect(r.keys, NLeft);
+    rd.Expect(r.keysUn, NLeft);
+    if (bPair) rd.Expect(r.keysRight, NRight);
+    rd.Expect(r.uRight, N);
+    rd.Expect(r.depth, N);
+    rd.Expect(r.descriptors, N);
+    rd.Expect(r.mapPointIds, N);
+    rd.Expect(r.leftToRight, bPair ? NLeft : 0);
+    rd.Expect(r.rightToLeft, NRight);
+    rd.Expect(r.scaleFactors, r.scaleLevels);
+    rd.Expect(r.levelSigma2, r.scaleLevels);
+    rd.Expect(r.invLevelSigma2, r.scaleLevels);
+    if (!rd.IsValid()) return pKF;
+
+    const KeyPointRecord* pKeys = rd.Get<KeyPointRecord>(SEC_KEYPOINTS, r.keys);
+    const KeyPointRecord* pKeysUn =
+        rd.Get<KeyPointRecord>(SEC_KEYPOINTS, r.keysUn);
+    const KeyPointRecord* pKeysRight =
+        rd.Get<KeyPointRecord>(SEC_KEYPOINTS, r.keysRight);
+    if (!rd.IsValid()) return pKF;
+    Mutable(pKF->mvKeys)      = ToKeyPoints(pKeys, r.keys.count);
+    Mutable(pKF->mvKeysUn)    = ToKeyPoints(pKeysUn, r.keysUn.count);
+    Mutable(pKF->mvKeysRight) = ToKeyPoints(pKeysRight, r.keysRight.count);
+
+    Mutable(pKF->mvuRight) = rd.GetVector<float>(SEC_ARRAYS, r.uRight);
+    Mutable(pKF->mvDepth)  = rd.GetVector<float>(SEC_ARRAYS, r.depth);
+
+    const std::vector<ORBkernels::Descriptor> vDescriptors =
+        rd.GetVector<ORBkernels::Descriptor>(SEC_DESCRIPTORS, r.descriptors);
+    cv::Mat descriptors(vDescriptors.size(), 32, CV_8U);
+    for (size_t i = 0; i < vDescriptors.size(); i++)
+        memcpy(descriptors.ptr(i), vDescriptors[i].w, 32);
+    Mutable(pKF->mDescriptors)        = descriptors;
+    Mutable(pKF->mvPackedDescriptors) = vDescriptors;
+
+    Mutable(pKF->mvScaleFactors) =
+        rd.GetVector<float>(SEC_ARRAYS, r.scaleFactors);
+    Mutable(pKF->mvLevelSigma2) =
+        rd.GetVector<float>(SEC_ARRAYS, r.levelSigma2);
+    Mutable(pKF->mvInvLevelSigma2) =
+        rd.GetVector<float>(SEC_ARRAYS, r.invLevelSigma2);
+    pKF->mvBackupMapPointsId =
+        rd.GetVector<int64_t, long long int>(SEC_ARRAYS, r.mapPointIds);
+    pKF->mvLeftToRightMatch = rd.GetVector<int32_t, int>(SEC_ARRAYS,
+                                                         r.leftToRight);
+    pKF->mvRightToLeftMatch = rd.GetVector<int32_t, int>(SEC_ARRAYS,
+                                                         r.rightToLeft);
+    pKF->mGrid.vOffsets = rd.GetVector<int32_t, int>(SEC_ARRAYS, r.gridOffsets);
+    pKF->mGrid.vIndices =
+        rd.GetVector<uint32_t, size_t>(SEC_ARRAYS, r.gridIndices);
+    pKF->mGridRight.vOffsets =
+        rd.GetVector<int32_t, int>(SEC_ARRAYS, r.gridRightOffsets);
+    pKF->mGridRight.vIndices =
+        rd.GetVector<uint32_t, size_t>(SEC_ARRAYS, r.gridRightIndices);
+    if (!IsValidOctaves(pKF->mvKeys, r.scaleLevels) ||
+        !IsValidOctaves(pKF->mvKeysUn, r.scaleLevels) ||
+        (bPair && !IsValidOctaves(pKF->mvKeysRight, r.scaleLevels)) ||
+        !IsValidMatches(pKF->mvLeftToRightMatch, NRight) ||
+        !IsValidMatches(pKF->mvRightToLeftMatch, NLeft) ||
+        !IsValidGrid(pKF->mGrid, NLeft) ||
+        !IsValidGrid(pKF->mGridRight, NRight))
+    {
+        rd.Invalidate();
+        return pKF;
+    }
+
+    const EdgeRecord* pEdges = rd.Get<EdgeRecord>(SEC_GRAPH, r.connections);
+    for (size_t i = 0; pEdges && i < r.connections.count; i++)
+        pKF->mBackupConnectedKeyFrameIdWeights[pEdges[i].id] = pEdges[i].weight;
+    pKF->mvBackupChildrensId =
+        rd.GetVector<uint64_t, unsigned long int>(SEC_GRAPH, r.children);
+    pKF->mvBackupLoopEdgesId =
+        rd.GetVector<uint64_t, unsigned long int>(SEC_GRAPH, r.loopEdges);
+    pKF->mvBackupMergeEdgesId =
+        rd.GetVector<uint64_t, unsigned long int>(SEC_GRAPH, r.mergeEdges);
+
+    const WordRecord* pWords = rd.Get<WordRecord>(SEC_BOW, r.bowWords);
+    for (size_t i = 0; pWords && i < r.bowWords.count; i++)
+        pKF->mBowVec.insert(pKF->mBowVec.end(),
+                            std::make_pair(pWords[i].id, pWords[i].weight));
+
+    const NodeRecord* pNodes   = rd.Get<NodeRecord>(SEC_BOW, r.featNodes);
+    const uint32_t*   pIndices = rd.Get<uint32_t>(SEC_BOW, r.featIndices);
+    size_t            nIndices = 0;
+    for (size_t i = 0; pNodes && i < r.featNodes.count; i++)
+    {
+        if (pNodes[i].count > r.featIndices.count - nIndices)
+        {
+            rd.Invalidate();
+            break;
+        }
+        std::vector<unsigned int>& vNodeIndices = pKF->mFeatVec[pNodes[i].id];
+        vNodeIndices.assign(pIndices + nIndices,
+                            pIndices + nIndices + pNodes[i].count);
+        nIndices += pNodes[i].count;
+    }
+
+    return pKF;
+}
+
+void AtlasFile::WriteMapPoint(Writer& w, MapPoint* pMP, MapPointRecord& r)
+{
+    memset(&r, 0, sizeof(r));
+    r.id          = pMP->mnId;
+    r.firstKFid   = pMP->mnFirstKFid;
+    r.firstFrame  = pMP->mnFirstFrame;
+    r.refKFId     = pMP->mBackupRefKFId;
+    r.replacedId  = pMP->mBackupReplacedId;
+    r.nObs        = pMP->nObs;
+    r.visible     = pMP->mnVisible;
+    r.found       = pMP->mnFound;
+    r.originMapId = pMP->mnOriginMapId;
+
+    const Eigen::Vector3f pos    = pMP->GetWorldPos();
+    const Eigen::Vector3f normal = pMP->GetNormal();
+    memcpy(r.pos, pos.data(), sizeof(r.pos));
+    memcpy(r.normal, normal.data(), sizeof(r.normal));
+    r.minDistance = pMP->mfMinDistance;
+    r.maxDistance = pMP->mfMaxDistance;
+    r.invDepth    = pMP->mInvDepth;
+    r.initU       = pMP->mInitU;
+    r.initV       = pMP->mInitV;
+    memcpy(r.descriptor, pMP->mPackedDescriptor, sizeof(r.descriptor));
+
+    std::vector<ObservationRecord> vObservations;
+    vObservations.reserve(pMP->mBackupObservationsId1.size());
+    for (const auto& ob : pMP->mBackupObservationsId1)
+        vObservations.push_back(
+            { ob.first, ob.second, pMP->mBackupObservationsId2[ob.first] });
+    r.observations = w.Append(SEC_OBSERVATIONS, vObservations);
+}
+
+MapPoint* AtlasFile::ReadMapPoint(Reader& rd, const MapPointRecord& r)
+{
+    MapPoint* pMP          = new MapPoint();
+    pMP->mnId              = r.id;
+    pMP->mnFirstKFid       = r.firstKFid;
+    pMP->mnFirstFrame      = r.firstFrame;
+    pMP->mBackupRefKFId    = r.refKFId;
+    pMP->mBackupReplacedId = r.replacedId;
+    pMP->nObs              = r.nObs;
+    pMP->mnVisible         = r.visible;
+    pMP->mnFound           = r.found;
+    pMP->mnOriginMapId     = r.originMapId;
+
+    pMP->mWorldPos.Store({ { r.pos[0], r.pos[1], r.pos[2] } });
+    pMP->mNormalVector.Store({ { r.normal[0], r.normal[1], r.normal[2] } });
+    pMP->mfMinDistance = r.minDistance;
+    pMP->mfMaxDistance = r.maxDistance;
+    pMP->mInvDepth     = r.invDepth;
+    pMP->mInitU        = r.initU;
+    pMP->mInitV        = r.initV;
+    memcpy(pMP->mPackedDescriptor, r.descriptor, sizeof(r.descriptor));
+    pMP->mDescriptor = cv::Mat(1, 32, CV_8U, pMP->mPackedDescriptor).clone();
+
+    const ObservationRecord* pObs =
+        rd.Get<ObservationRecord>(SEC_OBSERVATIONS, r.observations);
+    for (size_t i = 0; pObs && i < r.observations.count; i++)
+    {
+        pMP->mBackupObservationsId1[pObs[i].kfId] = pObs[i].leftIndex;
+        pMP->mBackupObservationsId2[pObs[i].kfId] = pObs[i].rightIndex;
+    }
+
+    return pMP;
+}
+
+void AtlasFile::WritePreintegrated(Writer&              w,
+                                   IMU::Preintegrated&  imu,
+                                   PreintegratedRecord& r)
+{
+    memset(&r, 0, sizeof(r));
+    r.dT = imu.dT;
+    memcpy(r.C, imu.C.data(), sizeof(r.C));
+    memcpy(r.Info, imu.Info.data(), sizeof(r.Info));
+    memcpy(r.Nga, imu.Nga.diagonal().data(), sizeof(r.Nga));
+    memcpy(r.NgaWalk, imu.NgaWalk.diagonal().data(), sizeof(r.NgaWalk));
+    PutBias(r.b, imu.b);
+    PutBias(r.bu, imu.bu);
+    memcpy(r.db, imu.db.data(), sizeof(r.db));
+    memcpy(r.dR, imu.dR.data(), sizeof(r.dR));
+    memcpy(r.dV, imu.dV.data(), sizeof(r.dV));
+    memcpy(r.dP, imu.dP.data(), sizeof(r.dP));
+    memcpy(r.JRg, imu.JRg.data(), sizeof(r.JRg));
+    memcpy(r.JVg, imu.JVg.data(), sizeof(r.JVg));
+    memcpy(r.JVa, imu.JVa.data(), sizeof(r.JVa));
+    memcpy(r.JPg, imu.JPg.data(), sizeof(r.JPg));
+    memcpy(r.JPa, imu.JPa.data(), sizeof(r.JPa));
+    memcpy(r.avgA, imu.avgA.data(), sizeof(r.avgA));
+    memcpy(r.avgW, imu.avgW.data(), sizeof(r.avgW));
+
+    std::vector<MeasurementRecord> vMeasurements(imu.mvMeasurements.size());
+    for (size_t i = 0; i < vMeasurements.size(); i++)
+    {
+        const IMU::Preintegrated::integrable& m = imu.mvMeasurements[i];
+        memcpy(vMeasurements[i].a, m.a.data(), sizeof(vMeasurements[i].a));
+        memcpy(vMeasurements[i].w, m.w.data(), sizeof(vMeasurements[i].w));
+        vMeasurements[i].t = m.t;
+    }
+    r.measurements = w.Append(SEC_ARRAYS, vMeasurements);
+}
+
+void AtlasFile::ReadPreintegrated(Reader&                    rd,
+                                  const PreintegratedRecord& r,
+                                  IMU::Preintegrated&        imu)
+{
+    imu.dT = r.dT;
+    memcpy(imu.C.data(), r.C, sizeof(r.C));
+    memcpy(imu.Info.data(), r.Info, sizeof(r.Info));
+    memcpy(imu.Nga.diagonal().data(), r.Nga, sizeof(r.Nga));
+    memcpy(imu.NgaWalk.diagonal().data(), r.NgaWalk, sizeof(r.NgaWalk));
+    imu.b  = GetBias(r.b);
+    imu.bu = GetBias(r.bu);
+    memcpy(imu.db.data(), r.db, sizeof(r.db));
+    memcpy(imu.dR.data(), r.dR, sizeof(r.dR));
+    memcpy(imu.dV.data(), r.dV, sizeof(r.dV));
+    memcpy(imu.dP.data(), r.dP, sizeof(r.dP));
+    memcpy(imu.JRg.data(), r.JRg, sizeof(r.JRg));
+    memcpy(imu.JVg.data(), r.JVg, sizeof(r.JVg));
+    memcpy(imu.JVa.data(), r.JVa, sizeof(r.JVa));
+    memcpy(imu.JPg.data(), r.JPg, sizeof(r.JPg));
+    memcpy(imu.JPa.data(), r.JPa, sizeof(r.JPa));
+    memcpy(imu.avgA.data(), r.avgA, sizeof(r.avgA));
+    memcpy(imu.avgW.data(), r.avgW, sizeof(r.avgW));
+
+    const MeasurementRecord* pMeasurements =
+        rd.Get<MeasurementRecord>(SEC_ARRAYS, r.measurements);
+    imu.mvMeasurements.clear();
+    for (size_t i = 0; pMeasurements && i < r.measurements.count; i++)
+    {
+        const MeasurementRecord& m = pMeasurements[i];
+        imu.mvMeasurements.emplace_back(Eigen::Vector3f(m.a[0], m.a[1], m.a[2]),
+                                        Eigen::Vector3f(m.w[0], m.w[1], m.w[2]),
+                                        m.t);
+    }
+}
+
+}  // namespace ORB_SLAM3
@@ -0,0 +1,102 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef ATLASFILE_H
+#define ATLASFILE_H
+#include <cstdint>
+#include <string>
+
+#include "feature/ORBVocabulary.h"
+
+namespace ORB_SLAM3
+{
+
+class Atlas;
+class Map;
+class KeyFrame;
+class MapPoint;
+class KeyFrameDatabase;
+class GeometricCamera;
+
+namespace IMU
+{
+class Preintegrated;
+}
+
+// Binary save file of an Atlas. Little endian, made of contiguous sections of
+// fixed size records (cameras, maps, keyframes, map points, observations,
+// covisibility and spanning tree edges, ...) that refer to each other by
+// offset. Loading maps the file in memory and copies the arrays into the new
+// objects without parsing them, then rebuilds the pointers through the
+// PostLoad functions of Atlas, Map, KeyFrame and MapPoint.
+class AtlasFile
+{
+public:
+    // Increased on every change of the layout, older files are refused
+    static const uint32_t VERSION = 1;
+
+    // Saves every map of pAtlas. Calls Atlas::PreSave, so the threads that
+    // change the atlas must be stopped.
+    static bool Save(Atlas*             pAtlas,
+                     ORBVocabulary*     pVoc,
+                     const std::string& filename);
+
+    // New atlas with the maps of the file, registered in pKFDB. The current
+    // map is the one that was current when saved. NULL if the file cannot be
+    // read or was saved with another vocabulary.
+    static Atlas* Load(const std::string& filename,
+                       ORBVocabulary*     pVoc,
+                       KeyFrameDatabase*  pKFDB);
+
+private:
+    // Defined in AtlasFile.cpp
+    class Writer;
+    class Reader;
+    struct CameraRecord;
+    struct MapRecord;
+    struct KeyFrameRecord;
+    struct MapPointRecord;
+    struct PreintegratedRecord;
+
+    // The objects are written from and read into their members directly,
+    // AtlasFile is a friend of each class
+    static void WriteCamera(Writer& w, GeometricCamera* pCam, CameraRecord& r);
+    static void WriteMap(Writer& w, Map* pMap, MapRecord& r);
+    static void WriteKeyFrame(Writer& w, KeyFrame* pKF, KeyFrameRecord& r);
+    static void WriteMapPoint(Writer& w, MapPoint* pMP, MapPointRecord& r);
+    static void WritePreintegrated(Writer&              w,
+                                   IMU::Preintegrated&  imu,
+                                   PreintegratedRecord& r);
+
+    static GeometricCamera* ReadCamera(Reader& rd, const CameraRecord& r);
+    static Map*             ReadMap(Reader& rd, const MapRecord& r);
+    static KeyFrame*        ReadKeyFrame(Reader& rd, const KeyFrameRecord& r);
+    static MapPoint*        ReadMapPoint(Reader& rd, const MapPointRecord& r);
+    static void             ReadPreintegrated(Reader&                    rd,
+                                              const PreintegratedRecord& r,
+                                              IMU::Preintegrated&        imu);
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // ATLASFILE_H
@@ -99,7 +99,7 @@ void Map::AddKeyFrame(KeyFrame* pKF)
         mpKFinitial = pKF;
         mpKFlowerID = pKF;
     }
-    mspKeyFrames.insert(pKF);
+    mspKeyFrames.Insert(pKF);
     if (pKF->mnId > mnMaxKFid)
     {
         mnMaxKFid = pKF->mnId;
@@ -113,7 +113,8 @@ void Map::AddKeyFrame(KeyFrame* pKF)
 void Map::AddMapPoint(MapPoint* pMP)
 {
     unique_lock<mutex> lock(mMutexMap);
-    mspMapPoints.insert(pMP);
+    mspMapPoints.Insert(pMP);
+    mPointGrid.Insert(pMP);
 }
 
 void Map::SetImuInitialized()
@@ -131,7 +132,8 @@ bool Map::isImuInitialized()
 void Map::EraseMapPoint(MapPoint* pMP)
 {
     unique_lock<mutex> lock(mMutexMap);
-    mspMapPoints.erase(pMP);
+    mspMapPoints.Erase(pMP);
+    mPointGrid.Erase(pMP);
 
     // TODO: This only erase the pointer.
     // Delete the MapPoint
@@ -140,7 +142,7 @@ void Map::EraseMapPoint(MapPoint* pMP)
 void Map::EraseKeyFrame(KeyFrame* pKF)
 {
     unique_lock<mutex> lock(mMutexMap);
-    mspKeyFrames.erase(pKF);
+    mspKeyFrames.Erase(pKF);
     if (mspKeyFrames.size() > 0)
     {
         if (pKF->mnId == mpKFlowerID->mnId)
@@ -189,6 +191,53 @@ vector<MapPoint*> Map::GetAllMapPoints()
     return vector<MapPoint*>(mspMapPoints.begin(), mspMapPoints.end());
 }
 
+SlotMap<KeyFrame>::Handle Map::GetKeyFrameHandle(KeyFrame* pKF)
+{
+    unique_lock<mutex> lock(mMutexMap);
+    return mspKeyFrames.Find(pKF);
+}
+
+SlotMap<MapPoint>::Handle Map::GetMapPointHandle(MapPoint* pMP)
+{
+    unique_lock<mutex> lock(mMutexMap);
+    return mspMapPoints.Find(pMP);
+}
+
+KeyFrame* Map::GetKeyFrame(SlotMap<KeyFrame>::Handle h)
+{
+    unique_lock<mutex> lock(mMutexMap);
+    return mspKeyFrames.Get(h);
+}
+
+MapPoint* Map::GetMapPoint(SlotMap<MapPoint>::Handle h)
+{
+    unique_lock<mutex> lock(mMutexMap);
+    return mspMapPoints.Get(h);
+}
+
+vector<MapPoint*> Map::GetMapPointsInBox(const Eigen::Vector3f& min,
+                                          const Eigen::Vector3f& max)
+{
+    return mPointGrid.QueryBox(min, max);
+}
+
+vector<MapPoint*> Map::GetMapPointsInFrustum(const VoxelGrid::Frustum& frustum)
+{
+    return mPointGrid.QueryFrustum(frustum);
+}
+
+vector<MapPoint*> Map::GetNearestMapPoints(const Eigen::Vector3f& pos,
+                                           size_t                 k,
+                                           float                  maxDist)
+{
+    return mPointGrid.QueryKNN(pos, k, maxDist);
+}
+
+void Map::UpdateMapPointPosition(MapPoint* pMP, const Eigen::Vector3f& pos)
+{
+    mPointGrid.Update(pMP, pos);
+}
+
 long unsigned int Map::MapPointsInMap()
 {
     unique_lock<mutex> lock(mMutexMap);
@@ -250,18 +299,15 @@ void Map::clear()
     //    send=mspMapPoints.end(); sit!=send; sit++)
     //        delete *sit;
 
-    for (set<KeyFrame*>::iterator sit  = mspKeyFrames.begin(),
-                                  send = mspKeyFrames.end();
-         sit != send;
-         sit++)
+    for (KeyFrame* pKF : mspKeyFrames)
     {
-        KeyFrame* pKF = *sit;
         pKF->UpdateMap(static_cast<Map*>(NULL));
         //        delete *sit;
     }
 
     mspMapPoints.clear();
     mspKeyFrames.clear();
+    mPointGrid.Clear();
     mnMaxKFid        = mnInitKFid;
     mbImuInitialized = false;
     mvpReferenceMapPoints.clear();
@@ -297,11 +343,8 @@ void Map::ApplyScaledRotation(const Sophus::SE3f& T,
     Eigen::Matrix3f Ryw = Tyw.rotationMatrix();
     Eigen::Vector3f tyw = Tyw.translation();
 
-    for (set<KeyFrame*>::iterator sit = mspKeyFrames.begin();
-         sit != mspKeyFrames.end();
-         sit++)
+    for (KeyFrame* pKF : mspKeyFrames)
     {
-        KeyFrame*    pKF = *sit;
         Sophus::SE3f Twc = pKF->GetPoseInverse();
         Twc.translation() *= s;
         Sophus::SE3f Tyc = Tyw * Twc;
@@ -313,11 +356,8 @@ void Map::ApplyScaledRotation(const Sophus::SE3f& T,
         else
             pKF->SetVelocity(Ryw * Vw * s);
     }
-    for (set<MapPoint*>::iterator sit = mspMapPoints.begin();
-         sit != mspMapPoints.end();
-         sit++)
+    for (MapPoint* pMP : mspMapPoints)
     {
-        MapPoint* pMP = *sit;
         pMP->SetWorldPos(s * Ryw * pMP->GetWorldPos() + tyw);
         pMP->UpdateNormalAndDepth();
     }
@@ -401,18 +441,21 @@ void Map::SetLastMapChange(int currentChangeId)
 
 void Map::PreSave(std::set<GeometricCamera*>& spCams)
 {
+    // Points made bad here erase themselves from the map, go over a copy
+    const vector<MapPoint*> vpMPs = GetAllMapPoints();
+
     int nMPWithoutObs = 0;
-    for (MapPoint* pMPi : mspMapPoints)
+    for (MapPoint* pMPi : vpMPs)
     {
         if (!pMPi || pMPi->isBad()) continue;
 
-        if (pMPi->GetObservations().size() == 0)
+        ObservationList mpObs = pMPi->GetObservations();
+        if (mpObs.size() == 0)
         {
             nMPWithoutObs++;
         }
-        map<KeyFrame*, std::tuple<int, int>> mpObs = pMPi->GetObservations();
-        for (map<KeyFrame*, std::tuple<int, int>>::iterator it  = mpObs.begin(),
-                                                            end = mpObs.end();
+        for (ObservationList::iterator it  = mpObs.begin(),
+                                       end = mpObs.end();
              it != end;
              ++it)
         {
@@ -432,24 +475,27 @@ void Map::PreSave(std::set<GeometricCamera*>& spCams)
     }
 
 
+    set<MapPoint*> spMPs(mspMapPoints.begin(), mspMapPoints.end());
+    set<KeyFrame*> spKFs(mspKeyFrames.begin(), mspKeyFrames.end());
+
     // Backup of MapPoints
     mvpBackupMapPoints.clear();
-    for (MapPoint* pMPi : mspMapPoints)
+    for (MapPoint* pMPi : spMPs)
     {
         if (!pMPi || pMPi->isBad()) continue;
 
         mvpBackupMapPoints.push_back(pMPi);
-        pMPi->PreSave(mspKeyFrames, mspMapPoints);
+        pMPi->PreSave(spKFs, spMPs);
     }
 
     // Backup of KeyFrames
     mvpBackupKeyFrames.clear();
-    for (KeyFrame* pKFi : mspKeyFrames)
+    for (KeyFrame* pKFi : spKFs)
     {
         if (!pKFi || pKFi->isBad()) continue;
 
         mvpBackupKeyFrames.push_back(pKFi);
-        pKFi->PreSave(mspKeyFrames, mspMapPoints, spCams);
+        pKFi->PreSave(spKFs, spMPs, spCams);
     }
 
     mnBackupKFinitialID = -1;
@@ -471,12 +517,12 @@ void Map::PostLoad(
         pORBVoc /*, map<long unsigned int, KeyFrame*>& mpKeyFrameId*/,
     map<unsigned int, GeometricCamera*>& mpCams)
 {
-    std::copy(mvpBackupMapPoints.begin(),
-              mvpBackupMapPoints.end(),
-              std::inserter(mspMapPoints, mspMapPoints.begin()));
-    std::copy(mvpBackupKeyFrames.begin(),
-              mvpBackupKeyFrames.end(),
-              std::inserter(mspKeyFrames, mspKeyFrames.begin()));
+    for (MapPoint* pMPi : mvpBackupMapPoints)
+    {
+        mspMapPoints.Insert(pMPi);
+        mPointGrid.Insert(pMPi);
+    }
+    for (KeyFrame* pKFi : mvpBackupKeyFrames) mspKeyFrames.Insert(pKFi);
 
     map<long unsigned int, MapPoint*> mpMapPointId;
     for (MapPoint* pMPi : mspMapPoints)
@@ -29,6 +29,9 @@
 
 #include "frame/KeyFrame.h"
 
+#include "map/VoxelGrid.h"
+#include "utils/SlotMap.h"
+
 namespace ORB_SLAM3
 {
 
@@ -39,6 +42,8 @@ class KeyFrameDatabase;
 
 class Map
 {
+    friend class AtlasFile;
+
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     Map();
@@ -57,6 +62,41 @@ public:
     std::vector<MapPoint*> GetAllMapPoints();
     std::vector<MapPoint*> GetReferenceMapPoints();
 
+    // Call f on every keyframe / map point without copying them. f runs with
+    // the map locked, so it must not call back into the map.
+    template <typename F>
+    void ForEachKeyFrame(F f)
+    {
+        std::unique_lock<std::mutex> lock(mMutexMap);
+        for (KeyFrame* pKF : mspKeyFrames) f(pKF);
+    }
+
+    template <typename F>
+    void ForEachMapPoint(F f)
+    {
+        std::unique_lock<std::mutex> lock(mMutexMap);
+        for (MapPoint* pMP : mspMapPoints) f(pMP);
+    }
+
+    // Handle of a keyframe / map point of the map, INVALID_HANDLE if it is
+    // not in the map. The element of a handle is NULL once it is erased.
+    SlotMap<KeyFrame>::Handle GetKeyFrameHandle(KeyFrame* pKF);
+    SlotMap<MapPoint>::Handle GetMapPointHandle(MapPoint* pMP);
+    KeyFrame*                 GetKeyFrame(SlotMap<KeyFrame>::Handle h);
+    MapPoint*                 GetMapPoint(SlotMap<MapPoint>::Handle h);
+
+    // Map points by position, see VoxelGrid
+    std::vector<MapPoint*> GetMapPointsInBox(const Eigen::Vector3f& min,
+                                             const Eigen::Vector3f& max);
+    std::vector<MapPoint*> GetMapPointsInFrustum(
+        const VoxelGrid::Frustum& frustum);
+    std::vector<MapPoint*> GetNearestMapPoints(const Eigen::Vector3f& pos,
+                                               size_t                 k,
+                                               float                  maxDist);
+
+    // Called by a map point of the map when it moves
+    void UpdateMapPointPosition(MapPoint* pMP, const Eigen::Vector3f& pos);
+
     long unsigned int MapPointsInMap();
     long unsigned     KeyFramesInMap();
 
@@ -140,8 +180,12 @@ public:
 protected:
     long unsigned int mnId;
 
-    std::set<MapPoint*> mspMapPoints;
-    std::set<KeyFrame*> mspKeyFrames;
+    // Stored contiguously for the viewer and the full map traversals
+    SlotMap<MapPoint> mspMapPoints;
+    SlotMap<KeyFrame> mspKeyFrames;
+
+    // Spatial index of mspMapPoints, it has its own lock
+    VoxelGrid mPointGrid;
 
     // Save/load, the set structure is broken in libboost 1.58 for ubuntu 16.04,
     // a vector is serializated
@@ -30,6 +30,17 @@ namespace ORB_SLAM3
 long unsigned int MapPoint::nNextId = 0;
 mutex             MapPoint::mGlobalMutex;
 
+// Positions and normals are kept in their SeqLock as plain floats
+static std::array<float, 3> ToArray(const Eigen::Vector3f& v)
+{
+    return { v.x(), v.y(), v.z() };
+}
+
+static Eigen::Vector3f ToVector(const std::array<float, 3>& a)
+{
+    return Eigen::Vector3f(a[0], a[1], a[2]);
+}
+
 MapPoint::MapPoint()
     : mnFirstKFid(0)
     , mnFirstFrame(0)
@@ -46,6 +57,12 @@ MapPoint::MapPoint()
     , mnFound(1)
     , mbBad(false)
     , mpReplaced(static_cast<MapPoint*>(NULL))
+    , mfMinDistance(0)
+    , mfMaxDistance(0)
+    , mpRefKF(nullptr)
+    , mpHostKF(nullptr)
+    , mpMap(nullptr)
+    , mnOriginMapId(0)
 {
     mpReplaced = static_cast<MapPoint*>(NULL);
 }
@@ -74,7 +91,7 @@ MapPoint::MapPoint(const Eigen::Vector3f& Pos, KeyFrame* pRefKF, Map* pMap)
 {
     SetWorldPos(Pos);
 
-    mNormalVector.setZero();
+    mNormalVector.Store(ToArray(Eigen::Vector3f::Zero()));
 
     mbTrackInViewR = false;
     mbTrackInView  = false;
@@ -116,7 +133,7 @@ MapPoint::MapPoint(const double invDepth,
     mInitV    = (double)uv_init.y;
     mpHostKF  = pHostKF;
 
-    mNormalVector.setZero();
+    mNormalVector.Store(ToArray(Eigen::Vector3f::Zero()));
 
     // Worldpos is not set
     // MapPoints can be created from Tracking and Local Mapping. This mutex
@@ -163,10 +180,9 @@ MapPoint::MapPoint(const Eigen::Vector3f& Pos,
 
         Ow = Rwl * tlr + twl;
     }
-    mNormalVector = mWorldPos - Ow;
-    mNormalVector = mNormalVector / mNormalVector.norm();
+    mNormalVector.Store(ToArray((Pos - Ow) / (Pos - Ow).norm()));
 
-    Eigen::Vector3f PC   = mWorldPos - Ow;
+    Eigen::Vector3f PC   = Pos - Ow;
     const float     dist = PC.norm();
     const int   level    = (pFrame->Nleft == -1) ? pFrame->mvKeysUn[idxF].octave
                          : (idxF < pFrame->Nleft) ? pFrame->mvKeys[idxF].octave
@@ -178,6 +194,9 @@ MapPoint::MapPoint(const Eigen::Vector3f& Pos,
     mfMinDistance = mfMaxDistance / pFrame->mvScaleFactors[nLevels - 1];
 
     pFrame->mDescriptors.row(idxF).copyTo(mDescriptor);
+    memcpy(mPackedDescriptor,
+           pFrame->mvPackedDescriptors[idxF].w,
+           sizeof(mPackedDescriptor));
 
     // MapPoints can be created from Tracking and Local Mapping. This mutex
     // avoid conflicts with id.
@@ -189,19 +208,21 @@ void MapPoint::SetWorldPos(const Eigen::Vector3f& Pos)
 {
     unique_lock<mutex> lock2(mGlobalMutex);
     unique_lock<mutex> lock(mMutexPos);
-    mWorldPos = Pos;
+    mWorldPos.Store(ToArray(Pos));
+
+    // Still under mMutexPos, so the index sees the moves in order
+    Map* pMap = GetMap();
+    if (pMap) pMap->UpdateMapPointPosition(this, Pos);
 }
 
 Eigen::Vector3f MapPoint::GetWorldPos()
 {
-    unique_lock<mutex> lock(mMutexPos);
-    return mWorldPos;
+    return ToVector(mWorldPos.Load());
 }
 
 Eigen::Vector3f MapPoint::GetNormal()
 {
-    unique_lock<mutex> lock(mMutexPos);
-    return mNormalVector;
+    return ToVector(mNormalVector.Load());
 }
 
 
@@ -211,11 +232,34 @@ KeyFrame* MapPoint::GetReferenceKeyFrame()
     return mpRefKF;
 }
 
+// Add n to the covisibility of pKF with the other keyframes in obs, both ways
+static void ChangeCovisibility(const ObservationList& obs,
+                               KeyFrame*              pKF,
+                               const int              n)
+{
+    for (const ObservationList::value_type& ob : obs)
+    {
+        if (ob.first == pKF) continue;
+        pKF->ChangeCovisibility(ob.first, n);
+        ob.first->ChangeCovisibility(pKF, n);
+    }
+}
+
+// Remove the covisibility between every pair of keyframes in obs
+static void EraseCovisibility(const ObservationList& obs)
+{
+    for (const ObservationList::value_type& ob1 : obs)
+        for (const ObservationList::value_type& ob2 : obs)
+            if (ob1.first != ob2.first)
+                ob1.first->ChangeCovisibility(ob2.first, -1);
+}
+
 void MapPoint::AddObservation(KeyFrame* pKF, int idx)
 {
     unique_lock<mutex> lock(mMutexFeatures);
     tuple<int, int>    indexes;
 
+    // Only good points count in the covisibility of their keyframes
     if (mObservations.count(pKF))
     {
         indexes = mObservations[pKF];
@@ -223,6 +267,7 @@ void MapPoint::AddObservation(KeyFrame* pKF, int idx)
     else
     {
         indexes = tuple<int, int>(-1, -1);
+        if (!mbBad) ChangeCovisibility(mObservations, pKF, 1);
     }
 
     if (pKF->NLeft != -1 && idx >= pKF->NLeft)
@@ -236,6 +281,13 @@ void MapPoint::AddObservation(KeyFrame* pKF, int idx)
 
     mObservations[pKF] = indexes;
 
+    if (!mbBad)
+    {
+        EraseDescriptorSamples(pKF);
+        if (get<0>(indexes) != -1) AddDescriptorSample(pKF, get<0>(indexes));
+        if (get<1>(indexes) != -1) AddDescriptorSample(pKF, get<1>(indexes));
+    }
+
     if (!pKF->mpCamera2 && pKF->mvuRight[idx] >= 0)
         nObs += 2;
     else
@@ -265,6 +317,13 @@ void MapPoint::EraseObservation(KeyFrame* pKF)
             }
 
             mObservations.erase(pKF);
+            if (!mbBad)
+            {
+                ChangeCovisibility(mObservations, pKF, -1);
+
+                EraseDescriptorSamples(pKF);
+                if (mvDescriptorSamples.empty()) RebuildDescriptorSamples();
+            }
 
             if (mpRefKF == pKF) mpRefKF = mObservations.begin()->first;
 
@@ -277,7 +336,7 @@ void MapPoint::EraseObservation(KeyFrame* pKF)
 }
 
 
-std::map<KeyFrame*, std::tuple<int, int>> MapPoint::GetObservations()
+ObservationList MapPoint::GetObservations()
 {
     unique_lock<mutex> lock(mMutexFeatures);
     return mObservations;
@@ -291,16 +350,18 @@ int MapPoint::Observations()
 
 void MapPoint::SetBadFlag()
 {
-    map<KeyFrame*, tuple<int, int>> obs;
+    ObservationList obs;
     {
         unique_lock<mutex> lock1(mMutexFeatures);
         unique_lock<mutex> lock2(mMutexPos);
+        if (!mbBad) EraseCovisibility(mObservations);
         mbBad = true;
         obs   = mObservations;
         mObservations.clear();
+        mvDescriptorSamples.clear();
     }
-    for (map<KeyFrame*, tuple<int, int>>::iterator mit  = obs.begin(),
-                                                   mend = obs.end();
+    for (ObservationList::iterator mit  = obs.begin(),
+                                   mend = obs.end();
          mit != mend;
          mit++)
     {
@@ -330,21 +391,23 @@ void MapPoint::Replace(MapPoint* pMP)
 {
     if (pMP->mnId == this->mnId) return;
 
-    int                             nvisible, nfound;
-    map<KeyFrame*, tuple<int, int>> obs;
+    int             nvisible, nfound;
+    ObservationList obs;
     {
         unique_lock<mutex> lock1(mMutexFeatures);
         unique_lock<mutex> lock2(mMutexPos);
+        if (!mbBad) EraseCovisibility(mObservations);
         obs = mObservations;
         mObservations.clear();
+        mvDescriptorSamples.clear();
         mbBad      = true;
         nvisible   = mnVisible;
         nfound     = mnFound;
         mpReplaced = pMP;
     }
 
-    for (map<KeyFrame*, tuple<int, int>>::iterator mit  = obs.begin(),
-                                                   mend = obs.end();
+    for (ObservationList::iterator mit  = obs.begin(),
+                                   mend = obs.end();
          mit != mend;
          mit++)
     {
@@ -413,86 +476,96 @@ float MapPoint::GetFoundRatio()
     return static_cast<float>(mnFound) / mnVisible;
 }
 
-void MapPoint::ComputeDistinctiveDescriptors()
+void MapPoint::AddDescriptorSample(KeyFrame* pKF, int idx)
 {
-    // Retrieve all observed descriptors
-    vector<cv::Mat> vDescriptors;
-
-    map<KeyFrame*, tuple<int, int>> observations;
+    if (mvDescriptorSamples.size() >= MAX_DESCRIPTOR_SAMPLES)
+        EraseDescriptorSample(0);
 
+    DescriptorSample sample;
+    sample.descriptor  = pKF->mvPackedDescriptors[idx];
+    sample.pKF         = pKF;
+    sample.distanceSum = 0;
+    for (DescriptorSample& other : mvDescriptorSamples)
     {
-        unique_lock<mutex> lock1(mMutexFeatures);
-        if (mbBad) return;
-        observations = mObservations;
+        const int dist =
+            ORBkernels::Distance(other.descriptor, sample.descriptor);
+        other.distanceSum += dist;
+        sample.distanceSum += dist;
     }
+    mvDescriptorSamples.push_back(sample);
+}
 
-    if (observations.empty()) return;
-
-    vDescriptors.reserve(observations.size());
-
-    for (map<KeyFrame*, tuple<int, int>>::iterator mit  = observations.begin(),
-                                                   mend = observations.end();
-         mit != mend;
-         mit++)
+void MapPoint::EraseDescriptorSample(size_t i)
+{
+    const ORBkernels::Descriptor& descriptor =
+        mvDescriptorSamples[i].descriptor;
+    for (size_t j = 0; j < mvDescriptorSamples.size(); j++)
     {
-        KeyFrame* pKF = mit->first;
-
-        if (!pKF->isBad())
-        {
-            tuple<int, int> indexes = mit->second;
-            int leftIndex = get<0>(indexes), rightIndex = get<1>(indexes);
-
-            if (leftIndex != -1)
-            {
-                vDescriptors.push_back(pKF->mDescriptors.row(leftIndex));
-            }
-            if (rightIndex != -1)
-            {
-                vDescriptors.push_back(pKF->mDescriptors.row(rightIndex));
-            }
-        }
+        if (j == i) continue;
+        mvDescriptorSamples[j].distanceSum -=
+            ORBkernels::Distance(mvDescriptorSamples[j].descriptor, descriptor);
     }
+    mvDescriptorSamples.erase(mvDescriptorSamples.begin() + i);
+}
 
-    if (vDescriptors.empty()) return;
-
-    // Compute distances between them
-    const size_t N = vDescriptors.size();
+void MapPoint::EraseDescriptorSamples(KeyFrame* pKF)
+{
+    for (size_t i = 0; i < mvDescriptorSamples.size();)
+    {
+        if (mvDescriptorSamples[i].pKF == pKF)
+            EraseDescriptorSample(i);
+        else
+            i++;
+    }
+}
 
-    // float Distances[N][N];
-    std::vector<std::vector<float>> Distances(N, std::vector<float>(N, 0.0f));
-    for (size_t i = 0; i < N; i++)
+void MapPoint::RebuildDescriptorSamples()
+{
+    mvDescriptorSamples.clear();
+    for (const ObservationList::value_type& ob : mObservations)
     {
-        Distances[i][i] = 0;
-        for (size_t j = i + 1; j < N; j++)
-        {
-            int distij      = ORBmatcher::DescriptorDistance(vDescriptors[i],
-                                                        vDescriptors[j]);
-            Distances[i][j] = distij;
-            Distances[j][i] = distij;
-        }
+        const int leftIndex = get<0>(ob.second), rightIndex = get<1>(ob.second);
+        if (leftIndex != -1) AddDescriptorSample(ob.first, leftIndex);
+        if (rightIndex != -1) AddDescriptorSample(ob.first, rightIndex);
     }
+}
 
-    // Take the descriptor with least median distance to the rest
-    int BestMedian = INT_MAX;
-    int BestIdx    = 0;
-    for (size_t i = 0; i < N; i++)
+void MapPoint::ComputeDistinctiveDescriptors()
+{
+    // Keyframes of the samples, checked for isBad() without the lock held
+    KeyFrame* vpSampleKFs[MAX_DESCRIPTOR_SAMPLES];
+    size_t    nSampleKFs = 0;
     {
-        // vector<int> vDists(Distances[i],Distances[i]+N);
-        vector<int> vDists(Distances[i].begin(), Distances[i].end());
-        sort(vDists.begin(), vDists.end());
-        int median = vDists[0.5 * (N - 1)];
+        unique_lock<mutex> lock1(mMutexFeatures);
+        if (mbBad) return;
+        for (const DescriptorSample& sample : mvDescriptorSamples)
+            vpSampleKFs[nSampleKFs++] = sample.pKF;
+    }
 
-        if (median < BestMedian)
-        {
-            BestMedian = median;
-            BestIdx    = i;
-        }
+    size_t nBadKFs = 0;
+    for (size_t i = 0; i < nSampleKFs; i++)
+    {
+        if (vpSampleKFs[i]->isBad()) vpSampleKFs[nBadKFs++] = vpSampleKFs[i];
     }
 
+    unique_lock<mutex> lock(mMutexFeatures);
+    for (size_t i = 0; i < nBadKFs; i++)
+        EraseDescriptorSamples(vpSampleKFs[i]);
+    if (mbBad || mvDescriptorSamples.empty()) return;
+
+    // Take the descriptor with least distance to the rest
+    size_t bestIdx = 0;
+    for (size_t i = 1; i < mvDescriptorSamples.size(); i++)
     {
-        unique_lock<mutex> lock(mMutexFeatures);
-        mDescriptor = vDescriptors[BestIdx].clone();
+        if (mvDescriptorSamples[i].distanceSum <
+            mvDescriptorSamples[bestIdx].distanceSum)
+            bestIdx = i;
     }
+
+    const ORBkernels::Descriptor& best =
+        mvDescriptorSamples[bestIdx].descriptor;
+    mDescriptor = cv::Mat(1, 32, CV_8U, const_cast<uint64_t*>(best.w)).clone();
+    memcpy(mPackedDescriptor, best.w, sizeof(mPackedDescriptor));
 }
 
 cv::Mat MapPoint::GetDescriptor()
@@ -501,6 +574,15 @@ cv::Mat MapPoint::GetDescriptor()
     return mDescriptor.clone();
 }
 
+ORBkernels::Descriptor MapPoint::GetPackedDescriptor()
+{
+    ORBkernels::Descriptor descriptor;
+
+    unique_lock<mutex> lock(mMutexFeatures);
+    memcpy(descriptor.w, mPackedDescriptor, sizeof(mPackedDescriptor));
+    return descriptor;
+}
+
 tuple<int, int> MapPoint::GetIndexInKeyFrame(KeyFrame* pKF)
 {
     unique_lock<mutex> lock(mMutexFeatures);
@@ -518,16 +600,16 @@ bool MapPoint::IsInKeyFrame(KeyFrame* pKF)
 
 void MapPoint::UpdateNormalAndDepth()
 {
-    map<KeyFrame*, tuple<int, int>> observations;
-    KeyFrame*                       pRefKF;
-    Eigen::Vector3f                 Pos;
+    ObservationList observations;
+    KeyFrame*       pRefKF;
+    Eigen::Vector3f Pos;
     {
         unique_lock<mutex> lock1(mMutexFeatures);
         unique_lock<mutex> lock2(mMutexPos);
         if (mbBad) return;
         observations = mObservations;
         pRefKF       = mpRefKF;
-        Pos          = mWorldPos;
+        Pos          = ToVector(mWorldPos.Load());
     }
 
     if (observations.empty()) return;
@@ -535,8 +617,8 @@ void MapPoint::UpdateNormalAndDepth()
     Eigen::Vector3f normal;
     normal.setZero();
     int n = 0;
-    for (map<KeyFrame*, tuple<int, int>>::iterator mit  = observations.begin(),
-                                                   mend = observations.end();
+    for (ObservationList::iterator mit  = observations.begin(),
+                                   mend = observations.end();
          mit != mend;
          mit++)
     {
@@ -588,14 +670,14 @@ void MapPoint::UpdateNormalAndDepth()
         unique_lock<mutex> lock3(mMutexPos);
         mfMaxDistance = dist * levelScaleFactor;
         mfMinDistance = mfMaxDistance / pRefKF->mvScaleFactors[nLevels - 1];
-        mNormalVector = normal / n;
+        mNormalVector.Store(ToArray(normal / n));
     }
 }
 
 void MapPoint::SetNormalVector(const Eigen::Vector3f& normal)
 {
     unique_lock<mutex> lock3(mMutexPos);
-    mNormalVector = normal;
+    mNormalVector.Store(ToArray(normal));
 }
 
 float MapPoint::GetMinDistanceInvariance()
@@ -647,8 +729,8 @@ int MapPoint::PredictScale(const float& currentDist, Frame* pF)
 void MapPoint::PrintObservations()
 {
     cout << "MP_OBS: MP " << mnId << endl;
-    for (map<KeyFrame*, tuple<int, int>>::iterator mit  = mObservations.begin(),
-                                                   mend = mObservations.end();
+    for (ObservationList::iterator mit  = mObservations.begin(),
+                                   mend = mObservations.end();
          mit != mend;
          mit++)
     {
@@ -680,10 +762,11 @@ void MapPoint::PreSave(set<KeyFrame*>& spKF, set<MapPoint*>& spMP)
 
     mBackupObservationsId1.clear();
     mBackupObservationsId2.clear();
-    // Save the id and position in each KF who view it
-    for (std::map<KeyFrame*, std::tuple<int, int>>::const_iterator
-             it  = mObservations.begin(),
-             end = mObservations.end();
+    // Save the id and position in each KF who view it. Go over a copy,
+    // EraseObservation changes the list.
+    const ObservationList observations = GetObservations();
+    for (ObservationList::const_iterator it  = observations.begin(),
+                                         end = observations.end();
          it != end;
          ++it)
     {
@@ -737,9 +820,11 @@ void MapPoint::PostLoad(map<long unsigned int, KeyFrame*>& mpKFid,
         std::tuple<int, int> indexes = tuple<int, int>(it->second, it2->second);
         if (pKFi)
         {
+            ChangeCovisibility(mObservations, pKFi, 1);
             mObservations[pKFi] = indexes;
         }
     }
+    RebuildDescriptorSamples();
 
     mBackupObservationsId1.clear();
     mBackupObservationsId2.clear();
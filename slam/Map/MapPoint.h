@@ -22,14 +22,17 @@
 
 #ifndef MAPPOINT_H
 #define MAPPOINT_H
+#include <array>
 #include <mutex>
 
 #include <opencv2/core/core.hpp>
 
 #include "frame/Frame.h"
 #include "frame/KeyFrame.h"
+#include "map/ObservationList.h"
 
 #include "utils/Converter.h"
+#include "utils/SeqLock.h"
 
 namespace ORB_SLAM3
 {
@@ -40,6 +43,8 @@ class Frame;
 
 class MapPoint
 {
+    friend class AtlasFile;
+
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     MapPoint();
@@ -63,8 +68,19 @@ public:
 
     KeyFrame* GetReferenceKeyFrame();
 
-    std::map<KeyFrame*, std::tuple<int, int>> GetObservations();
-    int                                       Observations();
+    ObservationList GetObservations();
+    int             Observations();
+
+    // Call f(pKF, leftIndex, rightIndex) for each observation without copying
+    // them. f runs with the features lock held, so it must not call back into
+    // this point nor lock keyframes.
+    template <typename F>
+    void ForEachObservation(F f)
+    {
+        std::unique_lock<std::mutex> lock(mMutexFeatures);
+        for (const ObservationList::value_type& ob : mObservations)
+            f(ob.first, std::get<0>(ob.second), std::get<1>(ob.second));
+    }
 
     void AddObservation(KeyFrame* pKF, int idx);
     void EraseObservation(KeyFrame* pKF);
@@ -87,6 +103,9 @@ public:
 
     cv::Mat GetDescriptor();
 
+    // Same descriptor packed for the matcher
+    ORBkernels::Descriptor GetPackedDescriptor();
+
     void UpdateNormalAndDepth();
 
     float GetMinDistanceInvariance();
@@ -151,22 +170,48 @@ public:
     unsigned int mnOriginMapId;
 
 protected:
-    // Position in absolute coordinates
-    Eigen::Vector3f mWorldPos;
+    // Keep mvDescriptorSamples in sync with mObservations, with
+    // mMutexFeatures held
+    void AddDescriptorSample(KeyFrame* pKF, int idx);
+    void EraseDescriptorSample(size_t i);
+    void EraseDescriptorSamples(KeyFrame* pKF);
+    void RebuildDescriptorSamples();
+
+    // Position in absolute coordinates. Read without locks, written under
+    // mMutexPos.
+    SeqLock<std::array<float, 3>> mWorldPos;
 
     // Keyframes observing the point and associated index in keyframe
-    std::map<KeyFrame*, std::tuple<int, int>> mObservations;
+    ObservationList mObservations;
     // For save relation without pointer, this is necessary for save/load
     // function
     std::map<long unsigned int, int> mBackupObservationsId1;
     std::map<long unsigned int, int> mBackupObservationsId2;
 
-    // Mean viewing direction
-    Eigen::Vector3f mNormalVector;
+    // Mean viewing direction, read and written as mWorldPos
+    SeqLock<std::array<float, 3>> mNormalVector;
 
     // Best descriptor to fast matching
     cv::Mat mDescriptor;
 
+    // mDescriptor as plain words, the operator new of Eigen does not give
+    // the alignment of ORBkernels::Descriptor
+    uint64_t mPackedDescriptor[4] = { 0, 0, 0, 0 };
+
+    // Observed descriptors mDescriptor is chosen from, each with the sum of
+    // its distances to the others. Kept up to date as observations come and
+    // go, in insertion order. Long lived points only keep the most recent
+    // MAX_DESCRIPTOR_SAMPLES.
+    struct DescriptorSample
+    {
+        ORBkernels::Descriptor descriptor;
+        KeyFrame*              pKF;
+        int                    distanceSum;
+    };
+    std::vector<DescriptorSample> mvDescriptorSamples;
+
+    static const size_t MAX_DESCRIPTOR_SAMPLES = 32;
+
     // Reference KeyFrame
     KeyFrame*         mpRefKF;
     long unsigned int mBackupRefKFId;
@@ -0,0 +1,174 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OBSERVATIONLIST_H
+#define OBSERVATIONLIST_H
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace ORB_SLAM3
+{
+
+class KeyFrame;
+
+// Keyframes observing a map point with the (left, right) index of the point
+// in each of them. Most points are seen by a handful of keyframes, so the
+// entries live in a small inline array and only move to the heap beyond
+// that. Entries keep their insertion order. Same interface as the
+// std::map<KeyFrame*, std::tuple<int, int>> it replaces.
+class ObservationList
+{
+public:
+    typedef std::pair<KeyFrame*, std::tuple<int, int>> value_type;
+    typedef value_type*                                 iterator;
+    typedef const value_type*                           const_iterator;
+
+    static const int INLINE_CAPACITY = 6;
+
+    ObservationList()
+        : mpData(mInline)
+        , mnSize(0)
+        , mnCapacity(INLINE_CAPACITY)
+    {
+    }
+
+    ObservationList(const ObservationList& other)
+        : ObservationList()
+    {
+        *this = other;
+    }
+
+    ObservationList(ObservationList&& other)
+        : ObservationList()
+    {
+        *this = std::move(other);
+    }
+
+    ~ObservationList() { Release(); }
+
+    ObservationList& operator=(const ObservationList& other)
+    {
+        if (this == &other) return *this;
+        mnSize = 0;
+        Reserve(other.mnSize);
+        std::copy(other.begin(), other.end(), mpData);
+        mnSize = other.mnSize;
+        return *this;
+    }
+
+    ObservationList& operator=(ObservationList&& other)
+    {
+        if (this == &other) return *this;
+        if (other.mpData == other.mInline)
+        {
+            *this = other;
+        }
+        else
+        {
+            Release();
+            mpData           = other.mpData;
+            mnCapacity       = other.mnCapacity;
+            mnSize           = other.mnSize;
+            other.mpData     = other.mInline;
+            other.mnCapacity = INLINE_CAPACITY;
+        }
+        other.mnSize = 0;
+        return *this;
+    }
+
+    iterator       begin() { return mpData; }
+    iterator       end() { return mpData + mnSize; }
+    const_iterator begin() const { return mpData; }
+    const_iterator end() const { return mpData + mnSize; }
+
+    size_t size() const { return mnSize; }
+    bool   empty() const { return mnSize == 0; }
+    void   clear() { mnSize = 0; }
+
+    iterator find(KeyFrame* pKF)
+    {
+        for (iterator it = begin(); it != end(); ++it)
+            if (it->first == pKF) return it;
+        return end();
+    }
+
+    const_iterator find(KeyFrame* pKF) const
+    {
+        for (const_iterator it = begin(); it != end(); ++it)
+            if (it->first == pKF) return it;
+        return end();
+    }
+
+    size_t count(KeyFrame* pKF) const { return find(pKF) != end(); }
+
+    // Indexes of pKF, added with default value if not there yet
+    std::tuple<int, int>& operator[](KeyFrame* pKF)
+    {
+        iterator it = find(pKF);
+        if (it != end()) return it->second;
+
+        Reserve(mnSize + 1);
+        mpData[mnSize] = value_type(pKF, std::tuple<int, int>());
+        return mpData[mnSize++].second;
+    }
+
+    size_t erase(KeyFrame* pKF)
+    {
+        iterator it = find(pKF);
+        if (it == end()) return 0;
+
+        std::copy(it + 1, end(), it);
+        mnSize--;
+        return 1;
+    }
+
+private:
+    void Reserve(const size_t n)
+    {
+        if (n <= mnCapacity) return;
+
+        const size_t capacity = std::max(n, 2 * mnCapacity);
+        value_type*  pData    = new value_type[capacity];
+        std::copy(begin(), end(), pData);
+        Release();
+        mpData     = pData;
+        mnCapacity = capacity;
+    }
+
+    void Release()
+    {
+        if (mpData != mInline) delete[] mpData;
+        mpData     = mInline;
+        mnCapacity = INLINE_CAPACITY;
+    }
+
+    value_type* mpData;
+    size_t      mnSize;
+    size_t      mnCapacity;
+    value_type  mInline[INLINE_CAPACITY];
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // OBSERVATIONLIST_H
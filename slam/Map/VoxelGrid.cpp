@@ -0,0 +1,329 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "map/VoxelGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "map/MapPoint.h"
+
+namespace ORB_SLAM3
+{
+
+VoxelGrid::Frustum VoxelGrid::MakeFrustum(const Sophus::SE3f& Tcw,
+                                          float               xMin,
+                                          float               xMax,
+                                          float               yMin,
+                                          float               yMax,
+                                          float               zNear,
+                                          float               zFar)
+{
+    // Planes in the camera frame
+    const Eigen::Vector4f planesC[6] = {
+        Eigen::Vector4f(1.f, 0.f, -xMin, 0.f),
+        Eigen::Vector4f(-1.f, 0.f, xMax, 0.f),
+        Eigen::Vector4f(0.f, 1.f, -yMin, 0.f),
+        Eigen::Vector4f(0.f, -1.f, yMax, 0.f),
+        Eigen::Vector4f(0.f, 0.f, 1.f, -zNear),
+        Eigen::Vector4f(0.f, 0.f, -1.f, zFar),
+    };
+
+    // n.(R pw + t) + d = (Rt n).pw + n.t + d
+    const Eigen::Matrix3f Rcw = Tcw.rotationMatrix();
+    const Eigen::Vector3f tcw = Tcw.translation();
+
+    Frustum frustum;
+    for (const Eigen::Vector4f& planeC : planesC)
+    {
+        const Eigen::Vector3f n = planeC.head<3>();
+        Eigen::Vector4f       planeW;
+        planeW.head<3>() = Rcw.transpose() * n;
+        planeW(3)        = n.dot(tcw) + planeC(3);
+        frustum.planes.push_back(planeW);
+    }
+
+    const Sophus::SE3f Twc = Tcw.inverse();
+    frustum.min.setConstant(INFINITY);
+    frustum.max.setConstant(-INFINITY);
+    for (const float z : { zNear, zFar })
+        for (const float x : { xMin, xMax })
+            for (const float y : { yMin, yMax })
+            {
+                const Eigen::Vector3f corner = Twc * Eigen::Vector3f(x * z,
+                                                                     y * z,
+                                                                     z);
+                frustum.min = frustum.min.cwiseMin(corner);
+                frustum.max = frustum.max.cwiseMax(corner);
+            }
+
+    return frustum;
+}
+
+VoxelGrid::VoxelGrid(float voxelSize)
+    : mfVoxelSize(voxelSize)
+    , mfInvVoxelSize(1.f / voxelSize)
+{
+}
+
+Eigen::Vector3i VoxelGrid::Cell(const Eigen::Vector3f& pos) const
+{
+    return Eigen::Vector3i(int(std::floor(pos.x() * mfInvVoxelSize)),
+                           int(std::floor(pos.y() * mfInvVoxelSize)),
+                           int(std::floor(pos.z() * mfInvVoxelSize)));
+}
+
+uint64_t VoxelGrid::Key(const Eigen::Vector3i& cell)
+{
+    // 21 bits per coordinate
+    const uint64_t mask = (1u << 21) - 1;
+    return ((uint64_t(cell.x()) & mask) << 42) |
+           ((uint64_t(cell.y()) & mask) << 21) | (uint64_t(cell.z()) & mask);
+}
+
+void VoxelGrid::Insert(MapPoint* pMP)
+{
+    unique_lock<mutex> lock(mMutex);
+    if (mVoxelOf.count(pMP)) return;
+
+    // Read under the lock, so a concurrent Update is not lost. GetWorldPos
+    // takes no lock, which keeps the lock order of the class comment.
+    const Eigen::Vector3f pos = pMP->GetWorldPos();
+    const uint64_t        key = Key(Cell(pos));
+
+    mVoxels[key].push_back({ pMP, pos });
+    mVoxelOf[pMP] = key;
+}
+
+void VoxelGrid::Update(MapPoint* pMP, const Eigen::Vector3f& pos)
+{
+    unique_lock<mutex> lock(mMutex);
+    std::unordered_map<MapPoint*, uint64_t>::iterator it = mVoxelOf.find(pMP);
+    if (it == mVoxelOf.end()) return;
+
+    const uint64_t key = Key(Cell(pos));
+    if (key == it->second)
+    {
+        for (Entry& entry : mVoxels[key])
+            if (entry.pMP == pMP) entry.pos = pos;
+        return;
+    }
+
+    EraseFromVoxel(pMP, it->second);
+    mVoxels[key].push_back({ pMP, pos });
+    it->second = key;
+}
+
+void VoxelGrid::Erase(MapPoint* pMP)
+{
+    unique_lock<mutex> lock(mMutex);
+    std::unordered_map<MapPoint*, uint64_t>::iterator it = mVoxelOf.find(pMP);
+    if (it == mVoxelOf.end()) return;
+
+    EraseFromVoxel(pMP, it->second);
+    mVoxelOf.erase(it);
+}
+
+void VoxelGrid::EraseFromVoxel(MapPoint* pMP, uint64_t key)
+{
+    Voxels::iterator    vit     = mVoxels.find(key);
+    std::vector<Entry>& entries = vit->second;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].pMP != pMP) continue;
+        entries[i] = entries.back();
+        entries.pop_back();
+        break;
+    }
+    if (entries.empty()) mVoxels.erase(vit);
+}
+
+void VoxelGrid::Clear()
+{
+    unique_lock<mutex> lock(mMutex);
+    mVoxels.clear();
+    mVoxelOf.clear();
+}
+
+size_t VoxelGrid::Size()
+{
+    unique_lock<mutex> lock(mMutex);
+    return mVoxelOf.size();
+}
+
+template <typename F>
+void VoxelGrid::ForEachEntryInBox(const Eigen::Vector3f& min,
+                                  const Eigen::Vector3f& max,
+                                  F                      f)
+{
+    const Eigen::Vector3i c0 = Cell(min);
+    const Eigen::Vector3i c1 = Cell(max);
+
+    const double nCells = double(c1.x() - c0.x() + 1) *
+                          double(c1.y() - c0.y() + 1) *
+                          double(c1.z() - c0.z() + 1);
+    if (nCells > mVoxels.size())
+    {
+        for (const Voxels::value_type& voxel : mVoxels)
+            for (const Entry& entry : voxel.second) f(entry);
+        return;
+    }
+
+    for (int x = c0.x(); x <= c1.x(); x++)
+        for (int y = c0.y(); y <= c1.y(); y++)
+            for (int z = c0.z(); z <= c1.z(); z++)
+            {
+                Voxels::const_iterator vit =
+                    mVoxels.find(Key(Eigen::Vector3i(x, y, z)));
+                if (vit == mVoxels.end()) continue;
+                for (const Entry& entry : vit->second) f(entry);
+            }
+}
+
+vector<MapPoint*> VoxelGrid::QueryBox(const Eigen::Vector3f& min,
+                                      const Eigen::Vector3f& max)
+{
+    vector<MapPoint*> vpMPs;
+
+    unique_lock<mutex> lock(mMutex);
+    ForEachEntryInBox(min,
+                      max,
+                      [&](const Entry& entry)
+                      {
+                          if ((entry.pos.array() >= min.array()).all() &&
+                              (entry.pos.array() <= max.array()).all())
+                              vpMPs.push_back(entry.pMP);
+                      });
+    return vpMPs;
+}
+
+vector<MapPoint*> VoxelGrid::QueryFrustum(const Frustum& frustum)
+{
+    vector<MapPoint*> vpMPs;
+
+    unique_lock<mutex> lock(mMutex);
+    ForEachEntryInBox(frustum.min,
+                      frustum.max,
+                      [&](const Entry& entry)
+                      {
+                          for (const Eigen::Vector4f& plane : frustum.planes)
+                              if (plane.head<3>().dot(entry.pos) + plane(3) < 0)
+                                  return;
+                          vpMPs.push_back(entry.pMP);
+                      });
+    return vpMPs;
+}
+
+vector<MapPoint*> VoxelGrid::QueryKNN(const Eigen::Vector3f& pos,
+                                      size_t                 k,
+                                      float                  maxDist)
+{
+    vector<pair<float, MapPoint*>> vNearest;
+    if (k == 0) return vector<MapPoint*>();
+
+    unique_lock<mutex> lock(mMutex);
+
+    // Go over shells of voxels around pos. Points in shell r+1 are at least
+    // r voxels away, stop when the k-th nearest is closer than that.
+    // maxDist may be infinite, clamp the radius before converting it. Shells
+    // wider than 2^21 voxels would wrap around the keys.
+    const float           rLimit = float((1 << 20) - 1);
+    const float           rDist  = std::ceil(maxDist * mfInvVoxelSize);
+    const Eigen::Vector3i c      = Cell(pos);
+    const float           maxSq  = maxDist * maxDist;
+    const int             rMax   = rDist < rLimit ? int(rDist) : int(rLimit);
+    size_t                nSeen  = 0;
+    double                nCells = 0;
+    bool                  bScan  = false;
+    for (int r = 0; r <= rMax && nSeen < mVoxelOf.size(); r++)
+    {
+        // Past as many lookups as there are voxels, e.g. around a far
+        // outlier, a scan of all the entries is cheaper
+        nCells += r == 0 ? 1 : 24 * double(r) * r + 2;
+        if (nCells > mVoxels.size())
+        {
+            bScan = true;
+            break;
+        }
+
+        for (int x = -r; x <= r; x++)
+            for (int y = -r; y <= r; y++)
+                for (int z = -r; z <= r; z++)
+                {
+                    // Only the voxels on the surface of the shell
+                    if (std::abs(x) != r && std::abs(y) != r &&
+                        std::abs(z) != r)
+                        continue;
+
+                    Voxels::const_iterator vit =
+                        mVoxels.find(Key(c + Eigen::Vector3i(x, y, z)));
+                    if (vit == mVoxels.end()) continue;
+
+                    for (const Entry& entry : vit->second)
+                    {
+                        nSeen++;
+                        const float distSq = (entry.pos - pos).squaredNorm();
+                        if (distSq <= maxSq)
+                            vNearest.push_back(make_pair(distSq, entry.pMP));
+                    }
+                }
+
+        if (vNearest.size() >= k)
+        {
+            std::nth_element(vNearest.begin(),
+                             vNearest.begin() + k - 1,
+                             vNearest.end());
+            vNearest.resize(k);
+            const float reach = r * mfVoxelSize;
+            if (vNearest.back().first <= reach * reach) break;
+        }
+    }
+
+    if (bScan)
+    {
+        vNearest.clear();
+        for (const Voxels::value_type& voxel : mVoxels)
+            for (const Entry& entry : voxel.second)
+            {
+                const float distSq = (entry.pos - pos).squaredNorm();
+                if (distSq <= maxSq)
+                    vNearest.push_back(make_pair(distSq, entry.pMP));
+            }
+        if (vNearest.size() > k)
+        {
+            std::nth_element(vNearest.begin(),
+                             vNearest.begin() + k - 1,
+                             vNearest.end());
+            vNearest.resize(k);
+        }
+    }
+
+    std::sort(vNearest.begin(), vNearest.end());
+    vector<MapPoint*> vpMPs;
+    vpMPs.reserve(vNearest.size());
+    for (const pair<float, MapPoint*>& nearest : vNearest)
+        vpMPs.push_back(nearest.second);
+    return vpMPs;
+}
+
+}  // namespace ORB_SLAM3
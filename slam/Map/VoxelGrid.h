@@ -0,0 +1,119 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef VOXELGRID_H
+#define VOXELGRID_H
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+#include <sophus/se3.hpp>
+
+namespace ORB_SLAM3
+{
+
+class MapPoint;
+
+// Map points hashed by the voxel they fall in, for spatial queries without
+// going through the covisibility graph. The map keeps it up to date as points
+// are added, erased and moved. It has its own mutex, taken inside the map and
+// map point locks (MapPoint::SetWorldPos updates it under mMutexPos). With it
+// held the grid only calls MapPoint::GetWorldPos, which takes no lock, so it
+// must never lock a map or map point mutex.
+class VoxelGrid
+{
+public:
+    // Convex region, the points p with n.dot(p) + d >= 0 for every plane
+    // (n, d), and its bounding box
+    struct Frustum
+    {
+        std::vector<Eigen::Vector4f> planes;
+        Eigen::Vector3f              min;
+        Eigen::Vector3f              max;
+    };
+
+    // Frustum of a camera with pose Tcw, from the bounds of the image in
+    // normalized coordinates (x/z, y/z) and the depth range
+    static Frustum MakeFrustum(const Sophus::SE3f& Tcw,
+                               float               xMin,
+                               float               xMax,
+                               float               yMin,
+                               float               yMax,
+                               float               zNear,
+                               float               zFar);
+
+    explicit VoxelGrid(float voxelSize = 0.5f);
+
+    // Insert reads the position of the point, Update only moves points
+    // already inserted
+    void Insert(MapPoint* pMP);
+    void Update(MapPoint* pMP, const Eigen::Vector3f& pos);
+    void Erase(MapPoint* pMP);
+    void Clear();
+
+    size_t Size();
+
+    std::vector<MapPoint*> QueryBox(const Eigen::Vector3f& min,
+                                    const Eigen::Vector3f& max);
+    std::vector<MapPoint*> QueryFrustum(const Frustum& frustum);
+
+    // Up to k nearest points to pos closer than maxDist, nearest first
+    std::vector<MapPoint*> QueryKNN(const Eigen::Vector3f& pos,
+                                    size_t                 k,
+                                    float                  maxDist);
+
+private:
+    struct Entry
+    {
+        MapPoint*       pMP;
+        Eigen::Vector3f pos;
+    };
+
+    typedef std::unordered_map<uint64_t, std::vector<Entry>> Voxels;
+
+    Eigen::Vector3i Cell(const Eigen::Vector3f& pos) const;
+    static uint64_t Key(const Eigen::Vector3i& cell);
+
+    void EraseFromVoxel(MapPoint* pMP, uint64_t key);
+
+    // Call f on every entry that may be in the box [min, max], the entries
+    // of the voxels it covers or of all voxels when that is cheaper
+    template <typename F>
+    void ForEachEntryInBox(const Eigen::Vector3f& min,
+                           const Eigen::Vector3f& max,
+                           F                      f);
+
+    const float mfVoxelSize;
+    const float mfInvVoxelSize;
+
+    Voxels                                  mVoxels;
+    std::unordered_map<MapPoint*, uint64_t> mVoxelOf;
+
+    std::mutex mMutex;
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // VOXELGRID_H
@@ -153,13 +153,11 @@ void Optimizer::BundleAdjustment(const vector<KeyFrame*>& vpKFs,
         vPoint->setMarginalized(true);
         optimizer.addVertex(vPoint);
 
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMP->GetObservations();
+        const ObservationList observations = pMP->GetObservations();
 
         int nEdges = 0;
         // SET EDGES
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator mit =
-                 observations.begin();
+        for (ObservationList::const_iterator mit = observations.begin();
              mit != observations.end();
              mit++)
         {
@@ -675,16 +673,14 @@ void Optimizer::FullInertialBA(Map*                    pMap,
         vPoint->setMarginalized(true);
         optimizer.addVertex(vPoint);
 
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMP->GetObservations();
+        const ObservationList observations = pMP->GetObservations();
 
 
         bool bAllFixed = true;
 
         // Set edges
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        for (ObservationList::const_iterator mit  = observations.begin(),
+                                             mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -1305,11 +1301,9 @@ void Optimizer::LocalBundleAdjustment(KeyFrame* pKF,
          lit != lend;
          lit++)
     {
-        map<KeyFrame*, tuple<int, int>> observations =
-            (*lit)->GetObservations();
-        for (map<KeyFrame*, tuple<int, int>>::iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        ObservationList observations = (*lit)->GetObservations();
+        for (ObservationList::iterator mit  = observations.begin(),
+                                       mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -1450,13 +1444,11 @@ void Optimizer::LocalBundleAdjustment(KeyFrame* pKF,
         optimizer.addVertex(vPoint);
         nPoints++;
 
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMP->GetObservations();
+        const ObservationList observations = pMP->GetObservations();
 
         // Set edges
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        for (ObservationList::const_iterator mit  = observations.begin(),
+                                             mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -2814,11 +2806,9 @@ void Optimizer::LocalInertialBA(KeyFrame* pKF,
          lit != lend;
          lit++)
     {
-        map<KeyFrame*, tuple<int, int>> observations =
-            (*lit)->GetObservations();
-        for (map<KeyFrame*, tuple<int, int>>::iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        ObservationList observations = (*lit)->GetObservations();
+        for (ObservationList::iterator mit  = observations.begin(),
+                                       mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -3098,13 +3088,11 @@ void Optimizer::LocalInertialBA(KeyFrame* pKF,
         vPoint->setId(id);
         vPoint->setMarginalized(true);
         optimizer.addVertex(vPoint);
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMP->GetObservations();
+        const ObservationList observations = pMP->GetObservations();
 
         // Create visual constraints
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        for (ObservationList::const_iterator mit  = observations.begin(),
+                                             mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -4115,12 +4103,10 @@ void Optimizer::LocalBundleAdjustment(KeyFrame*         pMainKF,
         optimizer.addVertex(vPoint);
 
 
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMPi->GetObservations();
+        const ObservationList observations = pMPi->GetObservations();
         int nEdges = 0;
         // SET EDGES
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator mit =
-                 observations.begin();
+        for (ObservationList::const_iterator mit = observations.begin();
              mit != observations.end();
              mit++)
         {
@@ -4332,10 +4318,8 @@ void Optimizer::LocalBundleAdjustment(KeyFrame*         pMainKF,
         MapPoint* pMPi = vpMPs[i];
         if (pMPi->isBad()) continue;
 
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMPi->GetObservations();
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator mit =
-                 observations.begin();
+        const ObservationList observations = pMPi->GetObservations();
+        for (ObservationList::const_iterator mit = observations.begin();
              mit != observations.end();
              mit++)
         {
@@ -4575,12 +4559,10 @@ void Optimizer::MergeInertialBA(KeyFrame*                     pCurrKF,
          lit != lend;
          lit++, i++)
     {
-        map<KeyFrame*, tuple<int, int>> observations =
-            lit->first->GetObservations();
+        ObservationList observations = lit->first->GetObservations();
         if (i >= maxCovKF) break;
-        for (map<KeyFrame*, tuple<int, int>>::iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        for (ObservationList::iterator mit  = observations.begin(),
+                                       mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -4845,13 +4827,11 @@ void Optimizer::MergeInertialBA(KeyFrame*                     pCurrKF,
         vPoint->setMarginalized(true);
         optimizer.addVertex(vPoint);
 
-        const map<KeyFrame*, tuple<int, int>> observations =
-            pMP->GetObservations();
+        const ObservationList observations = pMP->GetObservations();
 
         // Create visual constraints
-        for (map<KeyFrame*, tuple<int, int>>::const_iterator
-                 mit  = observations.begin(),
-                 mend = observations.end();
+        for (ObservationList::const_iterator mit  = observations.begin(),
+                                             mend = observations.end();
              mit != mend;
              mit++)
         {
@@ -36,6 +36,9 @@
 
 namespace ORB_SLAM3
 {
+
+class AtlasFile;
+
 namespace IMU
 {
 
@@ -147,6 +150,8 @@ public:
 // Preintegration of Imu Measurements
 class Preintegrated
 {
+    friend class ORB_SLAM3::AtlasFile;
+
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     Preintegrated(const Bias& b_, const Calib& calib);
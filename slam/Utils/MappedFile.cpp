@@ -0,0 +1,143 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "utils/MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ORB_SLAM3
+{
+
+MappedFile::MappedFile()
+    : mpData(nullptr)
+    , mnSize(0)
+#ifdef _WIN32
+    , mhFile(INVALID_HANDLE_VALUE)
+    , mhMapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Close();
+
+    mhFile = CreateFileA(filename.c_str(),
+                         GENERIC_READ,
+                         FILE_SHARE_READ,
+                         nullptr,
+                         OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL,
+                         nullptr);
+    if (mhFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mhFile, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    mhMapping =
+        CreateFileMappingA(mhFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mhMapping)
+    {
+        Close();
+        return false;
+    }
+
+    mpData = static_cast<const char*>(
+        MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mpData)
+    {
+        Close();
+        return false;
+    }
+    mnSize = size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mpData) UnmapViewOfFile(mpData);
+    if (mhMapping) CloseHandle(mhMapping);
+    if (mhFile != INVALID_HANDLE_VALUE) CloseHandle(mhFile);
+    mpData    = nullptr;
+    mnSize    = 0;
+    mhMapping = nullptr;
+    mhFile    = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Close();
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file
+    void* pData = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pData == MAP_FAILED) return false;
+
+    mpData = static_cast<const char*>(pData);
+    mnSize = st.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mpData) munmap(const_cast<char*>(mpData), mnSize);
+    mpData = nullptr;
+    mnSize = 0;
+}
+
+#endif
+
+}  // namespace ORB_SLAM3
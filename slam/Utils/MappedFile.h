@@ -0,0 +1,64 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <cstddef>
+#include <string>
+
+namespace ORB_SLAM3
+{
+
+// Whole file mapped read only in memory. The pages are loaded by the OS as
+// they are touched, so opening a big file costs nothing up front.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file cannot be opened or mapped
+    bool Open(const std::string& filename);
+    void Close();
+
+    bool IsOpen() const { return mpData != nullptr; }
+
+    const char* Data() const { return mpData; }
+    size_t      Size() const { return mnSize; }
+
+private:
+    const char* mpData;
+    size_t      mnSize;
+
+#ifdef _WIN32
+    void* mhFile;
+    void* mhMapping;
+#endif
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,104 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ORB_SLAM3
+{
+
+// Value that can be read without taking a lock. Readers copy it and retry if
+// a write happened meanwhile, so they never wait on a writer that is not
+// writing. Writers must be serialized by the caller, usually with the mutex
+// that guards the rest of the object.
+// T is copied with memcpy and must be trivially copyable, e.g. a struct of
+// floats. Eigen and Sophus types are not, store their coefficients instead.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock()
+        : mnSeq(0)
+    {
+        for (std::atomic<uint32_t>& word : mvWords)
+            word.store(0, std::memory_order_relaxed);
+    }
+
+    explicit SeqLock(const T& value)
+        : SeqLock()
+    {
+        Store(value);
+    }
+
+    SeqLock(const SeqLock&)            = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    void Store(const T& value)
+    {
+        uint32_t words[NWORDS] = {};
+        std::memcpy(words, &value, sizeof(T));
+
+        // An odd sequence tells readers a write is in progress
+        const unsigned seq = mnSeq.load(std::memory_order_relaxed);
+        mnSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < NWORDS; i++)
+            mvWords[i].store(words[i], std::memory_order_relaxed);
+        mnSeq.store(seq + 2, std::memory_order_release);
+    }
+
+    T Load() const
+    {
+        uint32_t words[NWORDS];
+        unsigned seq0, seq1;
+        do
+        {
+            seq0 = mnSeq.load(std::memory_order_acquire);
+            for (size_t i = 0; i < NWORDS; i++)
+                words[i] = mvWords[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq1 = mnSeq.load(std::memory_order_relaxed);
+        } while ((seq0 & 1) || seq0 != seq1);
+
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t NWORDS =
+        (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<unsigned> mnSeq;
+    std::atomic<uint32_t> mvWords[NWORDS];
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // SEQLOCK_H
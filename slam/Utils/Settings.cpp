@@ -342,11 +342,17 @@ Settings::Settings(const SettingDesc& desc)
 
     // read orb
     {
-        nFeatures_   = desc.orbInfo.nFeatures;
-        scaleFactor_ = desc.orbInfo.scaleFactor;
-        nLevels_     = desc.orbInfo.nLevels;
-        initThFAST_  = desc.orbInfo.initThFAST;
-        minThFAST_   = desc.orbInfo.minThFAST;
+        nFeatures_       = desc.orbInfo.nFeatures;
+        scaleFactor_     = desc.orbInfo.scaleFactor;
+        nLevels_         = desc.orbInfo.nLevels;
+        initThFAST_      = desc.orbInfo.initThFAST;
+        minThFAST_       = desc.orbInfo.minThFAST;
+        nOrbThreads_     = desc.orbInfo.nThreads;
+        orbDistribution_ = desc.orbInfo.distribution;
+        bOrbIncremental_ = desc.orbInfo.bIncremental;
+        bOrbOpticalFlow_ = desc.orbInfo.bOpticalFlow;
+        nMatchThreads_   = desc.orbInfo.nMatchThreads;
+        bEpipolarSearch_ = desc.orbInfo.bEpipolarSearch;
     }
 
     // read viewer
@@ -372,7 +378,10 @@ Settings::Settings(const SettingDesc& desc)
 
     // other info
     {
-        thFarPoints_ = desc.otherInfo.thFarPoints;
+        thFarPoints_        = desc.otherInfo.thFarPoints;
+        nFrontEndQueueSize_ = desc.otherInfo.frontEndQueueSize;
+        nInputQueueSize_    = desc.otherInfo.inputQueueSize;
+        inputDropPolicy_    = desc.otherInfo.inputDropPolicy;
     }
 
     if (bNeedToRectify_)
@@ -799,6 +808,45 @@ void Settings::readORB(cv::FileStorage& fSettings)
     initThFAST_ =
         readParameter<int>(fSettings, "ORBextractor.iniThFAST", found);
     minThFAST_ = readParameter<int>(fSettings, "ORBextractor.minThFAST", found);
+    nOrbThreads_ =
+        readParameter<int>(fSettings, "ORBextractor.nThreads", found, false);
+
+    if (!found) nOrbThreads_ = 1;
+
+    string distribution = readParameter<string>(fSettings,
+                                                "ORBextractor.distribution",
+                                                found,
+                                                false);
+    if (!found || distribution == "OctTree")
+    {
+        orbDistribution_ = 0;
+    }
+    else if (distribution == "QuadTree")
+    {
+        orbDistribution_ = 1;
+    }
+    else
+    {
+        cerr << "Error: ORB distribution " << distribution << " not known"
+             << endl;
+        exit(-1);
+    }
+
+    bOrbIncremental_ =
+        readParameter<int>(fSettings, "ORBextractor.incremental", found, false);
+
+    bOrbOpticalFlow_ =
+        readParameter<int>(fSettings, "ORBextractor.opticalFlow", found, false);
+
+    nMatchThreads_ =
+        readParameter<int>(fSettings, "ORBmatcher.nThreads", found, false);
+
+    if (!found) nMatchThreads_ = 1;
+
+    bEpipolarSearch_ = readParameter<int>(fSettings,
+                                          "ORBmatcher.epipolarSearch",
+                                          found,
+                                          false);
 }
 
 void Settings::readViewer(cv::FileStorage& fSettings)
@@ -845,6 +893,34 @@ void Settings::readOtherParameters(cv::FileStorage& fSettings)
 
     thFarPoints_ =
         readParameter<float>(fSettings, "System.thFarPoints", found, false);
+
+    nFrontEndQueueSize_ = readParameter<int>(fSettings,
+                                             "System.frontEndQueueSize",
+                                             found,
+                                             false);
+
+    nInputQueueSize_ =
+        readParameter<int>(fSettings, "System.inputQueueSize", found, false);
+
+    if (!found) nInputQueueSize_ = 1;
+
+    string policy = readParameter<string>(fSettings,
+                                          "System.inputDropPolicy",
+                                          found,
+                                          false);
+    if (!found || policy == "DropOldest")
+    {
+        inputDropPolicy_ = 0;
+    }
+    else if (policy == "KeepLatest")
+    {
+        inputDropPolicy_ = 1;
+    }
+    else
+    {
+        cerr << "Error: input drop policy " << policy << " not known" << endl;
+        exit(-1);
+    }
 }
 
 void Settings::precomputeRectificationMaps()
@@ -1063,6 +1139,22 @@ ostream& operator<<(std::ostream& output, const Settings& settings)
     output << "\t-ORB number of scales: " << settings.nLevels_ << endl;
     output << "\t-Initial FAST threshold: " << settings.initThFAST_ << endl;
     output << "\t-Min FAST threshold: " << settings.minThFAST_ << endl;
+    output << "\t-ORB extraction threads: " << settings.nOrbThreads_ << endl;
+    output << "\t-ORB distribution: "
+           << (settings.orbDistribution_ == 1 ? "QuadTree" : "OctTree") << endl;
+    output << "\t-ORB incremental detection: " << settings.bOrbIncremental_
+           << endl;
+    output << "\t-Optical flow tracking: " << settings.bOrbOpticalFlow_
+           << endl;
+    output << "\t-ORB matching threads: " << settings.nMatchThreads_ << endl;
+    output << "\t-Epipolar band triangulation: " << settings.bEpipolarSearch_
+           << endl;
+    output << "\t-Front-end queue size: " << settings.nFrontEndQueueSize_
+           << endl;
+    output << "\t-Input queue size: " << settings.nInputQueueSize_ << endl;
+    output << "\t-Input drop policy: "
+           << (settings.inputDropPolicy_ == 1 ? "KeepLatest" : "DropOldest")
+           << endl;
 
     return output;
 }
@@ -103,6 +103,12 @@ public:
             int32_t nLevels;
             int32_t initThFAST;
             int32_t minThFAST;
+            int32_t nThreads        = 1;
+            int32_t distribution    = 0;  // ORBextractor::DistributionMode
+            bool    bIncremental    = false;
+            bool    bOpticalFlow    = false;
+            int32_t nMatchThreads   = 1;
+            bool    bEpipolarSearch = false;
         } orbInfo;
 
         struct
@@ -128,7 +134,10 @@ public:
 
         struct
         {
-            float thFarPoints = 0.0f;
+            float   thFarPoints       = 0.0f;
+            int32_t frontEndQueueSize = 0;  // 0: synchronous front-end
+            int32_t inputQueueSize    = 1;  // frames waiting in System::Submit*
+            int32_t inputDropPolicy   = 0;  // InputQueue::DropPolicy
         } otherInfo;
     };
 
@@ -193,6 +202,12 @@ public:
     float initThFAST() { return initThFAST_; }
     float minThFAST() { return minThFAST_; }
     float scaleFactor() { return scaleFactor_; }
+    int   orbThreads() { return nOrbThreads_; }
+    int   orbDistribution() { return orbDistribution_; }
+    bool  orbIncremental() { return bOrbIncremental_; }
+    bool  orbOpticalFlow() { return bOrbOpticalFlow_; }
+    int   matchThreads() { return nMatchThreads_; }
+    bool  epipolarSearch() { return bEpipolarSearch_; }
 
     float keyFrameSize() { return keyFrameSize_; }
     float keyFrameLineWidth() { return keyFrameLineWidth_; }
@@ -210,6 +225,9 @@ public:
     std::string atlasSaveFile() { return sSaveto_; }
 
     float thFarPoints() { return thFarPoints_; }
+    int   frontEndQueueSize() { return nFrontEndQueueSize_; }
+    int   inputQueueSize() { return nInputQueueSize_; }
+    int   inputDropPolicy() { return inputDropPolicy_; }
 
     cv::Mat M1l() { return M1l_; }
     cv::Mat M2l() { return M2l_; }
@@ -311,6 +329,12 @@ private:
     float scaleFactor_;
     int   nLevels_;
     int   initThFAST_, minThFAST_;
+    int   nOrbThreads_;
+    int   orbDistribution_;
+    bool  bOrbIncremental_;
+    bool  bOrbOpticalFlow_;
+    int   nMatchThreads_;
+    bool  bEpipolarSearch_;
 
     /*
      * Viewer stuff
@@ -333,6 +357,9 @@ private:
      * Other stuff
      */
     float thFarPoints_;
+    int   nFrontEndQueueSize_;
+    int   nInputQueueSize_;
+    int   inputDropPolicy_;
 };
 
 }  // namespace ORB_SLAM3
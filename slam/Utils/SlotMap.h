@@ -0,0 +1,184 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ORB_SLAM3
+{
+
+// Set of pointers stored contiguously, with a stable 32-bit handle for each
+// of them. Erasing moves the last element into the hole, so iteration goes
+// over a plain array without holes but the order is not kept. A handle is
+// the slot index in its low INDEX_BITS bits and the generation of the slot
+// in the rest. The generation changes every time the slot is freed, so an
+// old handle no longer resolves once its element is erased. It only has
+// 32 - INDEX_BITS bits though: a stale handle resolves again, to another
+// element, once its slot was reused 1024 times. Handles held across many
+// erasures must be checked against the expected element.
+// Only iteration and Get are cheap. Insert, Erase, Find and count look the
+// pointer up in a hash map, like the std::set they replace did in a tree.
+// Not thread safe, the owner locks it.
+template <typename T>
+class SlotMap
+{
+public:
+    typedef uint32_t Handle;
+
+    static const int    INDEX_BITS     = 22;
+    static const Handle INVALID_HANDLE = 0xFFFFFFFF;
+
+    // Handle of p, inserted if it is not there yet
+    Handle Insert(T* p)
+    {
+        typename std::unordered_map<T*, uint32_t>::iterator it =
+            mmSlotOf.find(p);
+        if (it != mmSlotOf.end()) return MakeHandle(it->second);
+
+        uint32_t slot;
+        if (mvFreeSlots.empty())
+        {
+            slot = mvSlots.size();
+            mvSlots.push_back(Slot());
+        }
+        else
+        {
+            slot = mvFreeSlots.back();
+            mvFreeSlots.pop_back();
+        }
+
+        mvSlots[slot].dense = mvDense.size();
+        mvDense.push_back(p);
+        mvDenseSlot.push_back(slot);
+        mmSlotOf[p] = slot;
+        return MakeHandle(slot);
+    }
+
+    bool Erase(T* p)
+    {
+        typename std::unordered_map<T*, uint32_t>::iterator it =
+            mmSlotOf.find(p);
+        if (it == mmSlotOf.end()) return false;
+
+        const uint32_t slot = it->second;
+        mmSlotOf.erase(it);
+
+        // Move the last element into the hole
+        const uint32_t dense = mvSlots[slot].dense;
+        mvDense[dense]       = mvDense.back();
+        mvDenseSlot[dense]   = mvDenseSlot.back();
+        mvSlots[mvDenseSlot[dense]].dense = dense;
+        mvDense.pop_back();
+        mvDenseSlot.pop_back();
+
+        mvSlots[slot].dense = FREE;
+        mvSlots[slot].generation++;
+        mvFreeSlots.push_back(slot);
+        return true;
+    }
+
+    bool Erase(Handle h)
+    {
+        T* p = Get(h);
+        return p && Erase(p);
+    }
+
+    // Element of the handle, NULL if it was erased
+    T* Get(Handle h) const
+    {
+        const uint32_t slot = h & INDEX_MASK;
+        if (h == INVALID_HANDLE || slot >= mvSlots.size()) return NULL;
+        if (mvSlots[slot].dense == FREE || MakeHandle(slot) != h) return NULL;
+        return mvDense[mvSlots[slot].dense];
+    }
+
+    // INVALID_HANDLE if p is not there
+    Handle Find(T* p) const
+    {
+        typename std::unordered_map<T*, uint32_t>::const_iterator it =
+            mmSlotOf.find(p);
+        if (it == mmSlotOf.end()) return INVALID_HANDLE;
+        return MakeHandle(it->second);
+    }
+
+    bool count(T* p) const { return mmSlotOf.count(p); }
+
+    size_t size() const { return mvDense.size(); }
+    bool   empty() const { return mvDense.empty(); }
+
+    void clear()
+    {
+        for (uint32_t slot : mvDenseSlot)
+        {
+            mvSlots[slot].dense = FREE;
+            mvSlots[slot].generation++;
+            mvFreeSlots.push_back(slot);
+        }
+        mvDense.clear();
+        mvDenseSlot.clear();
+        mmSlotOf.clear();
+    }
+
+    // The elements, contiguous
+    T* const* begin() const { return mvDense.data(); }
+    T* const* end() const { return mvDense.data() + mvDense.size(); }
+
+    const std::vector<T*>& Values() const { return mvDense; }
+
+private:
+    static const uint32_t INDEX_MASK      = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+    static const uint32_t FREE            = 0xFFFFFFFF;
+
+    struct Slot
+    {
+        uint32_t dense      = FREE;
+        uint32_t generation = 0;
+    };
+
+    // The generation wraps around, see the class comment. The last index is
+    // left out so that no handle equals INVALID_HANDLE.
+    Handle MakeHandle(uint32_t slot) const
+    {
+        assert(slot < INDEX_MASK);
+        return ((mvSlots[slot].generation & GENERATION_MASK) << INDEX_BITS) |
+               slot;
+    }
+
+    std::vector<T*>       mvDense;
+    std::vector<uint32_t> mvDenseSlot;
+    std::vector<Slot>     mvSlots;
+    std::vector<uint32_t> mvFreeSlots;
+
+    // Slot of every element, to find them by pointer
+    std::unordered_map<T*, uint32_t> mmSlotOf;
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // SLOTMAP_H
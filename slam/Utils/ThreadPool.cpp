@@ -0,0 +1,134 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "utils/ThreadPool.h"
+
+namespace ORB_SLAM3
+{
+
+// Set in pool workers, nested jobs run serially to avoid waiting on ourselves
+static thread_local bool tlbPoolWorker = false;
+
+ThreadPool::ThreadPool(int nThreads)
+    : mpFn(nullptr)
+    , mpCtx(nullptr)
+    , mnTasks(0)
+    , mnNext(0)
+    , mnDone(0)
+    , mnActive(0)
+    , mnGeneration(0)
+    , mbFinish(false)
+{
+    for (int i = 1; i < nThreads; ++i)
+        mvThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mbFinish = true;
+    }
+    mCondWork.notify_all();
+
+    for (std::thread& t : mvThreads) t.join();
+}
+
+void ThreadPool::Run(int n, TaskFn fn, void* ctx)
+{
+    if (n <= 0) return;
+
+    std::unique_lock<std::mutex> lockRun(mMutexRun, std::defer_lock);
+    if (mvThreads.empty() || n == 1 || tlbPoolWorker || !lockRun.try_lock())
+    {
+        for (int i = 0; i < n; ++i) fn(ctx, i);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mpFn    = fn;
+        mpCtx   = ctx;
+        mnTasks = n;
+        mnNext  = 0;
+        mnDone  = 0;
+        mnGeneration++;
+    }
+    mCondWork.notify_all();
+
+    const int nDone = Work();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mnDone += nDone;
+    // Wait also for the workers to leave the job, fn and ctx belong to the
+    // caller's stack
+    mCondDone.wait(lock,
+                   [this]
+                   {
+                       return mnDone == mnTasks && mnActive == 0;
+                   });
+    mpFn  = nullptr;
+    mpCtx = nullptr;
+}
+
+int ThreadPool::Work()
+{
+    int nDone = 0;
+    for (int i = mnNext.fetch_add(1); i < mnTasks; i = mnNext.fetch_add(1))
+    {
+        mpFn(mpCtx, i);
+        nDone++;
+    }
+    return nDone;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    tlbPoolWorker = true;
+
+    unsigned long nLastGeneration = 0;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondWork.wait(lock,
+                       [&]
+                       {
+                           return mbFinish || (mpFn != nullptr &&
+                                               mnGeneration != nLastGeneration);
+                       });
+        if (mbFinish) return;
+
+        nLastGeneration = mnGeneration;
+        mnActive++;
+        lock.unlock();
+
+        const int nDone = Work();
+
+        lock.lock();
+        mnDone += nDone;
+        mnActive--;
+        if (mnDone == mnTasks && mnActive == 0) mCondDone.notify_all();
+    }
+}
+
+}  // namespace ORB_SLAM3
@@ -0,0 +1,111 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ORB_SLAM3
+{
+
+// Persistent pool of worker threads used to split a loop over several cores.
+// Workers are created once and sleep between jobs, so a ParallelFor does not
+// create threads nor allocate memory.
+class ThreadPool
+{
+public:
+    // nThreads counts the calling thread, which also takes part in the work.
+    // A pool of 1 thread runs everything on the caller.
+    explicit ThreadPool(int nThreads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int GetNumThreads() const { return (int)mvThreads.size() + 1; }
+
+    // Call fn(i) for every i in [0, n) and return when all of them are done.
+    // Indices are handed out dynamically, fn must be safe to call
+    // concurrently. Calls made from inside a pool worker, or while another
+    // thread is running a job, are executed serially on the caller.
+    template <typename F>
+    void ParallelFor(int n, F&& fn)
+    {
+        using Fn = typename std::remove_reference<F>::type;
+        Run(n,
+            [](void* ctx, int i)
+            {
+                (*static_cast<Fn*>(ctx))(i);
+            },
+            const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    // Run fn(i) for i in [0, n) on pool when given, serially otherwise.
+    template <typename F>
+    static void ParallelFor(ThreadPool* pool, int n, F&& fn)
+    {
+        if (pool)
+            pool->ParallelFor(n, std::forward<F>(fn));
+        else
+            for (int i = 0; i < n; ++i) fn(i);
+    }
+
+private:
+    using TaskFn = void (*)(void*, int);
+
+    void Run(int n, TaskFn fn, void* ctx);
+
+    // Process indices of the current job until none is left.
+    // Returns how many were processed.
+    int Work();
+
+    void WorkerLoop();
+
+    std::vector<std::thread> mvThreads;
+
+    // Only one job runs at a time
+    std::mutex mMutexRun;
+
+    std::mutex              mMutex;
+    std::condition_variable mCondWork;
+    std::condition_variable mCondDone;
+
+    // Current job, written under mMutex before mnGeneration is increased
+    TaskFn           mpFn;
+    void*            mpCtx;
+    int              mnTasks;
+    std::atomic<int> mnNext;
+    int              mnDone;
+    int              mnActive;
+    unsigned long    mnGeneration;
+    bool             mbFinish;
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // THREADPOOL_H
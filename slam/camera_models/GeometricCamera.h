@@ -39,6 +39,8 @@ namespace ORB_SLAM3
 
 class GeometricCamera
 {
+    friend class AtlasFile;
+
 public:
     GeometricCamera() = default;
     GeometricCamera(const std::vector<float>& _vParameters)
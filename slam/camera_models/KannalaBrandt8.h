@@ -55,6 +55,7 @@ public:
         : GeometricCamera(_vParameters)
         , precision(_precision)
         , mvLappingArea(2, 0)
+        , tvr(nullptr)
     {
         assert(mvParameters.size() == 8);
         mnId   = nNextId++;
@@ -0,0 +1,152 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "threads/FrontEnd.h"
+
+#include "threads/Tracking.h"
+
+namespace ORB_SLAM3
+{
+
+FrontEnd::FrontEnd(System* pSys, Tracking* pTracker, int nQueueSize)
+    : mpSystem(pSys)
+    , mpTracker(pTracker)
+    , mvSlots(std::max(nQueueSize, 1) + 1)
+    , mnHead(0)
+    , mnCount(0)
+    , mbFinish(false)
+{
+    mThread = std::thread(&FrontEnd::Run, this);
+}
+
+FrontEnd::~FrontEnd()
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mbFinish = true;
+    }
+    mCondPushed.notify_one();
+
+    mThread.join();
+}
+
+void FrontEnd::SubmitStereo(const cv::Mat&               imRectLeft,
+                            const cv::Mat&               imRectRight,
+                            const double&                timestamp,
+                            const std::string&           filename,
+                            const System::TrackCallback& callback)
+{
+    Slot& slot = AcquireSlot();
+    mpTracker->PrepareFrameStereo(imRectLeft,
+                                  imRectRight,
+                                  timestamp,
+                                  slot.frame,
+                                  slot.imGray);
+    slot.filename = filename;
+    slot.callback = callback;
+    Push();
+}
+
+void FrontEnd::SubmitRGBD(const cv::Mat&               imRGB,
+                          const cv::Mat&               imD,
+                          const double&                timestamp,
+                          const std::string&           filename,
+                          const System::TrackCallback& callback)
+{
+    Slot& slot = AcquireSlot();
+    mpTracker->PrepareFrameRGBD(imRGB, imD, timestamp, slot.frame, slot.imGray);
+    slot.filename = filename;
+    slot.callback = callback;
+    Push();
+}
+
+void FrontEnd::SubmitMonocular(const cv::Mat&               im,
+                               const double&                timestamp,
+                               const std::string&           filename,
+                               const System::TrackCallback& callback)
+{
+    Slot& slot = AcquireSlot();
+    mpTracker->PrepareFrameMonocular(im, timestamp, slot.frame, slot.imGray);
+    slot.filename = filename;
+    slot.callback = callback;
+    Push();
+}
+
+void FrontEnd::Flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondPopped.wait(lock, [this] { return mnCount == 0; });
+}
+
+FrontEnd::Slot& FrontEnd::AcquireSlot()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondPopped.wait(lock, [this] { return mnCount < mvSlots.size(); });
+
+    // Only the feature stage adds slots, this one stays free until Push()
+    return mvSlots[(mnHead + mnCount) % mvSlots.size()];
+}
+
+void FrontEnd::Push()
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mnCount++;
+    }
+    mCondPushed.notify_one();
+}
+
+void FrontEnd::Run()
+{
+    while (true)
+    {
+        Slot* pSlot;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondPushed.wait(lock, [this] { return mnCount > 0 || mbFinish; });
+            if (mnCount == 0) break;
+
+            pSlot = &mvSlots[mnHead];
+        }
+
+        const System::TrackResult result =
+            mpSystem->TrackPreparedFrame(pSlot->frame,
+                                         pSlot->imGray,
+                                         pSlot->filename);
+        pSlot->imGray.release();
+
+        if (pSlot->callback)
+        {
+            pSlot->callback(result);
+            pSlot->callback = nullptr;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mnHead = (mnHead + 1) % mvSlots.size();
+            mnCount--;
+        }
+        mCondPopped.notify_all();
+    }
+}
+
+}  // namespace ORB_SLAM3
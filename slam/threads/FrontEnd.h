@@ -0,0 +1,119 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FRONTEND_H
+#define FRONTEND_H
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "core/System.h"
+#include "frame/Frame.h"
+
+namespace ORB_SLAM3
+{
+
+class Tracking;
+
+// Pipelined front-end. The feature stage builds the frames of the incoming
+// images (Tracking::PrepareFrame*) on the thread that submits them, while the
+// tracking stage tracks the previous frames on its own thread. The stages are
+// connected by a bounded queue with back-pressure: Submit*() blocks while the
+// queue is full, so that the input is throttled to the tracking rate.
+class FrontEnd
+{
+public:
+    // Up to nQueueSize prepared frames wait besides the one being tracked
+    FrontEnd(System* pSys, Tracking* pTracker, int nQueueSize);
+
+    // Tracks the frames left in the queue and stops the tracking stage
+    ~FrontEnd();
+
+    FrontEnd(const FrontEnd&)            = delete;
+    FrontEnd& operator=(const FrontEnd&) = delete;
+
+    // Feature stage, to be called from a single thread. The images are not
+    // copied and must not be modified afterwards. callback, if any, is given
+    // the result of the frame on the tracking thread.
+    void SubmitStereo(const cv::Mat&               imRectLeft,
+                      const cv::Mat&               imRectRight,
+                      const double&                timestamp,
+                      const std::string&           filename,
+                      const System::TrackCallback& callback);
+
+    void SubmitRGBD(const cv::Mat&               imRGB,
+                    const cv::Mat&               imD,
+                    const double&                timestamp,
+                    const std::string&           filename,
+                    const System::TrackCallback& callback);
+
+    void SubmitMonocular(const cv::Mat&               im,
+                         const double&                timestamp,
+                         const std::string&           filename,
+                         const System::TrackCallback& callback);
+
+    // Wait until every submitted frame has been tracked
+    void Flush();
+
+private:
+    struct Slot
+    {
+        Frame                 frame;
+        cv::Mat               imGray;
+        std::string           filename;
+        System::TrackCallback callback;
+    };
+
+    // Free slot to build the next frame in, waits while the queue is full
+    Slot& AcquireSlot();
+
+    // Hand the slot returned by AcquireSlot() over to the tracking stage
+    void Push();
+
+    // Tracking stage
+    void Run();
+
+    System*   mpSystem;
+    Tracking* mpTracker;
+
+    // Ring of slots. The mnCount slots from mnHead hold prepared frames, the
+    // one at mnHead being tracked, so frames are never copied.
+    std::vector<Slot> mvSlots;
+    size_t            mnHead;
+    size_t            mnCount;
+    bool              mbFinish;
+
+    std::mutex              mMutex;
+    std::condition_variable mCondPushed;
+    std::condition_variable mCondPopped;
+
+    std::thread mThread;
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // FRONTEND_H
@@ -0,0 +1,154 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "threads/InputQueue.h"
+
+#include <algorithm>
+
+namespace ORB_SLAM3
+{
+
+InputQueue::InputQueue(System* pSys, int nSize, DropPolicy policy)
+    : mpSystem(pSys)
+    , mnSize(std::max(nSize, 1))
+    , mPolicy(policy)
+    , mbFinish(false)
+{
+}
+
+InputQueue::~InputQueue()
+{
+    Close();
+}
+
+void InputQueue::Close()
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mbFinish = true;
+    }
+    mCondPushed.notify_one();
+
+    // No Push() starts the thread once mbFinish is set
+    if (mThread.joinable()) mThread.join();
+}
+
+void InputQueue::Push(Request&& request)
+{
+    std::vector<Request> vDropped;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mbFinish)
+        {
+            lock.unlock();
+            if (request.callback)
+                request.callback(mpSystem->DroppedResult(request.timestamp));
+            return;
+        }
+
+        if (!mThread.joinable())
+            mThread = std::thread(&InputQueue::Run, this);
+
+        size_t nDrop = 0;
+        if (mlRequests.size() >= mnSize)
+            nDrop = mPolicy == KEEP_LATEST ? mlRequests.size()
+                                           : mlRequests.size() - mnSize + 1;
+
+        // The IMU measurements of a dropped frame are still needed to
+        // integrate up to the next one, prepend them to it
+        for (size_t i = 0; i < nDrop; i++)
+        {
+            Request&                 dropped = mlRequests.front();
+            std::vector<IMU::Point>& vNext   = mlRequests.size() > 1
+                                                   ? mlRequests[1].vImuMeas
+                                                   : request.vImuMeas;
+            vNext.insert(vNext.begin(),
+                         dropped.vImuMeas.begin(),
+                         dropped.vImuMeas.end());
+
+            vDropped.push_back(std::move(dropped));
+            mlRequests.pop_front();
+        }
+
+        mlRequests.push_back(std::move(request));
+    }
+    mCondPushed.notify_one();
+
+    for (Request& dropped : vDropped)
+    {
+        if (dropped.callback)
+            dropped.callback(mpSystem->DroppedResult(dropped.timestamp));
+    }
+}
+
+void InputQueue::Run()
+{
+    while (true)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondPushed.wait(lock,
+                             [this]
+                             {
+                                 return !mlRequests.empty() || mbFinish;
+                             });
+            if (mlRequests.empty()) break;
+
+            request = std::move(mlRequests.front());
+            mlRequests.pop_front();
+        }
+
+        const System::eSensor sensor = mpSystem->mSensor;
+        if (sensor == System::STEREO || sensor == System::IMU_STEREO)
+        {
+            mpSystem->TrackStereo(request.im,
+                                  request.im2,
+                                  request.timestamp,
+                                  request.vImuMeas,
+                                  request.filename,
+                                  request.callback,
+                                  false);
+        }
+        else if (sensor == System::RGBD || sensor == System::IMU_RGBD)
+        {
+            mpSystem->TrackRGBD(request.im,
+                                request.im2,
+                                request.timestamp,
+                                request.vImuMeas,
+                                request.filename,
+                                request.callback,
+                                false);
+        }
+        else
+        {
+            mpSystem->TrackMonocular(request.im,
+                                     request.timestamp,
+                                     request.vImuMeas,
+                                     request.filename,
+                                     request.callback,
+                                     false);
+        }
+    }
+}
+
+}  // namespace ORB_SLAM3
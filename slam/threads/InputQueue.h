@@ -0,0 +1,98 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "core/System.h"
+#include "utils/ImuTypes.h"
+
+namespace ORB_SLAM3
+{
+
+// Input queue of the non-blocking System::Submit* functions. A thread, started
+// with the first frame, hands the queued frames to the Track functions one at
+// a time. Push() never blocks: when the queue is full frames are dropped
+// according to the policy, so that a camera driver is never stalled by a
+// lagging tracker. The callbacks of dropped frames are called from the thread
+// calling Push().
+class InputQueue
+{
+public:
+    enum DropPolicy
+    {
+        DROP_OLDEST = 0,  // Drop the oldest waiting frame
+        KEEP_LATEST = 1   // Drop every waiting frame, keep the new one
+    };
+
+    struct Request
+    {
+        cv::Mat                 im;
+        cv::Mat                 im2;  // Right image or depth map
+        double                  timestamp;
+        std::vector<IMU::Point> vImuMeas;
+        std::string             filename;
+        System::TrackCallback   callback;
+    };
+
+    InputQueue(System* pSys, int nSize, DropPolicy policy);
+
+    // Closes the queue if it is still open
+    ~InputQueue();
+
+    InputQueue(const InputQueue&)            = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    // Drops request at once if the queue is closed
+    void Push(Request&& request);
+
+    // Tracks the requests left in the queue and stops the input thread.
+    // Push() can still be called, from any thread, but tracks nothing more.
+    void Close();
+
+private:
+    void Run();
+
+    System*    mpSystem;
+    size_t     mnSize;
+    DropPolicy mPolicy;
+
+    std::deque<Request> mlRequests;
+    bool                mbFinish;  // Closed, set under mMutex
+
+    std::mutex              mMutex;
+    std::condition_variable mCondPushed;
+
+    std::thread mThread;
+};
+
+}  // namespace ORB_SLAM3
+
+#endif  // INPUTQUEUE_H
@@ -21,6 +21,7 @@
 
 
 #include "threads/LocalMapping.h"
+#include <algorithm>
 #include <chrono>
 #include <mutex>
 
@@ -35,6 +36,7 @@
 
 #include "utils/Converter.h"
 #include "utils/GeometricTools.h"
+#include "utils/ThreadPool.h"
 
 namespace ORB_SLAM3
 {
@@ -74,6 +76,8 @@ LocalMapping::LocalMapping(System*       pSys,
 
     mNumLM        = 0;
     mNumKFCulling = 0;
+
+    mbEpipolarSearch = false;
 }
 
 void LocalMapping::SetLoopCloser(LoopClosing* pLoopCloser)
@@ -86,6 +90,14 @@ void LocalMapping::SetTracker(Tracking* pTracker)
     mpTracker = pTracker;
 }
 
+void LocalMapping::SetMatchThreads(int nThreads)
+{
+    if (nThreads > 1)
+        mpMatcherPool.reset(new ThreadPool(nThreads));
+    else
+        mpMatcherPool.reset();
+}
+
 void LocalMapping::Run()
 {
     mbFinished = false;
@@ -421,10 +433,91 @@ void LocalMapping::CreateNewMapPoints()
         }
     }
 
-    float th = 0.6f;
+    // Decided once for all the neighbors
+    const bool bCoarse = mbInertial &&
+                         mpTracker->mState == Tracking::RECENTLY_LOST &&
+                         mpCurrentKeyFrame->GetMap()->GetIniertialBA2();
+
+    // Search matches with epipolar restriction and triangulate, several
+    // neighbors at once. Searched one after the other, a neighbor skipped the
+    // features that got a point from the earlier ones. Here the neighbors of
+    // a round are searched with the points the keyframe had at the start of
+    // the round. When a match uses a feature that got a point meanwhile, the
+    // neighbor is searched again in the next round, so the points created are
+    // those of the serial search.
+    const int nNeighs = vpNeighKFs.size();
+    const int nRound  = mpMatcherPool ? mpMatcherPool->GetNumThreads() : 1;
+    vector<vector<NewMapPoint>> vvNewPoints(nNeighs);
+    vector<vector<size_t>>      vvMatched1(nNeighs);
+
+    int next = 0;
+    while (next < nNeighs)
+    {
+        const int first = next;
+        const int last  = std::min(first + nRound, nNeighs);
+        ThreadPool::ParallelFor(mpMatcherPool.get(),
+                                last - first,
+                                [&](int k)
+                                {
+                                    const int i = first + k;
+                                    vvNewPoints[i].clear();
+                                    vvMatched1[i].clear();
+                                    if (i > 0 && CheckNewKeyFrames()) return;
+                                    TriangulateWithNeighbor(vpNeighKFs[i],
+                                                            bCoarse,
+                                                            vvNewPoints[i],
+                                                            vvMatched1[i]);
+                                });
+
+        // Create the map points in neighbor order
+        for (; next < last; next++)
+        {
+            if (next > 0 && CheckNewKeyFrames()) return;
+
+            // The first neighbor of a round saw all the points created so far
+            if (next > first &&
+                std::any_of(vvMatched1[next].begin(),
+                            vvMatched1[next].end(),
+                            [&](size_t idx1)
+                            {
+                                return mpCurrentKeyFrame->GetMapPoint(idx1) !=
+                                       nullptr;
+                            }))
+                break;
+
+            KeyFrame* pKF2 = vpNeighKFs[next];
+            for (const NewMapPoint& newPoint : vvNewPoints[next])
+            {
+                const int idx1 = newPoint.idx1;
+                const int idx2 = newPoint.idx2;
+                if (mpCurrentKeyFrame->GetMapPoint(idx1)) continue;
+
+                MapPoint* pMP = new MapPoint(newPoint.x3D,
+                                             mpCurrentKeyFrame,
+                                             mpAtlas->GetCurrentMap());
+
+                pMP->AddObservation(mpCurrentKeyFrame, idx1);
+                pMP->AddObservation(pKF2, idx2);
 
-    ORBmatcher matcher(th, false);
+                mpCurrentKeyFrame->AddMapPoint(pMP, idx1);
+                pKF2->AddMapPoint(pMP, idx2);
 
+                pMP->ComputeDistinctiveDescriptors();
+
+                pMP->UpdateNormalAndDepth();
+
+                mpAtlas->AddMapPoint(pMP);
+                mlpRecentAddedMapPoints.push_back(pMP);
+            }
+        }
+    }
+}
+
+void LocalMapping::TriangulateWithNeighbor(KeyFrame*            pKF2,
+                                           const bool           bCoarse,
+                                           vector<NewMapPoint>& vNewPoints,
+                                           vector<size_t>&      vMatched1)
+{
     Sophus::SE3<float>         sophTcw1 = mpCurrentKeyFrame->GetPose();
     Eigen::Matrix<float, 3, 4> eigTcw1  = sophTcw1.matrix3x4();
     Eigen::Matrix<float, 3, 3> Rcw1     = eigTcw1.block<3, 3>(0, 0);
@@ -439,315 +532,287 @@ void LocalMapping::CreateNewMapPoints()
     const float& invfx1 = mpCurrentKeyFrame->invfx;
     const float& invfy1 = mpCurrentKeyFrame->invfy;
 
-    const float ratioFactor         = 1.5f * mpCurrentKeyFrame->mfScaleFactor;
-    int         countStereo         = 0;
-    int         countStereoGoodProj = 0;
-    int         countStereoAttempt  = 0;
-    int         totalStereoPts      = 0;
-    // Search matches with epipolar restriction and triangulate
-    for (size_t i = 0; i < vpNeighKFs.size(); i++)
-    {
-        if (i > 0 && CheckNewKeyFrames()) return;
-
-        KeyFrame* pKF2 = vpNeighKFs[i];
+    const float ratioFactor = 1.5f * mpCurrentKeyFrame->mfScaleFactor;
 
-        GeometricCamera *pCamera1 = mpCurrentKeyFrame->mpCamera,
-                        *pCamera2 = pKF2->mpCamera;
+    GeometricCamera *pCamera1 = mpCurrentKeyFrame->mpCamera,
+                    *pCamera2 = pKF2->mpCamera;
 
-        // Check first that baseline is not too short
-        Eigen::Vector3f Ow2       = pKF2->GetCameraCenter();
-        Eigen::Vector3f vBaseline = Ow2 - Ow1;
-        const float     baseline  = vBaseline.norm();
+    // Check first that baseline is not too short
+    Eigen::Vector3f Ow2       = pKF2->GetCameraCenter();
+    Eigen::Vector3f vBaseline = Ow2 - Ow1;
+    const float     baseline  = vBaseline.norm();
 
-        if (!mbMonocular)
-        {
-            if (baseline < pKF2->mb) continue;
-        }
-        else
-        {
-            const float medianDepthKF2     = pKF2->ComputeSceneMedianDepth(2);
-            const float ratioBaselineDepth = baseline / medianDepthKF2;
+    if (!mbMonocular)
+    {
+        if (baseline < pKF2->mb) return;
+    }
+    else
+    {
+        const float medianDepthKF2     = pKF2->ComputeSceneMedianDepth(2);
+        const float ratioBaselineDepth = baseline / medianDepthKF2;
 
-            if (ratioBaselineDepth < 0.01) continue;
-        }
+        if (ratioBaselineDepth < 0.01) return;
+    }
 
-        // Search matches that fullfil epipolar constraint
-        vector<pair<size_t, size_t>> vMatchedIndices;
-        bool                         bCoarse = mbInertial &&
-                       mpTracker->mState == Tracking::RECENTLY_LOST &&
-                       mpCurrentKeyFrame->GetMap()->GetIniertialBA2();
-
-        matcher.SearchForTriangulation(mpCurrentKeyFrame,
-                                       pKF2,
-                                       vMatchedIndices,
-                                       false,
-                                       bCoarse);
-
-        Sophus::SE3<float>         sophTcw2 = pKF2->GetPose();
-        Eigen::Matrix<float, 3, 4> eigTcw2  = sophTcw2.matrix3x4();
-        Eigen::Matrix<float, 3, 3> Rcw2     = eigTcw2.block<3, 3>(0, 0);
-        Eigen::Matrix<float, 3, 3> Rwc2     = Rcw2.transpose();
-        Eigen::Vector3f            tcw2     = sophTcw2.translation();
-
-        const float& fx2    = pKF2->fx;
-        const float& fy2    = pKF2->fy;
-        const float& cx2    = pKF2->cx;
-        const float& cy2    = pKF2->cy;
-        const float& invfx2 = pKF2->invfx;
-        const float& invfy2 = pKF2->invfy;
-
-        // Triangulate each match
-        const int nmatches = vMatchedIndices.size();
-        for (int ikp = 0; ikp < nmatches; ikp++)
+    // Search matches that fullfil epipolar constraint
+    ORBmatcher                   matcher(0.6f, false);
+    vector<pair<size_t, size_t>> vMatchedIndices;
+    matcher.SearchForTriangulation(mpCurrentKeyFrame,
+                                   pKF2,
+                                   vMatchedIndices,
+                                   false,
+                                   bCoarse,
+                                   mbEpipolarSearch
+                                       ? ORBmatcher::SEARCH_EPIPOLAR
+                                       : ORBmatcher::SEARCH_BOW);
+
+    vMatched1.reserve(vMatchedIndices.size());
+    for (const pair<size_t, size_t>& match : vMatchedIndices)
+        vMatched1.push_back(match.first);
+
+    Sophus::SE3<float>         sophTcw2 = pKF2->GetPose();
+    Eigen::Matrix<float, 3, 4> eigTcw2  = sophTcw2.matrix3x4();
+    Eigen::Matrix<float, 3, 3> Rcw2     = eigTcw2.block<3, 3>(0, 0);
+    Eigen::Matrix<float, 3, 3> Rwc2     = Rcw2.transpose();
+    Eigen::Vector3f            tcw2     = sophTcw2.translation();
+
+    const float& fx2    = pKF2->fx;
+    const float& fy2    = pKF2->fy;
+    const float& cx2    = pKF2->cx;
+    const float& cy2    = pKF2->cy;
+    const float& invfx2 = pKF2->invfx;
+    const float& invfy2 = pKF2->invfy;
+
+    // Triangulate each match
+    const int nmatches = vMatchedIndices.size();
+    for (int ikp = 0; ikp < nmatches; ikp++)
+    {
+        const int& idx1 = vMatchedIndices[ikp].first;
+        const int& idx2 = vMatchedIndices[ikp].second;
+
+        const cv::KeyPoint& kp1 =
+            (mpCurrentKeyFrame->NLeft == -1)
+                ? mpCurrentKeyFrame->mvKeysUn[idx1]
+            : (idx1 < mpCurrentKeyFrame->NLeft)
+                ? mpCurrentKeyFrame->mvKeys[idx1]
+                : mpCurrentKeyFrame
+                      ->mvKeysRight[idx1 - mpCurrentKeyFrame->NLeft];
+        const float kp1_ur = mpCurrentKeyFrame->mvuRight[idx1];
+        bool bStereo1      = (!mpCurrentKeyFrame->mpCamera2 && kp1_ur >= 0);
+        const bool bRight1 = (mpCurrentKeyFrame->NLeft == -1 ||
+                              idx1 < mpCurrentKeyFrame->NLeft)
+                               ? false
+                               : true;
+
+        const cv::KeyPoint& kp2 = (pKF2->NLeft == -1) ? pKF2->mvKeysUn[idx2]
+                                : (idx2 < pKF2->NLeft)
+                                    ? pKF2->mvKeys[idx2]
+                                    : pKF2->mvKeysRight[idx2 - pKF2->NLeft];
+
+        const float kp2_ur   = pKF2->mvuRight[idx2];
+        bool        bStereo2 = (!pKF2->mpCamera2 && kp2_ur >= 0);
+        const bool  bRight2 =
+            (pKF2->NLeft == -1 || idx2 < pKF2->NLeft) ? false : true;
+
+        if (mpCurrentKeyFrame->mpCamera2 && pKF2->mpCamera2)
         {
-            const int& idx1 = vMatchedIndices[ikp].first;
-            const int& idx2 = vMatchedIndices[ikp].second;
-
-            const cv::KeyPoint& kp1 =
-                (mpCurrentKeyFrame->NLeft == -1)
-                    ? mpCurrentKeyFrame->mvKeysUn[idx1]
-                : (idx1 < mpCurrentKeyFrame->NLeft)
-                    ? mpCurrentKeyFrame->mvKeys[idx1]
-                    : mpCurrentKeyFrame
-                          ->mvKeysRight[idx1 - mpCurrentKeyFrame->NLeft];
-            const float kp1_ur = mpCurrentKeyFrame->mvuRight[idx1];
-            bool bStereo1      = (!mpCurrentKeyFrame->mpCamera2 && kp1_ur >= 0);
-            const bool bRight1 = (mpCurrentKeyFrame->NLeft == -1 ||
-                                  idx1 < mpCurrentKeyFrame->NLeft)
-                                   ? false
-                                   : true;
-
-            const cv::KeyPoint& kp2 = (pKF2->NLeft == -1) ? pKF2->mvKeysUn[idx2]
-                                    : (idx2 < pKF2->NLeft)
-                                        ? pKF2->mvKeys[idx2]
-                                        : pKF2->mvKeysRight[idx2 - pKF2->NLeft];
-
-            const float kp2_ur   = pKF2->mvuRight[idx2];
-            bool        bStereo2 = (!pKF2->mpCamera2 && kp2_ur >= 0);
-            const bool  bRight2 =
-                (pKF2->NLeft == -1 || idx2 < pKF2->NLeft) ? false : true;
-
-            if (mpCurrentKeyFrame->mpCamera2 && pKF2->mpCamera2)
+            if (bRight1 && bRight2)
             {
-                if (bRight1 && bRight2)
-                {
-                    sophTcw1 = mpCurrentKeyFrame->GetRightPose();
-                    Ow1      = mpCurrentKeyFrame->GetRightCameraCenter();
+                sophTcw1 = mpCurrentKeyFrame->GetRightPose();
+                Ow1      = mpCurrentKeyFrame->GetRightCameraCenter();
 
-                    sophTcw2 = pKF2->GetRightPose();
-                    Ow2      = pKF2->GetRightCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera2;
-                    pCamera2 = pKF2->mpCamera2;
-                }
-                else if (bRight1 && !bRight2)
-                {
-                    sophTcw1 = mpCurrentKeyFrame->GetRightPose();
-                    Ow1      = mpCurrentKeyFrame->GetRightCameraCenter();
+                sophTcw2 = pKF2->GetRightPose();
+                Ow2      = pKF2->GetRightCameraCenter();
 
-                    sophTcw2 = pKF2->GetPose();
-                    Ow2      = pKF2->GetCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera2;
-                    pCamera2 = pKF2->mpCamera;
-                }
-                else if (!bRight1 && bRight2)
-                {
-                    sophTcw1 = mpCurrentKeyFrame->GetPose();
-                    Ow1      = mpCurrentKeyFrame->GetCameraCenter();
-
-                    sophTcw2 = pKF2->GetRightPose();
-                    Ow2      = pKF2->GetRightCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera;
-                    pCamera2 = pKF2->mpCamera2;
-                }
-                else
-                {
-                    sophTcw1 = mpCurrentKeyFrame->GetPose();
-                    Ow1      = mpCurrentKeyFrame->GetCameraCenter();
-
-                    sophTcw2 = pKF2->GetPose();
-                    Ow2      = pKF2->GetCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera;
-                    pCamera2 = pKF2->mpCamera;
-                }
-                eigTcw1 = sophTcw1.matrix3x4();
-                Rcw1    = eigTcw1.block<3, 3>(0, 0);
-                Rwc1    = Rcw1.transpose();
-                tcw1    = sophTcw1.translation();
-
-                eigTcw2 = sophTcw2.matrix3x4();
-                Rcw2    = eigTcw2.block<3, 3>(0, 0);
-                Rwc2    = Rcw2.transpose();
-                tcw2    = sophTcw2.translation();
+                pCamera1 = mpCurrentKeyFrame->mpCamera2;
+                pCamera2 = pKF2->mpCamera2;
             }
+            else if (bRight1 && !bRight2)
+            {
+                sophTcw1 = mpCurrentKeyFrame->GetRightPose();
+                Ow1      = mpCurrentKeyFrame->GetRightCameraCenter();
 
-            // Check parallax between rays
-            Eigen::Vector3f xn1 = pCamera1->unprojectEig(kp1.pt);
-            Eigen::Vector3f xn2 = pCamera2->unprojectEig(kp2.pt);
-
-            Eigen::Vector3f ray1 = Rwc1 * xn1;
-            Eigen::Vector3f ray2 = Rwc2 * xn2;
-            const float     cosParallaxRays =
-                ray1.dot(ray2) / (ray1.norm() * ray2.norm());
-
-            float cosParallaxStereo  = cosParallaxRays + 1;
-            float cosParallaxStereo1 = cosParallaxStereo;
-            float cosParallaxStereo2 = cosParallaxStereo;
-
-            if (bStereo1)
-                cosParallaxStereo1 =
-                    cos(2 * atan2(mpCurrentKeyFrame->mb / 2,
-                                  mpCurrentKeyFrame->mvDepth[idx1]));
-            else if (bStereo2)
-                cosParallaxStereo2 =
-                    cos(2 * atan2(pKF2->mb / 2, pKF2->mvDepth[idx2]));
-
-            if (bStereo1 || bStereo2) totalStereoPts++;
-
-            cosParallaxStereo = min(cosParallaxStereo1, cosParallaxStereo2);
-
-            Eigen::Vector3f x3D;
+                sophTcw2 = pKF2->GetPose();
+                Ow2      = pKF2->GetCameraCenter();
 
-            bool goodProj     = false;
-            bool bPointStereo = false;
-            if (cosParallaxRays < cosParallaxStereo && cosParallaxRays > 0 &&
-                (bStereo1 || bStereo2 ||
-                 (cosParallaxRays < 0.9996 && mbInertial) ||
-                 (cosParallaxRays < 0.9998 && !mbInertial)))
-            {
-                goodProj = GeometricTools::Triangulate(xn1,
-                                                       xn2,
-                                                       eigTcw1,
-                                                       eigTcw2,
-                                                       x3D);
-                if (!goodProj) continue;
-            }
-            else if (bStereo1 && cosParallaxStereo1 < cosParallaxStereo2)
-            {
-                countStereoAttempt++;
-                bPointStereo = true;
-                goodProj     = mpCurrentKeyFrame->UnprojectStereo(idx1, x3D);
+                pCamera1 = mpCurrentKeyFrame->mpCamera2;
+                pCamera2 = pKF2->mpCamera;
             }
-            else if (bStereo2 && cosParallaxStereo2 < cosParallaxStereo1)
+            else if (!bRight1 && bRight2)
             {
-                countStereoAttempt++;
-                bPointStereo = true;
-                goodProj     = pKF2->UnprojectStereo(idx2, x3D);
+                sophTcw1 = mpCurrentKeyFrame->GetPose();
+                Ow1      = mpCurrentKeyFrame->GetCameraCenter();
+
+                sophTcw2 = pKF2->GetRightPose();
+                Ow2      = pKF2->GetRightCameraCenter();
+
+                pCamera1 = mpCurrentKeyFrame->mpCamera;
+                pCamera2 = pKF2->mpCamera2;
             }
             else
             {
-                continue;  // No stereo and very low parallax
-            }
-
-            if (goodProj && bPointStereo) countStereoGoodProj++;
-
-            if (!goodProj) continue;
+                sophTcw1 = mpCurrentKeyFrame->GetPose();
+                Ow1      = mpCurrentKeyFrame->GetCameraCenter();
 
-            // Check triangulation in front of cameras
-            float z1 = Rcw1.row(2).dot(x3D) + tcw1(2);
-            if (z1 <= 0) continue;
+                sophTcw2 = pKF2->GetPose();
+                Ow2      = pKF2->GetCameraCenter();
 
-            float z2 = Rcw2.row(2).dot(x3D) + tcw2(2);
-            if (z2 <= 0) continue;
-
-            // Check reprojection error in first keyframe
-            const float& sigmaSquare1 =
-                mpCurrentKeyFrame->mvLevelSigma2[kp1.octave];
-            const float x1    = Rcw1.row(0).dot(x3D) + tcw1(0);
-            const float y1    = Rcw1.row(1).dot(x3D) + tcw1(1);
-            const float invz1 = 1.0 / z1;
+                pCamera1 = mpCurrentKeyFrame->mpCamera;
+                pCamera2 = pKF2->mpCamera;
+            }
+            eigTcw1 = sophTcw1.matrix3x4();
+            Rcw1    = eigTcw1.block<3, 3>(0, 0);
+            Rwc1    = Rcw1.transpose();
+            tcw1    = sophTcw1.translation();
+
+            eigTcw2 = sophTcw2.matrix3x4();
+            Rcw2    = eigTcw2.block<3, 3>(0, 0);
+            Rwc2    = Rcw2.transpose();
+            tcw2    = sophTcw2.translation();
+        }
 
-            if (!bStereo1)
-            {
-                cv::Point2f uv1   = pCamera1->project(cv::Point3f(x1, y1, z1));
-                float       errX1 = uv1.x - kp1.pt.x;
-                float       errY1 = uv1.y - kp1.pt.y;
+        // Check parallax between rays
+        Eigen::Vector3f xn1 = pCamera1->unprojectEig(kp1.pt);
+        Eigen::Vector3f xn2 = pCamera2->unprojectEig(kp2.pt);
+
+        Eigen::Vector3f ray1 = Rwc1 * xn1;
+        Eigen::Vector3f ray2 = Rwc2 * xn2;
+        const float     cosParallaxRays =
+            ray1.dot(ray2) / (ray1.norm() * ray2.norm());
+
+        float cosParallaxStereo  = cosParallaxRays + 1;
+        float cosParallaxStereo1 = cosParallaxStereo;
+        float cosParallaxStereo2 = cosParallaxStereo;
+
+        if (bStereo1)
+            cosParallaxStereo1 =
+                cos(2 * atan2(mpCurrentKeyFrame->mb / 2,
+                              mpCurrentKeyFrame->mvDepth[idx1]));
+        else if (bStereo2)
+            cosParallaxStereo2 =
+                cos(2 * atan2(pKF2->mb / 2, pKF2->mvDepth[idx2]));
+
+        cosParallaxStereo = min(cosParallaxStereo1, cosParallaxStereo2);
+
+        Eigen::Vector3f x3D;
+
+        bool goodProj     = false;
+        bool bPointStereo = false;
+        if (cosParallaxRays < cosParallaxStereo && cosParallaxRays > 0 &&
+            (bStereo1 || bStereo2 ||
+             (cosParallaxRays < 0.9996 && mbInertial) ||
+             (cosParallaxRays < 0.9998 && !mbInertial)))
+        {
+            goodProj = GeometricTools::Triangulate(xn1,
+                                                   xn2,
+                                                   eigTcw1,
+                                                   eigTcw2,
+                                                   x3D);
+            if (!goodProj) continue;
+        }
+        else if (bStereo1 && cosParallaxStereo1 < cosParallaxStereo2)
+        {
+            bPointStereo = true;
+            goodProj     = mpCurrentKeyFrame->UnprojectStereo(idx1, x3D);
+        }
+        else if (bStereo2 && cosParallaxStereo2 < cosParallaxStereo1)
+        {
+            bPointStereo = true;
+            goodProj     = pKF2->UnprojectStereo(idx2, x3D);
+        }
+        else
+        {
+            continue;  // No stereo and very low parallax
+        }
 
-                if ((errX1 * errX1 + errY1 * errY1) > 5.991 * sigmaSquare1)
-                    continue;
-            }
-            else
-            {
-                float u1      = fx1 * x1 * invz1 + cx1;
-                float u1_r    = u1 - mpCurrentKeyFrame->mbf * invz1;
-                float v1      = fy1 * y1 * invz1 + cy1;
-                float errX1   = u1 - kp1.pt.x;
-                float errY1   = v1 - kp1.pt.y;
-                float errX1_r = u1_r - kp1_ur;
-                if ((errX1 * errX1 + errY1 * errY1 + errX1_r * errX1_r) >
-                    7.8 * sigmaSquare1)
-                    continue;
-            }
+        if (!goodProj) continue;
 
-            // Check reprojection error in second keyframe
-            const float sigmaSquare2 = pKF2->mvLevelSigma2[kp2.octave];
-            const float x2           = Rcw2.row(0).dot(x3D) + tcw2(0);
-            const float y2           = Rcw2.row(1).dot(x3D) + tcw2(1);
-            const float invz2        = 1.0 / z2;
-            if (!bStereo2)
-            {
-                cv::Point2f uv2   = pCamera2->project(cv::Point3f(x2, y2, z2));
-                float       errX2 = uv2.x - kp2.pt.x;
-                float       errY2 = uv2.y - kp2.pt.y;
-                if ((errX2 * errX2 + errY2 * errY2) > 5.991 * sigmaSquare2)
-                    continue;
-            }
-            else
-            {
-                float u2      = fx2 * x2 * invz2 + cx2;
-                float u2_r    = u2 - mpCurrentKeyFrame->mbf * invz2;
-                float v2      = fy2 * y2 * invz2 + cy2;
-                float errX2   = u2 - kp2.pt.x;
-                float errY2   = v2 - kp2.pt.y;
-                float errX2_r = u2_r - kp2_ur;
-                if ((errX2 * errX2 + errY2 * errY2 + errX2_r * errX2_r) >
-                    7.8 * sigmaSquare2)
-                    continue;
-            }
+        // Check triangulation in front of cameras
+        float z1 = Rcw1.row(2).dot(x3D) + tcw1(2);
+        if (z1 <= 0) continue;
 
-            // Check scale consistency
-            Eigen::Vector3f normal1 = x3D - Ow1;
-            float           dist1   = normal1.norm();
+        float z2 = Rcw2.row(2).dot(x3D) + tcw2(2);
+        if (z2 <= 0) continue;
 
-            Eigen::Vector3f normal2 = x3D - Ow2;
-            float           dist2   = normal2.norm();
+        // Check reprojection error in first keyframe
+        const float& sigmaSquare1 =
+            mpCurrentKeyFrame->mvLevelSigma2[kp1.octave];
+        const float x1    = Rcw1.row(0).dot(x3D) + tcw1(0);
+        const float y1    = Rcw1.row(1).dot(x3D) + tcw1(1);
+        const float invz1 = 1.0 / z1;
 
-            if (dist1 == 0 || dist2 == 0) continue;
+        if (!bStereo1)
+        {
+            cv::Point2f uv1   = pCamera1->project(cv::Point3f(x1, y1, z1));
+            float       errX1 = uv1.x - kp1.pt.x;
+            float       errY1 = uv1.y - kp1.pt.y;
 
-            if (mbFarPoints && (dist1 >= mThFarPoints ||
-                                dist2 >= mThFarPoints))  // MODIFICATION
+            if ((errX1 * errX1 + errY1 * errY1) > 5.991 * sigmaSquare1)
                 continue;
+        }
+        else
+        {
+            float u1      = fx1 * x1 * invz1 + cx1;
+            float u1_r    = u1 - mpCurrentKeyFrame->mbf * invz1;
+            float v1      = fy1 * y1 * invz1 + cy1;
+            float errX1   = u1 - kp1.pt.x;
+            float errY1   = v1 - kp1.pt.y;
+            float errX1_r = u1_r - kp1_ur;
+            if ((errX1 * errX1 + errY1 * errY1 + errX1_r * errX1_r) >
+                7.8 * sigmaSquare1)
+                continue;
+        }
 
-            const float ratioDist = dist2 / dist1;
-            const float ratioOctave =
-                mpCurrentKeyFrame->mvScaleFactors[kp1.octave] /
-                pKF2->mvScaleFactors[kp2.octave];
-
-            if (ratioDist * ratioFactor < ratioOctave ||
-                ratioDist > ratioOctave * ratioFactor)
+        // Check reprojection error in second keyframe
+        const float sigmaSquare2 = pKF2->mvLevelSigma2[kp2.octave];
+        const float x2           = Rcw2.row(0).dot(x3D) + tcw2(0);
+        const float y2           = Rcw2.row(1).dot(x3D) + tcw2(1);
+        const float invz2        = 1.0 / z2;
+        if (!bStereo2)
+        {
+            cv::Point2f uv2   = pCamera2->project(cv::Point3f(x2, y2, z2));
+            float       errX2 = uv2.x - kp2.pt.x;
+            float       errY2 = uv2.y - kp2.pt.y;
+            if ((errX2 * errX2 + errY2 * errY2) > 5.991 * sigmaSquare2)
                 continue;
+        }
+        else
+        {
+            float u2      = fx2 * x2 * invz2 + cx2;
+            float u2_r    = u2 - mpCurrentKeyFrame->mbf * invz2;
+            float v2      = fy2 * y2 * invz2 + cy2;
+            float errX2   = u2 - kp2.pt.x;
+            float errY2   = v2 - kp2.pt.y;
+            float errX2_r = u2_r - kp2_ur;
+            if ((errX2 * errX2 + errY2 * errY2 + errX2_r * errX2_r) >
+                7.8 * sigmaSquare2)
+                continue;
+        }
+
+        // Check scale consistency
+        Eigen::Vector3f normal1 = x3D - Ow1;
+        float           dist1   = normal1.norm();
 
-            // Triangulation is succesfull
-            MapPoint* pMP =
-                new MapPoint(x3D, mpCurrentKeyFrame, mpAtlas->GetCurrentMap());
-            if (bPointStereo) countStereo++;
+        Eigen::Vector3f normal2 = x3D - Ow2;
+        float           dist2   = normal2.norm();
 
-            pMP->AddObservation(mpCurrentKeyFrame, idx1);
-            pMP->AddObservation(pKF2, idx2);
+        if (dist1 == 0 || dist2 == 0) continue;
 
-            mpCurrentKeyFrame->AddMapPoint(pMP, idx1);
-            pKF2->AddMapPoint(pMP, idx2);
+        if (mbFarPoints && (dist1 >= mThFarPoints ||
+                            dist2 >= mThFarPoints))  // MODIFICATION
+            continue;
 
-            pMP->ComputeDistinctiveDescriptors();
+        const float ratioDist = dist2 / dist1;
+        const float ratioOctave =
+            mpCurrentKeyFrame->mvScaleFactors[kp1.octave] /
+            pKF2->mvScaleFactors[kp2.octave];
 
-            pMP->UpdateNormalAndDepth();
+        if (ratioDist * ratioFactor < ratioOctave ||
+            ratioDist > ratioOctave * ratioFactor)
+            continue;
 
-            mpAtlas->AddMapPoint(pMP);
-            mlpRecentAddedMapPoints.push_back(pMP);
-        }
+        // Triangulation is succesfull
+        vNewPoints.push_back({ x3D, idx1, idx2 });
     }
 }
 
@@ -773,10 +838,10 @@ void LocalMapping::SearchInNeighbors()
 
     // Add some covisible of covisible
     // Extend to some second neighbors if abort is not requested
+    vector<KeyFrame*> vpSecondNeighKFs;
     for (int i = 0, imax = vpTargetKFs.size(); i < imax; i++)
     {
-        const vector<KeyFrame*> vpSecondNeighKFs =
-            vpTargetKFs[i]->GetBestCovisibilityKeyFrames(20);
+        vpTargetKFs[i]->GetBestCovisibilityKeyFrames(20, vpSecondNeighKFs);
         for (vector<KeyFrame*>::const_iterator vit2  = vpSecondNeighKFs.begin(),
                                                vend2 = vpSecondNeighKFs.end();
              vit2 != vend2;
@@ -1037,10 +1102,10 @@ void LocalMapping::KeyFrameCulling()
                             (pKF->NLeft == -1) ? pKF->mvKeysUn[i].octave
                             : (i < pKF->NLeft) ? pKF->mvKeys[i].octave
                                                : pKF->mvKeysRight[i].octave;
-                        const map<KeyFrame*, tuple<int, int>> observations =
+                        const ObservationList observations =
                             pMP->GetObservations();
                         int nObs = 0;
-                        for (map<KeyFrame*, tuple<int, int>>::const_iterator
+                        for (ObservationList::const_iterator
                                  mit  = observations.begin(),
                                  mend = observations.end();
                              mit != mend;
@@ -1350,7 +1415,7 @@ void LocalMapping::InitializeIMU(float priorG, float priorA, bool bFIBA)
 
     mScale = 1.0;
 
-    mInitTime = mpTracker->mLastFrame.mTimeStamp - vpKF.front()->mTimeStamp;
+    mInitTime = mpTracker->mpLastFrame->mTimeStamp - vpKF.front()->mTimeStamp;
 
     std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
     Optimizer::InertialOptimization(mpAtlas->GetCurrentMap(),
@@ -1404,7 +1469,7 @@ void LocalMapping::InitializeIMU(float priorG, float priorA, bool bFIBA)
     if (!mpAtlas->isImuInitialized())
     {
         mpAtlas->SetImuInitialized();
-        mpTracker->t0IMU        = mpTracker->mCurrentFrame.mTimeStamp;
+        mpTracker->t0IMU        = mpTracker->mpCurrentFrame->mTimeStamp;
         mpCurrentKeyFrame->bImu = true;
 
         std::cout << "[Imu init Rwg]\n" << mRwg << std::endl;
@@ -22,6 +22,7 @@
 
 #ifndef LOCALMAPPING_H
 #define LOCALMAPPING_H
+#include <memory>
 #include <mutex>
 
 #include "map/Atlas.h"
@@ -30,6 +31,7 @@
 #include "frame/KeyFrameDatabase.h"
 
 #include "utils/Settings.h"
+#include "utils/ThreadPool.h"
 
 namespace ORB_SLAM3
 {
@@ -53,6 +55,10 @@ public:
 
     void SetTracker(Tracking* pTracker);
 
+    // Threads used to triangulate against the neighbor keyframes, 1 for
+    // serial. Set before the first keyframe is inserted.
+    void SetMatchThreads(int nThreads);
+
     // Main function
     void Run();
 
@@ -117,6 +123,9 @@ public:
     bool  mbFarPoints;
     float mThFarPoints;
 
+    // Triangulation candidates from epipolar bands instead of BoW nodes
+    bool mbEpipolarSearch;
+
 #ifdef REGISTER_TIMES
     vector<double> vdKFInsert_ms;
     vector<double> vdMPCulling_ms;
@@ -140,6 +149,23 @@ protected:
     void ProcessNewKeyFrame();
     void CreateNewMapPoints();
 
+    // Map point found by triangulating a match between the current keyframe
+    // and a neighbor, not yet added to the map
+    struct NewMapPoint
+    {
+        Eigen::Vector3f x3D;
+        int             idx1;
+        int             idx2;
+    };
+
+    // Match the current keyframe with pKF2 and triangulate the matches. Only
+    // reads the keyframes, so it can run for several neighbors at once.
+    // vMatched1 gets the features of the current keyframe that were matched.
+    void TriangulateWithNeighbor(KeyFrame*                 pKF2,
+                                 const bool                bCoarse,
+                                 std::vector<NewMapPoint>& vNewPoints,
+                                 std::vector<size_t>&      vMatched1);
+
     void MapPointCulling();
     void SearchInNeighbors();
     void KeyFrameCulling();
@@ -172,6 +198,9 @@ protected:
 
     std::list<MapPoint*> mlpRecentAddedMapPoints;
 
+    // Workers for CreateNewMapPoints, null when it runs serially
+    std::unique_ptr<ThreadPool> mpMatcherPool;
+
     std::mutex mMutexNewKFs;
 
     bool mbAbortBA;
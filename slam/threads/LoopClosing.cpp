@@ -593,7 +593,8 @@ bool LoopClosing::NewDetectCommonRegions()
         mpKeyFrameDB->DetectNBestCandidates(mpCurrentKF,
                                             vpLoopBowCand,
                                             vpMergeBowCand,
-                                            3);
+                                            3,
+                                            mPlaceRecognitionContext);
 #ifdef REGISTER_TIMES
         std::chrono::steady_clock::time_point time_EndQuery =
             std::chrono::steady_clock::now();
@@ -2536,7 +2537,7 @@ void LoopClosing::CheckObservations(set<KeyFrame*>& spKFsMap1,
                 continue;
             }
 
-            map<KeyFrame*, tuple<int, int>> mMPijObs = pMPij->GetObservations();
+            ObservationList mMPijObs = pMPij->GetObservations();
             for (KeyFrame* pKFi2 : spKFsMap2)
             {
                 if (mMPijObs.find(pKFi2) != mMPijObs.end())
@@ -188,6 +188,9 @@ protected:
     KeyFrameDatabase* mpKeyFrameDB;
     ORBVocabulary*    mpORBVocabulary;
 
+    // Scratch of the place recognition queries of this thread
+    KeyFrameDatabase::QueryContext mPlaceRecognitionContext;
+
     LocalMapping* mpLocalMapper;
 
     std::list<KeyFrame*> mlpLoopKeyFrameQueue;
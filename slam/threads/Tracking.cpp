@@ -66,6 +66,7 @@ Tracking::Tracking(System*           pSys,
     , mpSystem(pSys)
     , mpAtlas(pAtlas)
     , mnLastRelocFrameId(0)
+    , mbRelocalized(false)
     , time_recently_lost(5.0)
     , mnInitialFrameId(0)
     , mbCreatedMap(false)
@@ -223,25 +224,45 @@ void Tracking::newParameterLoader(Settings* settings)
     int   fMinThFAST   = settings->minThFAST();
     float fScaleFactor = settings->scaleFactor();
 
+    const ORBextractor::DistributionMode distribution =
+        static_cast<ORBextractor::DistributionMode>(
+            settings->orbDistribution());
+
     mpORBextractorLeft = new ORBextractor(nFeatures,
                                           fScaleFactor,
                                           nLevels,
                                           fIniThFAST,
                                           fMinThFAST);
+    mpORBextractorLeft->SetNumThreads(settings->orbThreads());
+    mpORBextractorLeft->SetDistributionMode(distribution);
 
     if (mSensor == System::STEREO || mSensor == System::IMU_STEREO)
+    {
         mpORBextractorRight = new ORBextractor(nFeatures,
                                                fScaleFactor,
                                                nLevels,
                                                fIniThFAST,
                                                fMinThFAST);
+        mpORBextractorRight->SetNumThreads(settings->orbThreads());
+        mpORBextractorRight->SetDistributionMode(distribution);
+    }
 
     if (mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR)
+    {
         mpIniORBextractor = new ORBextractor(5 * nFeatures,
                                              fScaleFactor,
                                              nLevels,
                                              fIniThFAST,
                                              fMinThFAST);
+        mpIniORBextractor->SetNumThreads(settings->orbThreads());
+        mpIniORBextractor->SetDistributionMode(distribution);
+    }
+
+    mbIncrementalORB = settings->orbIncremental();
+    mbOpticalFlow    = settings->orbOpticalFlow();
+
+    if (settings->matchThreads() > 1)
+        mpMatcherPool.reset(new ThreadPool(settings->matchThreads()));
 
     // IMU parameters
     Sophus::SE3f Tbc = settings->Tbc();
@@ -996,6 +1017,50 @@ bool Tracking::ParseORBParamFile(cv::FileStorage& fSettings)
         b_miss_params = true;
     }
 
+    // Optional, extraction runs on the tracking thread only by default
+    int nThreads = 1;
+    node         = fSettings["ORBextractor.nThreads"];
+    if (!node.empty() && node.isInt())
+    {
+        nThreads = node.operator int();
+    }
+
+    ORBextractor::DistributionMode distribution =
+        ORBextractor::DISTRIBUTE_OCTREE;
+    node = fSettings["ORBextractor.distribution"];
+    if (!node.empty() && node.isString())
+    {
+        if (node.string() == "QuadTree")
+            distribution = ORBextractor::DISTRIBUTE_QUADTREE;
+        else if (node.string() != "OctTree")
+        {
+            std::cerr << "*ORBextractor.distribution must be OctTree or "
+                         "QuadTree*"
+                      << std::endl;
+            b_miss_params = true;
+        }
+    }
+
+    node = fSettings["ORBextractor.incremental"];
+    if (!node.empty() && node.isInt())
+    {
+        mbIncrementalORB = node.operator int();
+    }
+
+    node = fSettings["ORBextractor.opticalFlow"];
+    if (!node.empty() && node.isInt())
+    {
+        mbOpticalFlow = node.operator int();
+    }
+
+    // Optional, the local map is searched on the tracking thread by default
+    int nMatchThreads = 1;
+    node              = fSettings["ORBmatcher.nThreads"];
+    if (!node.empty() && node.isInt())
+    {
+        nMatchThreads = node.operator int();
+    }
+
     if (b_miss_params)
     {
         return false;
@@ -1006,20 +1071,35 @@ bool Tracking::ParseORBParamFile(cv::FileStorage& fSettings)
                                           nLevels,
                                           fIniThFAST,
                                           fMinThFAST);
+    mpORBextractorLeft->SetNumThreads(nThreads);
+    mpORBextractorLeft->SetDistributionMode(distribution);
 
     if (mSensor == System::STEREO || mSensor == System::IMU_STEREO)
+    {
         mpORBextractorRight = new ORBextractor(nFeatures,
                                                fScaleFactor,
                                                nLevels,
                                                fIniThFAST,
                                                fMinThFAST);
+        mpORBextractorRight->SetNumThreads(nThreads);
+        mpORBextractorRight->SetDistributionMode(distribution);
+    }
 
     if (mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR)
+    {
         mpIniORBextractor = new ORBextractor(5 * nFeatures,
                                              fScaleFactor,
                                              nLevels,
                                              fIniThFAST,
                                              fMinThFAST);
+        mpIniORBextractor->SetNumThreads(nThreads);
+        mpIniORBextractor->SetDistributionMode(distribution);
+    }
+
+    if (nMatchThreads > 1)
+        mpMatcherPool.reset(new ThreadPool(nMatchThreads));
+    else
+        mpMatcherPool.reset();
 
     cout << endl << "ORB Extractor Parameters: " << endl;
     cout << "- Number of Features: " << nFeatures << endl;
@@ -1027,6 +1107,14 @@ bool Tracking::ParseORBParamFile(cv::FileStorage& fSettings)
     cout << "- Scale Factor: " << fScaleFactor << endl;
     cout << "- Initial Fast Threshold: " << fIniThFAST << endl;
     cout << "- Minimum Fast Threshold: " << fMinThFAST << endl;
+    cout << "- Extraction Threads: " << nThreads << endl;
+    cout << "- Distribution: "
+         << (distribution == ORBextractor::DISTRIBUTE_QUADTREE ? "QuadTree"
+                                                                : "OctTree")
+         << endl;
+    cout << "- Incremental Detection: " << mbIncrementalORB << endl;
+    cout << "- Optical Flow Tracking: " << mbOpticalFlow << endl;
+    cout << "- Matching Threads: " << nMatchThreads << endl;
 
     return true;
 }
@@ -1184,131 +1272,25 @@ Sophus::SE3f Tracking::GrabImageStereo(const cv::Mat& imRectLeft,
                                        const double&  timestamp,
                                        string         filename)
 {
-    // cout << "GrabImageStereo" << endl;
+    cv::Mat imGrayRight;
+    ConvertToGray(imRectLeft, mImGray);
+    ConvertToGray(imRectRight, imGrayRight);
+    mImRight = imRectRight;
+
+    mpCurrentFrame = NextFrameSlot();
+    BuildFrameStereo(*mpCurrentFrame,
+                     mImGray,
+                     imGrayRight,
+                     timestamp,
+                     mSensor == System::IMU_STEREO ? mpLastFrame : nullptr,
+                     mpCamera2 ? cv::Mat() : ComputeDetectionMask());
+
+    mpCurrentFrame->mNameFile = filename;
+    mpCurrentFrame->mnDataset = mnNumDataset;
 
-    mImGray             = imRectLeft;
-    cv::Mat imGrayRight = imRectRight;
-    mImRight            = imRectRight;
-
-    if (mImGray.channels() == 3)
-    {
-        // cout << "Image with 3 channels" << endl;
-        if (mbRGB)
-        {
-            cvtColor(mImGray, mImGray, cv::COLOR_RGB2GRAY);
-            cvtColor(imGrayRight, imGrayRight, cv::COLOR_RGB2GRAY);
-        }
-        else
-        {
-            cvtColor(mImGray, mImGray, cv::COLOR_BGR2GRAY);
-            cvtColor(imGrayRight, imGrayRight, cv::COLOR_BGR2GRAY);
-        }
-    }
-    else if (mImGray.channels() == 4)
-    {
-        // cout << "Image with 4 channels" << endl;
-        if (mbRGB)
-        {
-            cvtColor(mImGray, mImGray, cv::COLOR_RGBA2GRAY);
-            cvtColor(imGrayRight, imGrayRight, cv::COLOR_RGBA2GRAY);
-        }
-        else
-        {
-            cvtColor(mImGray, mImGray, cv::COLOR_BGRA2GRAY);
-            cvtColor(imGrayRight, imGrayRight, cv::COLOR_BGRA2GRAY);
-        }
-    }
-
-    // cout << "Incoming frame creation" << endl;
-
-    if (mSensor == System::STEREO && !mpCamera2)
-    {
-        // mCurrentFrame = Frame(mImGray, imGrayRight, timestamp,
-        // mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK,
-        // mDistCoef, mbf, mThDepth, mpCamera);
-        mCurrentFrame.reset(mImGray,
-                            imGrayRight,
-                            timestamp,
-                            mpORBextractorLeft,
-                            mpORBextractorRight,
-                            mpORBVocabulary,
-                            mK,
-                            mDistCoef,
-                            mbf,
-                            mThDepth,
-                            mpCamera);
-    }
-    else if (mSensor == System::STEREO && mpCamera2)
-    {
-        // mCurrentFrame = Frame(mImGray, imGrayRight, timestamp,
-        // mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK,
-        // mDistCoef, mbf, mThDepth, mpCamera, mpCamera2, mTlr);
-        mCurrentFrame.reset(mImGray,
-                            imGrayRight,
-                            timestamp,
-                            mpORBextractorLeft,
-                            mpORBextractorRight,
-                            mpORBVocabulary,
-                            mK,
-                            mDistCoef,
-                            mbf,
-                            mThDepth,
-                            mpCamera,
-                            mpCamera2,
-                            mTlr);
-    }
-    else if (mSensor == System::IMU_STEREO && !mpCamera2)
-    {
-        // mCurrentFrame = Frame(mImGray, imGrayRight, timestamp,
-        // mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK,
-        // mDistCoef, mbf, mThDepth, mpCamera, &mLastFrame, *mpImuCalib);
-        mCurrentFrame.reset(mImGray,
-                            imGrayRight,
-                            timestamp,
-                            mpORBextractorLeft,
-                            mpORBextractorRight,
-                            mpORBVocabulary,
-                            mK,
-                            mDistCoef,
-                            mbf,
-                            mThDepth,
-                            mpCamera,
-                            &mLastFrame,
-                            *mpImuCalib);
-    }
-    else if (mSensor == System::IMU_STEREO && mpCamera2)
-    {
-        // mCurrentFrame = Frame(mImGray, imGrayRight, timestamp,
-        // mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK,
-        // mDistCoef, mbf, mThDepth, mpCamera, mpCamera2, mTlr, &mLastFrame,
-        // *mpImuCalib);
-        mCurrentFrame.reset(mImGray,
-                            imGrayRight,
-                            timestamp,
-                            mpORBextractorLeft,
-                            mpORBextractorRight,
-                            mpORBVocabulary,
-                            mK,
-                            mDistCoef,
-                            mbf,
-                            mThDepth,
-                            mpCamera,
-                            mpCamera2,
-                            mTlr,
-                            &mLastFrame,
-                            *mpImuCalib);
-    }
-
-    // cout << "Incoming frame ended" << endl;
-
-    mCurrentFrame.mNameFile = filename;
-    mCurrentFrame.mnDataset = mnNumDataset;
-
-    // cout << "Tracking start" << endl;
     Track();
-    // cout << "Tracking end" << endl;
 
-    return mCurrentFrame.GetPose();
+    return mpCurrentFrame->GetPose();
 }
 
 
@@ -1317,167 +1299,277 @@ Sophus::SE3f Tracking::GrabImageRGBD(const cv::Mat& imRGB,
                                      const double&  timestamp,
                                      string         filename)
 {
-    mImGray         = imRGB;
     cv::Mat imDepth = imD;
+    ConvertToGray(imRGB, mImGray);
 
-    if (mImGray.channels() == 3)
+    if ((fabs(mDepthMapFactor - 1.0f) > 1e-5) || imDepth.type() != CV_32F)
+        imDepth.convertTo(imDepth, CV_32F, mDepthMapFactor);
+
+    mpCurrentFrame = NextFrameSlot();
+    mbFlowFrame    = false;
+    if (mSensor == System::IMU_RGBD ||
+        !TrackWithOpticalFlow(imDepth, timestamp))
     {
-        if (mbRGB)
-            cvtColor(mImGray, mImGray, cv::COLOR_RGB2GRAY);
-        else
-            cvtColor(mImGray, mImGray, cv::COLOR_BGR2GRAY);
+        BuildFrameRGBD(*mpCurrentFrame,
+                       mImGray,
+                       imDepth,
+                       timestamp,
+                       mSensor == System::IMU_RGBD ? mpLastFrame : nullptr,
+                       ComputeDetectionMask());
     }
-    else if (mImGray.channels() == 4)
+
+    mpCurrentFrame->mNameFile = filename;
+    mpCurrentFrame->mnDataset = mnNumDataset;
+
+    Track();
+
+    return mpCurrentFrame->GetPose();
+}
+
+
+Sophus::SE3f Tracking::GrabImageMonocular(const cv::Mat& im,
+                                          const double&  timestamp,
+                                          string         filename)
+{
+    ConvertToGray(im, mImGray);
+
+    mpCurrentFrame = NextFrameSlot();
+    mbFlowFrame    = false;
+
+    // Optical flow only for visual monocular, once initialized
+    const bool bInitial = UseInitialExtractor();
+    if (bInitial || mSensor == System::IMU_MONOCULAR ||
+        !TrackWithOpticalFlow(cv::Mat(), timestamp))
     {
-        if (mbRGB)
-            cvtColor(mImGray, mImGray, cv::COLOR_RGBA2GRAY);
-        else
-            cvtColor(mImGray, mImGray, cv::COLOR_BGRA2GRAY);
+        BuildFrameMonocular(
+            *mpCurrentFrame,
+            mImGray,
+            timestamp,
+            bInitial,
+            mSensor == System::IMU_MONOCULAR ? mpLastFrame : nullptr,
+            bInitial ? cv::Mat() : ComputeDetectionMask());
     }
 
+    if (mState == NO_IMAGES_YET) t0 = timestamp;
+
+    mpCurrentFrame->mNameFile = filename;
+    mpCurrentFrame->mnDataset = mnNumDataset;
+
+    lastID = mpCurrentFrame->mnId;
+    Track();
+
+    return mpCurrentFrame->GetPose();
+}
+
+
+void Tracking::PrepareFrameStereo(const cv::Mat& imRectLeft,
+                                  const cv::Mat& imRectRight,
+                                  const double&  timestamp,
+                                  Frame&         frame,
+                                  cv::Mat&       imGray)
+{
+    cv::Mat imGrayRight;
+    ConvertToGray(imRectLeft, imGray);
+    ConvertToGray(imRectRight, imGrayRight);
+
+    BuildFrameStereo(frame, imGray, imGrayRight, timestamp, nullptr, cv::Mat());
+}
+
+
+void Tracking::PrepareFrameRGBD(const cv::Mat& imRGB,
+                                const cv::Mat& imD,
+                                const double&  timestamp,
+                                Frame&         frame,
+                                cv::Mat&       imGray)
+{
+    cv::Mat imDepth = imD;
+    ConvertToGray(imRGB, imGray);
+
     if ((fabs(mDepthMapFactor - 1.0f) > 1e-5) || imDepth.type() != CV_32F)
         imDepth.convertTo(imDepth, CV_32F, mDepthMapFactor);
 
-    if (mSensor == System::RGBD)
-    {
-        // mCurrentFrame = Frame(mImGray, imDepth, timestamp,
-        // mpORBextractorLeft, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth,
-        // mpCamera);
-        mCurrentFrame.reset(mImGray,
-                            imDepth,
-                            timestamp,
-                            mpORBextractorLeft,
-                            mpORBVocabulary,
-                            mK,
-                            mDistCoef,
-                            mbf,
-                            mThDepth,
-                            mpCamera);
-    }
-    else if (mSensor == System::IMU_RGBD)
-    {
-        // mCurrentFrame = Frame(mImGray, imDepth, timestamp,
-        // mpORBextractorLeft, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth,
-        // mpCamera, &mLastFrame, *mpImuCalib);
-        mCurrentFrame.reset(mImGray,
-                            imDepth,
-                            timestamp,
-                            mpORBextractorLeft,
-                            mpORBVocabulary,
-                            mK,
-                            mDistCoef,
-                            mbf,
-                            mThDepth,
-                            mpCamera,
-                            &mLastFrame,
-                            *mpImuCalib);
-    }
-
-
-    mCurrentFrame.mNameFile = filename;
-    mCurrentFrame.mnDataset = mnNumDataset;
+    BuildFrameRGBD(frame, imGray, imDepth, timestamp, nullptr, cv::Mat());
+}
+
+
+void Tracking::PrepareFrameMonocular(const cv::Mat& im,
+                                     const double&  timestamp,
+                                     Frame&         frame,
+                                     cv::Mat&       imGray)
+{
+    ConvertToGray(im, imGray);
+
+    BuildFrameMonocular(frame,
+                        imGray,
+                        timestamp,
+                        mbInitialExtractor,
+                        nullptr,
+                        cv::Mat());
+}
+
 
+Sophus::SE3f Tracking::TrackFrame(Frame&         frame,
+                                  const cv::Mat& imGray,
+                                  string         filename)
+{
+    const bool bMono =
+        mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR;
+    const bool bImu = mSensor == System::IMU_MONOCULAR ||
+                      mSensor == System::IMU_STEREO ||
+                      mSensor == System::IMU_RGBD;
+
+    mImGray         = imGray;
+    mpCurrentFrame  = NextFrameSlot();
+    *mpCurrentFrame = std::move(frame);
+    mbFlowFrame     = false;
+
+    // Link to the last frame as the frame constructor does for inertial
+    // sensors, the last frame did not exist when this one was built
+    if (bImu)
+    {
+        mpCurrentFrame->mpPrevFrame = mpLastFrame;
+        if (mpLastFrame->HasVelocity())
+            mpCurrentFrame->SetVelocity(mpLastFrame->GetVelocity());
+    }
+
+    if (bMono && mState == NO_IMAGES_YET) t0 = mpCurrentFrame->mTimeStamp;
+
+    mpCurrentFrame->mNameFile = filename;
+    mpCurrentFrame->mnDataset = mnNumDataset;
+
+    if (bMono) lastID = mpCurrentFrame->mnId;
     Track();
 
-    return mCurrentFrame.GetPose();
+    mbInitialExtractor = UseInitialExtractor();
+
+    return mpCurrentFrame->GetPose();
 }
 
 
-Sophus::SE3f Tracking::GrabImageMonocular(const cv::Mat& im,
-                                          const double&  timestamp,
-                                          string         filename)
+void Tracking::ConvertToGray(const cv::Mat& im, cv::Mat& imGray) const
 {
-    mImGray = im;
-    if (mImGray.channels() == 3)
+    imGray = im;
+    if (imGray.channels() == 3)
     {
         if (mbRGB)
-            cvtColor(mImGray, mImGray, cv::COLOR_RGB2GRAY);
+            cvtColor(imGray, imGray, cv::COLOR_RGB2GRAY);
         else
-            cvtColor(mImGray, mImGray, cv::COLOR_BGR2GRAY);
+            cvtColor(imGray, imGray, cv::COLOR_BGR2GRAY);
     }
-    else if (mImGray.channels() == 4)
+    else if (imGray.channels() == 4)
     {
         if (mbRGB)
-            cvtColor(mImGray, mImGray, cv::COLOR_RGBA2GRAY);
+            cvtColor(imGray, imGray, cv::COLOR_RGBA2GRAY);
         else
-            cvtColor(mImGray, mImGray, cv::COLOR_BGRA2GRAY);
+            cvtColor(imGray, imGray, cv::COLOR_BGRA2GRAY);
     }
+}
+
+
+bool Tracking::UseInitialExtractor() const
+{
+    if (mState == NOT_INITIALIZED || mState == NO_IMAGES_YET) return true;
+
+    return mSensor == System::MONOCULAR && (lastID - initID) < mMaxFrames;
+}
+
 
-    if (mSensor == System::MONOCULAR)
+void Tracking::BuildFrameStereo(Frame&         frame,
+                                const cv::Mat& imLeft,
+                                const cv::Mat& imRight,
+                                const double&  timestamp,
+                                Frame*         pPrevF,
+                                const cv::Mat& mask)
+{
+    const IMU::Calib calib =
+        mSensor == System::IMU_STEREO ? *mpImuCalib : IMU::Calib();
+
+    if (!mpCamera2)
+    {
+        frame.reset(imLeft,
+                    imRight,
+                    timestamp,
+                    mpORBextractorLeft,
+                    mpORBextractorRight,
+                    mpORBVocabulary,
+                    mK,
+                    mDistCoef,
+                    mbf,
+                    mThDepth,
+                    mpCamera,
+                    pPrevF,
+                    calib,
+                    mask);
+    }
+    else
     {
-        if (mState == NOT_INITIALIZED || mState == NO_IMAGES_YET ||
-            (lastID - initID) < mMaxFrames)
-        {
-            // mCurrentFrame = Frame(mImGray, timestamp, mpIniORBextractor,
-            // mpORBVocabulary, mpCamera, mDistCoef, mbf, mThDepth);
-            mCurrentFrame.reset(mImGray,
-                                timestamp,
-                                mpIniORBextractor,
-                                mpORBVocabulary,
-                                mpCamera,
-                                mDistCoef,
-                                mbf,
-                                mThDepth);
-        }
-        else
-        {
-            // mCurrentFrame = Frame(mImGray, timestamp, mpORBextractorLeft,
-            // mpORBVocabulary, mpCamera, mDistCoef, mbf, mThDepth);
-            mCurrentFrame.reset(mImGray,
-                                timestamp,
-                                mpORBextractorLeft,
-                                mpORBVocabulary,
-                                mpCamera,
-                                mDistCoef,
-                                mbf,
-                                mThDepth);
-        }
-    }
-    else if (mSensor == System::IMU_MONOCULAR)
-    {
-        if (mState == NOT_INITIALIZED || mState == NO_IMAGES_YET)
-        {
-            // mCurrentFrame = Frame(mImGray, timestamp, mpIniORBextractor,
-            // mpORBVocabulary, mpCamera, mDistCoef, mbf, mThDepth, &mLastFrame,
-            // *mpImuCalib);
-            mCurrentFrame.reset(mImGray,
-                                timestamp,
-                                mpIniORBextractor,
-                                mpORBVocabulary,
-                                mpCamera,
-                                mDistCoef,
-                                mbf,
-                                mThDepth,
-                                &mLastFrame,
-                                *mpImuCalib);
-        }
-        else
-        {
-            // mCurrentFrame = Frame(mImGray, timestamp, mpORBextractorLeft,
-            // mpORBVocabulary, mpCamera, mDistCoef, mbf, mThDepth, &mLastFrame,
-            // *mpImuCalib);
-            mCurrentFrame.reset(mImGray,
-                                timestamp,
-                                mpORBextractorLeft,
-                                mpORBVocabulary,
-                                mpCamera,
-                                mDistCoef,
-                                mbf,
-                                mThDepth,
-                                &mLastFrame,
-                                *mpImuCalib);
-        }
+        // No detection mask for the fisheye pair
+        frame.reset(imLeft,
+                    imRight,
+                    timestamp,
+                    mpORBextractorLeft,
+                    mpORBextractorRight,
+                    mpORBVocabulary,
+                    mK,
+                    mDistCoef,
+                    mbf,
+                    mThDepth,
+                    mpCamera,
+                    mpCamera2,
+                    mTlr,
+                    pPrevF,
+                    calib);
     }
+}
 
-    if (mState == NO_IMAGES_YET) t0 = timestamp;
 
-    mCurrentFrame.mNameFile = filename;
-    mCurrentFrame.mnDataset = mnNumDataset;
+void Tracking::BuildFrameRGBD(Frame&         frame,
+                              const cv::Mat& imGray,
+                              const cv::Mat& imDepth,
+                              const double&  timestamp,
+                              Frame*         pPrevF,
+                              const cv::Mat& mask)
+{
+    const IMU::Calib calib =
+        mSensor == System::IMU_RGBD ? *mpImuCalib : IMU::Calib();
+
+    frame.reset(imGray,
+                imDepth,
+                timestamp,
+                mpORBextractorLeft,
+                mpORBVocabulary,
+                mK,
+                mDistCoef,
+                mbf,
+                mThDepth,
+                mpCamera,
+                pPrevF,
+                calib,
+                mask);
+}
 
-    lastID = mCurrentFrame.mnId;
-    Track();
 
-    return mCurrentFrame.GetPose();
+void Tracking::BuildFrameMonocular(Frame&         frame,
+                                   const cv::Mat& imGray,
+                                   const double&  timestamp,
+                                   bool           bInitial,
+                                   Frame*         pPrevF,
+                                   const cv::Mat& mask)
+{
+    const IMU::Calib calib =
+        mSensor == System::IMU_MONOCULAR ? *mpImuCalib : IMU::Calib();
+
+    frame.reset(imGray,
+                timestamp,
+                bInitial ? mpIniORBextractor : mpORBextractorLeft,
+                mpORBVocabulary,
+                mpCamera,
+                mDistCoef,
+                mbf,
+                mThDepth,
+                pPrevF,
+                calib,
+                mask);
 }
 
 
@@ -1489,10 +1581,10 @@ void Tracking::GrabImuData(const IMU::Point& imuMeasurement)
 
 void Tracking::PreintegrateIMU()
 {
-    if (!mCurrentFrame.mpPrevFrame)
+    if (!mpCurrentFrame->mpPrevFrame)
     {
         Verbose::PrintMess("non prev frame ", Verbose::VERBOSITY_NORMAL);
-        mCurrentFrame.setIntegrated();
+        mpCurrentFrame->setIntegrated();
         return;
     }
 
@@ -1502,7 +1594,7 @@ void Tracking::PreintegrateIMU()
     {
         Verbose::PrintMess("Not IMU data in mlQueueImuData!!",
                            Verbose::VERBOSITY_NORMAL);
-        mCurrentFrame.setIntegrated();
+        mpCurrentFrame->setIntegrated();
         return;
     }
 
@@ -1515,11 +1607,11 @@ void Tracking::PreintegrateIMU()
             {
                 IMU::Point* m = &mlQueueImuData.front();
                 cout.precision(17);
-                if (m->t < mCurrentFrame.mpPrevFrame->mTimeStamp - mImuPer)
+                if (m->t < mpCurrentFrame->mpPrevFrame->mTimeStamp - mImuPer)
                 {
                     mlQueueImuData.pop_front();
                 }
-                else if (m->t < mCurrentFrame.mTimeStamp - mImuPer)
+                else if (m->t < mpCurrentFrame->mTimeStamp - mImuPer)
                 {
                     mvImuFromLastFrame.push_back(*m);
                     mlQueueImuData.pop_front();
@@ -1551,7 +1643,8 @@ void Tracking::PreintegrateIMU()
     }
 
     IMU::Preintegrated* pImuPreintegratedFromLastFrame =
-        new IMU::Preintegrated(mLastFrame.mImuBias, mCurrentFrame.mImuCalib);
+        new IMU::Preintegrated(mpLastFrame->mImuBias,
+                               mpCurrentFrame->mImuCalib);
 
     for (int i = 0; i < n; i++)
     {
@@ -1560,8 +1653,8 @@ void Tracking::PreintegrateIMU()
         if ((i == 0) && (i < (n - 1)))
         {
             float tab = mvImuFromLastFrame[i + 1].t - mvImuFromLastFrame[i].t;
-            float tini =
-                mvImuFromLastFrame[i].t - mCurrentFrame.mpPrevFrame->mTimeStamp;
+            float tini = mvImuFromLastFrame[i].t -
+                         mpCurrentFrame->mpPrevFrame->mTimeStamp;
             acc = (mvImuFromLastFrame[i].a + mvImuFromLastFrame[i + 1].a -
                    (mvImuFromLastFrame[i + 1].a - mvImuFromLastFrame[i].a) *
                        (tini / tab)) *
@@ -1571,7 +1664,7 @@ void Tracking::PreintegrateIMU()
                           (tini / tab)) *
                      0.5f;
             tstep = mvImuFromLastFrame[i + 1].t -
-                    mCurrentFrame.mpPrevFrame->mTimeStamp;
+                    mpCurrentFrame->mpPrevFrame->mTimeStamp;
         }
         else if (i < (n - 1))
         {
@@ -1584,7 +1677,8 @@ void Tracking::PreintegrateIMU()
         else if ((i > 0) && (i == (n - 1)))
         {
             float tab  = mvImuFromLastFrame[i + 1].t - mvImuFromLastFrame[i].t;
-            float tend = mvImuFromLastFrame[i + 1].t - mCurrentFrame.mTimeStamp;
+            float tend =
+                mvImuFromLastFrame[i + 1].t - mpCurrentFrame->mTimeStamp;
             acc = (mvImuFromLastFrame[i].a + mvImuFromLastFrame[i + 1].a -
                    (mvImuFromLastFrame[i + 1].a - mvImuFromLastFrame[i].a) *
                        (tend / tab)) *
@@ -1593,14 +1687,14 @@ void Tracking::PreintegrateIMU()
                       (mvImuFromLastFrame[i + 1].w - mvImuFromLastFrame[i].w) *
                           (tend / tab)) *
                      0.5f;
-            tstep = mCurrentFrame.mTimeStamp - mvImuFromLastFrame[i].t;
+            tstep = mpCurrentFrame->mTimeStamp - mvImuFromLastFrame[i].t;
         }
         else if ((i == 0) && (i == (n - 1)))
         {
             acc    = mvImuFromLastFrame[i].a;
             angVel = mvImuFromLastFrame[i].w;
-            tstep  = mCurrentFrame.mTimeStamp -
-                    mCurrentFrame.mpPrevFrame->mTimeStamp;
+            tstep  = mpCurrentFrame->mTimeStamp -
+                    mpCurrentFrame->mpPrevFrame->mTimeStamp;
         }
 
         if (!mpImuPreintegratedFromLastKF)
@@ -1613,11 +1707,11 @@ void Tracking::PreintegrateIMU()
                                                                 tstep);
     }
 
-    mCurrentFrame.mpImuPreintegratedFrame = pImuPreintegratedFromLastFrame;
-    mCurrentFrame.mpImuPreintegrated      = mpImuPreintegratedFromLastKF;
-    mCurrentFrame.mpLastKeyFrame          = mpLastKeyFrame;
+    mpCurrentFrame->mpImuPreintegratedFrame = pImuPreintegratedFromLastFrame;
+    mpCurrentFrame->mpImuPreintegrated      = mpImuPreintegratedFromLastKF;
+    mpCurrentFrame->mpLastKeyFrame          = mpLastKeyFrame;
 
-    mCurrentFrame.setIntegrated();
+    mpCurrentFrame->setIntegrated();
 
     // Verbose::PrintMess("Preintegration is finished!! ",
     // Verbose::VERBOSITY_DEBUG);
@@ -1626,7 +1720,7 @@ void Tracking::PreintegrateIMU()
 
 bool Tracking::PredictStateIMU()
 {
-    if (!mCurrentFrame.mpPrevFrame)
+    if (!mpCurrentFrame->mpPrevFrame)
     {
         Verbose::PrintMess("No last frame", Verbose::VERBOSITY_NORMAL);
         return false;
@@ -1652,36 +1746,36 @@ bool Tracking::PredictStateIMU()
             Vwb1 + t12 * Gz +
             Rwb1 * mpImuPreintegratedFromLastKF->GetDeltaVelocity(
                        mpLastKeyFrame->GetImuBias());
-        mCurrentFrame.SetImuPoseVelocity(Rwb2, twb2, Vwb2);
+        mpCurrentFrame->SetImuPoseVelocity(Rwb2, twb2, Vwb2);
 
-        mCurrentFrame.mImuBias  = mpLastKeyFrame->GetImuBias();
-        mCurrentFrame.mPredBias = mCurrentFrame.mImuBias;
+        mpCurrentFrame->mImuBias  = mpLastKeyFrame->GetImuBias();
+        mpCurrentFrame->mPredBias = mpCurrentFrame->mImuBias;
         return true;
     }
     else if (!mbMapUpdated)
     {
-        const Eigen::Vector3f twb1 = mLastFrame.GetImuPosition();
-        const Eigen::Matrix3f Rwb1 = mLastFrame.GetImuRotation();
-        const Eigen::Vector3f Vwb1 = mLastFrame.GetVelocity();
+        const Eigen::Vector3f twb1 = mpLastFrame->GetImuPosition();
+        const Eigen::Matrix3f Rwb1 = mpLastFrame->GetImuRotation();
+        const Eigen::Vector3f Vwb1 = mpLastFrame->GetVelocity();
         const Eigen::Vector3f Gz(0, 0, -IMU::GRAVITY_VALUE);
-        const float           t12 = mCurrentFrame.mpImuPreintegratedFrame->dT;
+        const float           t12 = mpCurrentFrame->mpImuPreintegratedFrame->dT;
 
         Eigen::Matrix3f Rwb2 = IMU::NormalizeRotation(
-            Rwb1 * mCurrentFrame.mpImuPreintegratedFrame->GetDeltaRotation(
-                       mLastFrame.mImuBias));
+            Rwb1 * mpCurrentFrame->mpImuPreintegratedFrame->GetDeltaRotation(
+                       mpLastFrame->mImuBias));
         Eigen::Vector3f twb2 =
             twb1 + Vwb1 * t12 + 0.5f * t12 * t12 * Gz +
-            Rwb1 * mCurrentFrame.mpImuPreintegratedFrame->GetDeltaPosition(
-                       mLastFrame.mImuBias);
+            Rwb1 * mpCurrentFrame->mpImuPreintegratedFrame->GetDeltaPosition(
+                       mpLastFrame->mImuBias);
         Eigen::Vector3f Vwb2 =
             Vwb1 + t12 * Gz +
-            Rwb1 * mCurrentFrame.mpImuPreintegratedFrame->GetDeltaVelocity(
-                       mLastFrame.mImuBias);
+            Rwb1 * mpCurrentFrame->mpImuPreintegratedFrame->GetDeltaVelocity(
+                       mpLastFrame->mImuBias);
 
-        mCurrentFrame.SetImuPoseVelocity(Rwb2, twb2, Vwb2);
+        mpCurrentFrame->SetImuPoseVelocity(Rwb2, twb2, Vwb2);
 
-        mCurrentFrame.mImuBias  = mLastFrame.mImuBias;
-        mCurrentFrame.mPredBias = mCurrentFrame.mImuBias;
+        mpCurrentFrame->mImuBias  = mpLastFrame->mImuBias;
+        mpCurrentFrame->mPredBias = mpCurrentFrame->mImuBias;
         return true;
     }
     else
@@ -1696,6 +1790,313 @@ void Tracking::ResetFrameIMU()
 }
 
 
+cv::Mat Tracking::ComputeDetectionMask()
+{
+    // Only while tracking is healthy and the motion model can predict where
+    // the tracked points will be seen
+    if (!mbIncrementalORB || (mState != OK && mState != OK_KLT) ||
+        !mbVelocity || mnMatchesInliers < 50 || mImGray.empty())
+        return cv::Mat();
+
+    const int BLOCK_SIZE = 64;
+    // Prediction error allowed around the tracked points
+    const int R = 8;
+
+    const int cols       = mImGray.cols;
+    const int rows       = mImGray.rows;
+    const int nBlockCols = (cols + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const int nBlockRows = (rows + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    // Share of the feature budget of a block
+    const int nShare =
+        ceil(static_cast<float>(mpORBextractorLeft->GetNumFeatures()) *
+             BLOCK_SIZE * BLOCK_SIZE / (cols * rows));
+
+    const Sophus::SE3f Tcw = mVelocity * mpLastFrame->GetPose();
+
+    // mImGray is not undistorted. The pinhole projection is distorted with
+    // mDistCoef, as in Frame::ProjectPointDistort (fisheye models already
+    // project to the raw image and have no coefficients here).
+    const bool bDistort = !mDistCoef.empty() && cv::countNonZero(mDistCoef);
+    float      k1 = 0.f, k2 = 0.f, p1 = 0.f, p2 = 0.f, k3 = 0.f;
+    if (bDistort)
+    {
+        k1 = mDistCoef.at<float>(0);
+        k2 = mDistCoef.at<float>(1);
+        p1 = mDistCoef.at<float>(2);
+        p2 = mDistCoef.at<float>(3);
+        if (mDistCoef.total() == 5) k3 = mDistCoef.at<float>(4);
+    }
+
+    mvBlockTracked.assign(nBlockCols * nBlockRows, 0);
+    mvTrackedProjections.clear();
+    for (int i = 0; i < mpLastFrame->N; i++)
+    {
+        MapPoint* pMP = mpLastFrame->mvpMapPoints[i];
+        if (!pMP || mpLastFrame->mvbOutlier[i] || pMP->isBad()) continue;
+
+        const Eigen::Vector3f x3Dc = Tcw * pMP->GetWorldPos();
+        if (x3Dc(2) <= 0.f) continue;
+
+        Eigen::Vector2f uv = mpCamera->project(x3Dc);
+        if (bDistort)
+        {
+            // Out of the undistorted image the polynomial can bring points
+            // back inside
+            if (uv(0) < Frame::mnMinX || uv(0) > Frame::mnMaxX ||
+                uv(1) < Frame::mnMinY || uv(1) > Frame::mnMaxY)
+                continue;
+
+            const float x  = x3Dc(0) / x3Dc(2);
+            const float y  = x3Dc(1) / x3Dc(2);
+            const float r2 = x * x + y * y;
+            const float radial =
+                1.f + k1 * r2 + k2 * r2 * r2 + k3 * r2 * r2 * r2;
+            const float xd =
+                x * radial + 2.f * p1 * x * y + p2 * (r2 + 2.f * x * x);
+            const float yd =
+                y * radial + p1 * (r2 + 2.f * y * y) + 2.f * p2 * x * y;
+            uv(0) = mK_(0, 0) * xd + mK_(0, 2);
+            uv(1) = mK_(1, 1) * yd + mK_(1, 2);
+        }
+        if (uv(0) < 0.f || uv(1) < 0.f || uv(0) >= cols || uv(1) >= rows)
+            continue;
+
+        mvTrackedProjections.push_back(cv::Point2f(uv(0), uv(1)));
+        mvBlockTracked[int(uv(1)) / BLOCK_SIZE * nBlockCols +
+                       int(uv(0)) / BLOCK_SIZE]++;
+    }
+
+    mDetectionMask.create(rows, cols, CV_8U);
+    mDetectionMask.setTo(255);
+
+    int nCovered = 0;
+    for (int i = 0; i < nBlockRows; i++)
+    {
+        for (int j = 0; j < nBlockCols; j++)
+        {
+            if (mvBlockTracked[i * nBlockCols + j] < nShare) continue;
+
+            const cv::Rect block(j * BLOCK_SIZE,
+                                 i * BLOCK_SIZE,
+                                 BLOCK_SIZE,
+                                 BLOCK_SIZE);
+            mDetectionMask(block & cv::Rect(0, 0, cols, rows)).setTo(0);
+            nCovered++;
+        }
+    }
+
+    if (nCovered == 0) return cv::Mat();
+
+    // Keep the tracked points detectable, the rest of the budget goes to the
+    // blocks where new map points are needed
+    for (const cv::Point2f& uv : mvTrackedProjections)
+    {
+        const int block = int(uv.y) / BLOCK_SIZE * nBlockCols +
+                          int(uv.x) / BLOCK_SIZE;
+        if (mvBlockTracked[block] < nShare) continue;
+
+        const cv::Rect window(int(uv.x) - R,
+                              int(uv.y) - R,
+                              2 * R + 1,
+                              2 * R + 1);
+        mDetectionMask(window & cv::Rect(0, 0, cols, rows)).setTo(255);
+    }
+
+    return mDetectionMask;
+}
+
+Frame* Tracking::NextFrameSlot()
+{
+    return (mpLastFrame == mFrameSlots) ? mFrameSlots + 1 : mFrameSlots;
+}
+
+bool Tracking::TrackWithOpticalFlow(const cv::Mat& imDepth,
+                                    const double&  timestamp)
+{
+    // Only for visual SLAM while tracking is healthy. The extractor must
+    // still hold the pyramid of the last frame.
+    if (!mbOpticalFlow || mbOnlyTracking || mbForceExtraction ||
+        (mSensor != System::MONOCULAR && mSensor != System::RGBD) ||
+        (mState != OK && mState != OK_KLT) || !mbVelocity ||
+        mpLastFrame->mpORBextractorLeft != mpORBextractorLeft ||
+        mpLastFrame->mnId + 1 != Frame::nNextId || mImGray.empty())
+        return false;
+
+    // A keyframe is due or the last relocalisation is recent
+    if (Frame::nNextId >= mnLastKeyFrameId + mMaxFrames ||
+        Frame::nNextId < mnLastRelocFrameId + mMaxFrames)
+        return false;
+
+    Map* pCurrentMap = mpAtlas->GetCurrentMap();
+    if (!pCurrentMap) return false;
+
+    unique_lock<mutex> lock(pCurrentMap->mMutexMapUpdate);
+
+    CheckReplacedInLastFrame();
+
+    // Motion model prediction, also used as initial flow
+    const Sophus::SE3f Tcw  = mVelocity * mpLastFrame->GetPose();
+    const float        maxX = mImGray.cols - 1;
+    const float        maxY = mImGray.rows - 1;
+
+    mvFlowIndices.clear();
+    mvFlowPrevPts.clear();
+    mvFlowPts.clear();
+    for (int i = 0; i < mpLastFrame->N; i++)
+    {
+        MapPoint* pMP = mpLastFrame->mvpMapPoints[i];
+        if (!pMP || mpLastFrame->mvbOutlier[i] || pMP->isBad()) continue;
+
+        const cv::Point2f& pt   = mpLastFrame->mvKeys[i].pt;
+        cv::Point2f        pred = pt;
+
+        const Eigen::Vector3f x3Dc = Tcw * pMP->GetWorldPos();
+        if (x3Dc(2) > 0)
+        {
+            // Predicted displacement applied to the distorted keypoint
+            const Eigen::Vector2f uv   = mpCamera->project(x3Dc);
+            const cv::Point2f&    ptUn = mpLastFrame->mvKeysUn[i].pt;
+            pred.x += uv(0) - ptUn.x;
+            pred.y += uv(1) - ptUn.y;
+            if (pred.x < 0 || pred.y < 0 || pred.x > maxX || pred.y > maxY)
+                pred = pt;
+        }
+
+        mvFlowIndices.push_back(i);
+        mvFlowPrevPts.push_back(pt);
+        mvFlowPts.push_back(pred);
+    }
+
+    const int nPoints = (int)mvFlowIndices.size();
+    if (nPoints < 50) return false;
+
+    // The pyramid of the last frame becomes the previous one
+    ORBextractor* pExtractor = mpORBextractorLeft;
+    pExtractor->ComputePyramid(mImGray);
+
+    const vector<cv::Mat>& vPrevPyramid = pExtractor->mvPrevImagePyramid;
+    const vector<cv::Mat>& vPyramid     = pExtractor->mvImagePyramid;
+    const vector<float>&   vScale       = mpLastFrame->mvScaleFactors;
+
+    // Coarse to fine on the ORB levels closest to one octave apart, up to
+    // three octaves. Each level refines the flow of the coarser one.
+    const int nLevels = pExtractor->GetLevels();
+    const int step    = std::max(
+        1,
+        cvRound(std::log(2.0) / std::log(pExtractor->GetScaleFactor())));
+    const int topLevel = std::min((nLevels - 1) / step, 3) * step;
+
+    const cv::TermCriteria criteria(
+        cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+        30,
+        0.01);
+
+    mvFlowLevelPrevPts.resize(nPoints);
+    mvFlowLevelPts.resize(nPoints);
+    for (int level = topLevel; level >= 0; level -= step)
+    {
+        const float scale    = vScale[level];
+        const float invScale = 1.0f / scale;
+        for (int k = 0; k < nPoints; k++)
+        {
+            mvFlowLevelPrevPts[k] = mvFlowPrevPts[k] * invScale;
+            mvFlowLevelPts[k]     = mvFlowPts[k] * invScale;
+        }
+
+        cv::calcOpticalFlowPyrLK(vPrevPyramid[level],
+                                 vPyramid[level],
+                                 mvFlowLevelPrevPts,
+                                 mvFlowLevelPts,
+                                 mvFlowStatus,
+                                 mvFlowErr,
+                                 cv::Size(21, 21),
+                                 0,
+                                 criteria,
+                                 cv::OPTFLOW_USE_INITIAL_FLOW);
+
+        for (int k = 0; k < nPoints; k++)
+            if (mvFlowStatus[k]) mvFlowPts[k] = mvFlowLevelPts[k] * scale;
+    }
+
+    // Keep the points tracked at the finest level
+    int nTracked = 0;
+    for (int k = 0; k < nPoints; k++)
+    {
+        const cv::Point2f& pt = mvFlowPts[k];
+        if (!mvFlowStatus[k] || pt.x < 0 || pt.y < 0 || pt.x > maxX ||
+            pt.y > maxY)
+            continue;
+
+        mvFlowIndices[nTracked] = mvFlowIndices[k];
+        mvFlowPts[nTracked]     = pt;
+        nTracked++;
+    }
+    mvFlowIndices.resize(nTracked);
+    mvFlowPts.resize(nTracked);
+
+    if (nTracked < 50) return false;
+
+    mpCurrentFrame->reset(*mpLastFrame,
+                          timestamp,
+                          mvFlowIndices,
+                          mvFlowPts,
+                          imDepth);
+    mpCurrentFrame->SetPose(Tcw);
+
+    Optimizer::PoseOptimization(mpCurrentFrame);
+
+    // Discard outliers. Map points are only flagged once the frame is kept,
+    // a failed attempt must not change what SearchLocalPoints sees.
+    int nInliers = 0;
+    mvpFlowOutliers.clear();
+    for (int i = 0; i < mpCurrentFrame->N; i++)
+    {
+        MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
+        if (!pMP) continue;
+
+        if (mpCurrentFrame->mvbOutlier[i])
+        {
+            mpCurrentFrame->mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
+            mpCurrentFrame->mvbOutlier[i]   = false;
+            mvpFlowOutliers.push_back(pMP);
+        }
+        else if (pMP->Observations() > 0)
+            nInliers++;
+    }
+
+    // Same bound as TrackLocalMap, the frame is extracted otherwise
+    if (nInliers < 30) return false;
+
+    // The frame is kept, it takes its id now
+    mpCurrentFrame->mnId = Frame::nNextId++;
+
+    for (MapPoint* pMP : mvpFlowOutliers)
+    {
+        pMP->mbTrackInView   = false;
+        pMP->mnLastFrameSeen = mpCurrentFrame->mnId;
+    }
+
+    // Update MapPoints Statistics
+    for (int i = 0; i < mpCurrentFrame->N; i++)
+    {
+        MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
+        if (pMP)
+        {
+            pMP->IncreaseVisible();
+            pMP->IncreaseFound();
+        }
+    }
+    mnMatchesInliers = nInliers;
+
+    // Tracks are lost over time and never replaced, extract again once too
+    // many of the inliers of the last extracted frame are gone
+    if (nInliers < 0.7f * mnFlowRefInliers) mbForceExtraction = true;
+
+    mbFlowFrame = true;
+    return true;
+}
+
 void Tracking::Track()
 {
     if (mpLocalMapper->mbBadImu)
@@ -1714,7 +2115,7 @@ void Tracking::Track()
 
     if (mState != NO_IMAGES_YET)
     {
-        if (mLastFrame.mTimeStamp > mCurrentFrame.mTimeStamp)
+        if (mpLastFrame->mTimeStamp > mpCurrentFrame->mTimeStamp)
         {
             cerr << "ERROR: Frame with a timestamp older than previous frame "
                     "detected!"
@@ -1724,7 +2125,7 @@ void Tracking::Track()
             CreateMapInAtlas();
             return;
         }
-        else if (mCurrentFrame.mTimeStamp > mLastFrame.mTimeStamp + 1.0)
+        else if (mpCurrentFrame->mTimeStamp > mpLastFrame->mTimeStamp + 1.0)
         {
             // cout << mCurrentFrame.mTimeStamp << ", " << mLastFrame.mTimeStamp
             // << endl; cout << "id last: " << mLastFrame.mnId << "    id curr:
@@ -1762,7 +2163,7 @@ void Tracking::Track()
          mSensor == System::IMU_RGBD) &&
         mpLastKeyFrame)
     {
-        mCurrentFrame.SetNewBias(mpLastKeyFrame->GetImuBias());
+        mpCurrentFrame->SetNewBias(mpLastKeyFrame->GetImuBias());
     }
 
     if (mState == NO_IMAGES_YET)
@@ -1808,13 +2209,13 @@ void Tracking::Track()
 
         if (mState != OK)  // If rightly initialized, mState=OK
         {
-            mLastFrame.copyFrom(mCurrentFrame);
+            mpLastFrame = mpCurrentFrame;
             return;
         }
 
         if (mpAtlas->GetAllMaps().size() == 1)
         {
-            mnFirstFrameId = mCurrentFrame.mnId;
+            mnFirstFrameId = mpCurrentFrame->mnId;
         }
     }
     else
@@ -1829,14 +2230,19 @@ void Tracking::Track()
             // State OK
             // Local Mapping is activated. This is the normal behaviour, unless
             // you explicitly activate the "only tracking" mode.
-            if (mState == OK)
+            if (mState == OK || mState == OK_KLT)
             {
                 // Local Mapping might have changed some MapPoints tracked in
                 // last frame
                 CheckReplacedInLastFrame();
 
-                if ((!mbVelocity && !pCurrentMap->isImuInitialized()) ||
-                    mCurrentFrame.mnId < mnLastRelocFrameId + 2)
+                if (mbFlowFrame)
+                {
+                    // Pose already optimized on the optical flow tracks
+                    bOK = true;
+                }
+                else if ((!mbVelocity && !pCurrentMap->isImuInitialized()) ||
+                         mpCurrentFrame->mnId < mnLastRelocFrameId + 2)
                 {
                     Verbose::PrintMess(
                         "TRACK: Track with respect to the reference KF ",
@@ -1859,7 +2265,7 @@ void Tracking::Track()
 
                 if (!bOK)
                 {
-                    if ((mCurrentFrame.mnId <=
+                    if ((mpCurrentFrame->mnId <=
                          (mnLastRelocFrameId + mnFramesToResetIMU)) &&
                         (mSensor == System::IMU_MONOCULAR ||
                          mSensor == System::IMU_STEREO ||
@@ -1870,7 +2276,7 @@ void Tracking::Track()
                     else if (pCurrentMap->KeyFramesInMap() > 10)
                     {
                         mState         = RECENTLY_LOST;
-                        mTimeStampLost = mCurrentFrame.mTimeStamp;
+                        mTimeStampLost = mpCurrentFrame->mTimeStamp;
                     }
                     else
                     {
@@ -1899,7 +2305,7 @@ void Tracking::Track()
                             bOK = false;
                         }
 
-                        if (mCurrentFrame.mTimeStamp - mTimeStampLost >
+                        if (mpCurrentFrame->mTimeStamp - mTimeStampLost >
                             time_recently_lost)
                         {
                             mState = LOST;
@@ -1916,7 +2322,8 @@ void Tracking::Track()
                         // to_string(mCurrentFrame.mTimeStamp) << std::endl;
                         // std::cout << "mTimeStampLost:" <<
                         // to_string(mTimeStampLost) << std::endl;
-                        if (mCurrentFrame.mTimeStamp - mTimeStampLost > 3.0f &&
+                        if (mpCurrentFrame->mTimeStamp - mTimeStampLost >
+                                3.0f &&
                             !bOK)
                         {
                             mState = LOST;
@@ -1993,26 +2400,26 @@ void Tracking::Track()
                     if (mbVelocity)
                     {
                         bOKMM   = TrackWithMotionModel();
-                        vpMPsMM = mCurrentFrame.mvpMapPoints;
-                        vbOutMM = mCurrentFrame.mvbOutlier;
-                        TcwMM   = mCurrentFrame.GetPose();
+                        vpMPsMM = mpCurrentFrame->mvpMapPoints;
+                        vbOutMM = mpCurrentFrame->mvbOutlier;
+                        TcwMM   = mpCurrentFrame->GetPose();
                     }
                     bOKReloc = Relocalization();
 
                     if (bOKMM && !bOKReloc)
                     {
-                        mCurrentFrame.SetPose(TcwMM);
-                        mCurrentFrame.mvpMapPoints = vpMPsMM;
-                        mCurrentFrame.mvbOutlier   = vbOutMM;
+                        mpCurrentFrame->SetPose(TcwMM);
+                        mpCurrentFrame->mvpMapPoints = vpMPsMM;
+                        mpCurrentFrame->mvbOutlier   = vbOutMM;
 
                         if (mbVO)
                         {
-                            for (int i = 0; i < mCurrentFrame.N; i++)
+                            for (int i = 0; i < mpCurrentFrame->N; i++)
                             {
-                                if (mCurrentFrame.mvpMapPoints[i] &&
-                                    !mCurrentFrame.mvbOutlier[i])
+                                if (mpCurrentFrame->mvpMapPoints[i] &&
+                                    !mpCurrentFrame->mvbOutlier[i])
                                 {
-                                    mCurrentFrame.mvpMapPoints[i]
+                                    mpCurrentFrame->mvpMapPoints[i]
                                         ->IncreaseFound();
                                 }
                             }
@@ -2028,8 +2435,8 @@ void Tracking::Track()
             }
         }
 
-        if (!mCurrentFrame.mpReferenceKF)
-            mCurrentFrame.mpReferenceKF = mpReferenceKF;
+        if (!mpCurrentFrame->mpReferenceKF)
+            mpCurrentFrame->mpReferenceKF = mpReferenceKF;
 
 #ifdef REGISTER_TIMES
         std::chrono::steady_clock::time_point time_EndPosePred =
@@ -2051,7 +2458,9 @@ void Tracking::Track()
         // Track the local map.
         if (!mbOnlyTracking)
         {
-            if (bOK)
+            // Frames tracked with optical flow have no new features to match
+            // to the local map
+            if (bOK && !mbFlowFrame)
             {
                 bOK = TrackLocalMap();
             }
@@ -2066,9 +2475,17 @@ void Tracking::Track()
             if (bOK && !mbVO) bOK = TrackLocalMap();
         }
 
-        if (bOK)
+        if (bOK && mbFlowFrame)
+            mState = OK_KLT;
+        else if (bOK)
+        {
             mState = OK;
-        else if (mState == OK)
+
+            // Reference for the optical flow tracking of the next frames
+            mnFlowRefInliers  = mnMatchesInliers;
+            mbForceExtraction = false;
+        }
+        else if (mState == OK || mState == OK_KLT)
         {
             if (mSensor == System::IMU_MONOCULAR ||
                 mSensor == System::IMU_STEREO || mSensor == System::IMU_RGBD)
@@ -2089,17 +2506,18 @@ void Tracking::Track()
             else
                 mState = RECENTLY_LOST;  // visual to lost
 
-            /*if(mCurrentFrame.mnId>mnLastRelocFrameId+mMaxFrames)
+            /*if(mpCurrentFrame->mnId>mnLastRelocFrameId+mMaxFrames)
             {*/
-            mTimeStampLost = mCurrentFrame.mTimeStamp;
+            mTimeStampLost = mpCurrentFrame->mTimeStamp;
             //}
         }
 
         // Save frame if recent relocalization, since they are used for IMU
         // reset (as we are making copy, it shluld be once mCurrFrame is
         // completely modified)
-        if ((mCurrentFrame.mnId < (mnLastRelocFrameId + mnFramesToResetIMU)) &&
-            (mCurrentFrame.mnId > mnFramesToResetIMU) &&
+        if ((mpCurrentFrame->mnId <
+             (mnLastRelocFrameId + mnFramesToResetIMU)) &&
+            (mpCurrentFrame->mnId > mnFramesToResetIMU) &&
             (mSensor == System::IMU_MONOCULAR ||
              mSensor == System::IMU_STEREO || mSensor == System::IMU_RGBD) &&
             pCurrentMap->isImuInitialized())
@@ -2108,27 +2526,27 @@ void Tracking::Track()
             Verbose::PrintMess("Saving pointer to frame. imu needs reset...",
                                Verbose::VERBOSITY_NORMAL);
             auto pF = new Frame;
-            pF->copyFrom(mCurrentFrame);
+            pF->copyFrom(*mpCurrentFrame);
             pF->mpPrevFrame = new Frame;
-            pF->mpPrevFrame->copyFrom(mLastFrame);
+            pF->mpPrevFrame->copyFrom(*mpLastFrame);
 
             // Load preintegration
             pF->mpImuPreintegratedFrame =
-                new IMU::Preintegrated(mCurrentFrame.mpImuPreintegratedFrame);
+                new IMU::Preintegrated(mpCurrentFrame->mpImuPreintegratedFrame);
         }
 
         if (pCurrentMap->isImuInitialized())
         {
             if (bOK)
             {
-                if (mCurrentFrame.mnId ==
+                if (mpCurrentFrame->mnId ==
                     (mnLastRelocFrameId + mnFramesToResetIMU))
                 {
                     cout << "RESETING FRAME!!!" << endl;
                     ResetFrameIMU();
                 }
-                else if (mCurrentFrame.mnId > (mnLastRelocFrameId + 30))
-                    mLastBias = mCurrentFrame.mImuBias;
+                else if (mpCurrentFrame->mnId > (mnLastRelocFrameId + 30))
+                    mLastBias = mpCurrentFrame->mImuBias;
             }
         }
 
@@ -2136,10 +2554,10 @@ void Tracking::Track()
         if (bOK || mState == RECENTLY_LOST)
         {
             // Update motion model
-            if (mLastFrame.isSet() && mCurrentFrame.isSet())
+            if (mpLastFrame->isSet() && mpCurrentFrame->isSet())
             {
-                Sophus::SE3f LastTwc = mLastFrame.GetPose().inverse();
-                mVelocity            = mCurrentFrame.GetPose() * LastTwc;
+                Sophus::SE3f LastTwc = mpLastFrame->GetPose().inverse();
+                mVelocity            = mpCurrentFrame->GetPose() * LastTwc;
                 mbVelocity           = true;
             }
             else
@@ -2148,14 +2566,14 @@ void Tracking::Track()
             }
 
             // Clean VO matches
-            for (int i = 0; i < mCurrentFrame.N; i++)
+            for (int i = 0; i < mpCurrentFrame->N; i++)
             {
-                MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
+                MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
                 if (pMP)
                     if (pMP->Observations() < 1)
                     {
-                        mCurrentFrame.mvbOutlier[i] = false;
-                        mCurrentFrame.mvpMapPoints[i] =
+                        mpCurrentFrame->mvbOutlier[i] = false;
+                        mpCurrentFrame->mvpMapPoints[i] =
                             static_cast<MapPoint*>(NULL);
                     }
             }
@@ -2173,6 +2591,13 @@ void Tracking::Track()
 
             bool bNeedKF = NeedNewKeyFrame();
 
+            // Keyframes need ORB features, extract the next frame instead
+            if (bNeedKF && mbFlowFrame)
+            {
+                mbForceExtraction = true;
+                bNeedKF           = false;
+            }
+
             // Check if we need to insert a new keyframe
             // if(bNeedKF && bOK)
             if ((bNeedKF) &&
@@ -2190,14 +2615,14 @@ void Tracking::Track()
             // don't want next frame to estimate its position with those points
             // so we discard them in the frame. Only has effect if lastframe is
             // tracked
-            for (int i = 0; i < mCurrentFrame.N; i++)
+            for (int i = 0; i < mpCurrentFrame->N; i++)
             {
-                if (mCurrentFrame.mvpMapPoints[i] &&
-                    mCurrentFrame.mvbOutlier[i])
+                if (mpCurrentFrame->mvpMapPoints[i] &&
+                    mpCurrentFrame->mvbOutlier[i])
                 {
                     // mCurrentFrame.mvpMapPoints[i] =
                     // static_cast<MapPoint*>(NULL);
-                    mCurrentFrame.mvpMapPoints[i] = nullptr;
+                    mpCurrentFrame->mvpMapPoints[i] = nullptr;
                 }
             }
         }
@@ -2226,26 +2651,26 @@ void Tracking::Track()
             return;
         }
 
-        if (!mCurrentFrame.mpReferenceKF)
+        if (!mpCurrentFrame->mpReferenceKF)
         {
-            mCurrentFrame.mpReferenceKF = mpReferenceKF;
+            mpCurrentFrame->mpReferenceKF = mpReferenceKF;
         }
 
-        mLastFrame.copyFrom(mCurrentFrame);
+        mpLastFrame = mpCurrentFrame;
     }
 
 
-    if (mState == OK || mState == RECENTLY_LOST)
+    if (mState == OK || mState == OK_KLT || mState == RECENTLY_LOST)
     {
         // Store frame pose information to retrieve the complete camera
         // trajectory afterwards.
-        if (mCurrentFrame.isSet())
+        if (mpCurrentFrame->isSet())
         {
-            Sophus::SE3f Tcr_ = mCurrentFrame.GetPose() *
-                                mCurrentFrame.mpReferenceKF->GetPoseInverse();
+            Sophus::SE3f Tcr_ = mpCurrentFrame->GetPose() *
+                                mpCurrentFrame->mpReferenceKF->GetPoseInverse();
             mlRelativeFramePoses.push_back(Tcr_);
-            mlpReferences.push_back(mCurrentFrame.mpReferenceKF);
-            mlFrameTimes.push_back(mCurrentFrame.mTimeStamp);
+            mlpReferences.push_back(mpCurrentFrame->mpReferenceKF);
+            mlFrameTimes.push_back(mpCurrentFrame->mTimeStamp);
             mlbLost.push_back(mState == LOST);
         }
         else
@@ -2273,19 +2698,19 @@ void Tracking::Track()
 
 void Tracking::StereoInitialization()
 {
-    if (mCurrentFrame.N > 500)
+    if (mpCurrentFrame->N > 500)
     {
         if (mSensor == System::IMU_STEREO || mSensor == System::IMU_RGBD)
         {
-            if (!mCurrentFrame.mpImuPreintegrated ||
-                !mLastFrame.mpImuPreintegrated)
+            if (!mpCurrentFrame->mpImuPreintegrated ||
+                !mpLastFrame->mpImuPreintegrated)
             {
                 cout << "not IMU meas" << endl;
                 return;
             }
 
-            if (!mFastInit && (mCurrentFrame.mpImuPreintegratedFrame->avgA -
-                               mLastFrame.mpImuPreintegratedFrame->avgA)
+            if (!mFastInit && (mpCurrentFrame->mpImuPreintegratedFrame->avgA -
+                               mpLastFrame->mpImuPreintegratedFrame->avgA)
                                       .norm() < 0.5)
             {
                 cout << "not enough acceleration" << endl;
@@ -2297,25 +2722,27 @@ void Tracking::StereoInitialization()
 
             mpImuPreintegratedFromLastKF =
                 new IMU::Preintegrated(IMU::Bias(), *mpImuCalib);
-            mCurrentFrame.mpImuPreintegrated = mpImuPreintegratedFromLastKF;
+            mpCurrentFrame->mpImuPreintegrated =
+                mpImuPreintegratedFromLastKF;
         }
 
         // Set Frame pose to the origin (In case of inertial SLAM to imu)
         if (mSensor == System::IMU_STEREO || mSensor == System::IMU_RGBD)
         {
             Eigen::Matrix3f Rwb0 =
-                mCurrentFrame.mImuCalib.mTcb.rotationMatrix();
-            Eigen::Vector3f twb0 = mCurrentFrame.mImuCalib.mTcb.translation();
+                mpCurrentFrame->mImuCalib.mTcb.rotationMatrix();
+            Eigen::Vector3f twb0 = mpCurrentFrame->mImuCalib.mTcb.translation();
             Eigen::Vector3f Vwb0;
             Vwb0.setZero();
-            mCurrentFrame.SetImuPoseVelocity(Rwb0, twb0, Vwb0);
+            mpCurrentFrame->SetImuPoseVelocity(Rwb0, twb0, Vwb0);
         }
         else
-            mCurrentFrame.SetPose(Sophus::SE3f());
+            mpCurrentFrame->SetPose(Sophus::SE3f());
 
         // Create KeyFrame
-        KeyFrame* pKFini =
-            new KeyFrame(mCurrentFrame, mpAtlas->GetCurrentMap(), mpKeyFrameDB);
+        KeyFrame* pKFini = new KeyFrame(*mpCurrentFrame,
+                                        mpAtlas->GetCurrentMap(),
+                                        mpKeyFrameDB);
 
         // Insert KeyFrame in the map
         mpAtlas->AddKeyFrame(pKFini);
@@ -2323,13 +2750,13 @@ void Tracking::StereoInitialization()
         // Create MapPoints and asscoiate to KeyFrame
         if (!mpCamera2)
         {
-            for (int i = 0; i < mCurrentFrame.N; i++)
+            for (int i = 0; i < mpCurrentFrame->N; i++)
             {
-                float z = mCurrentFrame.mvDepth[i];
+                float z = mpCurrentFrame->mvDepth[i];
                 if (z > 0)
                 {
                     Eigen::Vector3f x3D;
-                    mCurrentFrame.UnprojectStereo(i, x3D);
+                    mpCurrentFrame->UnprojectStereo(i, x3D);
                     MapPoint* pNewMP =
                         new MapPoint(x3D, pKFini, mpAtlas->GetCurrentMap());
                     pNewMP->AddObservation(pKFini, i);
@@ -2338,37 +2765,37 @@ void Tracking::StereoInitialization()
                     pNewMP->UpdateNormalAndDepth();
                     mpAtlas->AddMapPoint(pNewMP);
 
-                    mCurrentFrame.mvpMapPoints[i] = pNewMP;
+                    mpCurrentFrame->mvpMapPoints[i] = pNewMP;
                 }
             }
         }
         else
         {
-            for (int i = 0; i < mCurrentFrame.Nleft; i++)
+            for (int i = 0; i < mpCurrentFrame->Nleft; i++)
             {
-                int rightIndex = mCurrentFrame.mvLeftToRightMatch[i];
+                int rightIndex = mpCurrentFrame->mvLeftToRightMatch[i];
                 if (rightIndex != -1)
                 {
-                    Eigen::Vector3f x3D = mCurrentFrame.mvStereo3Dpoints[i];
+                    Eigen::Vector3f x3D = mpCurrentFrame->mvStereo3Dpoints[i];
 
                     MapPoint* pNewMP =
                         new MapPoint(x3D, pKFini, mpAtlas->GetCurrentMap());
 
                     pNewMP->AddObservation(pKFini, i);
                     pNewMP->AddObservation(pKFini,
-                                           rightIndex + mCurrentFrame.Nleft);
+                                           rightIndex + mpCurrentFrame->Nleft);
 
                     pKFini->AddMapPoint(pNewMP, i);
                     pKFini->AddMapPoint(pNewMP,
-                                        rightIndex + mCurrentFrame.Nleft);
+                                        rightIndex + mpCurrentFrame->Nleft);
 
                     pNewMP->ComputeDistinctiveDescriptors();
                     pNewMP->UpdateNormalAndDepth();
                     mpAtlas->AddMapPoint(pNewMP);
 
-                    mCurrentFrame.mvpMapPoints[i] = pNewMP;
-                    mCurrentFrame
-                        .mvpMapPoints[rightIndex + mCurrentFrame.Nleft] =
+                    mpCurrentFrame->mvpMapPoints[i] = pNewMP;
+                    mpCurrentFrame
+                        ->mvpMapPoints[rightIndex + mpCurrentFrame->Nleft] =
                         pNewMP;
                 }
             }
@@ -2382,15 +2809,15 @@ void Tracking::StereoInitialization()
 
         mpLocalMapper->InsertKeyFrame(pKFini);
 
-        mLastFrame.copyFrom(mCurrentFrame);
-        mnLastKeyFrameId = mCurrentFrame.mnId;
+        mpLastFrame      = mpCurrentFrame;
+        mnLastKeyFrameId = mpCurrentFrame->mnId;
         mpLastKeyFrame   = pKFini;
         // mnLastRelocFrameId = mCurrentFrame.mnId;
 
         mvpLocalKeyFrames.push_back(pKFini);
-        mvpLocalMapPoints           = mpAtlas->GetAllMapPoints();
-        mpReferenceKF               = pKFini;
-        mCurrentFrame.mpReferenceKF = pKFini;
+        mvpLocalMapPoints             = mpAtlas->GetAllMapPoints();
+        mpReferenceKF                 = pKFini;
+        mpCurrentFrame->mpReferenceKF = pKFini;
 
         mpAtlas->SetReferenceMapPoints(mvpLocalMapPoints);
 
@@ -2405,13 +2832,13 @@ void Tracking::MonocularInitialization()
     if (!mbReadyToInitializate)  // Have no image before this frame.
     {
         // Set Reference Frame
-        if (mCurrentFrame.mvKeys.size() > 100)
+        if (mpCurrentFrame->mvKeys.size() > 100)
         {
-            mInitialFrame.copyFrom(mCurrentFrame);
-            mLastFrame.copyFrom(mCurrentFrame);
-            mvbPrevMatched.resize(mCurrentFrame.mvKeysUn.size());
-            for (size_t i = 0; i < mCurrentFrame.mvKeysUn.size(); i++)
-                mvbPrevMatched[i] = mCurrentFrame.mvKeysUn[i].pt;
+            mInitialFrame.copyFrom(*mpCurrentFrame);
+            mpLastFrame = mpCurrentFrame;
+            mvbPrevMatched.resize(mpCurrentFrame->mvKeysUn.size());
+            for (size_t i = 0; i < mpCurrentFrame->mvKeysUn.size(); i++)
+                mvbPrevMatched[i] = mpCurrentFrame->mvKeysUn[i].pt;
 
             fill(mvIniMatches.begin(), mvIniMatches.end(), -1);
 
@@ -2423,7 +2850,8 @@ void Tracking::MonocularInitialization()
                 }
                 mpImuPreintegratedFromLastKF =
                     new IMU::Preintegrated(IMU::Bias(), *mpImuCalib);
-                mCurrentFrame.mpImuPreintegrated = mpImuPreintegratedFromLastKF;
+                mpCurrentFrame->mpImuPreintegrated =
+                    mpImuPreintegratedFromLastKF;
             }
 
             mbReadyToInitializate =
@@ -2434,9 +2862,9 @@ void Tracking::MonocularInitialization()
     {
         // This frame doesn't have enough keypoints or if is imu mode and wait
         // to long.
-        if (((int)mCurrentFrame.mvKeys.size() <= 100) ||
+        if (((int)mpCurrentFrame->mvKeys.size() <= 100) ||
             ((mSensor == System::IMU_MONOCULAR) &&
-             (mLastFrame.mTimeStamp - mInitialFrame.mTimeStamp > 1.0)))
+             (mpLastFrame->mTimeStamp - mInitialFrame.mTimeStamp > 1.0)))
         {
             mbReadyToInitializate = false;
             return;
@@ -2445,7 +2873,7 @@ void Tracking::MonocularInitialization()
         // Find correspondences
         ORBmatcher matcher(0.9, true);
         int        nmatches = matcher.SearchForInitialization(mInitialFrame,
-                                                       mCurrentFrame,
+                                                       *mpCurrentFrame,
                                                        mvbPrevMatched,
                                                        mvIniMatches,
                                                        100);
@@ -2461,12 +2889,13 @@ void Tracking::MonocularInitialization()
         vector<bool>
             vbTriangulated;  // Triangulated Correspondences (mvIniMatches)
 
-        bool success = mpCamera->ReconstructWithTwoViews(mInitialFrame.mvKeysUn,
-                                                         mCurrentFrame.mvKeysUn,
-                                                         mvIniMatches,
-                                                         Tcw,
-                                                         mvIniP3D,
-                                                         vbTriangulated);
+        bool success =
+            mpCamera->ReconstructWithTwoViews(mInitialFrame.mvKeysUn,
+                                              mpCurrentFrame->mvKeysUn,
+                                              mvIniMatches,
+                                              Tcw,
+                                              mvIniP3D,
+                                              vbTriangulated);
 
         if (success)
         {
@@ -2482,7 +2911,7 @@ void Tracking::MonocularInitialization()
             // Set Frame Poses
             mInitialFrame.SetPose(
                 Sophus::SE3f{});  // First frame's pose is zero.
-            mCurrentFrame.SetPose(Tcw);
+            mpCurrentFrame->SetPose(Tcw);
 
             CreateInitialMapMonocular();
 
@@ -2497,7 +2926,7 @@ void Tracking::CreateInitialMapMonocular()
     KeyFrame* pKFini =
         new KeyFrame(mInitialFrame, mpAtlas->GetCurrentMap(), mpKeyFrameDB);
     KeyFrame* pKFcur =
-        new KeyFrame(mCurrentFrame, mpAtlas->GetCurrentMap(), mpKeyFrameDB);
+        new KeyFrame(*mpCurrentFrame, mpAtlas->GetCurrentMap(), mpKeyFrameDB);
 
     if (mSensor == System::IMU_MONOCULAR)
     {
@@ -2537,8 +2966,8 @@ void Tracking::CreateInitialMapMonocular()
         pMP->UpdateNormalAndDepth();
 
         // Fill Current Frame structure
-        mCurrentFrame.mvpMapPoints[mvIniMatches[i]] = pMP;
-        mCurrentFrame.mvbOutlier[mvIniMatches[i]]   = false;
+        mpCurrentFrame->mvpMapPoints[mvIniMatches[i]] = pMP;
+        mpCurrentFrame->mvbOutlier[mvIniMatches[i]]   = false;
 
         // Add to Map
         mpAtlas->AddMapPoint(pMP);
@@ -2610,16 +3039,16 @@ void Tracking::CreateInitialMapMonocular()
     mpLocalMapper->InsertKeyFrame(pKFcur);
     mpLocalMapper->mFirstTs = pKFcur->mTimeStamp;
 
-    mCurrentFrame.SetPose(pKFcur->GetPose());
-    mnLastKeyFrameId = mCurrentFrame.mnId;
+    mpCurrentFrame->SetPose(pKFcur->GetPose());
+    mnLastKeyFrameId = mpCurrentFrame->mnId;
     mpLastKeyFrame   = pKFcur;
     // mnLastRelocFrameId = mInitialFrame.mnId;
 
     mvpLocalKeyFrames.push_back(pKFcur);
     mvpLocalKeyFrames.push_back(pKFini);
-    mvpLocalMapPoints           = mpAtlas->GetAllMapPoints();
-    mpReferenceKF               = pKFcur;
-    mCurrentFrame.mpReferenceKF = pKFcur;
+    mvpLocalMapPoints             = mpAtlas->GetAllMapPoints();
+    mpReferenceKF                 = pKFcur;
+    mpCurrentFrame->mpReferenceKF = pKFcur;
 
     // Compute here initial velocity
     vector<KeyFrame*> vKFs = mpAtlas->GetAllKeyFrames();
@@ -2629,11 +3058,11 @@ void Tracking::CreateInitialMapMonocular()
     mbVelocity          = false;
     Eigen::Vector3f phi = deltaT.so3().log();
 
-    float aux = (float)(mCurrentFrame.mTimeStamp - mLastFrame.mTimeStamp) /
-                (float)(mCurrentFrame.mTimeStamp - mInitialFrame.mTimeStamp);
+    float aux = (float)(mpCurrentFrame->mTimeStamp - mpLastFrame->mTimeStamp) /
+                (float)(mpCurrentFrame->mTimeStamp - mInitialFrame.mTimeStamp);
     phi *= aux;
 
-    mLastFrame.copyFrom(mCurrentFrame);
+    mpLastFrame = mpCurrentFrame;
 
     mpAtlas->SetReferenceMapPoints(mvpLocalMapPoints);
 
@@ -2647,14 +3076,14 @@ void Tracking::CreateInitialMapMonocular()
 
 void Tracking::CreateMapInAtlas()
 {
-    mnLastInitFrameId = mCurrentFrame.mnId;
+    mnLastInitFrameId = mpCurrentFrame->mnId;
     mpAtlas->CreateNewMap();
     if (mSensor == System::IMU_STEREO || mSensor == System::IMU_MONOCULAR ||
         mSensor == System::IMU_RGBD)
         mpAtlas->SetInertialSensor();
     mbSetInit = false;
 
-    mnInitialFrameId = mCurrentFrame.mnId + 1;
+    mnInitialFrameId = mpCurrentFrame->mnId + 1;
     mState           = NO_IMAGES_YET;
 
     // Restart the variable with information about the last KF
@@ -2694,8 +3123,8 @@ void Tracking::CreateMapInAtlas()
 
     // mLastFrame = Frame();
     // mCurrentFrame = Frame();
-    mLastFrame.reset();
-    mCurrentFrame.reset();
+    mpLastFrame->reset();
+    mpCurrentFrame->reset();
     mvIniMatches.clear();
 
     mbCreatedMap = true;
@@ -2703,16 +3132,16 @@ void Tracking::CreateMapInAtlas()
 
 void Tracking::CheckReplacedInLastFrame()
 {
-    for (int i = 0; i < mLastFrame.N; i++)
+    for (int i = 0; i < mpLastFrame->N; i++)
     {
-        MapPoint* pMP = mLastFrame.mvpMapPoints[i];
+        MapPoint* pMP = mpLastFrame->mvpMapPoints[i];
 
         if (pMP)
         {
             MapPoint* pRep = pMP->GetReplaced();
             if (pRep)
             {
-                mLastFrame.mvpMapPoints[i] = pRep;
+                mpLastFrame->mvpMapPoints[i] = pRep;
             }
         }
     }
@@ -2722,7 +3151,7 @@ void Tracking::CheckReplacedInLastFrame()
 bool Tracking::TrackReferenceKeyFrame()
 {
     // Compute Bag of Words vector
-    mCurrentFrame.ComputeBoW();
+    mpCurrentFrame->ComputeBoW();
 
     // We perform first an ORB matching with the reference keyframe
     // If enough matches are found we setup a PnP solver
@@ -2730,7 +3159,7 @@ bool Tracking::TrackReferenceKeyFrame()
     vector<MapPoint*> vpMapPointMatches;
 
     int nmatches =
-        matcher.SearchByBoW(mpReferenceKF, mCurrentFrame, vpMapPointMatches);
+        matcher.SearchByBoW(mpReferenceKF, *mpCurrentFrame, vpMapPointMatches);
 
     if (nmatches < 15)
     {
@@ -2738,30 +3167,30 @@ bool Tracking::TrackReferenceKeyFrame()
         return false;
     }
 
-    mCurrentFrame.mvpMapPoints = vpMapPointMatches;
-    mCurrentFrame.SetPose(mLastFrame.GetPose());
+    mpCurrentFrame->mvpMapPoints = vpMapPointMatches;
+    mpCurrentFrame->SetPose(mpLastFrame->GetPose());
 
     // mCurrentFrame.PrintPointDistribution();
 
 
     // cout << " TrackReferenceKeyFrame mLastFrame.mTcw:  " << mLastFrame.mTcw
     // << endl;
-    Optimizer::PoseOptimization(&mCurrentFrame);
+    Optimizer::PoseOptimization(mpCurrentFrame);
 
     // Discard outliers
     int nmatchesMap = 0;
-    for (int i = 0; i < mCurrentFrame.N; i++)
+    for (int i = 0; i < mpCurrentFrame->N; i++)
     {
         // if(i >= mCurrentFrame.Nleft) break;
-        if (mCurrentFrame.mvpMapPoints[i])
+        if (mpCurrentFrame->mvpMapPoints[i])
         {
-            if (mCurrentFrame.mvbOutlier[i])
+            if (mpCurrentFrame->mvbOutlier[i])
             {
-                MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
+                MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
 
-                mCurrentFrame.mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
-                mCurrentFrame.mvbOutlier[i]   = false;
-                if (i < mCurrentFrame.Nleft)
+                mpCurrentFrame->mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
+                mpCurrentFrame->mvbOutlier[i]   = false;
+                if (i < mpCurrentFrame->Nleft)
                 {
                     pMP->mbTrackInView = false;
                 }
@@ -2770,10 +3199,10 @@ bool Tracking::TrackReferenceKeyFrame()
                     pMP->mbTrackInViewR = false;
                 }
                 pMP->mbTrackInView   = false;
-                pMP->mnLastFrameSeen = mCurrentFrame.mnId;
+                pMP->mnLastFrameSeen = mpCurrentFrame->mnId;
                 nmatches--;
             }
-            else if (mCurrentFrame.mvpMapPoints[i]->Observations() > 0)
+            else if (mpCurrentFrame->mvpMapPoints[i]->Observations() > 0)
                 nmatchesMap++;
         }
     }
@@ -2788,11 +3217,11 @@ bool Tracking::TrackReferenceKeyFrame()
 void Tracking::UpdateLastFrame()
 {
     // Update pose according to reference keyframe
-    KeyFrame*    pRef = mLastFrame.mpReferenceKF;
+    KeyFrame*    pRef = mpLastFrame->mpReferenceKF;
     Sophus::SE3f Tlr  = mlRelativeFramePoses.back();
-    mLastFrame.SetPose(Tlr * pRef->GetPose());
+    mpLastFrame->SetPose(Tlr * pRef->GetPose());
 
-    if (mnLastKeyFrameId == mLastFrame.mnId || mSensor == System::MONOCULAR ||
+    if (mnLastKeyFrameId == mpLastFrame->mnId || mSensor == System::MONOCULAR ||
         mSensor == System::IMU_MONOCULAR || !mbOnlyTracking)
         return;
 
@@ -2800,11 +3229,12 @@ void Tracking::UpdateLastFrame()
     // We sort points according to their measured depth by the stereo/RGB-D
     // sensor
     vector<pair<float, int>> vDepthIdx;
-    const int Nfeat = mLastFrame.Nleft == -1 ? mLastFrame.N : mLastFrame.Nleft;
+    const int Nfeat =
+        mpLastFrame->Nleft == -1 ? mpLastFrame->N : mpLastFrame->Nleft;
     vDepthIdx.reserve(Nfeat);
     for (int i = 0; i < Nfeat; i++)
     {
-        float z = mLastFrame.mvDepth[i];
+        float z = mpLastFrame->mvDepth[i];
         if (z > 0)
         {
             vDepthIdx.push_back(make_pair(z, i));
@@ -2824,7 +3254,7 @@ void Tracking::UpdateLastFrame()
 
         bool bCreateNew = false;
 
-        MapPoint* pMP = mLastFrame.mvpMapPoints[i];
+        MapPoint* pMP = mpLastFrame->mvpMapPoints[i];
 
         if (!pMP)
             bCreateNew = true;
@@ -2835,18 +3265,18 @@ void Tracking::UpdateLastFrame()
         {
             Eigen::Vector3f x3D;
 
-            if (mLastFrame.Nleft == -1)
+            if (mpLastFrame->Nleft == -1)
             {
-                mLastFrame.UnprojectStereo(i, x3D);
+                mpLastFrame->UnprojectStereo(i, x3D);
             }
             else
             {
-                x3D = mLastFrame.UnprojectStereoFishEye(i);
+                x3D = mpLastFrame->UnprojectStereoFishEye(i);
             }
 
             MapPoint* pNewMP =
-                new MapPoint(x3D, mpAtlas->GetCurrentMap(), &mLastFrame, i);
-            mLastFrame.mvpMapPoints[i] = pNewMP;
+                new MapPoint(x3D, mpAtlas->GetCurrentMap(), mpLastFrame, i);
+            mpLastFrame->mvpMapPoints[i] = pNewMP;
 
             mlpTemporalPoints.push_back(pNewMP);
             nPoints++;
@@ -2869,7 +3299,7 @@ bool Tracking::TrackWithMotionModel()
     UpdateLastFrame();
 
     if (mpAtlas->isImuInitialized() &&
-        (mCurrentFrame.mnId > mnLastRelocFrameId + mnFramesToResetIMU))
+        (mpCurrentFrame->mnId > mnLastRelocFrameId + mnFramesToResetIMU))
     {
         // Predict state with IMU if it is initialized and it doesnt need reset
         PredictStateIMU();
@@ -2877,12 +3307,12 @@ bool Tracking::TrackWithMotionModel()
     }
     else
     {
-        mCurrentFrame.SetPose(mVelocity * mLastFrame.GetPose());
+        mpCurrentFrame->SetPose(mVelocity * mpLastFrame->GetPose());
     }
 
 
-    fill(mCurrentFrame.mvpMapPoints.begin(),
-         mCurrentFrame.mvpMapPoints.end(),
+    fill(mpCurrentFrame->mvpMapPoints.begin(),
+         mpCurrentFrame->mvpMapPoints.end(),
          static_cast<MapPoint*>(NULL));
 
     // Project points seen in previous frame
@@ -2894,8 +3324,8 @@ bool Tracking::TrackWithMotionModel()
         th = 15;
 
     int nmatches = matcher.SearchByProjection(
-        mCurrentFrame,
-        mLastFrame,
+        *mpCurrentFrame,
+        *mpLastFrame,
         th,
         mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR);
 
@@ -2904,13 +3334,13 @@ bool Tracking::TrackWithMotionModel()
     {
         Verbose::PrintMess("Not enough matches, wider window search!!",
                            Verbose::VERBOSITY_NORMAL);
-        fill(mCurrentFrame.mvpMapPoints.begin(),
-             mCurrentFrame.mvpMapPoints.end(),
+        fill(mpCurrentFrame->mvpMapPoints.begin(),
+             mpCurrentFrame->mvpMapPoints.end(),
              static_cast<MapPoint*>(NULL));
 
         nmatches = matcher.SearchByProjection(
-            mCurrentFrame,
-            mLastFrame,
+            *mpCurrentFrame,
+            *mpLastFrame,
             2 * th,
             mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR);
         Verbose::PrintMess("Matches with wider search: " + to_string(nmatches),
@@ -2928,21 +3358,21 @@ bool Tracking::TrackWithMotionModel()
     }
 
     // Optimize frame pose with all matches
-    Optimizer::PoseOptimization(&mCurrentFrame);
+    Optimizer::PoseOptimization(mpCurrentFrame);
 
     // Discard outliers
     int nmatchesMap = 0;
-    for (int i = 0; i < mCurrentFrame.N; i++)
+    for (int i = 0; i < mpCurrentFrame->N; i++)
     {
-        if (mCurrentFrame.mvpMapPoints[i])
+        if (mpCurrentFrame->mvpMapPoints[i])
         {
-            if (mCurrentFrame.mvbOutlier[i])
+            if (mpCurrentFrame->mvbOutlier[i])
             {
-                MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
+                MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
 
-                mCurrentFrame.mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
-                mCurrentFrame.mvbOutlier[i]   = false;
-                if (i < mCurrentFrame.Nleft)
+                mpCurrentFrame->mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
+                mpCurrentFrame->mvbOutlier[i]   = false;
+                if (i < mpCurrentFrame->Nleft)
                 {
                     pMP->mbTrackInView = false;
                 }
@@ -2950,10 +3380,10 @@ bool Tracking::TrackWithMotionModel()
                 {
                     pMP->mbTrackInViewR = false;
                 }
-                pMP->mnLastFrameSeen = mCurrentFrame.mnId;
+                pMP->mnLastFrameSeen = mpCurrentFrame->mnId;
                 nmatches--;
             }
-            else if (mCurrentFrame.mvpMapPoints[i]->Observations() > 0)
+            else if (mpCurrentFrame->mvpMapPoints[i]->Observations() > 0)
                 nmatchesMap++;
         }
     }
@@ -2983,23 +3413,23 @@ bool Tracking::TrackLocalMap()
 
     // TOO check outliers before PO
     int aux1 = 0, aux2 = 0;
-    for (int i = 0; i < mCurrentFrame.N; i++)
-        if (mCurrentFrame.mvpMapPoints[i])
+    for (int i = 0; i < mpCurrentFrame->N; i++)
+        if (mpCurrentFrame->mvpMapPoints[i])
         {
             aux1++;
-            if (mCurrentFrame.mvbOutlier[i]) aux2++;
+            if (mpCurrentFrame->mvbOutlier[i]) aux2++;
         }
 
     int inliers;
     if (!mpAtlas->isImuInitialized())
-        Optimizer::PoseOptimization(&mCurrentFrame);
+        Optimizer::PoseOptimization(mpCurrentFrame);
     else
     {
-        if (mCurrentFrame.mnId <= mnLastRelocFrameId + mnFramesToResetIMU)
+        if (mpCurrentFrame->mnId <= mnLastRelocFrameId + mnFramesToResetIMU)
         {
             Verbose::PrintMess("TLM: PoseOptimization ",
                                Verbose::VERBOSITY_DEBUG);
-            Optimizer::PoseOptimization(&mCurrentFrame);
+            Optimizer::PoseOptimization(mpCurrentFrame);
         }
         else
         {
@@ -3009,7 +3439,7 @@ bool Tracking::TrackLocalMap()
                 Verbose::PrintMess("TLM: PoseInertialOptimizationLastFrame ",
                                    Verbose::VERBOSITY_DEBUG);
                 inliers = Optimizer::PoseInertialOptimizationLastFrame(
-                    &mCurrentFrame);  // ,
+                    mpCurrentFrame);  // ,
                                       // !mpLastKeyFrame->GetMap()->GetIniertialBA1());
             }
             else
@@ -3017,47 +3447,47 @@ bool Tracking::TrackLocalMap()
                 Verbose::PrintMess("TLM: PoseInertialOptimizationLastKeyFrame ",
                                    Verbose::VERBOSITY_DEBUG);
                 inliers = Optimizer::PoseInertialOptimizationLastKeyFrame(
-                    &mCurrentFrame);  // ,
+                    mpCurrentFrame);  // ,
                                       // !mpLastKeyFrame->GetMap()->GetIniertialBA1());
             }
         }
     }
 
     aux1 = 0, aux2 = 0;
-    for (int i = 0; i < mCurrentFrame.N; i++)
-        if (mCurrentFrame.mvpMapPoints[i])
+    for (int i = 0; i < mpCurrentFrame->N; i++)
+        if (mpCurrentFrame->mvpMapPoints[i])
         {
             aux1++;
-            if (mCurrentFrame.mvbOutlier[i]) aux2++;
+            if (mpCurrentFrame->mvbOutlier[i]) aux2++;
         }
 
     mnMatchesInliers = 0;
 
     // Update MapPoints Statistics
-    for (int i = 0; i < mCurrentFrame.N; i++)
+    for (int i = 0; i < mpCurrentFrame->N; i++)
     {
-        if (mCurrentFrame.mvpMapPoints[i])
+        if (mpCurrentFrame->mvpMapPoints[i])
         {
-            if (!mCurrentFrame.mvbOutlier[i])
+            if (!mpCurrentFrame->mvbOutlier[i])
             {
-                mCurrentFrame.mvpMapPoints[i]->IncreaseFound();
+                mpCurrentFrame->mvpMapPoints[i]->IncreaseFound();
                 if (!mbOnlyTracking)
                 {
-                    if (mCurrentFrame.mvpMapPoints[i]->Observations() > 0)
+                    if (mpCurrentFrame->mvpMapPoints[i]->Observations() > 0)
                         mnMatchesInliers++;
                 }
                 else
                     mnMatchesInliers++;
             }
             else if (mSensor == System::STEREO)
-                mCurrentFrame.mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
+                mpCurrentFrame->mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
         }
     }
 
     // Decide if the tracking was succesful
     // More restrictive if there was a relocalization recently
     mpLocalMapper->mnMatchesInliers = mnMatchesInliers;
-    if (mCurrentFrame.mnId < mnLastRelocFrameId + mMaxFrames &&
+    if (mpCurrentFrame->mnId < mnLastRelocFrameId + mMaxFrames &&
         mnMatchesInliers < 50)
         return false;
 
@@ -3099,11 +3529,11 @@ bool Tracking::NeedNewKeyFrame()
         !mpAtlas->GetCurrentMap()->isImuInitialized())
     {
         if (mSensor == System::IMU_MONOCULAR &&
-            (mCurrentFrame.mTimeStamp - mpLastKeyFrame->mTimeStamp) >= 0.25)
+            (mpCurrentFrame->mTimeStamp - mpLastKeyFrame->mTimeStamp) >= 0.25)
             return true;
         else if ((mSensor == System::IMU_STEREO ||
                   mSensor == System::IMU_RGBD) &&
-                 (mCurrentFrame.mTimeStamp - mpLastKeyFrame->mTimeStamp) >=
+                 (mpCurrentFrame->mTimeStamp - mpLastKeyFrame->mTimeStamp) >=
                      0.25)
             return true;
         else
@@ -3126,7 +3556,7 @@ bool Tracking::NeedNewKeyFrame()
 
     // Do not insert keyframes if not enough frames have passed from last
     // relocalisation
-    if (mCurrentFrame.mnId < mnLastRelocFrameId + mMaxFrames &&
+    if (mpCurrentFrame->mnId < mnLastRelocFrameId + mMaxFrames &&
         nKFs > mMaxFrames)
     {
         return false;
@@ -3147,15 +3577,15 @@ bool Tracking::NeedNewKeyFrame()
 
     if (mSensor != System::MONOCULAR && mSensor != System::IMU_MONOCULAR)
     {
-        int N =
-            (mCurrentFrame.Nleft == -1) ? mCurrentFrame.N : mCurrentFrame.Nleft;
+        int N = (mpCurrentFrame->Nleft == -1) ? mpCurrentFrame->N
+                                              : mpCurrentFrame->Nleft;
         for (int i = 0; i < N; i++)
         {
-            if (mCurrentFrame.mvDepth[i] > 0 &&
-                mCurrentFrame.mvDepth[i] < mThDepth)
+            if (mpCurrentFrame->mvDepth[i] > 0 &&
+                mpCurrentFrame->mvDepth[i] < mThDepth)
             {
-                if (mCurrentFrame.mvpMapPoints[i] &&
-                    !mCurrentFrame.mvbOutlier[i])
+                if (mpCurrentFrame->mvpMapPoints[i] &&
+                    !mpCurrentFrame->mvbOutlier[i])
                     nTrackedClose++;
                 else
                     nNonTrackedClose++;
@@ -3197,10 +3627,10 @@ bool Tracking::NeedNewKeyFrame()
 
     // Condition 1a: More than "MaxFrames" have passed from last keyframe
     // insertion
-    const bool c1a = mCurrentFrame.mnId >= mnLastKeyFrameId + mMaxFrames;
+    const bool c1a = mpCurrentFrame->mnId >= mnLastKeyFrameId + mMaxFrames;
     // Condition 1b: More than "MinFrames" have passed and Local Mapping is idle
     const bool c1b =
-        ((mCurrentFrame.mnId >= mnLastKeyFrameId + mMinFrames) &&
+        ((mpCurrentFrame->mnId >= mnLastKeyFrameId + mMinFrames) &&
          bLocalMappingIdle);  // mpLocalMapper->KeyframesInQueue() < 2);
     // Condition 1c: tracking is weak
     const bool c1c =
@@ -3221,12 +3651,14 @@ bool Tracking::NeedNewKeyFrame()
     {
         if (mSensor == System::IMU_MONOCULAR)
         {
-            if ((mCurrentFrame.mTimeStamp - mpLastKeyFrame->mTimeStamp) >= 0.5)
+            if ((mpCurrentFrame->mTimeStamp - mpLastKeyFrame->mTimeStamp) >=
+                0.5)
                 c3 = true;
         }
         else if (mSensor == System::IMU_STEREO || mSensor == System::IMU_RGBD)
         {
-            if ((mCurrentFrame.mTimeStamp - mpLastKeyFrame->mTimeStamp) >= 0.5)
+            if ((mpCurrentFrame->mTimeStamp - mpLastKeyFrame->mTimeStamp) >=
+                0.5)
                 c3 = true;
         }
     }
@@ -3282,14 +3714,14 @@ void Tracking::CreateNewKeyFrame()
     if (!mpLocalMapper->SetNotStop(true)) return;
 
     KeyFrame* pKF =
-        new KeyFrame(mCurrentFrame, mpAtlas->GetCurrentMap(), mpKeyFrameDB);
+        new KeyFrame(*mpCurrentFrame, mpAtlas->GetCurrentMap(), mpKeyFrameDB);
 
     if (mpAtlas->isImuInitialized())  //  || mpLocalMapper->IsInitializing())
         pKF->bImu = true;
 
-    pKF->SetNewBias(mCurrentFrame.mImuBias);
-    mpReferenceKF               = pKF;
-    mCurrentFrame.mpReferenceKF = pKF;
+    pKF->SetNewBias(mpCurrentFrame->mImuBias);
+    mpReferenceKF                 = pKF;
+    mpCurrentFrame->mpReferenceKF = pKF;
 
     if (mpLastKeyFrame)
     {
@@ -3311,7 +3743,7 @@ void Tracking::CreateNewKeyFrame()
     if (mSensor != System::MONOCULAR &&
         mSensor != System::IMU_MONOCULAR)  // TODO check if incluide imu_stereo
     {
-        mCurrentFrame.UpdatePoseMatrices();
+        mpCurrentFrame->UpdatePoseMatrices();
         // cout << "create new MPs" << endl;
         // We sort points by the measured depth by the stereo/RGBD sensor.
         // We create all those MapPoints whose depth < mThDepth.
@@ -3321,12 +3753,13 @@ void Tracking::CreateNewKeyFrame()
             maxPoint = 100;
 
         vector<pair<float, int>> vDepthIdx;
-        int                      N =
-            (mCurrentFrame.Nleft != -1) ? mCurrentFrame.Nleft : mCurrentFrame.N;
-        vDepthIdx.reserve(mCurrentFrame.N);
+        int                      N = (mpCurrentFrame->Nleft != -1)
+                                           ? mpCurrentFrame->Nleft
+                                           : mpCurrentFrame->N;
+        vDepthIdx.reserve(mpCurrentFrame->N);
         for (int i = 0; i < N; i++)
         {
-            float z = mCurrentFrame.mvDepth[i];
+            float z = mpCurrentFrame->mvDepth[i];
             if (z > 0)
             {
                 vDepthIdx.push_back(make_pair(z, i));
@@ -3344,13 +3777,13 @@ void Tracking::CreateNewKeyFrame()
 
                 bool bCreateNew = false;
 
-                MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
+                MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
                 if (!pMP)
                     bCreateNew = true;
                 else if (pMP->Observations() < 1)
                 {
                     bCreateNew = true;
-                    mCurrentFrame.mvpMapPoints[i] =
+                    mpCurrentFrame->mvpMapPoints[i] =
                         static_cast<MapPoint*>(NULL);
                 }
 
@@ -3358,13 +3791,13 @@ void Tracking::CreateNewKeyFrame()
                 {
                     Eigen::Vector3f x3D;
 
-                    if (mCurrentFrame.Nleft == -1)
+                    if (mpCurrentFrame->Nleft == -1)
                     {
-                        mCurrentFrame.UnprojectStereo(i, x3D);
+                        mpCurrentFrame->UnprojectStereo(i, x3D);
                     }
                     else
                     {
-                        x3D = mCurrentFrame.UnprojectStereoFishEye(i);
+                        x3D = mpCurrentFrame->UnprojectStereoFishEye(i);
                     }
 
                     MapPoint* pNewMP =
@@ -3373,21 +3806,20 @@ void Tracking::CreateNewKeyFrame()
 
                     // Check if it is a stereo observation in order to not
                     // duplicate mappoints
-                    if (mCurrentFrame.Nleft != -1 &&
-                        mCurrentFrame.mvLeftToRightMatch[i] >= 0)
+                    if (mpCurrentFrame->Nleft != -1 &&
+                        mpCurrentFrame->mvLeftToRightMatch[i] >= 0)
                     {
-                        mCurrentFrame
-                            .mvpMapPoints[mCurrentFrame.Nleft +
-                                          mCurrentFrame.mvLeftToRightMatch[i]] =
-                            pNewMP;
+                        mpCurrentFrame->mvpMapPoints
+                            [mpCurrentFrame->Nleft +
+                             mpCurrentFrame->mvLeftToRightMatch[i]] = pNewMP;
                         pNewMP->AddObservation(
                             pKF,
-                            mCurrentFrame.Nleft +
-                                mCurrentFrame.mvLeftToRightMatch[i]);
+                            mpCurrentFrame->Nleft +
+                                mpCurrentFrame->mvLeftToRightMatch[i]);
                         pKF->AddMapPoint(
                             pNewMP,
-                            mCurrentFrame.Nleft +
-                                mCurrentFrame.mvLeftToRightMatch[i]);
+                            mpCurrentFrame->Nleft +
+                                mpCurrentFrame->mvLeftToRightMatch[i]);
                     }
 
                     pKF->AddMapPoint(pNewMP, i);
@@ -3395,7 +3827,7 @@ void Tracking::CreateNewKeyFrame()
                     pNewMP->UpdateNormalAndDepth();
                     mpAtlas->AddMapPoint(pNewMP);
 
-                    mCurrentFrame.mvpMapPoints[i] = pNewMP;
+                    mpCurrentFrame->mvpMapPoints[i] = pNewMP;
                     nPoints++;
                 }
                 else
@@ -3418,15 +3850,16 @@ void Tracking::CreateNewKeyFrame()
 
     mpLocalMapper->SetNotStop(false);
 
-    mnLastKeyFrameId = mCurrentFrame.mnId;
+    mnLastKeyFrameId = mpCurrentFrame->mnId;
     mpLastKeyFrame   = pKF;
 }
 
 void Tracking::SearchLocalPoints()
 {
     // Do not search map points already matched
-    for (vector<MapPoint*>::iterator vit  = mCurrentFrame.mvpMapPoints.begin(),
-                                     vend = mCurrentFrame.mvpMapPoints.end();
+    for (vector<MapPoint*>::iterator
+             vit  = mpCurrentFrame->mvpMapPoints.begin(),
+             vend = mpCurrentFrame->mvpMapPoints.end();
          vit != vend;
          vit++)
     {
@@ -3440,7 +3873,7 @@ void Tracking::SearchLocalPoints()
             else
             {
                 pMP->IncreaseVisible();
-                pMP->mnLastFrameSeen = mCurrentFrame.mnId;
+                pMP->mnLastFrameSeen = mpCurrentFrame->mnId;
                 pMP->mbTrackInView   = false;
                 pMP->mbTrackInViewR  = false;
             }
@@ -3457,17 +3890,17 @@ void Tracking::SearchLocalPoints()
     {
         MapPoint* pMP = *vit;
 
-        if (pMP->mnLastFrameSeen == mCurrentFrame.mnId) continue;
+        if (pMP->mnLastFrameSeen == mpCurrentFrame->mnId) continue;
         if (pMP->isBad()) continue;
         // Project (this fills MapPoint variables for matching)
-        if (mCurrentFrame.isInFrustum(pMP, 0.5))
+        if (mpCurrentFrame->isInFrustum(pMP, 0.5))
         {
             pMP->IncreaseVisible();
             nToMatch++;
         }
         if (pMP->mbTrackInView)
         {
-            mCurrentFrame.mmProjectPoints[pMP->mnId] =
+            mpCurrentFrame->mmProjectPoints[pMP->mnId] =
                 cv::Point2f(pMP->mTrackProjX, pMP->mTrackProjY);
         }
     }
@@ -3492,17 +3925,19 @@ void Tracking::SearchLocalPoints()
         }
 
         // If the camera has been relocalised recently, perform a coarser search
-        if (mCurrentFrame.mnId < mnLastRelocFrameId + 2) th = 5;
+        if (mpCurrentFrame->mnId < mnLastRelocFrameId + 2) th = 5;
 
         if (mState == LOST ||
             mState == RECENTLY_LOST)  // Lost for less than 1 second
             th = 15;                  // 15
 
-        int matches = matcher.SearchByProjection(mCurrentFrame,
-                                                 mvpLocalMapPoints,
-                                                 th,
-                                                 mpLocalMapper->mbFarPoints,
-                                                 mpLocalMapper->mThFarPoints);
+        int matches =
+            matcher.SearchByProjectionParallel(*mpCurrentFrame,
+                                               mvpLocalMapPoints,
+                                               mpMatcherPool.get(),
+                                               th,
+                                               mpLocalMapper->mbFarPoints,
+                                               mpLocalMapper->mThFarPoints);
     }
 }
 
@@ -3538,12 +3973,44 @@ void Tracking::UpdateLocalPoints()
         {
             MapPoint* pMP = *itMP;
             if (!pMP) continue;
-            if (pMP->mnTrackReferenceForFrame == mCurrentFrame.mnId) continue;
+            if (pMP->mnTrackReferenceForFrame == mpCurrentFrame->mnId) continue;
             if (!pMP->isBad())
             {
                 count_pts++;
                 mvpLocalMapPoints.push_back(pMP);
-                pMP->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+                pMP->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
+            }
+        }
+    }
+
+    // Right after a relocalization the covisible keyframes may be too few to
+    // give the points around the camera, take them from the map by position
+    if (mbRelocalized &&
+        mpCurrentFrame->mnId < mnLastRelocFrameId + mMaxFrames &&
+        mvpLocalKeyFrames.size() < 5 && mpReferenceKF)
+    {
+        const float medianDepth = mpReferenceKF->ComputeSceneMedianDepth(2);
+        if (medianDepth <= 0) return;
+
+        const VoxelGrid::Frustum frustum = VoxelGrid::MakeFrustum(
+            mpCurrentFrame->GetPose(),
+            (Frame::mnMinX - Frame::cx) * Frame::invfx,
+            (Frame::mnMaxX - Frame::cx) * Frame::invfx,
+            (Frame::mnMinY - Frame::cy) * Frame::invfy,
+            (Frame::mnMaxY - Frame::cy) * Frame::invfy,
+            0.1f * medianDepth,
+            3.0f * medianDepth);
+        const vector<MapPoint*> vpMPs =
+            mpAtlas->GetCurrentMap()->GetMapPointsInFrustum(frustum);
+
+        for (MapPoint* pMP : vpMPs)
+        {
+            if (pMP->mnTrackReferenceForFrame == mpCurrentFrame->mnId) continue;
+            if (!pMP->isBad())
+            {
+                count_pts++;
+                mvpLocalMapPoints.push_back(pMP);
+                pMP->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
             }
         }
     }
@@ -3555,55 +4022,43 @@ void Tracking::UpdateLocalKeyFrames()
     // Each map point vote for the keyframes in which it has been observed
     map<KeyFrame*, int> keyframeCounter;
     if (!mpAtlas->isImuInitialized() ||
-        (mCurrentFrame.mnId < mnLastRelocFrameId + 2))
+        (mpCurrentFrame->mnId < mnLastRelocFrameId + 2))
     {
-        for (int i = 0; i < mCurrentFrame.N; i++)
+        for (int i = 0; i < mpCurrentFrame->N; i++)
         {
-            MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
+            MapPoint* pMP = mpCurrentFrame->mvpMapPoints[i];
             if (pMP)
             {
                 if (!pMP->isBad())
                 {
-                    const map<KeyFrame*, tuple<int, int>> observations =
-                        pMP->GetObservations();
-                    for (map<KeyFrame*, tuple<int, int>>::const_iterator
-                             it    = observations.begin(),
-                             itend = observations.end();
-                         it != itend;
-                         it++)
-                        keyframeCounter[it->first]++;
+                    pMP->ForEachObservation([&](KeyFrame* pKF, int, int)
+                                            { keyframeCounter[pKF]++; });
                 }
                 else
                 {
-                    mCurrentFrame.mvpMapPoints[i] = NULL;
+                    mpCurrentFrame->mvpMapPoints[i] = NULL;
                 }
             }
         }
     }
     else
     {
-        for (int i = 0; i < mLastFrame.N; i++)
+        for (int i = 0; i < mpLastFrame->N; i++)
         {
             // Using lastframe since current frame has not matches yet
-            if (mLastFrame.mvpMapPoints[i])
+            if (mpLastFrame->mvpMapPoints[i])
             {
-                MapPoint* pMP = mLastFrame.mvpMapPoints[i];
+                MapPoint* pMP = mpLastFrame->mvpMapPoints[i];
                 if (!pMP) continue;
                 if (!pMP->isBad())
                 {
-                    const map<KeyFrame*, tuple<int, int>> observations =
-                        pMP->GetObservations();
-                    for (map<KeyFrame*, tuple<int, int>>::const_iterator
-                             it    = observations.begin(),
-                             itend = observations.end();
-                         it != itend;
-                         it++)
-                        keyframeCounter[it->first]++;
+                    pMP->ForEachObservation([&](KeyFrame* pKF, int, int)
+                                            { keyframeCounter[pKF]++; });
                 }
                 else
                 {
                     // MODIFICATION
-                    mLastFrame.mvpMapPoints[i] = NULL;
+                    mpLastFrame->mvpMapPoints[i] = NULL;
                 }
             }
         }
@@ -3634,7 +4089,7 @@ void Tracking::UpdateLocalKeyFrames()
         }
 
         mvpLocalKeyFrames.push_back(pKF);
-        pKF->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+        pKF->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
     }
 
     // Include also some not-already-included keyframes that are neighbors to
@@ -3661,10 +4116,10 @@ void Tracking::UpdateLocalKeyFrames()
             KeyFrame* pNeighKF = *itNeighKF;
             if (!pNeighKF->isBad())
             {
-                if (pNeighKF->mnTrackReferenceForFrame != mCurrentFrame.mnId)
+                if (pNeighKF->mnTrackReferenceForFrame != mpCurrentFrame->mnId)
                 {
                     mvpLocalKeyFrames.push_back(pNeighKF);
-                    pNeighKF->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+                    pNeighKF->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
                     break;
                 }
             }
@@ -3679,10 +4134,10 @@ void Tracking::UpdateLocalKeyFrames()
             KeyFrame* pChildKF = *sit;
             if (!pChildKF->isBad())
             {
-                if (pChildKF->mnTrackReferenceForFrame != mCurrentFrame.mnId)
+                if (pChildKF->mnTrackReferenceForFrame != mpCurrentFrame->mnId)
                 {
                     mvpLocalKeyFrames.push_back(pChildKF);
-                    pChildKF->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+                    pChildKF->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
                     break;
                 }
             }
@@ -3691,10 +4146,10 @@ void Tracking::UpdateLocalKeyFrames()
         KeyFrame* pParent = pKF->GetParent();
         if (pParent)
         {
-            if (pParent->mnTrackReferenceForFrame != mCurrentFrame.mnId)
+            if (pParent->mnTrackReferenceForFrame != mpCurrentFrame->mnId)
             {
                 mvpLocalKeyFrames.push_back(pParent);
-                pParent->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+                pParent->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
                 break;
             }
         }
@@ -3705,16 +4160,16 @@ void Tracking::UpdateLocalKeyFrames()
          mSensor == System::IMU_RGBD) &&
         mvpLocalKeyFrames.size() < 80)
     {
-        KeyFrame* tempKeyFrame = mCurrentFrame.mpLastKeyFrame;
+        KeyFrame* tempKeyFrame = mpCurrentFrame->mpLastKeyFrame;
 
         const int Nd = 20;
         for (int i = 0; i < Nd; i++)
         {
             if (!tempKeyFrame) break;
-            if (tempKeyFrame->mnTrackReferenceForFrame != mCurrentFrame.mnId)
+            if (tempKeyFrame->mnTrackReferenceForFrame != mpCurrentFrame->mnId)
             {
                 mvpLocalKeyFrames.push_back(tempKeyFrame);
-                tempKeyFrame->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+                tempKeyFrame->mnTrackReferenceForFrame = mpCurrentFrame->mnId;
                 tempKeyFrame                           = tempKeyFrame->mPrevKF;
             }
         }
@@ -3722,8 +4177,8 @@ void Tracking::UpdateLocalKeyFrames()
 
     if (pKFmax)
     {
-        mpReferenceKF               = pKFmax;
-        mCurrentFrame.mpReferenceKF = mpReferenceKF;
+        mpReferenceKF                 = pKFmax;
+        mpCurrentFrame->mpReferenceKF = mpReferenceKF;
     }
 }
 
@@ -3731,14 +4186,15 @@ bool Tracking::Relocalization()
 {
     Verbose::PrintMess("Starting relocalization", Verbose::VERBOSITY_NORMAL);
     // Compute Bag of Words Vector
-    mCurrentFrame.ComputeBoW();
+    mpCurrentFrame->ComputeBoW();
 
     // Relocalization is performed when tracking is lost
     // Track Lost: Query KeyFrame Database for keyframe candidates for
     // relocalisation
     vector<KeyFrame*> vpCandidateKFs =
-        mpKeyFrameDB->DetectRelocalizationCandidates(&mCurrentFrame,
-                                                     mpAtlas->GetCurrentMap());
+        mpKeyFrameDB->DetectRelocalizationCandidates(mpCurrentFrame,
+                                                     mpAtlas->GetCurrentMap(),
+                                                     mRelocContext);
 
     if (vpCandidateKFs.empty())
     {
@@ -3771,8 +4227,9 @@ bool Tracking::Relocalization()
             vbDiscarded[i] = true;
         else
         {
-            int nmatches =
-                matcher.SearchByBoW(pKF, mCurrentFrame, vvpMapPointMatches[i]);
+            int nmatches = matcher.SearchByBoW(pKF,
+                                               *mpCurrentFrame,
+                                               vvpMapPointMatches[i]);
             if (nmatches < 15)
             {
                 vbDiscarded[i] = true;
@@ -3781,7 +4238,7 @@ bool Tracking::Relocalization()
             else
             {
                 MLPnPsolver* pSolver =
-                    new MLPnPsolver(mCurrentFrame, vvpMapPointMatches[i]);
+                    new MLPnPsolver(*mpCurrentFrame, vvpMapPointMatches[i]);
                 pSolver->SetRansacParameters(
                     0.99,
                     10,
@@ -3827,7 +4284,7 @@ bool Tracking::Relocalization()
             if (bTcw)
             {
                 Sophus::SE3f Tcw(eigTcw);
-                mCurrentFrame.SetPose(Tcw);
+                mpCurrentFrame->SetPose(Tcw);
                 // Tcw.copyTo(mCurrentFrame.mTcw);
 
                 set<MapPoint*> sFound;
@@ -3838,21 +4295,21 @@ bool Tracking::Relocalization()
                 {
                     if (vbInliers[j])
                     {
-                        mCurrentFrame.mvpMapPoints[j] =
+                        mpCurrentFrame->mvpMapPoints[j] =
                             vvpMapPointMatches[i][j];
                         sFound.insert(vvpMapPointMatches[i][j]);
                     }
                     else
-                        mCurrentFrame.mvpMapPoints[j] = NULL;
+                        mpCurrentFrame->mvpMapPoints[j] = NULL;
                 }
 
-                int nGood = Optimizer::PoseOptimization(&mCurrentFrame);
+                int nGood = Optimizer::PoseOptimization(mpCurrentFrame);
 
                 if (nGood < 10) continue;
 
-                for (int io = 0; io < mCurrentFrame.N; io++)
-                    if (mCurrentFrame.mvbOutlier[io])
-                        mCurrentFrame.mvpMapPoints[io] =
+                for (int io = 0; io < mpCurrentFrame->N; io++)
+                    if (mpCurrentFrame->mvbOutlier[io])
+                        mpCurrentFrame->mvpMapPoints[io] =
                             static_cast<MapPoint*>(NULL);
 
                 // If few inliers, search by projection in a coarse window and
@@ -3860,7 +4317,7 @@ bool Tracking::Relocalization()
                 if (nGood < 50)
                 {
                     int nadditional =
-                        matcher2.SearchByProjection(mCurrentFrame,
+                        matcher2.SearchByProjection(*mpCurrentFrame,
                                                     vpCandidateKFs[i],
                                                     sFound,
                                                     10,
@@ -3868,7 +4325,7 @@ bool Tracking::Relocalization()
 
                     if (nadditional + nGood >= 50)
                     {
-                        nGood = Optimizer::PoseOptimization(&mCurrentFrame);
+                        nGood = Optimizer::PoseOptimization(mpCurrentFrame);
 
                         // If many inliers but still not enough, search by
                         // projection again in a narrower window the camera has
@@ -3876,12 +4333,12 @@ bool Tracking::Relocalization()
                         if (nGood > 30 && nGood < 50)
                         {
                             sFound.clear();
-                            for (int ip = 0; ip < mCurrentFrame.N; ip++)
-                                if (mCurrentFrame.mvpMapPoints[ip])
+                            for (int ip = 0; ip < mpCurrentFrame->N; ip++)
+                                if (mpCurrentFrame->mvpMapPoints[ip])
                                     sFound.insert(
-                                        mCurrentFrame.mvpMapPoints[ip]);
+                                        mpCurrentFrame->mvpMapPoints[ip]);
                             nadditional =
-                                matcher2.SearchByProjection(mCurrentFrame,
+                                matcher2.SearchByProjection(*mpCurrentFrame,
                                                             vpCandidateKFs[i],
                                                             sFound,
                                                             3,
@@ -3891,11 +4348,11 @@ bool Tracking::Relocalization()
                             if (nGood + nadditional >= 50)
                             {
                                 nGood =
-                                    Optimizer::PoseOptimization(&mCurrentFrame);
+                                    Optimizer::PoseOptimization(mpCurrentFrame);
 
-                                for (int io = 0; io < mCurrentFrame.N; io++)
-                                    if (mCurrentFrame.mvbOutlier[io])
-                                        mCurrentFrame.mvpMapPoints[io] = NULL;
+                                for (int io = 0; io < mpCurrentFrame->N; io++)
+                                    if (mpCurrentFrame->mvbOutlier[io])
+                                        mpCurrentFrame->mvpMapPoints[io] = NULL;
                             }
                         }
                     }
@@ -3919,7 +4376,8 @@ bool Tracking::Relocalization()
     }
     else
     {
-        mnLastRelocFrameId = mCurrentFrame.mnId;
+        mnLastRelocFrameId = mpCurrentFrame->mnId;
+        mbRelocalized      = true;
         cout << "Relocalized!!" << endl;
         return true;
     }
@@ -3969,10 +4427,11 @@ void Tracking::Reset(bool bLocMap)
     mlFrameTimes.clear();
     mlbLost.clear();
     // mCurrentFrame = Frame();
-    mCurrentFrame.reset();
+    mpCurrentFrame->reset();
     mnLastRelocFrameId = 0;
+    mbRelocalized      = false;
     // mLastFrame = Frame();
-    mLastFrame.reset();
+    mpLastFrame->reset();
     mpReferenceKF  = nullptr;
     mpLastKeyFrame = nullptr;
     mvIniMatches.clear();
@@ -4050,11 +4509,12 @@ void Tracking::ResetActiveMap(bool bLocMap)
 
     mlbLost = lbLost;
 
-    mnInitialFrameId   = mCurrentFrame.mnId;
-    mnLastRelocFrameId = mCurrentFrame.mnId;
+    mnInitialFrameId   = mpCurrentFrame->mnId;
+    mnLastRelocFrameId = mpCurrentFrame->mnId;
+    mbRelocalized      = false;
 
-    mCurrentFrame.reset();
-    mLastFrame.reset();
+    mpCurrentFrame->reset();
+    mpLastFrame->reset();
     mpReferenceKF  = nullptr;
     mpLastKeyFrame = nullptr;
     mvIniMatches.clear();
@@ -4145,69 +4605,72 @@ void Tracking::UpdateFrameIMU(const float      s,
 
     mpLastKeyFrame = pCurrentKeyFrame;
 
-    mLastFrame.SetNewBias(mLastBias);
-    mCurrentFrame.SetNewBias(mLastBias);
+    mpLastFrame->SetNewBias(mLastBias);
+    mpCurrentFrame->SetNewBias(mLastBias);
 
-    while (!mCurrentFrame.imuIsPreintegrated())
+    while (!mpCurrentFrame->imuIsPreintegrated())
     {
         // usleep(500);
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
     }
 
 
-    if (mLastFrame.mnId == mLastFrame.mpLastKeyFrame->mnFrameId)
+    if (mpLastFrame->mnId == mpLastFrame->mpLastKeyFrame->mnFrameId)
     {
-        mLastFrame.SetImuPoseVelocity(
-            mLastFrame.mpLastKeyFrame->GetImuRotation(),
-            mLastFrame.mpLastKeyFrame->GetImuPosition(),
-            mLastFrame.mpLastKeyFrame->GetVelocity());
+        mpLastFrame->SetImuPoseVelocity(
+            mpLastFrame->mpLastKeyFrame->GetImuRotation(),
+            mpLastFrame->mpLastKeyFrame->GetImuPosition(),
+            mpLastFrame->mpLastKeyFrame->GetVelocity());
     }
     else
     {
         const Eigen::Vector3f Gz(0, 0, -IMU::GRAVITY_VALUE);
         const Eigen::Vector3f twb1 =
-            mLastFrame.mpLastKeyFrame->GetImuPosition();
+            mpLastFrame->mpLastKeyFrame->GetImuPosition();
         const Eigen::Matrix3f Rwb1 =
-            mLastFrame.mpLastKeyFrame->GetImuRotation();
-        const Eigen::Vector3f Vwb1 = mLastFrame.mpLastKeyFrame->GetVelocity();
-        float                 t12  = mLastFrame.mpImuPreintegrated->dT;
+            mpLastFrame->mpLastKeyFrame->GetImuRotation();
+        const Eigen::Vector3f Vwb1 = mpLastFrame->mpLastKeyFrame->GetVelocity();
+        float                 t12  = mpLastFrame->mpImuPreintegrated->dT;
 
-        mLastFrame.SetImuPoseVelocity(
+        mpLastFrame->SetImuPoseVelocity(
             IMU::NormalizeRotation(
                 Rwb1 *
-                mLastFrame.mpImuPreintegrated->GetUpdatedDeltaRotation()),
+                mpLastFrame->mpImuPreintegrated->GetUpdatedDeltaRotation()),
             twb1 + Vwb1 * t12 + 0.5f * t12 * t12 * Gz +
-                Rwb1 * mLastFrame.mpImuPreintegrated->GetUpdatedDeltaPosition(),
+                Rwb1 *
+                    mpLastFrame->mpImuPreintegrated->GetUpdatedDeltaPosition(),
             Vwb1 + Gz * t12 +
                 Rwb1 *
-                    mLastFrame.mpImuPreintegrated->GetUpdatedDeltaVelocity());
+                    mpLastFrame->mpImuPreintegrated->GetUpdatedDeltaVelocity());
     }
 
-    if (mCurrentFrame.mpImuPreintegrated)
+    // Until the next frame is grabbed the current frame is also the last one,
+    // which was updated above
+    if (mpCurrentFrame != mpLastFrame && mpCurrentFrame->mpImuPreintegrated)
     {
         const Eigen::Vector3f Gz(0, 0, -IMU::GRAVITY_VALUE);
 
         const Eigen::Vector3f twb1 =
-            mCurrentFrame.mpLastKeyFrame->GetImuPosition();
+            mpCurrentFrame->mpLastKeyFrame->GetImuPosition();
         const Eigen::Matrix3f Rwb1 =
-            mCurrentFrame.mpLastKeyFrame->GetImuRotation();
+            mpCurrentFrame->mpLastKeyFrame->GetImuRotation();
         const Eigen::Vector3f Vwb1 =
-            mCurrentFrame.mpLastKeyFrame->GetVelocity();
-        float t12 = mCurrentFrame.mpImuPreintegrated->dT;
+            mpCurrentFrame->mpLastKeyFrame->GetVelocity();
+        float t12 = mpCurrentFrame->mpImuPreintegrated->dT;
 
-        mCurrentFrame.SetImuPoseVelocity(
+        mpCurrentFrame->SetImuPoseVelocity(
             IMU::NormalizeRotation(
                 Rwb1 *
-                mCurrentFrame.mpImuPreintegrated->GetUpdatedDeltaRotation()),
+                mpCurrentFrame->mpImuPreintegrated->GetUpdatedDeltaRotation()),
             twb1 + Vwb1 * t12 + 0.5f * t12 * t12 * Gz +
-                Rwb1 *
-                    mCurrentFrame.mpImuPreintegrated->GetUpdatedDeltaPosition(),
+                Rwb1 * mpCurrentFrame->mpImuPreintegrated
+                           ->GetUpdatedDeltaPosition(),
             Vwb1 + Gz * t12 +
-                Rwb1 * mCurrentFrame.mpImuPreintegrated
+                Rwb1 * mpCurrentFrame->mpImuPreintegrated
                            ->GetUpdatedDeltaVelocity());
     }
 
-    mnFirstImuFrameId = mCurrentFrame.mnId;
+    mnFirstImuFrameId = mpCurrentFrame->mnId;
 }
 
 void Tracking::NewDataset()
@@ -22,6 +22,7 @@
 
 #ifndef TRACKING_H
 #define TRACKING_H
+#include <atomic>
 #include <mutex>
 #include <unordered_set>
 
@@ -36,6 +37,7 @@
 #include "frame/KeyFrameDatabase.h"
 #include "utils/ImuTypes.h"
 #include "utils/Settings.h"
+#include "utils/ThreadPool.h"
 
 #include "camera_models/GeometricCamera.h"
 
@@ -91,6 +93,34 @@ public:
                                     const double&  timestamp,
                                     string         filename);
 
+    // Feature stage of the pipelined front-end (see FrontEnd). Converts the
+    // input to grayscale in imGray and builds frame from it, reading only the
+    // configuration of the tracker, so that it can run while Track()
+    // processes the previous frame. Frames are built without link to the
+    // last frame, detection mask nor optical flow.
+    void PrepareFrameStereo(const cv::Mat& imRectLeft,
+                            const cv::Mat& imRectRight,
+                            const double&  timestamp,
+                            Frame&         frame,
+                            cv::Mat&       imGray);
+
+    void PrepareFrameRGBD(const cv::Mat& imRGB,
+                          const cv::Mat& imD,
+                          const double&  timestamp,
+                          Frame&         frame,
+                          cv::Mat&       imGray);
+
+    void PrepareFrameMonocular(const cv::Mat& im,
+                               const double&  timestamp,
+                               Frame&         frame,
+                               cv::Mat&       imGray);
+
+    // Tracking stage of the pipelined front-end. Takes over a frame built by
+    // PrepareFrame*(), tracks it and returns its pose.
+    Sophus::SE3f TrackFrame(Frame&         frame,
+                            const cv::Mat& imGray,
+                            string         filename);
+
     void GrabImuData(const IMU::Point& imuMeasurement);
 
     void SetLocalMapper(LocalMapping* pLocalMapper);
@@ -156,9 +186,11 @@ public:
     // Input sensor
     int mSensor;
 
-    // Current Frame
-    Frame mCurrentFrame;
-    Frame mLastFrame;
+    // Current and last frames, kept in a ring of reusable slots. The current
+    // frame becomes the last one by pointer, without a copy.
+    Frame  mFrameSlots[2];
+    Frame* mpCurrentFrame{ mFrameSlots };
+    Frame* mpLastFrame{ mFrameSlots + 1 };
 
     cv::Mat mImGray;
 
@@ -243,6 +275,51 @@ protected:
     // Perform preintegration from last frame
     void PreintegrateIMU();
 
+    // Detection mask for the next frame when incremental extraction is on.
+    // Image blocks that already hold their share of the feature budget in
+    // points tracked by the last frame are masked, except around those
+    // points so that they can still be matched. Empty if not used.
+    cv::Mat ComputeDetectionMask();
+
+    // Tracks the inliers of the last frame in the current image with
+    // pyramidal Lucas-Kanade on the ORB pyramid levels and optimizes the pose
+    // on these correspondences, without ORB extraction (OK_KLT). Only tried
+    // on frames unlikely to become keyframes. Returns false if the frame has
+    // to be extracted and tracked as usual.
+    bool TrackWithOpticalFlow(const cv::Mat& imDepth, const double& timestamp);
+
+    // Slot where the next frame is built, the one not holding the last frame
+    Frame* NextFrameSlot();
+
+    // Input image in grayscale, im itself if it already is
+    void ConvertToGray(const cv::Mat& im, cv::Mat& imGray) const;
+
+    // Whether the next monocular frame is extracted with mpIniORBextractor
+    bool UseInitialExtractor() const;
+
+    // Frame construction for each sensor. pPrevF is the last frame for
+    // inertial sensors when it already exists, mask the detection mask.
+    void BuildFrameStereo(Frame&         frame,
+                          const cv::Mat& imLeft,
+                          const cv::Mat& imRight,
+                          const double&  timestamp,
+                          Frame*         pPrevF,
+                          const cv::Mat& mask);
+
+    void BuildFrameRGBD(Frame&         frame,
+                        const cv::Mat& imGray,
+                        const cv::Mat& imDepth,
+                        const double&  timestamp,
+                        Frame*         pPrevF,
+                        const cv::Mat& mask);
+
+    void BuildFrameMonocular(Frame&         frame,
+                             const cv::Mat& imGray,
+                             const double&  timestamp,
+                             bool           bInitial,
+                             Frame*         pPrevF,
+                             const cv::Mat& mask);
+
     // Reset IMU biases and compute frame velocity
     void ResetFrameIMU();
 
@@ -280,10 +357,42 @@ protected:
     ORBextractor *mpORBextractorLeft, *mpORBextractorRight;
     ORBextractor* mpIniORBextractor;
 
+    // UseInitialExtractor() after the last tracked frame, read by the feature
+    // stage of the pipelined front-end instead of the tracking state
+    std::atomic<bool> mbInitialExtractor{ true };
+
+    // Incremental extraction, buffers reused from frame to frame
+    bool                     mbIncrementalORB{ false };
+    cv::Mat                  mDetectionMask;
+    std::vector<int>         mvBlockTracked;
+    std::vector<cv::Point2f> mvTrackedProjections;
+
+    // Optical flow tracking of non-keyframes. mbFlowFrame tells whether the
+    // current frame was tracked that way, mbForceExtraction that the next one
+    // must not be. Buffers reused from frame to frame.
+    bool                     mbOpticalFlow{ false };
+    bool                     mbFlowFrame{ false };
+    bool                     mbForceExtraction{ false };
+    int                      mnFlowRefInliers{ 0 };
+    std::vector<int>         mvFlowIndices;
+    std::vector<cv::Point2f> mvFlowPrevPts;
+    std::vector<cv::Point2f> mvFlowPts;
+    std::vector<cv::Point2f> mvFlowLevelPrevPts;
+    std::vector<cv::Point2f> mvFlowLevelPts;
+    std::vector<uchar>       mvFlowStatus;
+    std::vector<float>       mvFlowErr;
+    std::vector<MapPoint*>   mvpFlowOutliers;
+
+    // Threads matching the local map, none when it is searched serially
+    std::unique_ptr<ThreadPool> mpMatcherPool;
+
     // BoW
     ORBVocabulary*    mpORBVocabulary;
     KeyFrameDatabase* mpKeyFrameDB;
 
+    // Scratch of the relocalization queries of this thread
+    KeyFrameDatabase::QueryContext mRelocContext;
+
     // Initalization (only for monocular)
     bool mbReadyToInitializate;
     bool mbSetInit;
@@ -334,6 +443,7 @@ protected:
     KeyFrame*    mpLastKeyFrame;
     unsigned int mnLastKeyFrameId;
     unsigned int mnLastRelocFrameId;
+    bool         mbRelocalized;  // mnLastRelocFrameId is a relocalisation
     double       mTimeStampLost;
     double       time_recently_lost;
 
@@ -197,9 +197,17 @@ int    main(int argc, char* argv[])
     auto settings = new ORB_SLAM3::Settings(settingDesc);
 
     std::cout << "Start loading vocabulary from " << argv[1] << std::endl;
+    auto tVoc0      = std::chrono::steady_clock::now();
     auto vocabulary = new ORB_SLAM3::ORBVocabulary();
-    vocabulary->loadFromTextFile(argv[1]);
-    std::cout << "Vocabulary loaded." << std::endl;
+    if (!ORB_SLAM3::LoadORBVocabulary(vocabulary, argv[1]))
+    {
+        std::cerr << "Failed to load the vocabulary." << std::endl;
+        return 1;
+    }
+    auto tVoc1 = std::chrono::steady_clock::now();
+    std::cout << "Vocabulary loaded in "
+              << std::chrono::duration<double>(tVoc1 - tVoc0).count() << " s."
+              << std::endl;
 
     ORB_SLAM3::System SLAM(
         vocabulary,
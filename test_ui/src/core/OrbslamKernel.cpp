@@ -45,13 +45,27 @@ Sophus::SE3f OrbslamKernel::track(const std::vector<ImgData>& imgs,
                                 imu.time_stamp * 1e-9);
     }
 
-    Sophus::SE3f pose = m_orb_system.TrackMonocular(imgs[0].image,
-                                                    imgs[0].time_stamp * 1e-9,
-                                                    imu_points);
+    m_orb_system.SubmitMonocular(
+        imgs[0].image,
+        imgs[0].time_stamp * 1e-9,
+        imu_points,
+        [this](const ORB_SLAM3::System::TrackResult& result)
+        {
+            if (result.bDropped)
+            {
+                APP_WARN("Frame at {0} s dropped, tracking is lagging.",
+                         result.timestamp);
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(m_pose_mutex);
+            m_latest_pose = result.Tcw;
+        });
 
     APP_INFO("\n");
 
-    return pose;
+    std::lock_guard<std::mutex> lock(m_pose_mutex);
+    return m_latest_pose;
 }
 
 auto OrbslamKernel::getPointCloudVetices() -> std::vector<PointVertex>
@@ -69,19 +83,23 @@ auto OrbslamKernel::getPointCloudVetices() -> std::vector<PointVertex>
                         glm::vec3(1.0f, 0.0f, 0.0f) });
     }
 
-    auto all_mp = m_orb_system.getAtlas().GetAllMapPoints();
-    for (auto mp : all_mp)
-    {
-        if (!mp || mp->isBad() || local_mp_ust.find(mp) != local_mp_ust.end())
-            continue;
-        auto eigen_pos = mp->GetWorldPos();
-        pvs.push_back({ glm::vec3(eigen_pos.x(), eigen_pos.y(), eigen_pos.z()),
-                        glm::vec3(1.0f, 1.0f, 1.0f) });
-    }
+    size_t all_mp_count = 0;
+    m_orb_system.getAtlas().ForEachMapPoint(
+        [&](ORB_SLAM3::MapPoint* mp)
+        {
+            all_mp_count++;
+            if (!mp || mp->isBad() ||
+                local_mp_ust.find(mp) != local_mp_ust.end())
+                return;
+            auto eigen_pos = mp->GetWorldPos();
+            pvs.push_back(
+                { glm::vec3(eigen_pos.x(), eigen_pos.y(), eigen_pos.z()),
+                  glm::vec3(1.0f, 1.0f, 1.0f) });
+        });
 
     APP_INFO("Global map point count: {0}. Local map point count: {1}",
              local_mp.size(),
-             all_mp.size());
+             all_mp_count);
 
     return pvs;
 }
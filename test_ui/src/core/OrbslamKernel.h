@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include <Core/System.h>
@@ -18,6 +19,8 @@ public:
     OrbslamKernel(const OrbslamKernel&)            = delete;
     OrbslamKernel& operator=(const OrbslamKernel&) = delete;
 
+    // Submits the frame without waiting for it to be tracked and returns the
+    // pose of the last tracked frame
     Sophus::SE3f track(const std::vector<ImgData>& imgs,
                        const std::vector<ImuData>& imus) override;
 
@@ -32,5 +35,10 @@ public:
     }
 
 private:
+    // Written by the tracking callback, declared before the system so that
+    // it outlives the SLAM threads
+    std::mutex   m_pose_mutex;
+    Sophus::SE3f m_latest_pose;
+
     ORB_SLAM3::System m_orb_system;
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdlib>
 #include <fstream>
@@ -151,8 +152,19 @@ int main(int argc, char** argv)
         APP_INFO("ORBSLAM System initializing, please wait.");
         auto settings =
             new ORB_SLAM3::Settings(helper::getDefaultSettingDesc());
-        auto vocabulary = new ORB_SLAM3::ORBVocabulary();
-        vocabulary->loadFromTextFile(vocabulary_path);
+        const auto voc_begin  = std::chrono::steady_clock::now();
+        auto       vocabulary = new ORB_SLAM3::ORBVocabulary();
+        if (!ORB_SLAM3::LoadORBVocabulary(vocabulary, vocabulary_path))
+        {
+            APP_ERROR("Failed to load the vocabulary from {}.",
+                      vocabulary_path);
+            glfwTerminate();
+            return -1;
+        }
+        APP_INFO("Vocabulary loaded in {:.3f} s.",
+                 std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - voc_begin)
+                     .count());
 
         auto slam_kernel = new OrbslamKernel(settings, vocabulary);
         APP_INFO("ORBSLAM System has been initialized.");
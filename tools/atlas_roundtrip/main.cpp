@@ -0,0 +1,323 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <Feature/ORBextractor.h>
+#include <Feature/ORBVocabulary.h>
+#include <Frame/KeyFrameDatabase.h>
+#include <Map/Atlas.h>
+#include <Map/AtlasFile.h>
+#include <camera_models/Pinhole.h>
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+static bool bFailed = false;
+
+static void Check(bool ok, const string& what)
+{
+    if (ok) return;
+    cerr << "Mismatch: " << what << endl;
+    bFailed = true;
+}
+
+// Objects by id, so both atlases are walked in the same order
+template <typename T>
+static map<unsigned long int, T*> ById(const vector<T*>& vp)
+{
+    map<unsigned long int, T*> mp;
+    for (T* p : vp) mp[p->mnId] = p;
+    return mp;
+}
+
+static long long int IdOf(KeyFrame* pKF)
+{
+    return pKF ? (long long int)pKF->mnId : -1;
+}
+
+static bool SameKeys(const vector<cv::KeyPoint>& vA,
+                     const vector<cv::KeyPoint>& vB)
+{
+    if (vA.size() != vB.size()) return false;
+    for (size_t i = 0; i < vA.size(); i++)
+    {
+        if (vA[i].pt != vB[i].pt || vA[i].octave != vB[i].octave ||
+            vA[i].angle != vB[i].angle || vA[i].response != vB[i].response)
+            return false;
+    }
+    return true;
+}
+
+static void CompareKeyFrames(KeyFrame* pA, KeyFrame* pB)
+{
+    const string kf = "keyframe " + to_string(pA->mnId);
+    Check(pA->N == pB->N, kf + " N");
+    Check(pA->mTimeStamp == pB->mTimeStamp, kf + " timestamp");
+    Check(pA->GetPose().matrix().isApprox(pB->GetPose().matrix(), 1e-6f),
+          kf + " pose");
+    Check(SameKeys(pA->mvKeys, pB->mvKeys), kf + " keys");
+    Check(SameKeys(pA->mvKeysUn, pB->mvKeysUn), kf + " undistorted keys");
+    Check(pA->mvPackedDescriptors.size() == pB->mvPackedDescriptors.size() &&
+              memcmp(pA->mvPackedDescriptors.data(),
+                     pB->mvPackedDescriptors.data(),
+                     pA->mvPackedDescriptors.size() *
+                         sizeof(ORBkernels::Descriptor)) == 0,
+          kf + " descriptors");
+    Check(pA->mvScaleFactors == pB->mvScaleFactors, kf + " scale factors");
+    Check(pA->mBowVec == pB->mBowVec, kf + " bag of words");
+    Check(pA->mFeatVec == pB->mFeatVec, kf + " feature vector");
+    Check(IdOf(pA->GetParent()) == IdOf(pB->GetParent()), kf + " parent");
+
+    const vector<MapPoint*> vpA = pA->GetMapPointMatches();
+    const vector<MapPoint*> vpB = pB->GetMapPointMatches();
+    bool                    bSameMatches = vpA.size() == vpB.size();
+    for (size_t i = 0; bSameMatches && i < vpA.size(); i++)
+        bSameMatches = (!vpA[i] && !vpB[i]) ||
+                       (vpA[i] && vpB[i] && vpA[i]->mnId == vpB[i]->mnId);
+    Check(bSameMatches, kf + " map point matches");
+
+    map<unsigned long int, int> connectionsA, connectionsB;
+    for (KeyFrame* pKF : pA->GetConnectedKeyFrames())
+        connectionsA[pKF->mnId] = pA->GetWeight(pKF);
+    for (KeyFrame* pKF : pB->GetConnectedKeyFrames())
+        connectionsB[pKF->mnId] = pB->GetWeight(pKF);
+    Check(connectionsA == connectionsB, kf + " covisibility");
+
+    // The grid, through the features found around the image center
+    const float x = (pA->mnMinX + pA->mnMaxX) / 2;
+    const float y = (pA->mnMinY + pA->mnMaxY) / 2;
+    Check(pA->GetFeaturesInArea(x, y, 100.f) ==
+              pB->GetFeaturesInArea(x, y, 100.f),
+          kf + " grid");
+}
+
+static void CompareMapPoints(MapPoint* pA, MapPoint* pB)
+{
+    const string mp = "map point " + to_string(pA->mnId);
+    Check(pA->GetWorldPos() == pB->GetWorldPos(), mp + " position");
+    Check(IdOf(pA->GetReferenceKeyFrame()) == IdOf(pB->GetReferenceKeyFrame()),
+          mp + " reference keyframe");
+
+    const ORBkernels::Descriptor dA = pA->GetPackedDescriptor();
+    const ORBkernels::Descriptor dB = pB->GetPackedDescriptor();
+    Check(memcmp(dA.w, dB.w, sizeof(dA.w)) == 0, mp + " descriptor");
+
+    map<unsigned long int, tuple<int, int>> observationsA, observationsB;
+    for (const ObservationList::value_type& ob : pA->GetObservations())
+        observationsA[ob.first->mnId] = ob.second;
+    for (const ObservationList::value_type& ob : pB->GetObservations())
+        observationsB[ob.first->mnId] = ob.second;
+    Check(observationsA == observationsB, mp + " observations");
+}
+
+// Saves the atlas and loads it back, true if the load is refused
+static bool IsRefused(Atlas& atlas, ORBVocabulary& voc, const string& filename)
+{
+    if (!AtlasFile::Save(&atlas, &voc, filename)) return false;
+
+    KeyFrameDatabase kfdb(voc);
+    return AtlasFile::Load(filename, &voc, &kfdb) == nullptr;
+}
+
+// Builds a synthetic atlas of two maps, monocular keyframes extracted from
+// random images and map points seen by several of them, saves it with
+// AtlasFile and compares what is loaded back with the original. Then checks
+// that files whose per feature arrays do not match the keyframe are refused.
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3)
+    {
+        cerr << endl
+             << "Usage: ./atlas_roundtrip path_to_vocabulary "
+                "[path_to_atlas_file]"
+             << endl;
+        return 1;
+    }
+    const string filename = argc == 3 ? argv[2] : "atlas_roundtrip.atlas";
+
+    ORBVocabulary voc;
+    if (!LoadORBVocabulary(&voc, argv[1]))
+    {
+        cerr << "Failed to load the vocabulary " << argv[1] << endl;
+        return 1;
+    }
+
+    ORBextractor     extractor(1000, 1.2f, 8, 20, 7);
+    KeyFrameDatabase kfdb(voc);
+    Atlas            atlas(0);
+    atlas.SetKeyFrameDababase(&kfdb);
+    atlas.SetORBVocabulary(&voc);
+    GeometricCamera* pCamera = atlas.AddCamera(
+        new Pinhole(vector<float>{ 458.f, 457.f, 367.f, 248.f }));
+    cv::Mat distCoef = cv::Mat::zeros(4, 1, CV_32F);
+
+    cv::RNG   rng(0);
+    const int nMaps = 2, nKeyFrames = 6, nPoints = 400;
+    for (int m = 0; m < nMaps; m++)
+    {
+        if (m > 0) atlas.CreateNewMap();
+        Map* pMap = atlas.GetCurrentMap();
+
+        vector<KeyFrame*> vpKFs;
+        for (int k = 0; k < nKeyFrames; k++)
+        {
+            cv::Mat im(480, 752, CV_8U);
+            rng.fill(im, cv::RNG::UNIFORM, 0, 255);
+            cv::GaussianBlur(im, im, cv::Size(5, 5), 1.5);
+
+            Frame frame(im,
+                        m * nKeyFrames + k,
+                        &extractor,
+                        &voc,
+                        pCamera,
+                        distCoef,
+                        0.f,
+                        0.f);
+            const Eigen::Vector3f w(0.f, 0.02f * k, 0.f);
+            const Eigen::Vector3f t(0.1f * k, 0.f, 0.f);
+            frame.SetPose(Sophus::SE3f(Sophus::SO3f::exp(w), t));
+
+            KeyFrame* pKF = new KeyFrame(frame, pMap, &kfdb);
+            pKF->ComputeBoW();
+            atlas.AddKeyFrame(pKF);
+            vpKFs.push_back(pKF);
+        }
+
+        // Point i is seen at keypoint i by two keyframes out of three
+        for (int i = 0; i < nPoints; i++)
+        {
+            MapPoint* pMP = nullptr;
+            for (size_t k = 0; k < vpKFs.size(); k++)
+            {
+                KeyFrame* pKF = vpKFs[k];
+                if (i >= pKF->N || (i + k) % 3 == 0) continue;
+                if (!pMP)
+                    pMP = new MapPoint(
+                        Eigen::Vector3f(rng.uniform(-1.f, 1.f),
+                                        rng.uniform(-1.f, 1.f),
+                                        rng.uniform(2.f, 5.f)),
+                        pKF,
+                        pMap);
+                pKF->AddMapPoint(pMP, i);
+                pMP->AddObservation(pKF, i);
+            }
+            if (!pMP) continue;
+            pMP->ComputeDistinctiveDescriptors();
+            pMP->UpdateNormalAndDepth();
+            atlas.AddMapPoint(pMP);
+        }
+        for (KeyFrame* pKF : vpKFs) pKF->UpdateConnections();
+    }
+
+    if (!AtlasFile::Save(&atlas, &voc, filename)) return 1;
+    KeyFrameDatabase kfdbLoaded(voc);
+    Atlas* pLoaded = AtlasFile::Load(filename, &voc, &kfdbLoaded);
+    if (!pLoaded)
+    {
+        cerr << "Failed to load the atlas back" << endl;
+        return 1;
+    }
+
+    map<unsigned long int, Map*> maps, mapsLoaded;
+    for (Map* pMap : atlas.GetAllMaps()) maps[pMap->GetId()] = pMap;
+    for (Map* pMap : pLoaded->GetAllMaps()) mapsLoaded[pMap->GetId()] = pMap;
+    Check(maps.size() == mapsLoaded.size(), "number of maps");
+    for (const pair<const unsigned long int, Map*>& entry : maps)
+    {
+        if (!mapsLoaded.count(entry.first))
+        {
+            Check(false, "map " + to_string(entry.first));
+            continue;
+        }
+        Map* pMap       = entry.second;
+        Map* pMapLoaded = mapsLoaded.at(entry.first);
+
+        const map<unsigned long int, KeyFrame*> kfs =
+            ById(pMap->GetAllKeyFrames());
+        const map<unsigned long int, KeyFrame*> kfsLoaded =
+            ById(pMapLoaded->GetAllKeyFrames());
+        Check(kfs.size() == kfsLoaded.size(), "number of keyframes");
+        for (const pair<const unsigned long int, KeyFrame*>& kf : kfs)
+        {
+            if (kfsLoaded.count(kf.first))
+                CompareKeyFrames(kf.second, kfsLoaded.at(kf.first));
+            else
+                Check(false, "keyframe " + to_string(kf.first));
+        }
+
+        const map<unsigned long int, MapPoint*> mps =
+            ById(pMap->GetAllMapPoints());
+        const map<unsigned long int, MapPoint*> mpsLoaded =
+            ById(pMapLoaded->GetAllMapPoints());
+        Check(mps.size() == mpsLoaded.size(), "number of map points");
+        for (const pair<const unsigned long int, MapPoint*>& mp : mps)
+        {
+            if (mpsLoaded.count(mp.first))
+                CompareMapPoints(mp.second, mpsLoaded.at(mp.first));
+            else
+                Check(false, "map point " + to_string(mp.first));
+        }
+    }
+
+    // Each corruption is undone before the next one
+    KeyFrame* pKF = atlas.GetAllKeyFrames()[0];
+
+    vector<float>& vScaleFactors =
+        const_cast<vector<float>&>(pKF->mvScaleFactors);
+    vScaleFactors.push_back(vScaleFactors.back());
+    Check(IsRefused(atlas, voc, filename), "extra scale factor accepted");
+    vScaleFactors.pop_back();
+
+    vector<cv::KeyPoint>& vKeysUn =
+        const_cast<vector<cv::KeyPoint>&>(pKF->mvKeysUn);
+    const cv::KeyPoint kpLast = vKeysUn.back();
+    vKeysUn.pop_back();
+    Check(IsRefused(atlas, voc, filename), "missing keypoint accepted");
+    vKeysUn.push_back(kpLast);
+
+    vector<cv::KeyPoint>& vKeys =
+        const_cast<vector<cv::KeyPoint>&>(pKF->mvKeys);
+    const int octave = vKeys[0].octave;
+    vKeys[0].octave  = pKF->mnScaleLevels;
+    Check(IsRefused(atlas, voc, filename), "keypoint octave accepted");
+    vKeys[0].octave = octave;
+
+    pKF->mvLeftToRightMatch.assign(1, 0);
+    Check(IsRefused(atlas, voc, filename),
+          "stereo match of a monocular keyframe accepted");
+    pKF->mvLeftToRightMatch.clear();
+
+    remove(filename.c_str());
+    if (bFailed) return 1;
+    cout << "Atlas round trip OK: " << maps.size() << " maps" << endl;
+    return 0;
+}
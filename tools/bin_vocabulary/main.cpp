@@ -0,0 +1,80 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <iostream>
+
+#include <Feature/ORBVocabulary.h>
+
+using namespace std;
+
+// Converts a text ORB vocabulary to the binary format read by
+// ORB_SLAM3::LoadORBVocabulary, then reports the load time of both files.
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        cerr << endl
+             << "Usage: ./bin_vocabulary path_to_text_vocabulary "
+                "path_to_binary_vocabulary"
+             << endl;
+        return 1;
+    }
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    ORB_SLAM3::ORBVocabulary         textVoc;
+    if (!textVoc.loadFromTextFile(argv[1]))
+    {
+        cerr << "Failed to load the text vocabulary " << argv[1] << endl;
+        return 1;
+    }
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+    if (!textVoc.saveToBinaryFile(argv[2]))
+    {
+        cerr << "Failed to write the binary vocabulary " << argv[2] << endl;
+        return 1;
+    }
+
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+    ORB_SLAM3::ORBVocabulary         binaryVoc;
+    if (!ORB_SLAM3::LoadORBVocabulary(&binaryVoc, argv[2]))
+    {
+        cerr << "Failed to load the binary vocabulary back" << endl;
+        return 1;
+    }
+    chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+
+    if (binaryVoc.size() != textVoc.size())
+    {
+        cerr << "The binary vocabulary has " << binaryVoc.size()
+             << " words, the text one " << textVoc.size() << endl;
+        return 1;
+    }
+
+    cout << textVoc << endl;
+    cout << "Text load:   " << chrono::duration<double>(t1 - t0).count()
+         << " s" << endl;
+    cout << "Binary load: " << chrono::duration<double>(t3 - t2).count()
+         << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <Feature/ORBextractor.h>
+
+using namespace std;
+
+// Gives access to the keypoint distributors of the extractor.
+class DistributionBench : public ORB_SLAM3::ORBextractor
+{
+public:
+    DistributionBench()
+        : ORBextractor(1000, 1.2f, 8, 20, 7)
+    {
+    }
+
+    void Distribute(DistributionMode            mode,
+                    const vector<cv::KeyPoint>& vKeys,
+                    int                         width,
+                    int                         height,
+                    int                         nFeatures,
+                    vector<cv::KeyPoint>&       vResult)
+    {
+        if (mode == DISTRIBUTE_QUADTREE)
+            DistributeQuadTree(vKeys, 0, width, 0, height, nFeatures, 0,
+                               vResult);
+        else
+            DistributeOctTree(vKeys, 0, width, 0, height, nFeatures, 0,
+                              vResult);
+    }
+};
+
+// FAST like candidates: most of them in textured blobs, the rest spread over
+// the level. Several FAST cells can return the same corner.
+static void MakeCandidates(int                   nKeys,
+                           int                   width,
+                           int                   height,
+                           mt19937&              rng,
+                           vector<cv::KeyPoint>& vKeys)
+{
+    uniform_real_distribution<float> x(0.f, width - 1.f), y(0.f, height - 1.f);
+    uniform_real_distribution<float> response(7.f, 100.f);
+    normal_distribution<float>       spread(0.f, 15.f);
+
+    vector<cv::Point2f> vBlobs(20);
+    for (cv::Point2f& blob : vBlobs) blob = cv::Point2f(x(rng), y(rng));
+
+    vKeys.clear();
+    while ((int)vKeys.size() < nKeys)
+    {
+        cv::Point2f pt;
+        if (rng() % 4 == 0)
+        {
+            pt = cv::Point2f(x(rng), y(rng));
+        }
+        else
+        {
+            const cv::Point2f& blob = vBlobs[rng() % vBlobs.size()];
+            pt = cv::Point2f(blob.x + spread(rng), blob.y + spread(rng));
+            if (pt.x < 0 || pt.y < 0 || pt.x >= width || pt.y >= height)
+                continue;
+        }
+        pt.x = (int)pt.x;
+        pt.y = (int)pt.y;
+        vKeys.push_back(cv::KeyPoint(pt, 7.f, -1, response(rng)));
+        if (rng() % 20 == 0) vKeys.push_back(vKeys.back());
+    }
+    vKeys.resize(nKeys);
+}
+
+// Cells of 32x32 pixels holding at least one of the keys.
+static int CountCells(const vector<cv::KeyPoint>& vKeys)
+{
+    set<pair<int, int> > cells;
+    for (const cv::KeyPoint& kp : vKeys)
+        cells.insert(make_pair((int)kp.pt.x / 32, (int)kp.pt.y / 32));
+    return cells.size();
+}
+
+// Times DistributeOctTree and DistributeQuadTree on the same random FAST
+// candidates of a 640x480 level (608x448 without borders).
+int main(int argc, char* argv[])
+{
+    const int nRuns = argc > 1 ? atoi(argv[1]) : 200;
+    if (nRuns <= 0)
+    {
+        cerr << endl << "Usage: ./distribution_bench [number_of_runs]" << endl;
+        return 1;
+    }
+
+    const int width = 608, height = 448;
+    const int vnKeys[]     = {1000, 5000, 20000};
+    const int vnFeatures[] = {60, 200, 400, 1000};
+
+    DistributionBench    bench;
+    mt19937              rng(0);
+    vector<cv::KeyPoint> vKeys, vResult;
+
+    cout << "candidates features | octree us keys cells"
+         << " | quadtree us keys cells" << endl;
+    for (int nKeys : vnKeys)
+    {
+        MakeCandidates(nKeys, width, height, rng, vKeys);
+        for (int nFeatures : vnFeatures)
+        {
+            cout << nKeys << " " << nFeatures;
+            for (int m = 0; m < 2; m++)
+            {
+                const ORB_SLAM3::ORBextractor::DistributionMode mode =
+                    m == 0 ? ORB_SLAM3::ORBextractor::DISTRIBUTE_OCTREE
+                           : ORB_SLAM3::ORBextractor::DISTRIBUTE_QUADTREE;
+
+                // First call warms up the scratch memory
+                bench.Distribute(mode, vKeys, width, height, nFeatures,
+                                 vResult);
+
+                chrono::steady_clock::time_point t0 =
+                    chrono::steady_clock::now();
+                for (int r = 0; r < nRuns; r++)
+                    bench.Distribute(mode, vKeys, width, height, nFeatures,
+                                     vResult);
+                chrono::steady_clock::time_point t1 =
+                    chrono::steady_clock::now();
+
+                const double us =
+                    chrono::duration<double, micro>(t1 - t0).count() / nRuns;
+                cout << " | " << us << " " << vResult.size() << " "
+                     << CountCells(vResult);
+            }
+            cout << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <Feature/ORBextractor.h>
+
+using namespace std;
+using ORB_SLAM3::ORBextractor;
+
+// Heap allocations done while bCounting is set, counted by the operator new
+// below. They are split by the library they were made from: OpenCV keeps
+// scratch memory of its own (FAST, resize, GaussianBlur) which the extractor
+// has no control over, everything else is counted as the extractor's.
+static atomic<bool>   bCounting(false);
+static atomic<size_t> nOwnAllocations(0);
+static atomic<size_t> nOpenCVAllocations(0);
+
+static bool CalledFromOpenCV(void* pCaller)
+{
+    Dl_info info;
+    return dladdr(pCaller, &info) && info.dli_fname &&
+           strstr(info.dli_fname, "opencv");
+}
+
+static void* Allocate(size_t size, void* pCaller)
+{
+    if (bCounting)
+    {
+        if (CalledFromOpenCV(pCaller))
+            ++nOpenCVAllocations;
+        else
+            ++nOwnAllocations;
+    }
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size)
+{
+    return Allocate(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size)
+{
+    return Allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// Checks that ORBextractor::operator() does not allocate once a few images
+// of the same size went through it, for both distribution modes, with and
+// without its thread pool. The keypoints and descriptors of every image are
+// kept from one pass to the next, so that the caller's outputs already have
+// the right size. OpenCV must be linked dynamically for its allocations to
+// be told apart.
+int main(int argc, char* argv[])
+{
+    const int nFrames = argc > 1 ? atoi(argv[1]) : 100;
+    if (nFrames <= 0)
+    {
+        cerr << endl << "Usage: ./extractor_alloc [number_of_frames]" << endl;
+        return 1;
+    }
+
+    // Serial OpenCV, the allocations of a parallel backend such as TBB
+    // would be counted as the extractor's
+    cv::setNumThreads(0);
+
+    const int       nImages = 4;
+    vector<cv::Mat> vImages(nImages);
+    for (cv::Mat& im : vImages)
+    {
+        im.create(480, 752, CV_8U);
+        cv::randu(im, 0, 255);
+        cv::GaussianBlur(im, im, cv::Size(5, 5), 1.5);
+    }
+
+    const ORBextractor::DistributionMode vModes[] = {
+        ORBextractor::DISTRIBUTE_OCTREE,
+        ORBextractor::DISTRIBUTE_QUADTREE
+    };
+    const int vThreads[] = { 1, 4 };
+
+    int nErrors = 0;
+    for (const ORBextractor::DistributionMode mode : vModes)
+    {
+        for (const int nThreads : vThreads)
+        {
+            ORBextractor extractor(1000, 1.2f, 8, 20, 7);
+            extractor.SetDistributionMode(mode);
+            extractor.SetNumThreads(nThreads);
+
+            vector<vector<cv::KeyPoint>> vKeys(nImages);
+            vector<cv::Mat>              vDescriptors(nImages);
+            vector<int>                  vLapping = { 0, 0 };
+            const cv::Mat                mask;
+
+            // Warm up, two passes over the images
+            for (int i = 0; i < 2 * nImages; i++)
+                extractor(vImages[i % nImages],
+                          mask,
+                          vKeys[i % nImages],
+                          vDescriptors[i % nImages],
+                          vLapping);
+
+            nOwnAllocations    = 0;
+            nOpenCVAllocations = 0;
+            bCounting          = true;
+            for (int i = 0; i < nFrames; i++)
+                extractor(vImages[i % nImages],
+                          mask,
+                          vKeys[i % nImages],
+                          vDescriptors[i % nImages],
+                          vLapping);
+            bCounting = false;
+
+            const size_t nOwn    = nOwnAllocations;
+            const size_t nOpenCV = nOpenCVAllocations;
+            cout << (mode == ORBextractor::DISTRIBUTE_OCTREE ? "octree"
+                                                             : "quadtree")
+                 << ", " << nThreads << " thread(s): " << nOwn
+                 << " allocations in the extractor, "
+                 << double(nOpenCV) / nFrames
+                 << " per frame in OpenCV" << endl;
+            if (nOwn != 0)
+            {
+                cerr << "FAILED: the extractor allocated " << nOwn
+                     << " times over " << nFrames << " frames" << endl;
+                ++nErrors;
+            }
+        }
+    }
+
+    if (nErrors > 0) return 1;
+    cout << "ORBextractor: no allocation once warmed up" << endl;
+    return 0;
+}
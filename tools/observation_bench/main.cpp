@@ -0,0 +1,133 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <Map/ObservationList.h>
+
+using namespace std;
+using ORB_SLAM3::KeyFrame;
+using ORB_SLAM3::ObservationList;
+
+// Bytes allocated on the heap, counted by the operator new below. The size
+// is stored in front of every block.
+static size_t nHeapBytes = 0;
+
+void* operator new(size_t size)
+{
+    size_t* p = static_cast<size_t*>(malloc(size + sizeof(size_t)));
+    if (!p) throw bad_alloc();
+    *p = size;
+    nHeapBytes += size;
+    return p + 1;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (!ptr) return;
+    size_t* p = static_cast<size_t*>(ptr) - 1;
+    nHeapBytes -= *p;
+    free(p);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void  operator delete[](void* p) noexcept { operator delete(p); }
+void  operator delete(void* p, size_t) noexcept { operator delete(p); }
+void  operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+typedef map<KeyFrame*, tuple<int, int>> ObservationMap;
+
+template <typename Observations>
+static void Fill(Observations& obs, int n, mt19937& rng)
+{
+    for (int k = 0; k < n; k++)
+    {
+        KeyFrame* pKF = reinterpret_cast<KeyFrame*>((rng() % 100000 + 1) * 64);
+        obs[pKF]      = make_tuple(k, -1);
+    }
+}
+
+// The work done by the callers of MapPoint::GetObservations: copy the
+// observations and visit them.
+template <typename Observations>
+static void Bench(const char* name, const vector<int>& vnObs, int nRuns)
+{
+    mt19937              rng(0);
+    vector<Observations> vObs(vnObs.size());
+    const size_t         nBytes0 = nHeapBytes;
+    for (size_t i = 0; i < vnObs.size(); i++) Fill(vObs[i], vnObs[i], rng);
+    const size_t nBytes = nHeapBytes - nBytes0;
+
+    long                             sum = 0;
+    chrono::steady_clock::time_point t0  = chrono::steady_clock::now();
+    for (int r = 0; r < nRuns; r++)
+    {
+        for (const Observations& obs : vObs)
+        {
+            const Observations copy = obs;
+            for (const auto& ob : copy) sum += get<0>(ob.second);
+        }
+    }
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+    const double ns = chrono::duration<double, nano>(t1 - t0).count() /
+                      (double(nRuns) * vObs.size());
+    cout << name << ": " << ns << " ns per copy and visit, "
+         << double(sizeof(Observations) * vObs.size() + nBytes) / vObs.size()
+         << " bytes per point (checksum " << sum % 1000 << ")" << endl;
+}
+
+// Compares the std::map the observations used to be stored in with
+// ObservationList on a synthetic map: most points are seen by two to a few
+// keyframes and a tail by many more.
+int main(int argc, char* argv[])
+{
+    const int nPoints = argc > 1 ? atoi(argv[1]) : 100000;
+    if (nPoints <= 0)
+    {
+        cerr << endl << "Usage: ./observation_bench [number_of_points]" << endl;
+        return 1;
+    }
+
+    mt19937                  rng(1);
+    geometric_distribution<> extra(0.3);
+    vector<int>              vnObs(nPoints);
+    double                   mean = 0;
+    for (int& n : vnObs)
+    {
+        n = min(2 + extra(rng), 40);
+        mean += n;
+    }
+    cout << nPoints << " points, " << mean / nPoints
+         << " observations per point on average" << endl;
+
+    Bench<ObservationMap>("std::map       ", vnObs, 20);
+    Bench<ObservationList>("ObservationList", vnObs, 20);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+
+#include <Map/ObservationList.h>
+
+using namespace std;
+using ORB_SLAM3::KeyFrame;
+using ORB_SLAM3::ObservationList;
+
+// Heap allocations done by this program, counted by the operator new below.
+static size_t nAllocations = 0;
+
+void* operator new(size_t size)
+{
+    ++nAllocations;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void  operator delete(void* p) noexcept { free(p); }
+void  operator delete[](void* p) noexcept { free(p); }
+void  operator delete(void* p, size_t) noexcept { free(p); }
+void  operator delete[](void* p, size_t) noexcept { free(p); }
+
+static int nErrors = 0;
+
+static void Check(bool bOk, const char* what)
+{
+    if (bOk) return;
+    cerr << "FAILED: " << what << endl;
+    ++nErrors;
+}
+
+static KeyFrame* FakeKeyFrame(size_t i)
+{
+    return reinterpret_cast<KeyFrame*>((i + 1) * 64);
+}
+
+static bool SameAs(const ObservationList&                 obs,
+                   const map<KeyFrame*, tuple<int, int>>& ref)
+{
+    if (obs.size() != ref.size()) return false;
+    for (const ObservationList::value_type& ob : obs)
+    {
+        auto it = ref.find(ob.first);
+        if (it == ref.end() || it->second != ob.second) return false;
+    }
+    return true;
+}
+
+// Checks that an ObservationList does not touch the heap while it holds at
+// most INLINE_CAPACITY observations, and that it keeps working once it
+// spilled to the heap. Random operations are compared with the std::map the
+// list replaced.
+int main()
+{
+    const size_t nInline = ObservationList::INLINE_CAPACITY;
+
+    {
+        size_t          n0 = nAllocations;
+        ObservationList obs;
+        for (size_t i = 0; i < nInline; ++i)
+            obs[FakeKeyFrame(i)] = make_tuple((int)i, -1);
+        ObservationList copy(obs);
+        ObservationList moved(move(copy));
+        obs.erase(FakeKeyFrame(0));
+        obs[FakeKeyFrame(nInline)] = make_tuple(0, 0);
+        Check(nAllocations == n0, "no allocation up to the inline capacity");
+        Check(moved.size() == nInline && copy.empty(), "inline move");
+        Check(obs.size() == nInline, "size after erase and insert");
+    }
+
+    {
+        size_t          n0 = nAllocations;
+        ObservationList obs;
+        for (size_t i = 0; i <= nInline; ++i)
+            obs[FakeKeyFrame(i)] = make_tuple((int)i, (int)i + 1);
+        Check(nAllocations == n0 + 1, "one allocation when spilling");
+        Check(obs.size() == nInline + 1, "size after spilling");
+
+        bool bOrdered = true;
+        int  i        = 0;
+        for (const ObservationList::value_type& ob : obs)
+        {
+            bOrdered = bOrdered && ob.first == FakeKeyFrame(i) &&
+                       get<0>(ob.second) == i && get<1>(ob.second) == i + 1;
+            ++i;
+        }
+        Check(bOrdered, "insertion order and values kept when spilling");
+
+        size_t          n1 = nAllocations;
+        ObservationList moved(move(obs));
+        Check(nAllocations == n1, "no allocation when moving a spilled list");
+        Check(obs.empty() && moved.size() == nInline + 1, "spilled move");
+        obs[FakeKeyFrame(0)] = make_tuple(0, 0);
+        Check(nAllocations == n1, "moved from list is inline again");
+
+        ObservationList copy(moved);
+        Check(copy.size() == moved.size() && copy.count(FakeKeyFrame(nInline)),
+              "copy of a spilled list");
+        Check(moved.erase(FakeKeyFrame(3)) == 1 &&
+                  !moved.count(FakeKeyFrame(3)),
+              "erase from a spilled list");
+        Check(moved.erase(FakeKeyFrame(3)) == 0, "erase of a missing entry");
+
+        size_t n2 = nAllocations;
+        moved.clear();
+        for (size_t i = 0; i <= nInline; ++i)
+            moved[FakeKeyFrame(i)] = make_tuple((int)i, -1);
+        Check(nAllocations == n2 && moved.size() == nInline + 1,
+              "a cleared list keeps its heap storage");
+    }
+
+    mt19937                         rng(0);
+    map<KeyFrame*, tuple<int, int>> ref;
+    ObservationList                 obs;
+    for (int t = 0; t < 100000; ++t)
+    {
+        KeyFrame* pKF = FakeKeyFrame(rng() % (3 * nInline));
+        switch (rng() % 4)
+        {
+            case 0:
+            case 1:
+                obs[pKF] = ref[pKF] = make_tuple((int)(rng() % 1000), -1);
+                break;
+            case 2:
+                Check(obs.erase(pKF) == ref.erase(pKF), "random erase");
+                break;
+            default:
+            {
+                ObservationList copy(obs);
+                obs = move(copy);
+                break;
+            }
+        }
+        if (!SameAs(obs, ref))
+        {
+            Check(false, "random operations");
+            break;
+        }
+    }
+
+    if (nErrors > 0) return 1;
+    cout << "ObservationList: all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <Feature/ORBkernels.h>
+
+using namespace std;
+using ORB_SLAM3::ORBkernels;
+
+// Same patch as the ORBextractor.
+const int HALF_PATCH_SIZE = 32;
+const int IMAGE_SIZE      = 2 * HALF_PATCH_SIZE + 64;
+
+static vector<int> BuildUmax()
+{
+    vector<int>  umax(HALF_PATCH_SIZE + 1);
+    int          v, v0;
+    int          vmax = (int)floor(HALF_PATCH_SIZE * sqrt(2.f) / 2 + 1);
+    int          vmin = (int)ceil(HALF_PATCH_SIZE * sqrt(2.f) / 2);
+    const double hp2  = HALF_PATCH_SIZE * HALF_PATCH_SIZE;
+    for (v = 0; v <= vmax; ++v) umax[v] = cvRound(sqrt(hp2 - v * v));
+    for (v = HALF_PATCH_SIZE, v0 = 0; v >= vmin; --v)
+    {
+        while (umax[v0] == umax[v0 + 1]) ++v0;
+        umax[v] = v0;
+        ++v0;
+    }
+    return umax;
+}
+
+// Runs every kernel of every level supported by the CPU on random images and
+// descriptors, and compares the results with the scalar code.
+int main(int argc, char* argv[])
+{
+    int nTrials = argc > 1 ? atoi(argv[1]) : 1000;
+    if (nTrials <= 0)
+    {
+        cerr << endl << "Usage: ./orb_kernels [number_of_trials]" << endl;
+        return 1;
+    }
+
+    const ORBkernels::Level top = ORBkernels::DetectLevel();
+    cout << "CPU level: " << ORBkernels::LevelName(top) << endl;
+
+    mt19937_64                         rng(0);
+    uniform_int_distribution<int>      pixel(0, 255);
+    uniform_int_distribution<int>      offset(-15, 15);
+    uniform_real_distribution<float>   angle(0.f, 6.2831853f);
+    uniform_int_distribution<int>      count(0, 100);
+    const vector<int>                  umax = BuildUmax();
+    vector<uchar>                      image(IMAGE_SIZE * IMAGE_SIZE);
+    vector<cv::Point>                  points(2 * ORBkernels::N_TESTS);
+    vector<ORBkernels::Descriptor>     descs(101);
+    vector<size_t>                     indices(101);
+    ORBkernels::Pattern                pattern;
+    const uchar* center =
+        &image[(IMAGE_SIZE / 2) * IMAGE_SIZE + IMAGE_SIZE / 2];
+
+    int nErrors = 0;
+    for (int t = 0; t < nTrials; ++t)
+    {
+        for (uchar& p : image) p = (uchar)pixel(rng);
+        for (cv::Point& pt : points)
+        {
+            pt.x = offset(rng);
+            pt.y = offset(rng);
+        }
+        ORBkernels::BuildPattern(points.data(), pattern);
+        for (ORBkernels::Descriptor& d : descs)
+            for (uint64_t& w : d.w) w = rng();
+        for (size_t& i : indices) i = rng() % descs.size();
+
+        const float theta = angle(rng);
+        const float a = cos(theta), b = sin(theta);
+        const int   n = count(rng);
+
+        int   m01, m10;
+        uchar desc[32];
+        int   dist[101], distContiguous[101];
+        ORBkernels::ICMoments(center,
+                              IMAGE_SIZE,
+                              &umax[0],
+                              HALF_PATCH_SIZE,
+                              ORBkernels::SCALAR,
+                              m01,
+                              m10);
+        ORBkernels::OrbDescriptor(
+            center, IMAGE_SIZE, a, b, pattern, ORBkernels::SCALAR, desc);
+        ORBkernels::Distances(descs[0],
+                              descs.data(),
+                              indices.data(),
+                              n,
+                              ORBkernels::SCALAR,
+                              dist);
+        ORBkernels::Distances(
+            descs[0], descs.data(), n, ORBkernels::SCALAR, distContiguous);
+
+        for (int l = ORBkernels::SSE42; l <= top; ++l)
+        {
+            const ORBkernels::Level level = (ORBkernels::Level)l;
+            const char*             name  = ORBkernels::LevelName(level);
+
+            int   m01L, m10L;
+            uchar descL[32];
+            int   distL[101], distContiguousL[101];
+            ORBkernels::ICMoments(center,
+                                  IMAGE_SIZE,
+                                  &umax[0],
+                                  HALF_PATCH_SIZE,
+                                  level,
+                                  m01L,
+                                  m10L);
+            ORBkernels::OrbDescriptor(
+                center, IMAGE_SIZE, a, b, pattern, level, descL);
+            ORBkernels::Distances(
+                descs[0], descs.data(), indices.data(), n, level, distL);
+            ORBkernels::Distances(
+                descs[0], descs.data(), n, level, distContiguousL);
+
+            if (m01L != m01 || m10L != m10)
+            {
+                cerr << name << " ICMoments differs at trial " << t << endl;
+                ++nErrors;
+            }
+            if (memcmp(descL, desc, sizeof(desc)) != 0)
+            {
+                cerr << name << " OrbDescriptor differs at trial " << t
+                     << endl;
+                ++nErrors;
+            }
+            for (int i = 0; i < n; ++i)
+            {
+                if (distL[i] != dist[i] ||
+                    dist[i] != ORBkernels::Distance(descs[0],
+                                                    descs[indices[i]]))
+                {
+                    cerr << name << " Distances differs at trial " << t
+                         << ", index " << i << endl;
+                    ++nErrors;
+                    break;
+                }
+                if (distContiguousL[i] != distContiguous[i] ||
+                    distContiguous[i] !=
+                        ORBkernels::Distance(descs[0], descs[i]))
+                {
+                    cerr << name << " contiguous Distances differs at trial "
+                         << t << ", index " << i << endl;
+                    ++nErrors;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (nErrors > 0)
+    {
+        cerr << nErrors << " mismatches in " << nTrials << " trials" << endl;
+        return 1;
+    }
+    cout << "All kernels match the scalar code in " << nTrials << " trials"
+         << endl;
+    return 0;
+}
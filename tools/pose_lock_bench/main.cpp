@@ -0,0 +1,239 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+#include <sophus/se3.hpp>
+
+#include <Utils/SeqLock.h>
+
+using namespace std;
+
+// Keyframe pose and map point position as they were stored before, read
+// under the mutex of the object.
+struct MutexStorage
+{
+    struct Pose
+    {
+        Sophus::SE3f Tcw, Twc;
+    };
+
+    MutexStorage(int nKFs, int nMPs)
+        : vKFs(nKFs)
+        , vMPs(nMPs)
+    {
+    }
+
+    struct KF
+    {
+        mutex m;
+        Pose  pose;
+    };
+    struct MP
+    {
+        mutex           m;
+        Eigen::Vector3f pos = Eigen::Vector3f::Zero();
+    };
+
+    Sophus::SE3f GetPose(int i)
+    {
+        unique_lock<mutex> lock(vKFs[i].m);
+        return vKFs[i].pose.Tcw;
+    }
+
+    Eigen::Vector3f GetWorldPos(int i)
+    {
+        unique_lock<mutex> lock(vMPs[i].m);
+        return vMPs[i].pos;
+    }
+
+    void SetPose(int i, const Sophus::SE3f& Tcw)
+    {
+        unique_lock<mutex> lock(vKFs[i].m);
+        vKFs[i].pose.Tcw = Tcw;
+        vKFs[i].pose.Twc = Tcw.inverse();
+    }
+
+    void SetWorldPos(int i, const Eigen::Vector3f& pos)
+    {
+        unique_lock<mutex> lock(vMPs[i].m);
+        vMPs[i].pos = pos;
+    }
+
+    vector<KF> vKFs;
+    vector<MP> vMPs;
+};
+
+// Same data behind a SeqLock, as KeyFrame and MapPoint keep it now: poses as
+// their SE3f::params() and positions as plain floats. Writers still take the
+// mutex of the object.
+struct SeqLockStorage
+{
+    struct Pose
+    {
+        float Tcw[7], Twc[7];
+    };
+
+    SeqLockStorage(int nKFs, int nMPs)
+        : vKFs(nKFs)
+        , vMPs(nMPs)
+    {
+    }
+
+    struct KF
+    {
+        mutex                    m;
+        ORB_SLAM3::SeqLock<Pose> pose{ ToPose(Sophus::SE3f()) };
+    };
+    struct MP
+    {
+        mutex                                    m;
+        ORB_SLAM3::SeqLock<std::array<float, 3>> pos;
+    };
+
+    static Pose ToPose(const Sophus::SE3f& Tcw)
+    {
+        Pose pose;
+        Eigen::Map<Eigen::Matrix<float, 7, 1>>(pose.Tcw) = Tcw.params();
+        Eigen::Map<Eigen::Matrix<float, 7, 1>>(pose.Twc) =
+            Tcw.inverse().params();
+        return pose;
+    }
+
+    Sophus::SE3f GetPose(int i)
+    {
+        const Pose pose = vKFs[i].pose.Load();
+        return Sophus::SE3f(Eigen::Map<const Sophus::SE3f>(pose.Tcw));
+    }
+
+    Eigen::Vector3f GetWorldPos(int i)
+    {
+        const std::array<float, 3> pos = vMPs[i].pos.Load();
+        return Eigen::Vector3f(pos[0], pos[1], pos[2]);
+    }
+
+    void SetPose(int i, const Sophus::SE3f& Tcw)
+    {
+        unique_lock<mutex> lock(vKFs[i].m);
+        vKFs[i].pose.Store(ToPose(Tcw));
+    }
+
+    void SetWorldPos(int i, const Eigen::Vector3f& pos)
+    {
+        unique_lock<mutex> lock(vMPs[i].m);
+        vMPs[i].pos.Store({ { pos.x(), pos.y(), pos.z() } });
+    }
+
+    vector<KF> vKFs;
+    vector<MP> vMPs;
+};
+
+// Tracking like readers project random map points with random keyframe
+// poses while a local BA like writer keeps updating a window of keyframes
+// and their points. Reports the reads and writes done per second.
+template <typename Storage>
+static void Run(const char* name, int nReaders, double seconds)
+{
+    const int nKFs = 200, nMPs = 20000;
+    const int nWindowKFs = 20, nWindowMPs = 2000;
+
+    Storage        storage(nKFs, nMPs);
+    atomic<bool>   bStop{ false };
+    atomic<long>   nReads{ 0 };
+    long           nWrites = 0;
+    vector<thread> vReaders;
+    atomic<float>  sink{ 0.f };
+
+    for (int r = 0; r < nReaders; r++)
+    {
+        vReaders.emplace_back(
+            [&, r]()
+            {
+                mt19937 rng(r);
+                long    n   = 0;
+                float   sum = 0.f;
+                while (!bStop.load(memory_order_relaxed))
+                {
+                    const Sophus::SE3f Tcw = storage.GetPose(rng() % nKFs);
+                    for (int k = 0; k < 64; k++)
+                    {
+                        const Eigen::Vector3f x3D =
+                            storage.GetWorldPos(rng() % nMPs);
+                        sum += (Tcw * x3D)(2);
+                    }
+                    n += 65;
+                }
+                nReads += n;
+                sink = sink + sum;
+            });
+    }
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    chrono::steady_clock::time_point t1 = t0;
+    mt19937                          rng(100);
+    while (chrono::duration<double>(t1 - t0).count() < seconds)
+    {
+        // One BA iteration written back on a window at the end of the map
+        const Sophus::SE3f dT = Sophus::SE3f::exp(
+            Sophus::Vector6f::Constant(1e-3f * (rng() % 10)));
+        for (int i = nKFs - nWindowKFs; i < nKFs; i++)
+            storage.SetPose(i, dT * storage.GetPose(i));
+        for (int i = nMPs - nWindowMPs; i < nMPs; i++)
+            storage.SetWorldPos(i, dT * storage.GetWorldPos(i));
+        nWrites += nWindowKFs + nWindowMPs;
+        t1 = chrono::steady_clock::now();
+    }
+    bStop = true;
+    for (thread& t : vReaders) t.join();
+
+    const double elapsed = chrono::duration<double>(t1 - t0).count();
+    cout << name << ": " << nReads / elapsed / 1e6 << " M reads/s, "
+         << nWrites / elapsed / 1e6 << " M writes/s" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    const int    nReaders = argc > 1 ? atoi(argv[1]) : 3;
+    const double seconds  = argc > 2 ? atof(argv[2]) : 2.0;
+    if (nReaders <= 0 || seconds <= 0)
+    {
+        cerr << endl
+             << "Usage: ./pose_lock_bench [number_of_readers] [seconds]"
+             << endl;
+        return 1;
+    }
+
+    cout << nReaders << " readers and 1 writer, "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+    Run<MutexStorage>("mutex  ", nReaders, seconds);
+    Run<SeqLockStorage>("seqlock", nReaders, seconds);
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * This file is part of ORB-SLAM3
+ *
+ * Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez
+ * Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+ * Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós,
+ * University of Zaragoza.
+ *
+ * ORB-SLAM3 is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ORB-SLAM3. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include <Feature/ORBVocabulary.h>
+#include <Utils/MappedFile.h>
+
+using namespace std;
+
+// Load time of vocabulary files through ORB_SLAM3::LoadORBVocabulary, the
+// path taken by System at start, text or binary as detected from the file.
+// The first load of each file reads it from disk unless it is already in the
+// page cache, the others give the parsing cost alone.
+int main(int argc, char* argv[])
+{
+    const int nRuns = argc > 2 ? atoi(argv[1]) : 0;
+    if (nRuns <= 0)
+    {
+        cerr << endl
+             << "Usage: ./vocabulary_bench number_of_runs path_to_vocabulary "
+                "[path_to_vocabulary ...]"
+             << endl;
+        return 1;
+    }
+
+    for (int f = 2; f < argc; f++)
+    {
+        ORB_SLAM3::MappedFile file;
+        if (!file.Open(argv[f]))
+        {
+            cerr << "Cannot open " << argv[f] << endl;
+            return 1;
+        }
+        const bool bBinary =
+            ORB_SLAM3::ORBVocabulary::isBinaryData(file.Data(), file.Size());
+        file.Close();
+
+        double tFirst = 0, tMin = 0, tSum = 0;
+        size_t nWords = 0;
+        for (int i = 0; i < nRuns; i++)
+        {
+            chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+            unique_ptr<ORB_SLAM3::ORBVocabulary> pVoc(
+                new ORB_SLAM3::ORBVocabulary());
+            if (!ORB_SLAM3::LoadORBVocabulary(pVoc.get(), argv[f]))
+            {
+                cerr << "Failed to load " << argv[f] << endl;
+                return 1;
+            }
+            chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+            // The destruction is left out of the time
+            nWords = pVoc->size();
+            pVoc.reset();
+
+            const double t = chrono::duration<double>(t1 - t0).count();
+            tFirst         = i == 0 ? t : tFirst;
+            tMin           = i == 0 ? t : min(tMin, t);
+            tSum += t;
+        }
+
+        cout << argv[f] << " (" << (bBinary ? "binary" : "text") << ", "
+             << nWords << " words)" << endl;
+        cout << "  first load: " << tFirst << " s" << endl;
+        cout << "  min: " << tMin << " s, mean: " << tSum / nRuns << " s over "
+             << nRuns << " runs" << endl;
+    }
+    return 0;
+}